@@ -0,0 +1,198 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - Benchmarks
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "bench.h"
+#include "tnlPlatform.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+namespace Bench
+{
+
+void Benchmark::addMetric(const char *name, F64 value)
+{
+   Metric m;
+   m.name = name;
+   m.value = value;
+   mMetrics.push_back(m);
+}
+
+Runner::Runner()
+{
+   mFilter = NULL;
+   mMinTime = DefaultMinTime;
+}
+
+static F64 timeBatch(Benchmark &benchmark, U32 count, bool &ok)
+{
+   S64 start = Platform::getHighPrecisionTimerValue();
+   ok = benchmark.run(count);
+   return Platform::getHighPrecisionMilliseconds(Platform::getHighPrecisionTimerValue() - start);
+}
+
+void Runner::run(Benchmark &benchmark)
+{
+   if(mFilter && !strstr(benchmark.getName(), mFilter))
+      return;
+
+   Result r;
+   strncpy(r.name, benchmark.getName(), sizeof(r.name) - 1);
+   r.name[sizeof(r.name) - 1] = 0;
+   r.failed = !benchmark.setup();
+   r.iterations = 0;
+   r.elapsedMs = 0;
+   r.bestNsPerOp = 0;
+
+   bool ok = !r.failed;
+
+   // grow the batch until it takes long enough to time; these batches
+   // double as the warm up and aren't counted.
+   U32 count = 1;
+   while(ok)
+   {
+      F64 ms = timeBatch(benchmark, count, ok);
+      if(!ok || ms >= MinBatchTime || count >= 0x10000000)
+         break;
+      if(ms < 1)
+         count *= 10;
+      else
+         count = U32(count * MinBatchTime * 1.5 / ms) + 1;
+   }
+
+   while(ok && r.elapsedMs < mMinTime)
+   {
+      F64 ms = timeBatch(benchmark, count, ok);
+      if(!ok)
+         break;
+      F64 nsPerOp = ms * 1000000.0 / count;
+      if(!r.iterations || nsPerOp < r.bestNsPerOp)
+         r.bestNsPerOp = nsPerOp;
+      r.iterations += count;
+      r.elapsedMs += ms;
+   }
+   r.failed = !ok;
+   benchmark.teardown();
+
+   r.metricCount = getMin(U32(benchmark.getMetricCount()), U32(MaxMetrics));
+   for(U32 i = 0; i < r.metricCount; i++)
+   {
+      r.metricNames[i] = benchmark.getMetricName(i);
+      r.metricValues[i] = benchmark.getMetricValue(i);
+   }
+
+   mResults.push_back(r);
+
+   if(r.failed)
+      fprintf(stderr, "%-36s FAILED\n", r.name);
+   else
+      fprintf(stderr, "%-36s %14.1f ns/op %12u ops\n", r.name, r.elapsedMs * 1000000.0 / r.iterations, r.iterations);
+}
+
+bool Runner::writeResults(FILE *file)
+{
+   bool allPassed = true;
+
+   fprintf(file, "{\n");
+   fprintf(file, "  \"library\": \"TNL\",\n");
+   fprintf(file, "  \"os\": \"%s\",\n", TNL_OS_STRING);
+   fprintf(file, "  \"cpu\": \"%s\",\n", TNL_CPU_STRING);
+   fprintf(file, "  \"compiler\": \"%s\",\n", TNL_COMPILER_STRING);
+#ifdef TNL_DEBUG
+   fprintf(file, "  \"debug\": true,\n");
+#else
+   fprintf(file, "  \"debug\": false,\n");
+#endif
+   fprintf(file, "  \"min_time_ms\": %u,\n", mMinTime);
+   fprintf(file, "  \"results\": [");
+   for(S32 i = 0; i < mResults.size(); i++)
+   {
+      Result &r = mResults[i];
+      fprintf(file, "%s\n    {\"name\": \"%s\", ", i ? "," : "", r.name);
+      if(r.failed)
+      {
+         allPassed = false;
+         fprintf(file, "\"failed\": true}");
+         continue;
+      }
+      F64 nsPerOp = r.elapsedMs * 1000000.0 / r.iterations;
+      fprintf(file, "\"iterations\": %u, \"elapsed_ms\": %.3f, \"ns_per_op\": %.3f, \"best_ns_per_op\": %.3f, \"ops_per_sec\": %.1f",
+         r.iterations, r.elapsedMs, nsPerOp, r.bestNsPerOp, nsPerOp > 0 ? 1000000000.0 / nsPerOp : 0.0);
+      if(r.metricCount)
+      {
+         fprintf(file, ", \"metrics\": {");
+         for(U32 j = 0; j < r.metricCount; j++)
+            fprintf(file, "%s\"%s\": %.3f", j ? ", " : "", r.metricNames[j], r.metricValues[j]);
+         fprintf(file, "}");
+      }
+      fprintf(file, "}");
+   }
+   fprintf(file, "\n  ]\n}\n");
+   return allPassed;
+}
+
+};
+
+using namespace Bench;
+
+int main(int argc, const char **argv)
+{
+   Runner runner;
+   const char *outputFile = NULL;
+
+   for(S32 i = 1; i < argc; i++)
+   {
+      if(!strcmp(argv[i], "-o") && i + 1 < argc)
+         outputFile = argv[++i];
+      else if(!strcmp(argv[i], "-time") && i + 1 < argc)
+         runner.setMinTime(atoi(argv[++i]));
+      else if(argv[i][0] != '-')
+         runner.setFilter(argv[i]);
+      else
+      {
+         printf("Usage: tnlbench [-o results.json] [-time minMilliseconds] [nameFilter]\n");
+         return 1;
+      }
+   }
+
+   runTNLBenchmarks(runner);
+   runZapBenchmarks(runner);
+
+   FILE *file = stdout;
+   if(outputFile)
+   {
+      file = fopen(outputFile, "w");
+      if(!file)
+      {
+         printf("Unable to open %s\n", outputFile);
+         return 1;
+      }
+   }
+   bool passed = runner.writeResults(file);
+   if(file != stdout)
+      fclose(file);
+   return passed ? 0 : 1;
+}
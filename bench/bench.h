@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - Benchmarks
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "tnlTypes.h"
+#include "tnlAssert.h"
+#include "tnlVector.h"
+
+#include <stdio.h>
+
+using namespace TNL;
+
+namespace Bench
+{
+
+/// Benchmark is the base class for a single timed case.
+///
+/// The runner calls setup() once, then run() with growing counts until a
+/// batch takes long enough to time, then with that count until the case
+/// has run for the minimum time.  run() should do count operations of
+/// whatever the case measures, so the results come out per operation.
+class Benchmark
+{
+   struct Metric
+   {
+      const char *name;
+      F64 value;
+   };
+   Vector<Metric> mMetrics;
+public:
+   virtual ~Benchmark() {}
+
+   /// Returns the name the case is reported under, like "bitstream.write".
+   virtual const char *getName() = 0;
+
+   /// Builds whatever state the case needs; returns false if the case
+   /// can't run.
+   virtual bool setup() { return true; }
+
+   /// Performs count operations.  Returns false if the case failed.
+   virtual bool run(U32 count) = 0;
+
+   /// Called after the last run to add metrics and free state.
+   virtual void teardown() {}
+
+   /// Adds a named value to the case's results, like the bytes written per
+   /// operation.  The name must be a string literal.
+   void addMetric(const char *name, F64 value);
+
+   S32 getMetricCount() { return mMetrics.size(); }
+   const char *getMetricName(S32 index) { return mMetrics[index].name; }
+   F64 getMetricValue(S32 index) { return mMetrics[index].value; }
+};
+
+/// Runner times benchmarks and writes the results out as JSON.
+class Runner
+{
+public:
+   enum {
+      DefaultMinTime = 200,   ///< Default milliseconds each case runs for.
+      MinBatchTime = 10,      ///< Milliseconds a batch must take to be timed.
+      MaxMetrics = 8,         ///< Most metrics kept for a case.
+   };
+private:
+   struct Result
+   {
+      char name[64];
+      bool failed;
+      U32 iterations;
+      F64 elapsedMs;
+      F64 bestNsPerOp;      ///< Per operation time of the fastest batch.
+      U32 metricCount;
+      const char *metricNames[MaxMetrics];
+      F64 metricValues[MaxMetrics];
+   };
+   Vector<Result> mResults;
+   const char *mFilter;
+   U32 mMinTime;
+public:
+   Runner();
+
+   /// Only runs cases whose names contain filter.
+   void setFilter(const char *filter) { mFilter = filter; }
+
+   /// Sets the milliseconds each case runs for.
+   void setMinTime(U32 minTime) { mMinTime = minTime; }
+
+   /// Times a benchmark and records its result.
+   void run(Benchmark &benchmark);
+
+   /// Writes all the results recorded so far as a JSON document.  Returns
+   /// true if every case ran.
+   bool writeResults(FILE *file);
+};
+
+/// Runs the TNL library benchmarks.
+extern void runTNLBenchmarks(Runner &runner);
+
+/// Runs the ZAP simulation benchmarks.
+extern void runZapBenchmarks(Runner &runner);
+
+};
+
+#endif
@@ -0,0 +1,1507 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - Benchmarks
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "bench.h"
+
+#include "tnl.h"
+#include "tnlBitStream.h"
+#include "tnlNetInterface.h"
+#include "tnlGhostConnection.h"
+#include "tnlNetObject.h"
+#include "tnlNetStringTable.h"
+#include "tnlRPC.h"
+#include "tnlPlatform.h"
+#include "tnlThread.h"
+#include "tnlVirtualNetwork.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+
+// Every heap allocation in the process is counted, so cases can check that
+// a path they time doesn't allocate.
+static U32 gAllocations = 0;
+
+void *operator new(size_t size)
+{
+   gAllocations++;
+   void *ptr = malloc(size ? size : 1);
+   if(!ptr)
+      throw std::bad_alloc();
+   return ptr;
+}
+
+void *operator new[](size_t size)
+{
+   return operator new(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+   free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+   free(ptr);
+}
+
+namespace Bench
+{
+
+// The benchmarks generate their data from a fixed seed, rather than the
+// TNL random generator, so every run works on the same data.
+static U32 gSeed = 1;
+
+static U32 nextRandom()
+{
+   gSeed = gSeed * 1664525 + 1013904223;
+   return gSeed >> 8;
+}
+
+static F32 nextUnit()
+{
+   return (nextRandom() & 0xFFFF) / 65535.0f;
+}
+
+static const char *gSampleStrings[] = {
+   "Hello everyone",
+   "gg",
+   "Defend the flag!",
+   "I need a repair over here",
+   "ZAP Game",
+   "Player 12",
+   "Capture the Flag",
+   "incoming enemy ship on the left side of the base",
+   "Wait for me at the teleporter",
+   "lol",
+   "Anyone up for another round after this one?",
+   "Retrieve",
+};
+
+enum {
+   SampleStringCount = sizeof(gSampleStrings) / sizeof(gSampleStrings[0]),
+};
+
+/// Chat lines, the longest strings a game connection sends.
+static const char *gChatStrings[] = {
+   "Hello everyone",
+   "gg",
+   "Defend the flag!",
+   "I need a repair over here",
+   "incoming enemy ship on the left side of the base",
+   "Wait for me at the teleporter",
+   "lol",
+   "Anyone up for another round after this one?",
+   "they have our flag, somebody cover me while I go get it back",
+   "nice shot!",
+   "Red team is camping the nexus again",
+   "brb",
+   "Who has the soccer ball?",
+   "Stop shooting the turrets and go for the flag",
+   "ok",
+   "I'll take the top route, you go around the bottom",
+};
+
+/// Player names, short and full of capitals, digits and punctuation.
+static const char *gPlayerNames[] = {
+   "Player 12",
+   "xXSniperXx",
+   "ZapMaster",
+   "Bob",
+   "[GG]Raptor",
+   "n00b_slayer99",
+   "Captain Vector",
+   "Kat",
+   "DeathFromAbove",
+   "Player 7",
+   "Mr. Fusion",
+   "ACE",
+   "zz_top",
+   "Lt.Dan",
+   "Qwerty123",
+   "The_Flag_Guy",
+};
+
+/// Pumps a set of interfaces for at most timeout milliseconds, until done
+/// returns true.
+template <class T> static bool pumpUntil(NetInterface **interfaces, S32 count, T done, U32 timeout = 5000)
+{
+   U32 start = Platform::getRealMilliseconds();
+   while(!done())
+   {
+      if(Platform::getRealMilliseconds() - start > timeout)
+         return false;
+      for(S32 i = 0; i < count; i++)
+      {
+         interfaces[i]->checkIncomingPackets();
+         interfaces[i]->processConnections();
+      }
+      Platform::sleep(1);
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// BitStream
+
+/// The kind of fields a game object update writes.
+struct SampleUpdate
+{
+   bool flag;
+   U32 index;
+   U32 ranged;
+   F32 unit;
+   F32 signedUnit;
+   S32 delta;
+   U32 word;
+
+   void randomize()
+   {
+      flag = (nextRandom() & 1) != 0;
+      index = nextRandom() & 0x3FF;
+      ranged = nextRandom() % 1001;
+      unit = nextUnit();
+      signedUnit = nextUnit() * 2 - 1;
+      delta = S32(nextRandom() & 0xFFFF) - 0x8000;
+      word = nextRandom();
+   }
+   void write(BitStream *s)
+   {
+      s->writeFlag(flag);
+      s->writeInt(index, 10);
+      s->writeRangedU32(ranged, 0, 1000);
+      s->writeFloat(unit, 8);
+      s->writeSignedFloat(signedUnit, 12);
+      s->writeSignedInt(delta, 17);
+      s->write(word);
+   }
+   void read(BitStream *s)
+   {
+      flag = s->readFlag();
+      index = s->readInt(10);
+      ranged = s->readRangedU32(0, 1000);
+      unit = s->readFloat(8);
+      signedUnit = s->readSignedFloat(12);
+      delta = s->readSignedInt(17);
+      s->read(&word);
+   }
+};
+
+class BitStreamBenchmark : public Benchmark
+{
+protected:
+   enum {
+      UpdateCount = 64,
+      BufferSize = 4096,
+   };
+   SampleUpdate mUpdates[UpdateCount];
+   U8 mBuffer[BufferSize];
+   BitStream mStream;
+   F64 mBitsPerUpdate;
+   U32 mSink;
+public:
+   BitStreamBenchmark() : mStream(mBuffer, BufferSize) {}
+   bool setup()
+   {
+      for(U32 i = 0; i < UpdateCount; i++)
+         mUpdates[i].randomize();
+      mStream.setBitPosition(0);
+      for(U32 i = 0; i < UpdateCount; i++)
+         mUpdates[i].write(&mStream);
+      mBitsPerUpdate = F64(mStream.getBitPosition()) / UpdateCount;
+      mSink = 0;
+      return mStream.isValid();
+   }
+   void teardown()
+   {
+      addMetric("bits_per_op", mBitsPerUpdate);
+   }
+};
+
+class BitStreamWriteBenchmark : public BitStreamBenchmark
+{
+public:
+   const char *getName() { return "bitstream.write"; }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         U32 index = i & (UpdateCount - 1);
+         if(!index)
+            mStream.setBitPosition(0);
+         mUpdates[index].write(&mStream);
+      }
+      return mStream.isValid();
+   }
+};
+
+class BitStreamReadBenchmark : public BitStreamBenchmark
+{
+public:
+   const char *getName() { return "bitstream.read"; }
+   bool run(U32 count)
+   {
+      SampleUpdate update;
+      for(U32 i = 0; i < count; i++)
+      {
+         if(!(i & (UpdateCount - 1)))
+            mStream.setBitPosition(0);
+         update.read(&mStream);
+         mSink += update.word;
+      }
+      return mStream.isValid();
+   }
+};
+
+//------------------------------------------------------------------------------
+// Huffman strings
+
+/// Huffman codes a set of strings.  The default set is the mixed sample
+/// strings; chat lines and player names are run as separate sets too,
+/// since they code quite differently.
+class HuffmanBenchmark : public Benchmark
+{
+protected:
+   enum {
+      BufferSize = 4096,
+   };
+   U8 mBuffer[BufferSize];
+   BitStream mStream;
+   F64 mBitsPerChar;
+   const char **mStrings;
+   U32 mStringCount;
+   char mName[40];
+public:
+   HuffmanBenchmark(const char *operation, const char *setName, const char **strings, U32 stringCount)
+      : mStream(mBuffer, BufferSize)
+   {
+      mStrings = strings;
+      mStringCount = stringCount;
+      if(setName)
+         dSprintf(mName, sizeof(mName), "huffman.%s.%s", operation, setName);
+      else
+         dSprintf(mName, sizeof(mName), "huffman.%s", operation);
+   }
+   const char *getName() { return mName; }
+   bool setup()
+   {
+      U32 chars = 0;
+      mStream.setBitPosition(0);
+      for(U32 i = 0; i < mStringCount; i++)
+      {
+         mStream.writeString(mStrings[i]);
+         chars += strlen(mStrings[i]);
+      }
+      mBitsPerChar = F64(mStream.getBitPosition()) / chars;
+      return mStream.isValid();
+   }
+   void teardown()
+   {
+      addMetric("bits_per_char", mBitsPerChar);
+   }
+};
+
+class HuffmanWriteBenchmark : public HuffmanBenchmark
+{
+public:
+   HuffmanWriteBenchmark(const char *setName = NULL, const char **strings = gSampleStrings, U32 stringCount = SampleStringCount)
+      : HuffmanBenchmark("write", setName, strings, stringCount) {}
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         U32 index = i % mStringCount;
+         if(!index)
+            mStream.setBitPosition(0);
+         mStream.writeString(mStrings[index]);
+      }
+      return mStream.isValid();
+   }
+};
+
+class HuffmanReadBenchmark : public HuffmanBenchmark
+{
+   U32 mSink;
+public:
+   HuffmanReadBenchmark(const char *setName = NULL, const char **strings = gSampleStrings, U32 stringCount = SampleStringCount)
+      : HuffmanBenchmark("read", setName, strings, stringCount) {}
+   bool run(U32 count)
+   {
+      char buffer[256];
+      mSink = 0;
+      for(U32 i = 0; i < count; i++)
+      {
+         if(!(i % mStringCount))
+            mStream.setBitPosition(0);
+         mStream.readString(buffer);
+         mSink += buffer[0];
+      }
+      return mStream.isValid();
+   }
+};
+
+//------------------------------------------------------------------------------
+// RPC
+
+static U32 gEventsReceived = 0;
+
+class BenchEventConnection : public EventConnection
+{
+public:
+   TNL_DECLARE_RPC(rpcSample, (U32 id, RangedU32<0, 1000> value, Float<12> fraction, StringPtr message));
+   TNL_DECLARE_RPC(rpcCount, (U32 id));
+   TNL_DECLARE_NETCONNECTION(BenchEventConnection);
+
+   /// Acks everything received so far, for a receiver with nothing of its
+   /// own to send.
+   void ack() { sendAckPacket(); }
+
+   /// Pings the remote host, so a sender learns the fate of its last
+   /// packets without sending more data.
+   void ping() { sendPingPacket(); }
+};
+
+TNL_IMPLEMENT_NETCONNECTION(BenchEventConnection, NetClassGroupGame, true);
+
+TNL_IMPLEMENT_RPC(BenchEventConnection, rpcSample, (U32 id, RangedU32<0, 1000> value, Float<12> fraction, StringPtr message), (id, value, fraction, message),
+   NetClassGroupGameMask, RPCGuaranteedOrdered, RPCDirAny, 0)
+{
+   gEventsReceived += id;
+}
+
+TNL_IMPLEMENT_RPC(BenchEventConnection, rpcCount, (U32 id), (id),
+   NetClassGroupGameMask, RPCGuaranteedOrdered, RPCDirAny, 0)
+{
+   gEventsReceived++;
+}
+
+class RPCMarshalBenchmark : public Benchmark
+{
+   RefPtr<BenchEventConnection> mConnection;
+   PacketStream mStream;
+public:
+   const char *getName() { return "rpc.marshal"; }
+   bool setup()
+   {
+      mConnection = new BenchEventConnection;
+      return true;
+   }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         RefPtr<NetEvent> event = mConnection->rpcSample_construct(i, i % 1001, 0.5f, gSampleStrings[i % SampleStringCount]);
+         mStream.setBitPosition(0);
+         event->pack(mConnection, &mStream);
+      }
+      return mStream.isValid();
+   }
+   void teardown()
+   {
+      RefPtr<NetEvent> event = mConnection->rpcSample_construct(1, 500, 0.5f, gSampleStrings[0]);
+      mStream.setBitPosition(0);
+      event->pack(mConnection, &mStream);
+      addMetric("bits_per_op", mStream.getBitPosition());
+      mConnection = NULL;
+   }
+};
+
+class RPCDispatchBenchmark : public Benchmark
+{
+   RefPtr<BenchEventConnection> mConnection;
+   RefPtr<NetEvent> mEvent;
+   PacketStream mStream;
+public:
+   const char *getName() { return "rpc.dispatch"; }
+   bool setup()
+   {
+      mConnection = new BenchEventConnection;
+      mEvent = mConnection->rpcSample_construct(1, 500, 0.5f, gSampleStrings[0]);
+      mEvent->pack(mConnection, &mStream);
+      return mStream.isValid();
+   }
+   bool run(U32 count)
+   {
+      U32 start = gEventsReceived;
+      for(U32 i = 0; i < count; i++)
+      {
+         mStream.setBitPosition(0);
+         mEvent->unpack(mConnection, &mStream);
+         mEvent->process(mConnection);
+      }
+      return gEventsReceived - start == count;
+   }
+   void teardown()
+   {
+      mEvent = NULL;
+      mConnection = NULL;
+   }
+};
+
+//------------------------------------------------------------------------------
+// EventConnection queueing under loss
+
+/// Sends guaranteed ordered events over a local connection that drops
+/// packets in both directions.  Packets are sent as fast as the window
+/// allows, so this times the event queues and the resends, not the rate
+/// limits.  One operation is one event delivered.
+class EventLossBenchmark : public Benchmark
+{
+   NetInterface *mClientInterface;
+   NetInterface *mServerInterface;
+   RefPtr<BenchEventConnection> mClient;
+   SafePtr<BenchEventConnection> mServer;
+   F32 mLoss;
+   U32 mPackets;
+   U32 mEvents;
+   char mName[32];
+public:
+   EventLossBenchmark(F32 loss)
+   {
+      mLoss = loss;
+      dSprintf(mName, sizeof(mName), "eventconnection.loss%d", S32(loss * 100 + 0.5f));
+   }
+   const char *getName() { return mName; }
+   bool setup()
+   {
+      mClientInterface = new NetInterface(Address("IP:127.0.0.1:0"));
+      mServerInterface = new NetInterface(Address("IP:127.0.0.1:0"));
+      mClient = new BenchEventConnection;
+      if(!mClient->connectLocal(mClientInterface, mServerInterface))
+         return false;
+      mServer = static_cast<BenchEventConnection *>(mClient->getRemoteConnectionObject());
+      mClient->setSimulatedNetParams(mLoss, 0);
+      mServer->setSimulatedNetParams(mLoss, 0);
+      mPackets = 0;
+      mEvents = 0;
+      return true;
+   }
+   bool run(U32 count)
+   {
+      U32 target = gEventsReceived + count;
+      for(U32 i = 0; i < count; i++)
+         mClient->rpcCount(i);
+
+      U32 start = Platform::getRealMilliseconds();
+      U32 firstSequence = mClient->getLastSendSequence();
+      while(gEventsReceived != target)
+      {
+         U32 time = Platform::getRealMilliseconds();
+         if(time - start > 10000 || !mServer.isValid())
+            return false;
+
+         U32 lastSequence = mClient->getLastSendSequence();
+         mClient->checkPacketSend(true, time);
+         if(lastSequence == mClient->getLastSendSequence())
+            mClient->ping();
+         mServerInterface->checkIncomingPackets();
+         mServer->ack();
+         mClientInterface->checkIncomingPackets();
+      }
+      mPackets += mClient->getLastSendSequence() - firstSequence;
+      mEvents += count;
+      return true;
+   }
+   void teardown()
+   {
+      if(mEvents)
+         addMetric("packets_per_event", F64(mPackets) / mEvents);
+      mClient = NULL;
+      delete mClientInterface;
+      delete mServerInterface;
+   }
+};
+
+//------------------------------------------------------------------------------
+// Rate control under competing load
+
+/// The rate modes a RateLatencyBenchmark can put its connections in.
+enum RateMode
+{
+   RateFixed,
+   RateAdaptive,
+   RatePaced,
+};
+
+static const char *gRateModeNames[] = { "fixed", "adaptive", "paced" };
+
+static RateMode gRateMode = RateFixed;
+static Vector<U32> gStampLatencies;
+static U32 gBulkBytes = 0;
+static U32 gBulkEventsReceived = 0;
+
+class BenchRateConnection : public EventConnection
+{
+   typedef EventConnection Parent;
+public:
+   enum {
+      MaxRate = 20000,   ///< Bytes per second the fixed and paced modes are capped at.
+   };
+
+   /// The paced protocol is requested when connecting, so the rate mode is
+   /// set up front rather than once the connection is established.
+   BenchRateConnection()
+   {
+      if(gRateMode == RateAdaptive)
+         setIsAdaptive();
+      else if(gRateMode == RatePaced)
+         setPacedRateParameters(50, 50, MaxRate, MaxRate);
+      else
+         setFixedRateParameters(50, 50, MaxRate, MaxRate);
+   }
+
+   void writeConnectRequest(BitStream *stream)
+   {
+      Parent::writeConnectRequest(stream);
+      writePacedRequest(stream);
+   }
+   bool readConnectRequest(BitStream *stream, const char **errorString)
+   {
+      if(!Parent::readConnectRequest(stream, errorString))
+         return false;
+      readPacedRequest(stream);
+      return true;
+   }
+   void writeConnectAccept(BitStream *stream)
+   {
+      Parent::writeConnectAccept(stream);
+      writePacedRequest(stream);
+   }
+   bool readConnectAccept(BitStream *stream, const char **errorString)
+   {
+      if(!Parent::readConnectAccept(stream, errorString))
+         return false;
+      readPacedRequest(stream);
+      return true;
+   }
+
+   /// Like a game connection, there's always something to send, so the
+   /// receiving side acks in its own packets rather than only in pings.
+   bool isDataToTransmit() { return true; }
+
+   TNL_DECLARE_RPC(rpcStamp, (U32 sendTime));
+   TNL_DECLARE_RPC(rpcBulk, (ByteBufferPtr data));
+   TNL_DECLARE_NETCONNECTION(BenchRateConnection);
+};
+
+TNL_IMPLEMENT_NETCONNECTION(BenchRateConnection, NetClassGroupGame, true);
+
+TNL_IMPLEMENT_RPC(BenchRateConnection, rpcStamp, (U32 sendTime), (sendTime),
+   NetClassGroupGameMask, RPCGuaranteedOrdered, RPCDirAny, 0)
+{
+   gStampLatencies.push_back(getInterface()->getCurrentTime() - sendTime);
+}
+
+TNL_IMPLEMENT_RPC(BenchRateConnection, rpcBulk, (ByteBufferPtr data), (data),
+   NetClassGroupGameMask, RPCGuaranteedOrdered, RPCDirAny, 0)
+{
+   gBulkBytes += data->getBufferSize();
+   gBulkEventsReceived++;
+}
+
+static S32 QSORT_CALLBACK compareLatencies(const void *a, const void *b)
+{
+   return S32(*((U32 *) a)) - S32(*((U32 *) b));
+}
+
+/// Runs two clients into a server on a virtual network, over a link that
+/// both clients' traffic queues for: 16000 bytes per second with a one
+/// second buffer and 20 ms each way.  The game client sends a timestamped
+/// event every 50 ms while the bulk client always has data queued, both
+/// in the rate mode under test.  The results are the game events' latency
+/// and the bulk client's throughput.  One operation is 10 ms of virtual
+/// time.
+class RateLatencyBenchmark : public Benchmark
+{
+   enum {
+      LinkLatency = 20,
+      LinkBandwidth = 16000,
+      LinkQueueDelay = 1000,
+      TickTime = 10,
+      StampInterval = 50,
+      BulkEventSize = 200,
+      BulkBacklog = 128,      ///< Bulk events kept posted ahead of the server, several times what the link holds.
+      WarmupTime = 10000,     ///< Virtual milliseconds run before measuring.
+   };
+   RateMode mMode;
+   VirtualNetwork *mNetwork;
+   NetInterface *mInterfaces[3];   ///< The server, then the game and bulk clients.
+   RefPtr<BenchRateConnection> mGame;
+   RefPtr<BenchRateConnection> mBulk;
+   U8 mBulkData[BulkEventSize];
+   U32 mBulkEventsSent;
+   U32 mLastStampTime;
+   U32 mMeasureStart;
+   char mName[32];
+
+   void tick()
+   {
+      mNetwork->advanceTime(TickTime);
+      U32 time = mNetwork->getCurrentTime();
+      if(mGame->isEstablished() && time - mLastStampTime >= StampInterval)
+      {
+         mGame->rpcStamp(time);
+         mLastStampTime = time;
+      }
+      if(mBulk->isEstablished())
+      {
+         while(mBulkEventsSent - gBulkEventsReceived < BulkBacklog)
+         {
+            mBulk->rpcBulk(new ByteBuffer(mBulkData, BulkEventSize));
+            mBulkEventsSent++;
+         }
+      }
+      for(S32 i = 0; i < 3; i++)
+      {
+         mInterfaces[i]->checkIncomingPackets();
+         mInterfaces[i]->processConnections();
+      }
+   }
+public:
+   RateLatencyBenchmark(RateMode mode)
+   {
+      mMode = mode;
+      dSprintf(mName, sizeof(mName), "rate.latency.%s", gRateModeNames[mode]);
+   }
+   const char *getName() { return mName; }
+   bool setup()
+   {
+      gRateMode = mMode;
+      mNetwork = new VirtualNetwork(1);
+      mNetwork->install();
+      VirtualNetwork::LinkParams link;
+      link.latency = LinkLatency;
+      mNetwork->setDefaultLink(link);
+
+      for(S32 i = 0; i < 3; i++)
+         mInterfaces[i] = new NetInterface(Address("IP:127.0.0.1:0"));
+      Address serverAddress = mInterfaces[0]->getSocket().getBoundAddress();
+
+      link.bandwidth = LinkBandwidth;
+      link.maxQueueDelay = LinkQueueDelay;
+      link.sharedQueue = true;
+      mNetwork->setLink(Address(IPProtocol, Address::Any, 0), serverAddress, link);
+
+      for(U32 i = 0; i < BulkEventSize; i++)
+         mBulkData[i] = U8(nextRandom());
+      mBulkEventsSent = 0;
+      gBulkEventsReceived = 0;
+      mLastStampTime = mNetwork->getCurrentTime();
+
+      mGame = new BenchRateConnection;
+      mGame->connect(mInterfaces[1], serverAddress);
+      mBulk = new BenchRateConnection;
+      mBulk->connect(mInterfaces[2], serverAddress);
+
+      U32 start = mNetwork->getCurrentTime();
+      while(mNetwork->getCurrentTime() - start < WarmupTime)
+         tick();
+      if(!mGame->isEstablished() || !mBulk->isEstablished())
+         return false;
+
+      gStampLatencies.clear();
+      gBulkBytes = 0;
+      mMeasureStart = mNetwork->getCurrentTime();
+      return true;
+   }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+         tick();
+      return mGame->isEstablished() && mBulk->isEstablished();
+   }
+   void teardown()
+   {
+      U32 elapsed = mNetwork->getCurrentTime() - mMeasureStart;
+      if(gStampLatencies.size())
+      {
+         F64 total = 0;
+         for(S32 i = 0; i < gStampLatencies.size(); i++)
+            total += gStampLatencies[i];
+         qsort(gStampLatencies.address(), gStampLatencies.size(), sizeof(U32), compareLatencies);
+         addMetric("latency_mean_ms", total / gStampLatencies.size());
+         addMetric("latency_p95_ms", gStampLatencies[gStampLatencies.size() * 95 / 100]);
+      }
+      if(elapsed)
+         addMetric("bulk_bytes_per_sec", gBulkBytes * 1000.0 / elapsed);
+
+      mGame = NULL;
+      mBulk = NULL;
+      for(S32 i = 0; i < 3; i++)
+         delete mInterfaces[i];
+      delete mNetwork;
+      gStampLatencies.clear();
+   }
+};
+
+//------------------------------------------------------------------------------
+// VirtualNetwork determinism
+
+/// Runs the same lossy, jittery session on a virtual network twice from
+/// the same seeds and checks that both runs come out the same, counter for
+/// counter.  A game client and a bulk client send to a server in the paced
+/// mode, which has the most timing dependent state.  One operation is the
+/// pair of runs.
+class VirtualNetworkDeterminismBenchmark : public Benchmark
+{
+   enum {
+      Seed = 7,
+      RunTime = 5000,   ///< Virtual milliseconds each run lasts.
+      TickTime = 10,
+      BulkEventSize = 200,
+      BulkBacklog = 32,
+   };
+
+   /// What a run did.  Only U32s, so two can be compared with memcmp.
+   /// Sequence numbers start from a random number, so only their counts
+   /// are compared.
+   struct Counters
+   {
+      U32 packetsSent;
+      U32 packetsDelivered;
+      U32 packetsLost;
+      U32 packetsQueueDropped;
+      U32 bytesDelivered;
+      U32 stampsReceived;
+      U32 stampLatencyTotal;
+      U32 bulkBytes;
+      U32 dataPacketsSent[2];
+   };
+   U8 mBulkData[BulkEventSize];
+   U32 mPackets;
+
+   bool runOnce(Counters &counters)
+   {
+      FastRandom::get().setSeed(Seed);
+      gRateMode = RatePaced;
+      gStampLatencies.clear();
+      gBulkBytes = 0;
+      gBulkEventsReceived = 0;
+
+      VirtualNetwork network(Seed);
+      network.install();
+      VirtualNetwork::LinkParams link;
+      link.latency = 30;
+      link.jitter = 20;
+      link.packetLoss = 0.05f;
+      link.reorder = 0.05f;
+      link.bandwidth = 16000;
+      network.setDefaultLink(link);
+
+      NetInterface *interfaces[3];
+      for(S32 i = 0; i < 3; i++)
+         interfaces[i] = new NetInterface(Address("IP:127.0.0.1:0"));
+      Address serverAddress = interfaces[0]->getSocket().getBoundAddress();
+
+      RefPtr<BenchRateConnection> clients[2];
+      for(S32 i = 0; i < 2; i++)
+      {
+         clients[i] = new BenchRateConnection;
+         clients[i]->connect(interfaces[i + 1], serverAddress);
+      }
+
+      U32 bulkEventsSent = 0;
+      U32 start = network.getCurrentTime();
+      while(network.getCurrentTime() - start < RunTime)
+      {
+         network.advanceTime(TickTime);
+         if(clients[0]->isEstablished())
+            clients[0]->rpcStamp(network.getCurrentTime());
+         if(clients[1]->isEstablished())
+         {
+            for(; bulkEventsSent - gBulkEventsReceived < BulkBacklog; bulkEventsSent++)
+               clients[1]->rpcBulk(new ByteBuffer(mBulkData, BulkEventSize));
+         }
+         for(S32 i = 0; i < 3; i++)
+         {
+            interfaces[i]->checkIncomingPackets();
+            interfaces[i]->processConnections();
+         }
+      }
+
+      bool established = clients[0]->isEstablished() && clients[1]->isEstablished();
+      const VirtualNetwork::Stats &stats = network.getStats();
+      memset(&counters, 0, sizeof(counters));
+      counters.packetsSent = stats.packetsSent;
+      counters.packetsDelivered = stats.packetsDelivered;
+      counters.packetsLost = stats.packetsLost;
+      counters.packetsQueueDropped = stats.packetsQueueDropped;
+      counters.bytesDelivered = stats.bytesDelivered;
+      counters.stampsReceived = gStampLatencies.size();
+      for(S32 i = 0; i < gStampLatencies.size(); i++)
+         counters.stampLatencyTotal += gStampLatencies[i];
+      counters.bulkBytes = gBulkBytes;
+      for(S32 i = 0; i < 2; i++)
+         counters.dataPacketsSent[i] = clients[i]->getLastSendSequence() - clients[i]->getInitialSendSequence();
+
+      for(S32 i = 0; i < 2; i++)
+         clients[i] = NULL;
+      for(S32 i = 0; i < 3; i++)
+         delete interfaces[i];
+      VirtualNetwork::uninstall();
+      gStampLatencies.clear();
+      return established;
+   }
+public:
+   const char *getName() { return "virtualnet.determinism"; }
+   bool setup()
+   {
+      for(U32 i = 0; i < BulkEventSize; i++)
+         mBulkData[i] = U8(nextRandom());
+      mPackets = 0;
+      return true;
+   }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         Counters first, second;
+         if(!runOnce(first) || !runOnce(second))
+            return false;
+         if(memcmp(&first, &second, sizeof(Counters)))
+         {
+            fprintf(stderr, "%s: runs differ, %u/%u packets sent, %u/%u delivered, %u/%u stamps, %u/%u bulk bytes\n",
+               getName(), first.packetsSent, second.packetsSent, first.packetsDelivered, second.packetsDelivered,
+               first.stampsReceived, second.stampsReceived, first.bulkBytes, second.bulkBytes);
+            return false;
+         }
+         mPackets = first.packetsSent;
+      }
+      return true;
+   }
+   void teardown()
+   {
+      addMetric("packets_per_run", mPackets);
+   }
+};
+
+//------------------------------------------------------------------------------
+// GhostConnection
+
+class BenchObject : public NetObject
+{
+   typedef NetObject Parent;
+public:
+   U32 mValue;
+   F32 mPosition[2];
+
+   static Vector<BenchObject *> mObjects;
+
+   BenchObject()
+   {
+      mValue = 0;
+      mPosition[0] = mPosition[1] = 0;
+      mNetFlags.set(Ghostable);
+   }
+   void update()
+   {
+      mValue++;
+      mPosition[0] = nextUnit();
+      mPosition[1] = nextUnit();
+      setMaskBits(1);
+   }
+   U32 packUpdate(GhostConnection *connection, U32 updateMask, BitStream *stream)
+   {
+      stream->writeInt(mValue, 16);
+      stream->writeFloat(mPosition[0], 12);
+      stream->writeFloat(mPosition[1], 12);
+      return 0;
+   }
+   void unpackUpdate(GhostConnection *connection, BitStream *stream)
+   {
+      mValue = stream->readInt(16);
+      mPosition[0] = stream->readFloat(12);
+      mPosition[1] = stream->readFloat(12);
+   }
+   void performScopeQuery(GhostConnection *connection)
+   {
+      for(S32 i = 0; i < mObjects.size(); i++)
+         connection->objectInScope(mObjects[i]);
+   }
+   TNL_DECLARE_CLASS(BenchObject);
+};
+
+Vector<BenchObject *> BenchObject::mObjects;
+
+TNL_IMPLEMENT_NETOBJECT(BenchObject);
+
+class BenchGhostConnection : public GhostConnection
+{
+   typedef GhostConnection Parent;
+   PacketNotify *mNotify;
+public:
+   BenchGhostConnection() { mNotify = NULL; }
+   ~BenchGhostConnection() { delete mNotify; }
+
+   /// Acks everything received so far; the client has nothing to send.
+   void ack() { sendAckPacket(); }
+
+   void onConnectionEstablished()
+   {
+      Parent::onConnectionEstablished();
+      if(isInitiator())
+      {
+         setGhostFrom(false);
+         setGhostTo(true);
+      }
+      else
+      {
+         setGhostFrom(true);
+         setGhostTo(false);
+         setScopeObject(BenchObject::mObjects[0]);
+         activateGhosting();
+      }
+   }
+
+   /// Writes one packet's worth of ghost updates, as checkPacketSend would,
+   /// and takes it as received without sending it anywhere.
+   U32 writeUpdate(BitStream *stream)
+   {
+      if(!mNotify)
+         mNotify = allocNotify();
+      mNotify->reset();
+      stream->setBitPosition(0);
+      prepareWritePacket();
+      writePacket(stream, mNotify);
+      packetReceived(mNotify);
+      return stream->getBitPosition();
+   }
+   TNL_DECLARE_NETCONNECTION(BenchGhostConnection);
+};
+
+TNL_IMPLEMENT_NETCONNECTION(BenchGhostConnection, NetClassGroupGame, true);
+
+/// Times the server side of ghosting: each operation updates every object
+/// and writes a packet to every connection.
+class GhostWriteBenchmark : public Benchmark
+{
+   U32 mObjectCount;
+   U32 mConnectionCount;
+   NetInterface *mServerInterface;
+   Vector<NetInterface *> mClientInterfaces;
+   Vector<RefPtr<BenchGhostConnection> > mClients;
+   Vector<BenchGhostConnection *> mServers;  ///< Held by the server interface.
+   PacketStream mStream;
+   U64 mBits;
+   U32 mPackets;
+   char mName[32];
+
+   bool isGhosting()
+   {
+      for(S32 i = 0; i < mServers.size(); i++)
+         if(!mServers[i]->isGhosting())
+            return false;
+      return true;
+   }
+   struct GhostingCheck
+   {
+      GhostWriteBenchmark *benchmark;
+      bool operator()() { return benchmark->isGhosting(); }
+   };
+public:
+   GhostWriteBenchmark(U32 objectCount, U32 connectionCount)
+   {
+      mObjectCount = objectCount;
+      mConnectionCount = connectionCount;
+      dSprintf(mName, sizeof(mName), "ghost.write.%dx%d", objectCount, connectionCount);
+   }
+   const char *getName() { return mName; }
+   bool setup()
+   {
+      for(U32 i = 0; i < mObjectCount; i++)
+         BenchObject::mObjects.push_back(new BenchObject);
+
+      mServerInterface = new NetInterface(Address("IP:127.0.0.1:0"));
+      for(U32 i = 0; i < mConnectionCount; i++)
+      {
+         NetInterface *clientInterface = new NetInterface(Address("IP:127.0.0.1:0"));
+         mClientInterfaces.push_back(clientInterface);
+         BenchGhostConnection *client = new BenchGhostConnection;
+         mClients.push_back(client);
+         if(!client->connectLocal(clientInterface, mServerInterface))
+            return false;
+         mServers.push_back(static_cast<BenchGhostConnection *>(client->getRemoteConnectionObject()));
+      }
+
+      // wait for ghosting to start on every connection.
+      Vector<NetInterface *> interfaces = mClientInterfaces;
+      interfaces.push_back(mServerInterface);
+      GhostingCheck check;
+      check.benchmark = this;
+      if(!pumpUntil(interfaces.address(), interfaces.size(), check))
+         return false;
+
+      // ghost everything before timing the updates.
+      for(U32 tick = 0; tick < mObjectCount; tick++)
+         for(S32 i = 0; i < mServers.size(); i++)
+            mServers[i]->writeUpdate(&mStream);
+      mBits = 0;
+      mPackets = 0;
+      return true;
+   }
+   bool run(U32 count)
+   {
+      for(U32 tick = 0; tick < count; tick++)
+      {
+         for(S32 i = 0; i < BenchObject::mObjects.size(); i++)
+            BenchObject::mObjects[i]->update();
+         NetObject::collapseDirtyList();
+         for(S32 i = 0; i < mServers.size(); i++)
+            mBits += mServers[i]->writeUpdate(&mStream);
+      }
+      mPackets += count * mServers.size();
+      return true;
+   }
+   void teardown()
+   {
+      if(mPackets)
+         addMetric("bytes_per_packet", F64(mBits) / (mPackets * 8));
+
+      mServers.clear();
+      mClients.clear();
+      for(S32 i = 0; i < mClientInterfaces.size(); i++)
+         delete mClientInterfaces[i];
+      mClientInterfaces.clear();
+      delete mServerInterface;
+      for(S32 i = 0; i < BenchObject::mObjects.size(); i++)
+         delete BenchObject::mObjects[i];
+      BenchObject::mObjects.clear();
+   }
+};
+
+/// Ghosts a set of objects over a connection on the loopback address,
+/// sending, receiving and acking a packet every tick.  Setup runs the connection until the
+/// packet window has cycled, after which the notifies and ghost update
+/// records should all be reused, so the case fails if a tick makes any
+/// heap allocation.  One operation is one packet sent, received and acked.
+class GhostSteadyStateBenchmark : public Benchmark
+{
+   enum {
+      ObjectCount = 64,
+      WarmupPackets = 256,   ///< Several times the largest packet window.
+   };
+   NetInterface *mInterfaces[2];
+   RefPtr<BenchGhostConnection> mClient;
+   SafePtr<BenchGhostConnection> mServer;
+   U32 mPackets;
+   U32 mAllocations;
+
+   struct GhostingCheck
+   {
+      NetInterface *server;
+      bool operator()()
+      {
+         Vector<NetConnection *> &list = server->getConnectionList();
+         return list.size() && static_cast<BenchGhostConnection *>(list[0])->isGhosting();
+      }
+   };
+
+   bool tick()
+   {
+      if(!mServer.isValid())
+         return false;
+      for(S32 i = 0; i < BenchObject::mObjects.size(); i++)
+         BenchObject::mObjects[i]->update();
+      NetObject::collapseDirtyList();
+
+      U32 sequence = mServer->getLastSendSequence();
+      mServer->checkPacketSend(true, Platform::getRealMilliseconds());
+      if(sequence == mServer->getLastSendSequence())
+         return false;
+      mInterfaces[0]->checkIncomingPackets();
+      mClient->ack();
+      mInterfaces[1]->checkIncomingPackets();
+      return true;
+   }
+public:
+   const char *getName() { return "ghost.steadystate"; }
+   bool setup()
+   {
+      for(U32 i = 0; i < ObjectCount; i++)
+         BenchObject::mObjects.push_back(new BenchObject);
+
+      mInterfaces[0] = new NetInterface(Address("IP:127.0.0.1:0"));
+      mInterfaces[1] = new NetInterface(Address("IP:127.0.0.1:0"));
+      Address serverAddress("IP:127.0.0.1");
+      serverAddress.port = mInterfaces[1]->getSocket().getBoundAddress().port;
+      mClient = new BenchGhostConnection;
+      mClient->connect(mInterfaces[0], serverAddress);
+
+      GhostingCheck check;
+      check.server = mInterfaces[1];
+      if(!pumpUntil(mInterfaces, 2, check))
+         return false;
+      mServer = static_cast<BenchGhostConnection *>(mInterfaces[1]->getConnectionList()[0]);
+
+      for(U32 i = 0; i < WarmupPackets; i++)
+         if(!tick())
+            return false;
+      mPackets = 0;
+      mAllocations = 0;
+      return true;
+   }
+   bool run(U32 count)
+   {
+      U32 allocations = gAllocations;
+      for(U32 i = 0; i < count; i++)
+         if(!tick())
+            return false;
+      mAllocations += gAllocations - allocations;
+      mPackets += count;
+      if(mAllocations)
+         fprintf(stderr, "%s: %u allocations in %u packets\n", getName(), mAllocations, mPackets);
+      return mAllocations == 0;
+   }
+   void teardown()
+   {
+      if(mPackets)
+         addMetric("allocations_per_packet", F64(mAllocations) / mPackets);
+      mClient = NULL;
+      delete mInterfaces[0];
+      delete mInterfaces[1];
+      for(S32 i = 0; i < BenchObject::mObjects.size(); i++)
+         delete BenchObject::mObjects[i];
+      BenchObject::mObjects.clear();
+   }
+};
+
+//------------------------------------------------------------------------------
+// Connection handshake
+
+/// Connects to a server over the loopback address and disconnects again.
+/// The client solves the server's puzzle each time, so this is mostly a
+/// measure of the puzzle difficulty.
+class HandshakeBenchmark : public Benchmark
+{
+   NetInterface *mInterfaces[2];
+   RefPtr<BenchEventConnection> mConnection;
+
+   struct EstablishedCheck
+   {
+      BenchEventConnection *connection;
+      bool operator()() { return connection->getConnectionState() >= NetConnection::ConnectTimedOut; }
+   };
+   struct ClosedCheck
+   {
+      NetInterface *server;
+      bool operator()() { return server->getConnectionList().size() == 0; }
+   };
+public:
+   const char *getName() { return "handshake.connect"; }
+   bool setup()
+   {
+      mInterfaces[0] = new NetInterface(Address("IP:127.0.0.1:0"));
+      mInterfaces[1] = new NetInterface(Address("IP:127.0.0.1:0"));
+      return true;
+   }
+   bool run(U32 count)
+   {
+      Address serverAddress("IP:127.0.0.1");
+      serverAddress.port = mInterfaces[1]->getSocket().getBoundAddress().port;
+      for(U32 i = 0; i < count; i++)
+      {
+         mConnection = new BenchEventConnection;
+         mConnection->connect(mInterfaces[0], serverAddress);
+
+         EstablishedCheck established;
+         established.connection = mConnection;
+         if(!pumpUntil(mInterfaces, 2, established) || !mConnection->isEstablished())
+            return false;
+
+         mConnection->disconnect("");
+         mConnection = NULL;
+         ClosedCheck closed;
+         closed.server = mInterfaces[1];
+         if(!pumpUntil(mInterfaces, 2, closed))
+            return false;
+      }
+      return true;
+   }
+   void teardown()
+   {
+      mConnection = NULL;
+      delete mInterfaces[0];
+      delete mInterfaces[1];
+   }
+};
+
+//------------------------------------------------------------------------------
+// StringTable
+
+class StringTableBenchmark : public Benchmark
+{
+protected:
+   enum {
+      StringCount = 4096,
+   };
+   char mStrings[StringCount][16];
+   StringTableEntry *mEntries;
+public:
+   bool setup()
+   {
+      for(U32 i = 0; i < StringCount; i++)
+         dSprintf(mStrings[i], sizeof(mStrings[i]), "name%x", nextRandom());
+      mEntries = new StringTableEntry[StringCount];
+      return true;
+   }
+   void teardown()
+   {
+      delete[] mEntries;
+   }
+};
+
+/// Interns strings already in the table, as happens for every name a
+/// connection reads.
+class StringTableHitBenchmark : public StringTableBenchmark
+{
+public:
+   const char *getName() { return "stringtable.intern_hit"; }
+   bool setup()
+   {
+      StringTableBenchmark::setup();
+      for(U32 i = 0; i < StringCount; i++)
+         mEntries[i].set(mStrings[i]);
+      return true;
+   }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         StringTableEntry entry(mStrings[i & (StringCount - 1)]);
+         if(entry != mEntries[i & (StringCount - 1)])
+            return false;
+      }
+      return true;
+   }
+};
+
+/// Interns strings that aren't in the table and frees them again.
+class StringTableNewBenchmark : public StringTableBenchmark
+{
+public:
+   const char *getName() { return "stringtable.intern_new"; }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         U32 index = i & (StringCount - 1);
+         if(!index)
+         {
+            for(U32 j = 0; j < StringCount; j++)
+               mEntries[j] = StringTableEntry();
+         }
+         mEntries[index].set(mStrings[index]);
+      }
+      return true;
+   }
+};
+
+/// One thread of the contention case.  Each increment of mStart has it
+/// intern, copy and release mCount strings, then increment mDone.
+class StringTableWorker : public Thread
+{
+public:
+   Semaphore mStart;
+   Semaphore *mDone;
+   const char (*mStrings)[16];
+   U32 mStringCount;
+   U32 mOffset;
+   U32 mCount;
+   volatile S32 *mRunning;
+   volatile bool mQuit;
+   bool mFailed;
+
+   StringTableWorker() : mStart(0) { mQuit = false; mFailed = false; mCount = 0; mRunning = NULL; }
+   U32 run()
+   {
+      for(;;)
+      {
+         mStart.wait();
+         if(mQuit)
+            break;
+         for(U32 i = 0; i < mCount; i++)
+         {
+            StringTableEntry entry(mStrings[(mOffset + i) & (mStringCount - 1)]);
+            StringTableEntry copy = entry;
+            if(copy != entry)
+               mFailed = true;
+         }
+         mOffset += mCount;
+         atomicDecrement(mRunning);
+         mDone->increment();
+      }
+      mDone->increment();
+      return 0;
+   }
+};
+
+/// Interns, copies and releases strings from several threads at once.
+/// Every other string is held by the main thread, so half the interns
+/// hit an existing entry and half insert one and free it again; the
+/// threads walk the same strings from different starting points.  The
+/// time per operation is wall clock time over all the threads.  The
+/// compacting version calls StringTable::compact() on the main thread
+/// the whole time.
+class StringTableContentionBenchmark : public StringTableBenchmark
+{
+   U32 mThreadCount;
+   bool mCompact;
+   Semaphore mDone;
+   volatile S32 mRunning;
+   Vector<StringTableWorker *> mWorkers;
+   char mName[40];
+public:
+   StringTableContentionBenchmark(U32 threadCount, bool compact) : mDone(0)
+   {
+      mThreadCount = threadCount;
+      mCompact = compact;
+      dSprintf(mName, sizeof(mName), "stringtable.%s.%d", compact ? "contention_compact" : "contention", threadCount);
+   }
+   const char *getName() { return mName; }
+   bool setup()
+   {
+      StringTableBenchmark::setup();
+      for(U32 i = 0; i < StringCount; i += 2)
+         mEntries[i].set(mStrings[i]);
+      for(U32 i = 0; i < mThreadCount; i++)
+      {
+         StringTableWorker *worker = new StringTableWorker;
+         worker->mDone = &mDone;
+         worker->mRunning = &mRunning;
+         worker->mStrings = mStrings;
+         worker->mStringCount = StringCount;
+         worker->mOffset = i * StringCount / mThreadCount;
+         worker->start();
+         mWorkers.push_back(worker);
+      }
+      return true;
+   }
+   bool run(U32 count)
+   {
+      mRunning = mWorkers.size();
+      for(S32 i = 0; i < mWorkers.size(); i++)
+      {
+         mWorkers[i]->mCount = count / mThreadCount + (i == 0 ? count % mThreadCount : 0);
+         mWorkers[i]->mStart.increment();
+      }
+      while(mCompact && mRunning)
+         StringTable::compact();
+      bool failed = false;
+      for(S32 i = 0; i < mWorkers.size(); i++)
+      {
+         mDone.wait();
+         failed |= mWorkers[i]->mFailed;
+      }
+      return !failed;
+   }
+   void teardown()
+   {
+      for(S32 i = 0; i < mWorkers.size(); i++)
+      {
+         mWorkers[i]->mQuit = true;
+         mWorkers[i]->mStart.increment();
+      }
+      for(S32 i = 0; i < mWorkers.size(); i++)
+         mDone.wait();
+      for(S32 i = 0; i < mWorkers.size(); i++)
+         delete mWorkers[i];
+      mWorkers.clear();
+      addMetric("threads", mThreadCount);
+      StringTableBenchmark::teardown();
+   }
+};
+
+void runTNLBenchmarks(Runner &runner)
+{
+   BitStreamWriteBenchmark bitStreamWrite;
+   runner.run(bitStreamWrite);
+   BitStreamReadBenchmark bitStreamRead;
+   runner.run(bitStreamRead);
+
+   HuffmanWriteBenchmark huffmanWrite;
+   runner.run(huffmanWrite);
+   HuffmanReadBenchmark huffmanRead;
+   runner.run(huffmanRead);
+   U32 chatCount = sizeof(gChatStrings) / sizeof(gChatStrings[0]);
+   HuffmanWriteBenchmark huffmanWriteChat("chat", gChatStrings, chatCount);
+   runner.run(huffmanWriteChat);
+   HuffmanReadBenchmark huffmanReadChat("chat", gChatStrings, chatCount);
+   runner.run(huffmanReadChat);
+   U32 nameCount = sizeof(gPlayerNames) / sizeof(gPlayerNames[0]);
+   HuffmanWriteBenchmark huffmanWriteNames("names", gPlayerNames, nameCount);
+   runner.run(huffmanWriteNames);
+   HuffmanReadBenchmark huffmanReadNames("names", gPlayerNames, nameCount);
+   runner.run(huffmanReadNames);
+
+   RPCMarshalBenchmark rpcMarshal;
+   runner.run(rpcMarshal);
+   RPCDispatchBenchmark rpcDispatch;
+   runner.run(rpcDispatch);
+
+   EventLossBenchmark eventLoss0(0);
+   runner.run(eventLoss0);
+   EventLossBenchmark eventLoss10(0.1f);
+   runner.run(eventLoss10);
+
+   for(U32 mode = RateFixed; mode <= RatePaced; mode++)
+   {
+      RateLatencyBenchmark rateLatency((RateMode) mode);
+      runner.run(rateLatency);
+   }
+   VirtualNetworkDeterminismBenchmark virtualNetworkDeterminism;
+   runner.run(virtualNetworkDeterminism);
+
+   static const U32 ghostSizes[][2] = {
+      { 64, 1 },
+      { 256, 8 },
+      { 512, 32 },
+   };
+   for(U32 i = 0; i < sizeof(ghostSizes) / sizeof(ghostSizes[0]); i++)
+   {
+      GhostWriteBenchmark ghostWrite(ghostSizes[i][0], ghostSizes[i][1]);
+      runner.run(ghostWrite);
+   }
+   GhostSteadyStateBenchmark ghostSteadyState;
+   runner.run(ghostSteadyState);
+
+   HandshakeBenchmark handshake;
+   runner.run(handshake);
+
+   StringTableHitBenchmark stringTableHit;
+   runner.run(stringTableHit);
+   StringTableNewBenchmark stringTableNew;
+   runner.run(stringTableNew);
+   for(U32 threads = 1; threads <= 16; threads *= 2)
+   {
+      StringTableContentionBenchmark stringTableContention(threads, false);
+      runner.run(stringTableContention);
+   }
+   StringTableContentionBenchmark stringTableCompact(4, true);
+   runner.run(stringTableCompact);
+}
+
+};
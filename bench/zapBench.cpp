@@ -0,0 +1,218 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - Benchmarks
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "bench.h"
+
+#include "tnlNetInterface.h"
+#include "gameObject.h"
+#include "gridDB.h"
+
+namespace Zap
+{
+
+// The simulation code refers to these; the game front ends normally
+// define them, see dedicated.cpp.
+U32 gSimulatedPing = 0;
+F32 gSimulatedPacketLoss = 0;
+bool gDedicatedServer = true;
+bool gFieldCoding = true;
+const char *gServerPassword = NULL;
+const char *gAdminPassword = NULL;
+Address gMasterAddress;
+
+void endGame()
+{
+}
+
+};
+
+using namespace Zap;
+
+namespace Bench
+{
+
+static U32 gSeed = 1;
+
+static F32 nextCoordinate(F32 range)
+{
+   gSeed = gSeed * 1664525 + 1013904223;
+   return (gSeed >> 16) * range / 65536.0f;
+}
+
+/// A stand in for the game's objects: a box for barriers, or a circle for
+/// everything else, added straight to a database with no game around it.
+class GridBenchObject : public GameObject
+{
+   Point mCenter;
+   F32 mRadius;
+public:
+   GridBenchObject(U32 typeMask, Point center, F32 radius)
+   {
+      mObjectTypeMask = typeMask;
+      mCenter = center;
+      mRadius = radius;
+      Rect extent(center, center);
+      extent.expand(Point(radius, radius));
+      setExtent(extent);
+   }
+   bool getCollisionPoly(Vector<Point> &polyPoints)
+   {
+      if(!(mObjectTypeMask & BarrierType))
+         return false;
+      polyPoints.push_back(mCenter + Point(-mRadius, -mRadius));
+      polyPoints.push_back(mCenter + Point(mRadius, -mRadius));
+      polyPoints.push_back(mCenter + Point(mRadius, mRadius));
+      polyPoints.push_back(mCenter + Point(-mRadius, mRadius));
+      return true;
+   }
+   bool getCollisionCircle(U32 stateIndex, Point &point, float &radius)
+   {
+      point = mCenter;
+      radius = mRadius;
+      return true;
+   }
+};
+
+/// Times queries on a database of barriers and items spread over a level
+/// the size of the database's grid.
+class GridBenchmark : public Benchmark
+{
+protected:
+   enum {
+      LevelSize = GridDatabase::BucketWidth * GridDatabase::BucketRowCount,
+      BarrierCount = 300,
+      ItemCount = 2000,
+   };
+   GridDatabase *mDatabase;
+   Vector<GridBenchObject *> mObjects;
+   Vector<GameObject *> mFound;
+   U32 mQueries;
+   U32 mFoundCount;
+
+   Point randomPoint()
+   {
+      return Point(nextCoordinate(LevelSize), nextCoordinate(LevelSize));
+   }
+public:
+   bool setup()
+   {
+      gSeed = 1;
+      mDatabase = new GridDatabase;
+      for(U32 i = 0; i < BarrierCount + ItemCount; i++)
+      {
+         bool barrier = i < BarrierCount;
+         GridBenchObject *object = new GridBenchObject(barrier ? BarrierType : ItemType,
+            randomPoint(), barrier ? 10 + nextCoordinate(90) : 10);
+         Rect extent = object->getExtent();
+         mDatabase->addToExtents(object, extent);
+         mObjects.push_back(object);
+      }
+      mQueries = 0;
+      mFoundCount = 0;
+      return true;
+   }
+   void teardown()
+   {
+      if(mQueries)
+         addMetric("objects_per_query", F64(mFoundCount) / mQueries);
+      for(S32 i = 0; i < mObjects.size(); i++)
+      {
+         Rect extent = mObjects[i]->getExtent();
+         mDatabase->removeFromExtents(mObjects[i], extent);
+         delete mObjects[i];
+      }
+      mObjects.clear();
+      delete mDatabase;
+   }
+};
+
+/// Finds everything in a square around a random point.
+class GridFindBenchmark : public GridBenchmark
+{
+   F32 mSize;
+   char mName[32];
+public:
+   GridFindBenchmark(F32 size)
+   {
+      mSize = size;
+      dSprintf(mName, sizeof(mName), "griddb.find.%d", S32(size));
+   }
+   const char *getName() { return mName; }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         Point center = randomPoint();
+         Rect extent(center, center);
+         extent.expand(Point(mSize / 2, mSize / 2));
+         mFound.clear();
+         mDatabase->findObjects(BarrierType | ItemType, mFound, extent);
+         mFoundCount += mFound.size();
+      }
+      mQueries += count;
+      return true;
+   }
+};
+
+/// Casts rays against the barriers, as the weapons and the bots do.
+class GridLOSBenchmark : public GridBenchmark
+{
+public:
+   const char *getName() { return "griddb.los"; }
+   bool run(U32 count)
+   {
+      for(U32 i = 0; i < count; i++)
+      {
+         Point start = randomPoint();
+         Point end = start + Point(nextCoordinate(1200) - 600, nextCoordinate(1200) - 600);
+         F32 t;
+         Point normal;
+         if(mDatabase->findObjectLOS(BarrierType, 0, start, end, t, normal))
+            mFoundCount++;
+      }
+      mQueries += count;
+      return true;
+   }
+   void teardown()
+   {
+      if(mQueries)
+         addMetric("hit_fraction", F64(mFoundCount) / mQueries);
+      mQueries = 0;
+      GridBenchmark::teardown();
+   }
+};
+
+void runZapBenchmarks(Runner &runner)
+{
+   GridFindBenchmark findSmall(200);
+   runner.run(findSmall);
+   GridFindBenchmark findScreen(1600);
+   runner.run(findScreen);
+   GridLOSBenchmark los;
+   runner.run(los);
+}
+
+};
@@ -28,14 +28,22 @@
 #include "masterInterface.h"
 #include "tnlVector.h"
 #include "tnlAsymmetricKey.h"
+#include "serverIndex.h"
 
 using namespace TNL;
 
 NetInterface *gNetInterface = NULL;
+ServerIndex gServerIndex;
+
+/// Set whenever a game or mission type is added or goes away, so the
+/// cached c2mQueryGameTypes response is rebuilt.
+bool gGameTypesChanged = true;
+
 class MissionGameType : public TNL::Object
 {
 public:
-   MissionGameType(const StringTableEntry &name) { mName = name; }
+   MissionGameType(const StringTableEntry &name) { mName = name; gGameTypesChanged = true; }
+   ~MissionGameType() { gGameTypesChanged = true; }
    StringTableEntry mName;
 };
 
@@ -83,6 +91,10 @@ protected:
    static Vector< SafePtr<MissionGameType> > gGameTypeList;
    static Vector< GameConnectRequest* >      gConnectList;
 
+   /// The c2mQueryGameTypes response, as pairs of game and mission type lists.
+   static Vector< Vector<StringTableEntry> > gGameTypePages;
+   static Vector< Vector<StringTableEntry> > gMissionTypePages;
+
 
    /// @}
 
@@ -121,6 +133,180 @@ protected:
    RefPtr<MissionGameType> mCurrentGameType;
    RefPtr<MissionGameType> mCurrentMissionType;
 
+   /// This server's entry in the server index.
+   ServerIndex::Entry mIndexEntry;
+
+   /// Copies the server info into the server index, and tells any
+   /// subscribed clients that care about the change.
+   void updateIndex()
+   {
+      bool wasListed = mIndexEntry.isListed();
+      ServerInfo oldInfo = mIndexEntry.info;
+
+      ServerInfo info;
+      info.gameString = mGameString;
+      info.gameType = mCurrentGameType->mName;
+      info.missionType = mCurrentMissionType->mName;
+      info.regionCode = mRegionCode;
+      info.cpuSpeed = mCPUSpeed;
+      info.infoFlags = mInfoFlags;
+      info.playerCount = mPlayerCount;
+      info.numBots = mNumBots;
+      info.address = getNetAddress().toIPAddress();
+      gServerIndex.update(&mIndexEntry, info);
+
+      if(wasListed)
+         notifySubscribers(&oldInfo, &info);
+   }
+
+   /// Adds this server to the server index.
+   void listServer()
+   {
+      updateIndex();
+      gServerIndex.add(&mIndexEntry);
+      notifySubscribers(NULL, &mIndexEntry.info);
+   }
+
+   /// @name Subscriptions
+   ///
+   /// A client can subscribe to a server list filter.  Each subscriber
+   /// collects the servers whose match state or status changed, and the
+   /// changes are sent as batched deltas by flushSubscriptions.
+   ///
+   /// @{
+
+   /// A change queued for a subscriber.  The match state is taken when the
+   /// change happens, so the server doesn't have to be around at the flush.
+   struct PendingChange
+   {
+      IPAddress address;
+      U32 sequence;                    ///< Orders changes to the same server.
+      bool matched;                    ///< Whether the server matched the filter after the change.
+   };
+
+   enum {
+      MinSubscribeInterval = 5000, ///< Subscribing again sooner than this is a strike.
+      MaxPendingChanges = 4096,    ///< Most changes a subscriber can have queued.
+   };
+
+   static Vector<MasterServerConnection *> gSubscriberList;
+
+   bool mSubscribed;
+   U32 mSubscriptionId;
+   U32 mLastSubscribeTime;
+   ServerQuery mSubscription;
+   Vector<PendingChange> mPendingChanges;
+
+   /// Queues this server's change with every subscriber whose filter
+   /// matched the server before or after the change.  Either info may
+   /// be NULL for a server that is being listed or going away.
+   void notifySubscribers(const ServerInfo *oldInfo, const ServerInfo *newInfo)
+   {
+      for(S32 i = 0; i < gSubscriberList.size(); )
+      {
+         MasterServerConnection *subscriber = gSubscriberList[i];
+         bool wasMatched = oldInfo && subscriber->mSubscription.matches(*oldInfo);
+         bool isMatched = newInfo && subscriber->mSubscription.matches(*newInfo);
+         if(wasMatched || isMatched)
+         {
+            // a full queue is cut down to the latest change of each
+            // server.  If that doesn't make room, the subscriber has
+            // more changed servers than it can be sent and is dropped.
+            if(subscriber->mPendingChanges.size() >= MaxPendingChanges)
+               subscriber->collapsePendingChanges();
+            if(subscriber->mPendingChanges.size() >= MaxPendingChanges)
+            {
+               logprintf("Client: %s fell too far behind, dropping its server list subscription",
+                  subscriber->getNetAddress().toString());
+               subscriber->unsubscribe();
+               continue;
+            }
+
+            PendingChange change;
+            change.address = getNetAddress().toIPAddress();
+            change.sequence = subscriber->mPendingChanges.size();
+            change.matched = isMatched;
+            subscriber->mPendingChanges.push_back(change);
+         }
+         i++;
+      }
+   }
+
+   static S32 QSORT_CALLBACK comparePendingChanges(PendingChange *a, PendingChange *b)
+   {
+      if(a->address.netNum != b->address.netNum)
+         return a->address.netNum < b->address.netNum ? -1 : 1;
+      if(a->address.port != b->address.port)
+         return a->address.port < b->address.port ? -1 : 1;
+      return S32(a->sequence - b->sequence);
+   }
+
+   /// Cuts the queued changes down to the last one of each server.
+   void collapsePendingChanges()
+   {
+      // group the changes by server, oldest first, and keep the last of each.
+      mPendingChanges.sort(comparePendingChanges);
+      S32 count = 0;
+      for(S32 i = 0; i < mPendingChanges.size(); i++)
+      {
+         PendingChange &change = mPendingChanges[i];
+         if(i + 1 < mPendingChanges.size() &&
+               mPendingChanges[i + 1].address.netNum == change.address.netNum &&
+               mPendingChanges[i + 1].address.port == change.address.port)
+            continue;
+         mPendingChanges[count] = change;
+         mPendingChanges[count].sequence = count;
+         count++;
+      }
+      mPendingChanges.setSize(count);
+   }
+
+   /// Sends the queued changes as deltas.  A server that changed more than
+   /// once is only sent once, with its latest state.
+   void sendPendingChanges()
+   {
+      Vector<IPAddress> updated;
+      Vector<IPAddress> removed;
+
+      collapsePendingChanges();
+      for(S32 i = 0; i < mPendingChanges.size(); i++)
+      {
+         PendingChange &change = mPendingChanges[i];
+         if(change.matched)
+            updated.push_back(change.address);
+         else
+            removed.push_back(change.address);
+
+         if(updated.size() + removed.size() == IPMessageAddressCount)
+         {
+            m2cServerListDelta(mSubscriptionId, updated, removed);
+            updated.clear();
+            removed.clear();
+         }
+      }
+      if(updated.size() || removed.size())
+         m2cServerListDelta(mSubscriptionId, updated, removed);
+      mPendingChanges.clear();
+   }
+
+   /// Stops sending deltas to this connection.
+   void unsubscribe()
+   {
+      if(!mSubscribed)
+         return;
+      mSubscribed = false;
+      mPendingChanges.clear();
+      for(S32 i = 0; i < gSubscriberList.size(); i++)
+      {
+         if(gSubscriberList[i] == this)
+         {
+            gSubscriberList.erase_fast(i);
+            break;
+         }
+      }
+   }
+
+   /// @}
 
 
    void setGameType(const StringTableEntry &gameType)
@@ -162,6 +348,9 @@ public:
    {
       mStrikeCount = 0;
       mLastActivityTime = 0;
+      mSubscribed = false;
+      mSubscriptionId = 0;
+      mLastSubscribeTime = 0;
       mNext = this;
       mPrev = this;
       setIsConnectionToClient();
@@ -175,6 +364,12 @@ public:
       // unlink it if it's in the list
       mPrev->mNext = mNext;
       mNext->mPrev = mPrev;
+      unsubscribe();
+      if(mIndexEntry.isListed())
+      {
+         gServerIndex.remove(&mIndexEntry);
+         notifySubscribers(&mIndexEntry.info, NULL);
+      }
       logprintf("%s disconnected", getNetAddress().toString());
    }
 
@@ -187,15 +382,18 @@ public:
       mPrev->mNext = this;
    }
 
-   /// RPC's a list of mission and game types to the requesting client.
-   /// This function also cleans up any game types from the global lists
-   /// that are no longer referenced.
-   TNL_DECLARE_RPC_OVERRIDE(c2mQueryGameTypes, (U32 queryId))
+   /// Rebuilds the cached c2mQueryGameTypes response from the game and
+   /// mission type lists.  This function also cleans up any game types
+   /// from the global lists that are no longer referenced.
+   static void buildGameTypePages()
    {
       Vector<StringTableEntry> gameTypes(GameMissionTypesPerPacket);
       Vector<StringTableEntry> missionTypes(GameMissionTypesPerPacket);
       U32 listSize = 0;
 
+      gGameTypePages.clear();
+      gMissionTypePages.clear();
+
       // Iterate through game types list, culling out any null entries.
       // Add all non-null entries to the gameTypes vector.
       for(S32 i = 0; i < gGameTypeList.size(); )
@@ -212,13 +410,13 @@ public:
          listSize++;
          if(listSize >= GameMissionTypesPerPacket)
          {
-            m2cQueryGameTypesResponse(queryId, gameTypes, missionTypes);
+            gGameTypePages.push_back(gameTypes);
+            gMissionTypePages.push_back(missionTypes);
             listSize = 0;
             gameTypes.clear();
          }
       }
 
-
       // Iterate through mission types list, culling out any null entries.
       // Add all non-null entries to the missionTypes vector.
       for(S32 i = 0; i < gMissionTypeList.size(); )
@@ -233,60 +431,71 @@ public:
          listSize++;
          if(listSize >= GameMissionTypesPerPacket)
          {
-            m2cQueryGameTypesResponse(queryId, gameTypes, missionTypes);
+            gGameTypePages.push_back(gameTypes);
+            gMissionTypePages.push_back(missionTypes);
             listSize = 0;
             gameTypes.clear();
             missionTypes.clear();
          }
       }
 
-      // Send the last lists to the client.
-      m2cQueryGameTypesResponse(queryId, gameTypes, missionTypes);
+      // The last lists...
+      gGameTypePages.push_back(gameTypes);
+      gMissionTypePages.push_back(missionTypes);
 
-      // Send a pair of empty lists to the client to signify that the
-      // query is done.
+      // and a pair of empty lists to signify that the query is done.
       if(gameTypes.size() || missionTypes.size())
       {
          gameTypes.clear();
          missionTypes.clear();
-         m2cQueryGameTypesResponse(queryId, gameTypes, missionTypes);
+         gGameTypePages.push_back(gameTypes);
+         gMissionTypePages.push_back(missionTypes);
       }
+      gGameTypesChanged = false;
+   }
+
+   /// RPC's a list of mission and game types to the requesting client.
+   /// The response is built once and reused until a type is added or
+   /// goes away.
+   TNL_DECLARE_RPC_OVERRIDE(c2mQueryGameTypes, (U32 queryId))
+   {
+      if(gGameTypesChanged)
+         buildGameTypePages();
+
+      for(S32 i = 0; i < gGameTypePages.size(); i++)
+         m2cQueryGameTypesResponse(queryId, gGameTypePages[i], gMissionTypePages[i]);
    }
 
    /// The query server method builds a piecewise list of servers
    /// that match the client's particular filter criteria and
    /// sends it to the client, followed by a QueryServersDone RPC.
+   /// The matching servers come from the server index rather than
+   /// a walk of the whole server list.
    TNL_DECLARE_RPC_OVERRIDE(c2mQueryServers,
                 (U32 queryId, U32 regionMask, U32 minPlayers, U32 maxPlayers,
                  U32 infoFlags, U32 maxBots, U32 minCPUSpeed,
                  StringTableEntry gameType, StringTableEntry missionType)
    )
    {
+      ServerQuery query;
+      query.gameString = mGameString;
+      query.gameType = gameType;
+      query.missionType = missionType;
+      query.regionMask = regionMask;
+      query.minPlayers = minPlayers;
+      query.maxPlayers = maxPlayers;
+      query.infoFlags = infoFlags;
+      query.maxBots = maxBots;
+      query.minCPUSpeed = minCPUSpeed;
+
+      const Vector<IPAddress> &results = gServerIndex.query(query, Platform::getRealMilliseconds());
+
       Vector<IPAddress> theVector(IPMessageAddressCount);
       theVector.reserve(IPMessageAddressCount);
 
-      for(MasterServerConnection *walk = gServerList.mNext; walk != &gServerList; walk = walk->mNext)
+      for(S32 i = 0; i < results.size(); i++)
       {
-         // Skip to the next if we don't match on any particular...
-         if(walk->mGameString != mGameString)
-            continue;
-         if(!(walk->mRegionCode & regionMask))
-            continue;
-         if(walk->mPlayerCount > maxPlayers || walk->mPlayerCount < minPlayers)
-            continue;
-         if(infoFlags & ~walk->mInfoFlags)
-            continue;
-         if(maxBots < walk->mNumBots)
-            continue;
-         if(minCPUSpeed > walk->mCPUSpeed)
-            continue;
-         if(gameType.isNotNull() && (gameType != walk->mCurrentGameType->mName))
-            continue;
-         if(missionType.isNotNull() && (missionType != walk->mCurrentMissionType->mName))
-            continue;
-
-         // Somehow we matched! Add us to the results list.
-         theVector.push_back(walk->getNetAddress().toIPAddress());
+         theVector.push_back(results[i]);
 
          // If we get a packet's worth, send it to the client and empty our buffer...
          if(theVector.size() == IPMessageAddressCount)
@@ -304,6 +513,74 @@ public:
       }
    }
 
+   /// Registers the client's server list filter, sends the servers that
+   /// match it now, and queues later changes for flushSubscriptions.
+   TNL_DECLARE_RPC_OVERRIDE(c2mSubscribeServers,
+                (U32 queryId, U32 regionMask, U32 minPlayers, U32 maxPlayers,
+                 U32 infoFlags, U32 maxBots, U32 minCPUSpeed,
+                 StringTableEntry gameType, StringTableEntry missionType)
+   )
+   {
+      // every subscribe sends the whole matching list, so resubscribing
+      // too often counts against the connection like any other flood.
+      U32 lastSubscribeTime = mLastSubscribeTime;
+      mLastSubscribeTime = Platform::getRealMilliseconds();
+      if(lastSubscribeTime && !checkActivityTime(MinSubscribeInterval, lastSubscribeTime))
+         return;
+
+      mSubscription.gameString = mGameString;
+      mSubscription.gameType = gameType;
+      mSubscription.missionType = missionType;
+      mSubscription.regionMask = regionMask;
+      mSubscription.minPlayers = minPlayers;
+      mSubscription.maxPlayers = maxPlayers;
+      mSubscription.infoFlags = infoFlags;
+      mSubscription.maxBots = maxBots;
+      mSubscription.minCPUSpeed = minCPUSpeed;
+      mSubscriptionId = queryId;
+      mPendingChanges.clear();
+
+      if(!mSubscribed)
+      {
+         mSubscribed = true;
+         gSubscriberList.push_back(this);
+      }
+
+      // the changes from here on are sent as deltas, so the snapshot can't
+      // be a cached result that is missing any earlier ones.
+      const Vector<IPAddress> &results = gServerIndex.query(mSubscription, Platform::getRealMilliseconds(), true);
+      Vector<IPAddress> theVector(IPMessageAddressCount);
+      Vector<IPAddress> noServers;
+
+      for(S32 i = 0; i < results.size(); i++)
+      {
+         theVector.push_back(results[i]);
+         if(theVector.size() == IPMessageAddressCount)
+         {
+            m2cServerListDelta(queryId, theVector, noServers);
+            theVector.clear();
+         }
+      }
+      if(theVector.size())
+         m2cServerListDelta(queryId, theVector, noServers);
+   }
+
+   TNL_DECLARE_RPC_OVERRIDE(c2mUnsubscribeServers, (U32 queryId))
+   {
+      if(queryId == mSubscriptionId)
+         unsubscribe();
+   }
+
+   /// Sends every subscriber the changes collected since the last flush.
+   static void flushSubscriptions()
+   {
+      for(S32 i = 0; i < gSubscriberList.size(); i++)
+      {
+         if(gSubscriberList[i]->mPendingChanges.size())
+            gSubscriberList[i]->sendPendingChanges();
+      }
+   }
+
    /// checkActivityTime validates that this particular connection is
    /// not issuing too many requests at once in an attempt to DOS
    /// by flooding either the master server or any other server
@@ -311,16 +588,27 @@ public:
    /// within the specified delta gets a strike... 3 strikes and
    /// you're out!  Strikes go away after being good for a while.
    void checkActivityTime(U32 timeDeltaMinimum)
+   {
+      checkActivityTime(timeDeltaMinimum, mLastActivityTime);
+   }
+
+   /// Gives the connection a strike if lastTime falls within the
+   /// specified delta.  Returns false if the connection was struck out.
+   bool checkActivityTime(U32 timeDeltaMinimum, U32 lastTime)
    {
       U32 currentTime = Platform::getRealMilliseconds();
-      if(currentTime - mLastActivityTime < timeDeltaMinimum)
+      if(currentTime - lastTime < timeDeltaMinimum)
       {
          mStrikeCount++;
          if(mStrikeCount == 3)
+         {
             disconnect("You're out!");
+            return false;
+         }
       }
       else if(mStrikeCount > 0)
          mStrikeCount--;
+      return true;
    }
 
    void removeConnectRequest(GameConnectRequest *gcr)
@@ -491,6 +779,7 @@ public:
       mPlayerCount = playerCount;
       mMaxPlayers = maxPlayers;
       mInfoFlags = infoFlags;
+      updateIndex();
 
       checkActivityTime(15000);
 
@@ -522,6 +811,7 @@ public:
          setMissionType(StringTableEntry(gameString));
 
          linkToServerList();
+         listServer();
       }
       logprintf("%s online at %s", mIsGameServer ? "Server" : "client", getNetAddress().toString());
       if(getEventClassVersion() > 0)
@@ -589,6 +879,9 @@ TNL_IMPLEMENT_NETCONNECTION(MasterServerConnection, NetClassGroupMaster, true);
 Vector< SafePtr<MissionGameType> > MasterServerConnection::gMissionTypeList;
 Vector< SafePtr<MissionGameType> > MasterServerConnection::gGameTypeList;
 Vector< GameConnectRequest* > MasterServerConnection::gConnectList;
+Vector< Vector<StringTableEntry> > MasterServerConnection::gGameTypePages;
+Vector< Vector<StringTableEntry> > MasterServerConnection::gMissionTypePages;
+Vector<MasterServerConnection *> MasterServerConnection::gSubscriberList;
 
 MasterServerConnection MasterServerConnection::gServerList;
 
@@ -609,6 +902,7 @@ public:
 
 enum {
    DefaultMasterPort = 29005,
+   SubscriptionFlushInterval = 1000,   ///< Milliseconds between server list deltas to subscribers.
 };
 
 U32 gMasterPort = DefaultMasterPort;
@@ -616,6 +910,8 @@ extern void readConfigFile();
 
 int main(int argc, const char **argv)
 {
+   TNL::startAsyncLogging();
+
    // Parse command line parameters... 
    readConfigFile();
 
@@ -630,6 +926,8 @@ int main(int argc, const char **argv)
 
    // And until infinity, process whatever comes our way.
    U32 lastConfigReadTime = Platform::getRealMilliseconds();
+   U32 lastStatsTime = lastConfigReadTime;
+   U32 lastFlushTime = lastConfigReadTime;
 
    for(;;)
    {
@@ -641,6 +939,16 @@ int main(int argc, const char **argv)
          lastConfigReadTime = currentTime;
          readConfigFile();
       }
+      if(currentTime - lastFlushTime >= SubscriptionFlushInterval)
+      {
+         lastFlushTime = currentTime;
+         MasterServerConnection::flushSubscriptions();
+      }
+      if(currentTime - lastStatsTime > 60000)
+      {
+         lastStatsTime = currentTime;
+         gServerIndex.logStats();
+      }
       Platform::sleep(1);
    }
    return 0;
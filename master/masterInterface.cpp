@@ -83,4 +83,18 @@ TNL_IMPLEMENT_RPC(MasterServerInterface, c2mUpdateServerStatus, (
    NetClassGroupMasterMask, RPCGuaranteedOrdered, RPCDirClientToServer, 0) {}
 
 TNL_IMPLEMENT_RPC(MasterServerInterface, m2cSetMOTD, (StringPtr motdString), (motdString),
-   NetClassGroupMasterMask, RPCGuaranteedOrdered, RPCDirServerToClient, 0) {}
\ No newline at end of file
+   NetClassGroupMasterMask, RPCGuaranteedOrdered, RPCDirServerToClient, 0) {}
+
+TNL_IMPLEMENT_RPC(MasterServerInterface, c2mSubscribeServers,
+   (U32 queryId, U32 regionMask, U32 minPlayers, U32 maxPlayers, U32 infoFlags,
+   U32 maxBots, U32 minCPUSpeed, StringTableEntry gameType, StringTableEntry missionType),
+   (queryId, regionMask, minPlayers, maxPlayers, infoFlags, maxBots, minCPUSpeed, gameType, missionType),
+   NetClassGroupMasterMask, RPCGuaranteedOrdered, RPCDirClientToServer, 2) {}
+
+TNL_IMPLEMENT_RPC(MasterServerInterface, c2mUnsubscribeServers, (U32 queryId), (queryId),
+   NetClassGroupMasterMask, RPCGuaranteedOrdered, RPCDirClientToServer, 2) {}
+
+TNL_IMPLEMENT_RPC(MasterServerInterface, m2cServerListDelta,
+   (U32 queryId, Vector<IPAddress> updatedServers, Vector<IPAddress> removedServers),
+   (queryId, updatedServers, removedServers),
+   NetClassGroupMasterMask, RPCGuaranteedOrdered, RPCDirServerToClient, 2) {}
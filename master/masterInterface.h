@@ -61,7 +61,7 @@ class MasterServerInterface : public EventConnection
 protected:
 public:
    enum {
-      MasterServerInterfaceVersion = 1,
+      MasterServerInterfaceVersion = 2,
    };
 
    /// c2mQueryGameTypes is sent from the client to the master to request a list of 
@@ -138,6 +138,28 @@ public:
    /// client's game string is used to pick which MOTD will be sent.
    TNL_DECLARE_RPC(m2cSetMOTD, (StringPtr motdString));
 
+   // Version 2 protocol messages:
+
+   /// c2mSubscribeServers registers a server list filter with the master, with the same
+   /// criteria as c2mQueryServers.  The master answers with the servers that currently match
+   /// as one or more m2cServerListDelta RPCs, and from then on sends further deltas as servers
+   /// come, go, or change status, so the client can keep its own copy of the list without
+   /// querying again.  A connection has at most one subscription; subscribing again replaces it.
+   /// Subscribing again within 5 seconds is rate limited like the other requests, and a
+   /// subscriber with more changed servers queued than the master will hold is unsubscribed.
+   TNL_DECLARE_RPC(c2mSubscribeServers, (U32 queryId, U32 regionMask,
+      U32 minPlayers, U32 maxPlayers, U32 infoFlags,
+      U32 maxBots, U32 minCPUSpeed, StringTableEntry gameType, StringTableEntry missionType));
+
+   /// c2mUnsubscribeServers stops the deltas for the subscription with the given queryId.
+   TNL_DECLARE_RPC(c2mUnsubscribeServers, (U32 queryId));
+
+   /// m2cServerListDelta is sent by the master to a subscribed client.  updatedServers lists
+   /// servers that have started matching the filter or whose status changed since they were
+   /// last sent, and removedServers lists servers that went away or no longer match.  Changes
+   /// are collected and sent at most once a second, with at most IPMessageAddressCount
+   /// addresses per message.  Each server is sent at most once per flush, in its latest state.
+   TNL_DECLARE_RPC(m2cServerListDelta, (U32 queryId, Vector<IPAddress> updatedServers, Vector<IPAddress> removedServers));
 };
 
 
@@ -0,0 +1,347 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - Master Server
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "serverIndex.h"
+#include "tnlLog.h"
+
+bool ServerQuery::matches(const ServerInfo &info) const
+{
+   if(info.gameString != gameString)
+      return false;
+   if(!(info.regionCode & regionMask))
+      return false;
+   if(info.playerCount > maxPlayers || info.playerCount < minPlayers)
+      return false;
+   if(infoFlags & ~info.infoFlags)
+      return false;
+   if(maxBots < info.numBots)
+      return false;
+   if(minCPUSpeed > info.cpuSpeed)
+      return false;
+   if(gameType.isNotNull() && gameType != info.gameType)
+      return false;
+   if(missionType.isNotNull() && missionType != info.missionType)
+      return false;
+   return true;
+}
+
+bool ServerQuery::operator==(const ServerQuery &q) const
+{
+   return gameString == q.gameString && gameType == q.gameType && missionType == q.missionType &&
+          regionMask == q.regionMask && minPlayers == q.minPlayers && maxPlayers == q.maxPlayers &&
+          infoFlags == q.infoFlags && maxBots == q.maxBots && minCPUSpeed == q.minCPUSpeed;
+}
+
+//------------------------------------------------------------------------------------
+
+ServerIndex::ServerIndex()
+{
+   mGeneration = 0;
+   mQueryStamp = 0;
+   mQueries = 0;
+   mCacheHits = 0;
+   mServersTested = 0;
+}
+
+void ServerIndex::insert(Vector<Entry *> &list, Entry *entry, S32 &slot)
+{
+   slot = list.size();
+   list.push_back(entry);
+}
+
+void ServerIndex::remove(Vector<Entry *> &list, S32 slot, S32 Entry::*slotMember)
+{
+   // move the last entry into the hole, and tell it where it went.
+   Entry *last = list[list.size() - 1];
+   list[slot] = last;
+   last->*slotMember = slot;
+   list.pop_back();
+}
+
+void ServerIndex::removeRegion(Vector<Entry *> &list, S32 slot, U32 bit)
+{
+   Entry *last = list[list.size() - 1];
+   list[slot] = last;
+   last->mRegionSlot[bit] = slot;
+   list.pop_back();
+}
+
+S32 ServerIndex::findGroup(const StringTableEntry &gameString)
+{
+   for(S32 i = 0; i < mGroups.size(); i++)
+      if(mGroups[i].gameString == gameString)
+         return i;
+   return -1;
+}
+
+S32 ServerIndex::findGameType(Group &group, const StringTableEntry &gameType)
+{
+   for(S32 i = 0; i < group.gameTypes.size(); i++)
+      if(group.gameTypes[i].gameType == gameType)
+         return i;
+   return -1;
+}
+
+U32 ServerIndex::getPlayerBucket(U32 playerCount)
+{
+   return playerCount < PlayerCountBuckets ? playerCount : PlayerCountBuckets - 1;
+}
+
+void ServerIndex::link(Entry *entry)
+{
+   const ServerInfo &info = entry->info;
+
+   S32 groupIndex = findGroup(info.gameString);
+   if(groupIndex == -1)
+   {
+      groupIndex = mGroups.size();
+      mGroups.setSize(groupIndex + 1);
+      mGroups[groupIndex].gameString = info.gameString;
+   }
+   Group &group = mGroups[groupIndex];
+   entry->mGroup = groupIndex;
+
+   insert(group.all, entry, entry->mAllSlot);
+
+   S32 typeIndex = findGameType(group, info.gameType);
+   if(typeIndex == -1)
+   {
+      typeIndex = group.gameTypes.size();
+      group.gameTypes.setSize(typeIndex + 1);
+      group.gameTypes[typeIndex].gameType = info.gameType;
+   }
+   entry->mGameTypeList = typeIndex;
+   insert(group.gameTypes[typeIndex].servers, entry, entry->mGameTypeSlot);
+
+   entry->mPlayerBucket = getPlayerBucket(info.playerCount);
+   insert(group.players[entry->mPlayerBucket], entry, entry->mPlayerSlot);
+
+   for(U32 bit = 0; bit < RegionBits; bit++)
+      if(info.regionCode & (U32(1) << bit))
+         insert(group.regions[bit], entry, entry->mRegionSlot[bit]);
+}
+
+void ServerIndex::unlink(Entry *entry)
+{
+   Group &group = mGroups[entry->mGroup];
+
+   remove(group.all, entry->mAllSlot, &Entry::mAllSlot);
+   remove(group.gameTypes[entry->mGameTypeList].servers, entry->mGameTypeSlot, &Entry::mGameTypeSlot);
+   remove(group.players[entry->mPlayerBucket], entry->mPlayerSlot, &Entry::mPlayerSlot);
+
+   for(U32 bit = 0; bit < RegionBits; bit++)
+      if(entry->info.regionCode & (U32(1) << bit))
+         removeRegion(group.regions[bit], entry->mRegionSlot[bit], bit);
+
+   // Empty game type lists and groups are left in place; game strings and
+   // game types come from a small set, and keeping the slots stable means
+   // other entries never have to be renumbered.
+   entry->mGroup = -1;
+}
+
+void ServerIndex::add(Entry *entry)
+{
+   if(entry->isListed())
+      return;
+   link(entry);
+   mGeneration++;
+}
+
+void ServerIndex::update(Entry *entry, const ServerInfo &info)
+{
+   if(!entry->isListed())
+   {
+      entry->info = info;
+      return;
+   }
+
+   const ServerInfo &old = entry->info;
+   if(old.gameString != info.gameString || old.gameType != info.gameType ||
+      old.regionCode != info.regionCode || getPlayerBucket(old.playerCount) != getPlayerBucket(info.playerCount))
+   {
+      unlink(entry);
+      entry->info = info;
+      link(entry);
+   }
+   else
+      entry->info = info;
+   mGeneration++;
+}
+
+void ServerIndex::remove(Entry *entry)
+{
+   if(!entry->isListed())
+      return;
+   unlink(entry);
+   mGeneration++;
+}
+
+void ServerIndex::runQuery(const ServerQuery &query, Vector<IPAddress> &results)
+{
+   S32 groupIndex = findGroup(query.gameString);
+   if(groupIndex == -1)
+      return;
+   Group &group = mGroups[groupIndex];
+
+   // Work out how many servers each applicable index would make us test,
+   // and walk the smallest.
+   enum { UseAll, UseGameType, UseRegions, UsePlayers };
+   U32 method = UseAll;
+   U32 bestCount = group.all.size();
+
+   S32 typeIndex = -1;
+   if(query.gameType.isNotNull())
+   {
+      typeIndex = findGameType(group, query.gameType);
+      if(typeIndex == -1)
+         return;
+      if(U32(group.gameTypes[typeIndex].servers.size()) < bestCount)
+      {
+         method = UseGameType;
+         bestCount = group.gameTypes[typeIndex].servers.size();
+      }
+   }
+
+   U32 regionCount = 0;
+   for(U32 bit = 0; bit < RegionBits; bit++)
+      if(query.regionMask & (U32(1) << bit))
+         regionCount += group.regions[bit].size();
+   if(regionCount < bestCount)
+   {
+      method = UseRegions;
+      bestCount = regionCount;
+   }
+
+   if(query.minPlayers > query.maxPlayers)
+      return;
+   U32 firstBucket = getPlayerBucket(query.minPlayers);
+   U32 lastBucket = getPlayerBucket(query.maxPlayers);
+   U32 playerCount = 0;
+   for(U32 i = firstBucket; i <= lastBucket; i++)
+      playerCount += group.players[i].size();
+   if(playerCount < bestCount)
+   {
+      method = UsePlayers;
+      bestCount = playerCount;
+   }
+
+   mServersTested += bestCount;
+
+   switch(method)
+   {
+      case UseAll:
+      case UseGameType:
+      {
+         Vector<Entry *> &list = method == UseAll ? group.all : group.gameTypes[typeIndex].servers;
+         for(S32 i = 0; i < list.size(); i++)
+            if(query.matches(list[i]->info))
+               results.push_back(list[i]->info.address);
+         break;
+      }
+      case UseRegions:
+      {
+         // a server can be in more than one of the regions, so mark each
+         // one as it's seen.
+         mQueryStamp++;
+         for(U32 bit = 0; bit < RegionBits; bit++)
+         {
+            if(!(query.regionMask & (U32(1) << bit)))
+               continue;
+            Vector<Entry *> &list = group.regions[bit];
+            for(S32 i = 0; i < list.size(); i++)
+            {
+               Entry *entry = list[i];
+               if(entry->mQueryStamp == mQueryStamp)
+                  continue;
+               entry->mQueryStamp = mQueryStamp;
+               if(query.matches(entry->info))
+                  results.push_back(entry->info.address);
+            }
+         }
+         break;
+      }
+      case UsePlayers:
+         for(U32 bucket = firstBucket; bucket <= lastBucket; bucket++)
+         {
+            Vector<Entry *> &list = group.players[bucket];
+            for(S32 i = 0; i < list.size(); i++)
+               if(query.matches(list[i]->info))
+                  results.push_back(list[i]->info.address);
+         }
+         break;
+   }
+}
+
+const Vector<IPAddress> &ServerIndex::query(const ServerQuery &query, U32 currentTime, bool requireCurrent)
+{
+   mQueries++;
+
+   S32 oldest = 0;
+   for(S32 i = 0; i < mCache.size(); i++)
+   {
+      CachedQuery &cached = mCache[i];
+      if(cached.query == query)
+      {
+         if(cached.generation == mGeneration || (!requireCurrent && currentTime - cached.time < QueryCacheLifetime))
+         {
+            mCacheHits++;
+            return cached.results;
+         }
+         oldest = i;
+         break;
+      }
+      if(S32(cached.time - mCache[oldest].time) < 0)
+         oldest = i;
+   }
+
+   if(mCache.size() < QueryCacheSize && (!mCache.size() || !(mCache[oldest].query == query)))
+   {
+      oldest = mCache.size();
+      mCache.setSize(oldest + 1);
+   }
+
+   CachedQuery &cached = mCache[oldest];
+   cached.query = query;
+   cached.time = currentTime;
+   cached.generation = mGeneration;
+   cached.results.clear();
+   runQuery(query, cached.results);
+   return cached.results;
+}
+
+void ServerIndex::logStats()
+{
+   if(!mQueries)
+      return;
+
+   U32 servers = 0;
+   for(S32 i = 0; i < mGroups.size(); i++)
+      servers += mGroups[i].all.size();
+
+   logprintf("Server index: %d servers listed, %d queries, %d answered from the cache, %d servers tested.",
+      servers, mQueries, mCacheHits, mServersTested);
+   mQueries = mCacheHits = mServersTested = 0;
+}
@@ -0,0 +1,179 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - Master Server
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _SERVERINDEX_H_
+#define _SERVERINDEX_H_
+
+#include "tnl.h"
+#include "tnlVector.h"
+#include "tnlNetStringTable.h"
+#include "tnlUDP.h"
+
+using namespace TNL;
+
+/// The filter fields of a listed game server.
+struct ServerInfo
+{
+   StringTableEntry gameString;  ///< The unique game string the server was registered with.
+   StringTableEntry gameType;    ///< Current game type.
+   StringTableEntry missionType; ///< Current mission type.
+   U32 regionCode;               ///< Bitmask of the regions the server operates in.
+   U32 cpuSpeed;
+   U32 infoFlags;
+   U32 playerCount;
+   U32 numBots;
+   IPAddress address;
+};
+
+/// A client's server list filter, as sent in c2mQueryServers.
+struct ServerQuery
+{
+   StringTableEntry gameString;
+   StringTableEntry gameType;    ///< Null matches any game type.
+   StringTableEntry missionType; ///< Null matches any mission type.
+   U32 regionMask;
+   U32 minPlayers;
+   U32 maxPlayers;
+   U32 infoFlags;
+   U32 maxBots;
+   U32 minCPUSpeed;
+
+   /// Returns true if the server passes every criterion of this query.
+   bool matches(const ServerInfo &info) const;
+
+   bool operator==(const ServerQuery &q) const;
+};
+
+/// ServerIndex keeps the listed game servers in secondary indexes so that
+/// server list queries don't have to test every server on the master.
+///
+/// Servers are grouped by game string.  Within a group each server is also
+/// listed by game type, under every region bit it operates in, and in a
+/// bucket for its player count.  A query estimates the size of each index
+/// that applies to it, walks only the smallest, and applies the full filter
+/// to the servers it finds there.
+///
+/// The result of a query is cached; an identical query is answered from the
+/// cache while the index hasn't changed, or for QueryCacheLifetime
+/// milliseconds if it has.
+class ServerIndex
+{
+public:
+   enum {
+      RegionBits = 32,
+      PlayerCountBuckets = 64,     ///< Servers with at least this many players share the last bucket.
+      QueryCacheSize = 64,         ///< Number of recent query results kept.
+      QueryCacheLifetime = 2000,   ///< Milliseconds a result is reused after the index changes.
+   };
+
+   /// A server's membership in the index.  The owner fills in info before
+   /// adding the entry and changes it only through update.
+   class Entry
+   {
+      friend class ServerIndex;
+
+      S32 mGroup;                      ///< Index of the game string group, or -1 if not listed.
+      S32 mAllSlot;
+      S32 mGameTypeList;
+      S32 mGameTypeSlot;
+      S32 mPlayerBucket;
+      S32 mPlayerSlot;
+      S32 mRegionSlot[RegionBits];
+      U32 mQueryStamp;                 ///< Marks entries already visited by the current query.
+   public:
+      ServerInfo info;
+
+      Entry() { mGroup = -1; mQueryStamp = 0; }
+      bool isListed() const { return mGroup != -1; }
+   };
+
+private:
+   struct GameTypeList
+   {
+      StringTableEntry gameType;
+      Vector<Entry *> servers;
+   };
+
+   struct Group
+   {
+      StringTableEntry gameString;
+      Vector<Entry *> all;
+      Vector<GameTypeList> gameTypes;
+      Vector<Entry *> regions[RegionBits];
+      Vector<Entry *> players[PlayerCountBuckets];
+   };
+
+   struct CachedQuery
+   {
+      ServerQuery query;
+      U32 time;
+      U32 generation;
+      Vector<IPAddress> results;
+   };
+
+   Vector<Group> mGroups;
+   Vector<CachedQuery> mCache;
+   U32 mGeneration;    ///< Incremented whenever the index changes.
+   U32 mQueryStamp;
+
+   U32 mQueries;
+   U32 mCacheHits;
+   U32 mServersTested;
+
+   static void insert(Vector<Entry *> &list, Entry *entry, S32 &slot);
+   static void remove(Vector<Entry *> &list, S32 slot, S32 Entry::*slotMember);
+   static void removeRegion(Vector<Entry *> &list, S32 slot, U32 bit);
+
+   S32 findGroup(const StringTableEntry &gameString);
+   S32 findGameType(Group &group, const StringTableEntry &gameType);
+   static U32 getPlayerBucket(U32 playerCount);
+
+   void link(Entry *entry);
+   void unlink(Entry *entry);
+   void runQuery(const ServerQuery &query, Vector<IPAddress> &results);
+public:
+   ServerIndex();
+
+   /// Lists a server.
+   void add(Entry *entry);
+
+   /// Changes the filter fields of a listed server.
+   void update(Entry *entry, const ServerInfo &info);
+
+   /// Removes a server from the index.
+   void remove(Entry *entry);
+
+   /// Returns the addresses of all the servers that match query.  The
+   /// returned list is valid until the next call to query.  With
+   /// requireCurrent set, a cached result is only used if the index hasn't
+   /// changed since it was made.
+   const Vector<IPAddress> &query(const ServerQuery &query, U32 currentTime, bool requireCurrent = false);
+
+   /// Logs query and cache statistics, then resets them.
+   void logStats();
+};
+
+#endif
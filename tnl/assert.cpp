@@ -51,6 +51,9 @@ void Assert::processAssert(const char *filename, U32 lineNumber, const char  *me
 {
    processing = true;
 
+   // make sure everything leading up to the assert makes it out of the log
+   flushLog();
+
    char buffer[2048];
    dSprintf(buffer, sizeof(buffer), "Fatal: (%s: %ld)", filename, lineNumber);
 #ifdef TNL_DEBUG
@@ -54,6 +54,7 @@ void BitStream::reset()
    mCompressRelative = false;
    mStringBuffer[0] = 0;
    mStringTable = NULL;
+   mFieldCoder = NULL;
 }
 
 U8 *BitStream::getBytePtr()
@@ -526,6 +527,24 @@ void BitStream::writeStringTableEntry(const StringTableEntry &ste)
    else
       writeString(ste.getString());
 }
+
+//----------------------------------------------------------------------------
+
+void BitStream::writeCodedInt(U32 value, U8 bitCount, CodedField &field)
+{
+   if(mFieldCoder)
+      mFieldCoder->writeInt(this, value, bitCount, field);
+   else
+      writeInt(value, bitCount);
+}
+
+U32 BitStream::readCodedInt(U8 bitCount, CodedField &field)
+{
+   if(mFieldCoder)
+      return mFieldCoder->readInt(this, bitCount, field);
+   else
+      return readInt(bitCount);
+}
 //------------------------------------------------------------------------------
 
 void BitStream::hashAndEncrypt(U32 hashDigestSize, U32 encryptStartOffset, SymmetricCipher *theCipher)
@@ -32,43 +32,82 @@
 
 namespace TNL {
 
+ClientPuzzleManager::NonceTable::NonceTable(const SipHash *hash)
+{
+   mHash = hash;
+   mTable = new U64[TableSize];
+   reset();
+}
+
+ClientPuzzleManager::NonceTable::~NonceTable()
+{
+   delete[] mTable;
+}
+
 void ClientPuzzleManager::NonceTable::reset()
 {
-   mChunker.freeBlocks();
-   mHashTableSize = Random::readI(MinHashTableSize, MaxHashTableSize) * 2 + 1;
-   mHashTable = (Entry **) mChunker.alloc(sizeof(Entry *) * mHashTableSize);
-   for(U32 i = 0; i < mHashTableSize; i++)
-      mHashTable[i] = NULL;
+   memset(mTable, 0, sizeof(U64) * TableSize);
+   mEntryCount = 0;
+   mHasZeroNonce = false;
 }
 
-bool ClientPuzzleManager::NonceTable::checkAdd(Nonce &theNonce)
+static inline U64 getNonceValue(const Nonce &theNonce)
 {
-   U32 nonce1 = readU32FromBuffer(theNonce.data);
-   U32 nonce2 = readU32FromBuffer(theNonce.data + 4);
+   return (U64(readU32FromBuffer(theNonce.data)) << 32) | readU32FromBuffer(theNonce.data + 4);
+}
 
-   U64 fullNonce = (U64(nonce1) << 32) | nonce2;
+U32 ClientPuzzleManager::NonceTable::findSlot(U64 nonce) const
+{
+   // linear probing always ends at an empty slot, since the table is
+   // never allowed to fill completely.
+   U32 index = U32(mHash->hash(&nonce, sizeof(nonce))) & (TableSize - 1);
+   while(mTable[index] && mTable[index] != nonce)
+      index = (index + 1) & (TableSize - 1);
+   return index;
+}
 
-   U32 hashIndex = U32(fullNonce % mHashTableSize);
-   for(Entry *walk = mHashTable[hashIndex]; walk; walk = walk->mHashNext)
-      if(walk->mNonce == theNonce)
-         return false;
-   Entry *newEntry = (Entry *) mChunker.alloc(sizeof(Entry));
-   newEntry->mNonce = theNonce;
-   newEntry->mHashNext = mHashTable[hashIndex];
-   mHashTable[hashIndex] = newEntry;
+bool ClientPuzzleManager::NonceTable::contains(const Nonce &theNonce) const
+{
+   U64 nonce = getNonceValue(theNonce);
+   if(!nonce)
+      return mHasZeroNonce;
+   return mTable[findSlot(nonce)] == nonce;
+}
+
+bool ClientPuzzleManager::NonceTable::add(const Nonce &theNonce)
+{
+   U64 nonce = getNonceValue(theNonce);
+   if(!nonce)
+   {
+      mHasZeroNonce = true;
+      return true;
+   }
+   U32 slot = findSlot(nonce);
+   if(mTable[slot] == nonce)
+      return true;
+   if(isFull())
+      return false;
+   mTable[slot] = nonce;
+   mEntryCount++;
    return true;
 }
 
 ClientPuzzleManager::ClientPuzzleManager()
 {
    mCurrentDifficulty = InitialPuzzleDifficulty;
+   mLastDifficulty = InitialPuzzleDifficulty;
    mLastUpdateTime = 0;
    mLastTickTime = 0;
+   mLoadIntervalStart = 0;
+   mIntervalSolutions = 0;
+   mQuietIntervals = 0;
+   mSolutionsChecked = 0;
+   mSolutionsAccepted = 0;
    Random::read(mCurrentNonce.data, Nonce::NonceSize);
    Random::read(mLastNonce.data, Nonce::NonceSize);
 
-   mCurrentNonceTable = new NonceTable;
-   mLastNonceTable = new NonceTable;
+   mCurrentNonceTable = new NonceTable(&mNonceHash);
+   mLastNonceTable = new NonceTable(&mNonceHash);
 }
 
 ClientPuzzleManager::~ClientPuzzleManager()
@@ -77,31 +116,71 @@ ClientPuzzleManager::~ClientPuzzleManager()
    delete mLastNonceTable;
 }
 
-void ClientPuzzleManager::tick(U32 currentTime)
+void ClientPuzzleManager::refreshNonce(U32 currentTime)
 {
-   if(!mLastTickTime)
-      mLastTickTime = currentTime;
+   mLastUpdateTime = currentTime;
+   mLastNonce = mCurrentNonce;
+   mLastDifficulty = mCurrentDifficulty;
+   NonceTable *tempTable = mLastNonceTable;
+   mLastNonceTable = mCurrentNonceTable;
+   mCurrentNonceTable = tempTable;
 
-   // use delta of last tick time and current time to manage puzzle
-   // difficulty.
+   mCurrentNonceTable->reset();
+   Random::read(mCurrentNonce.data, Nonce::NonceSize);
+}
 
-   // not yet implemented.
+void ClientPuzzleManager::updateDifficulty(U32 currentTime)
+{
+   if(currentTime - mLoadIntervalStart < LoadInterval)
+      return;
 
+   U32 solutions = mIntervalSolutions;
+   mLoadIntervalStart = currentTime;
+   mIntervalSolutions = 0;
 
-   // see if it's time to refresh the current puzzle:
-   U32 timeDelta = currentTime - mLastUpdateTime;
-   if(timeDelta > PuzzleRefreshTime)
+   if(solutions > RaiseDifficultyRate)
    {
-      mLastUpdateTime = currentTime;
-      mLastNonce = mCurrentNonce;
-      NonceTable *tempTable = mLastNonceTable;
-      mLastNonceTable = mCurrentNonceTable;
-      mCurrentNonceTable = tempTable;
-
-      mLastNonce = mCurrentNonce;
-      mCurrentNonceTable->reset();
-      Random::read(mCurrentNonce.data, Nonce::NonceSize);
+      mQuietIntervals = 0;
+      if(mCurrentDifficulty < MaxAdaptiveDifficulty)
+      {
+         // Solutions to the old puzzle stay good at the old difficulty
+         // under the last nonce, so clients part way through solving
+         // it aren't turned away.
+         mCurrentDifficulty++;
+         refreshNonce(currentTime);
+      }
    }
+   else if(solutions < LowerDifficultyRate && mCurrentDifficulty > InitialPuzzleDifficulty)
+   {
+      if(++mQuietIntervals >= LowerDifficultyDelay)
+      {
+         // Lowering the difficulty keeps the current nonce; solutions at
+         // the higher difficulty are still accepted.
+         mQuietIntervals = 0;
+         mCurrentDifficulty--;
+      }
+   }
+   else
+      mQuietIntervals = 0;
+}
+
+void ClientPuzzleManager::tick(U32 currentTime)
+{
+   if(!mLastTickTime)
+   {
+      mLastTickTime = currentTime;
+      mLoadIntervalStart = currentTime;
+   }
+
+   // use the rate of accepted solutions to manage puzzle difficulty.
+   updateDifficulty(currentTime);
+   mLastTickTime = currentTime;
+
+   // see if it's time to refresh the current puzzle, or if the current
+   // nonce has been used up:
+   U32 timeDelta = currentTime - mLastUpdateTime;
+   if(timeDelta > PuzzleRefreshTime || mCurrentNonceTable->isFull())
+      refreshNonce(currentTime);
 }
 
 bool ClientPuzzleManager::checkOneSolution(U32 solution, Nonce &clientNonce, Nonce &serverNonce, U32 puzzleDifficulty, U32 clientIdentity)
@@ -133,19 +212,33 @@ bool ClientPuzzleManager::checkOneSolution(U32 solution, Nonce &clientNonce, Non
 
 ClientPuzzleManager::ErrorCode ClientPuzzleManager::checkSolution(U32 solution, Nonce &clientNonce, Nonce &serverNonce, U32 puzzleDifficulty, U32 clientIdentity)
 {
-   if(puzzleDifficulty != mCurrentDifficulty)
-      return InvalidPuzzleDifficulty;
    NonceTable *theTable = NULL;
+   U32 requiredDifficulty = 0;
    if(serverNonce == mCurrentNonce)
+   {
       theTable = mCurrentNonceTable;
+      requiredDifficulty = mCurrentDifficulty;
+   }
    else if(serverNonce == mLastNonce)
+   {
       theTable = mLastNonceTable;
+      requiredDifficulty = mLastDifficulty;
+   }
    if(!theTable)
       return InvalidServerNonce;
+   if(puzzleDifficulty < requiredDifficulty || puzzleDifficulty > MaxPuzzleDifficulty)
+      return InvalidPuzzleDifficulty;
+   if(theTable->contains(clientNonce))
+      return InvalidClientNonce;
+
+   mSolutionsChecked++;
    if(!checkOneSolution(solution, clientNonce, serverNonce, puzzleDifficulty, clientIdentity))
       return InvalidSolution;
-   if(!theTable->checkAdd(clientNonce))
-      return InvalidClientNonce;
+   if(!theTable->add(clientNonce))
+      return InvalidServerNonce;
+
+   mSolutionsAccepted++;
+   mIntervalSolutions++;
    return Success;
 }
 
@@ -34,28 +34,77 @@ namespace TNL {
 //--------------------------------------------------------------------
 static ClassChunker<ConnectionStringTable::PacketEntry> packetEntryFreeList(4096);
 
-ConnectionStringTable::ConnectionStringTable(NetConnection *parent)
+ConnectionStringTable::ConnectionStringTable(NetConnection *parent, U32 entryBitSize)
 {
    mParent = parent;
-   for(U32 i = 0; i < EntryCount; i++)
+   mEntryTable = NULL;
+   mHashTable = NULL;
+   mRemoteStringTable = NULL;
+   mEntryBitSize = 0;
+   mEntryCount = 0;
+   mLastWriteIndex = 0;
+   mLastReadIndex = 0;
+   mSeedBits = 0;
+   setEntryBitSize(entryBitSize);
+}
+
+ConnectionStringTable::~ConnectionStringTable()
+{
+   freeTables();
+}
+
+void ConnectionStringTable::allocTables()
+{
+   mEntryCount = 1 << mEntryBitSize;
+   mEntryTable = new Entry[mEntryCount];
+   mHashTable = new Entry *[mEntryCount];
+   mRemoteStringTable = new StringTableEntry[mEntryCount];
+
+   for(U32 i = 0; i < mEntryCount; i++)
    {
       mEntryTable[i].nextHash = NULL;
       mEntryTable[i].nextLink = &mEntryTable[i+1];
       mEntryTable[i].prevLink = &mEntryTable[i-1];
       mEntryTable[i].index = i;
+      mEntryTable[i].receiveConfirmed = false;
       mHashTable[i] = NULL;
    }
    mLRUHead.nextLink = &mEntryTable[0];
    mEntryTable[0].prevLink = &mLRUHead;
-   mLRUTail.prevLink = &mEntryTable[EntryCount-1];
-   mEntryTable[EntryCount-1].nextLink = &mLRUTail;
+   mLRUTail.prevLink = &mEntryTable[mEntryCount-1];
+   mEntryTable[mEntryCount-1].nextLink = &mLRUTail;
 }
 
-void ConnectionStringTable::writeStringTableEntry(BitStream *stream, StringTableEntryRef string)
+void ConnectionStringTable::freeTables()
+{
+   delete[] mEntryTable;
+   delete[] mHashTable;
+   delete[] mRemoteStringTable;
+   mEntryTable = NULL;
+   mHashTable = NULL;
+   mRemoteStringTable = NULL;
+}
+
+void ConnectionStringTable::setEntryBitSize(U32 entryBitSize)
+{
+   if(entryBitSize < MinEntryBitSize)
+      entryBitSize = MinEntryBitSize;
+   else if(entryBitSize > MaxEntryBitSize)
+      entryBitSize = MaxEntryBitSize;
+
+   if(mEntryTable && entryBitSize == mEntryBitSize)
+      return;
+
+   TNLAssert(mSeeds.size() == 0, "Cannot resize a seeded string table.");
+   freeTables();
+   mEntryBitSize = entryBitSize;
+   allocTables();
+}
+
+bool ConnectionStringTable::findEntry(StringTableEntryRef string, Entry *&entry)
 {
    // see if the entry is in the hash table right now
-   U32 hashIndex = string.getIndex() % EntryCount;
-   Entry *sendEntry = NULL;
+   U32 hashIndex = string.getIndex() & (mEntryCount - 1);
    for(Entry *walk = mHashTable[hashIndex]; walk; walk = walk->nextHash)
    {
       if(walk->string == string)
@@ -63,38 +112,153 @@ void ConnectionStringTable::writeStringTableEntry(BitStream *stream, StringTable
          // it's in the table
          // first, push it to the back of the LRU list.
          pushBack(walk);
-         sendEntry = walk;
-         break;
+         entry = walk;
+         return true;
       }
    }
-   if(!sendEntry)
-   {
-      // not in the hash table, means we have to add it
-      // pull the new entry from the LRU list.
-      sendEntry = mLRUHead.nextLink;
 
-      // push it to the end of the LRU list
-      pushBack(sendEntry);
+   // not in the hash table, means we have to add it
+   // pull the new entry from the LRU list.
+   entry = mLRUHead.nextLink;
+
+   // push it to the end of the LRU list
+   pushBack(entry);
 
-      // remove the string from the hash table
-      Entry **hashWalk;
-      for (hashWalk = &mHashTable[sendEntry->string.getIndex() % EntryCount]; *hashWalk; hashWalk = &((*hashWalk)->nextHash))
+   // remove the string from the hash table
+   Entry **hashWalk;
+   for (hashWalk = &mHashTable[entry->string.getIndex() & (mEntryCount - 1)]; *hashWalk; hashWalk = &((*hashWalk)->nextHash))
+   {
+      if(*hashWalk == entry)
       {
-         if(*hashWalk == sendEntry)
-         {
-            *hashWalk = sendEntry->nextHash;
-            break;
-         }
+         *hashWalk = entry->nextHash;
+         break;
       }
-      
-      sendEntry->string = string;
-      sendEntry->receiveConfirmed = false;
-      sendEntry->nextHash = mHashTable[hashIndex];
-      mHashTable[hashIndex] = sendEntry;
    }
-   stream->writeInt(sendEntry->index, EntryBitSize);
-   if(!stream->writeFlag(sendEntry->receiveConfirmed))
+   
+   entry->string = string;
+   entry->receiveConfirmed = false;
+   entry->nextHash = mHashTable[hashIndex];
+   mHashTable[hashIndex] = entry;
+   return false;
+}
+
+// indexes are written as the distance forward from the last index
+// written in the packet when that is small, which it is for strings that
+// were added to the table together (like the seeds, or a burst of new
+// names) and are sent together.
+void ConnectionStringTable::writeIndex(BitStream *stream, U32 index)
+{
+   U32 delta = (index - mLastWriteIndex) & (mEntryCount - 1);
+   if(stream->writeFlag(delta < (1 << DeltaBitSize)))
+      stream->writeInt(delta, DeltaBitSize);
+   else
+      stream->writeInt(index, mEntryBitSize);
+   mLastWriteIndex = index;
+}
+
+U32 ConnectionStringTable::readIndex(BitStream *stream)
+{
+   U32 index;
+   if(stream->readFlag())
+      index = (mLastReadIndex + stream->readInt(DeltaBitSize)) & (mEntryCount - 1);
+   else
+      index = stream->readInt(mEntryBitSize);
+   mLastReadIndex = index;
+   return index;
+}
+
+bool ConnectionStringTable::addSeed(StringTableEntryRef string)
+{
+   if(string.isNull())
+      return true;
+
+   U32 bits = U32(strlen(string.getString()) + 1) << 3;
+   if(U32(mSeeds.size()) >= mEntryCount || mSeedBits + bits > SeedBitBudget)
+      return false;
+
+   Entry *entry;
+   if(findEntry(string, entry))
+      return true;
+
+   // the other side will have the string as soon as the connection is
+   // established, so there's no need to wait for a packet to confirm it.
+   entry->receiveConfirmed = true;
+   mSeeds.push_back(entry);
+   mSeedBits += bits;
+   return true;
+}
+
+void ConnectionStringTable::writeSeeds(BitStream *stream)
+{
+   stream->writeInt(mSeeds.size(), mEntryBitSize + 1);
+   mLastWriteIndex = 0;
+   for(S32 i = 0; i < mSeeds.size(); i++)
+   {
+      writeIndex(stream, mSeeds[i]->index);
+      stream->writeString(mSeeds[i]->string.getString());
+   }
+   mLastWriteIndex = 0;
+   mStats.seeds = mSeeds.size();
+}
+
+void ConnectionStringTable::readSeeds(BitStream *stream)
+{
+   U32 count = stream->readInt(mEntryBitSize + 1);
+   mLastReadIndex = 0;
+   char buf[256];
+   for(U32 i = 0; i < count && stream->isValid(); i++)
+   {
+      U32 index = readIndex(stream);
+      stream->readString(buf);
+      mRemoteStringTable[index].set(buf);
+   }
+   mLastReadIndex = 0;
+}
+
+void ConnectionStringTable::getWriteMark(WriteMark &mark)
+{
+   mark.lastIndex = mLastWriteIndex;
+   mark.tail = mParent->getCurrentWritePacketNotify()->stringList.stringTail;
+}
+
+void ConnectionStringTable::rewindToWriteMark(const WriteMark &mark)
+{
+   mLastWriteIndex = mark.lastIndex;
+
+   PacketList *note = &mParent->getCurrentWritePacketNotify()->stringList;
+   PacketEntry *walk = mark.tail ? mark.tail->nextInPacket : note->stringHead;
+   while(walk)
+   {
+      PacketEntry *next = walk->nextInPacket;
+      packetEntryFreeList.free(walk);
+      walk = next;
+   }
+   if(mark.tail)
+      mark.tail->nextInPacket = NULL;
+   else
+      note->stringHead = NULL;
+   note->stringTail = mark.tail;
+}
+
+void ConnectionStringTable::writeStringTableEntry(BitStream *stream, StringTableEntryRef string)
+{
+   U32 start = stream->getBitPosition();
+   Entry *sendEntry;
+   bool found = findEntry(string, sendEntry);
+
+   writeIndex(stream, sendEntry->index);
+   if(stream->writeFlag(sendEntry->receiveConfirmed))
    {
+      mStats.hits++;
+      mStats.bytesSaved += strlen(string.getString());
+   }
+   else
+   {
+      if(found)
+         mStats.unconfirmed++;
+      else
+         mStats.misses++;
+
       stream->writeString(sendEntry->string.getString());
       PacketEntry *entry = packetEntryFreeList.alloc();
 
@@ -110,11 +274,12 @@ void ConnectionStringTable::writeStringTableEntry(BitStream *stream, StringTable
          note->stringTail->nextInPacket = entry;
       note->stringTail = entry;
    }
+   mStats.bitsSent += stream->getBitPosition() - start;
 }
 
 StringTableEntry ConnectionStringTable::readStringTableEntry(BitStream *stream)
 {
-   U32 index = stream->readInt(EntryBitSize);
+   U32 index = readIndex(stream);
 
    char buf[256];
    if(!stream->readFlag())
@@ -32,6 +32,45 @@
 
 namespace TNL {
 
+NetEvent::~NetEvent()
+{
+   free(mSharedData);
+}
+
+void NetEvent::writeShared(BitStream *bstream)
+{
+   if(mPostCount < 2)
+   {
+      packShared(bstream);
+      return;
+   }
+   if(!mSharedData)
+   {
+      // Pack into a stream of our own, with an empty string buffer so
+      // the packed strings don't refer back to strings written before
+      // them in some other packet.
+      PacketStream sharedStream;
+      packShared(&sharedStream);
+      if(!sharedStream.isValid())
+      {
+         packShared(bstream);
+         return;
+      }
+      mSharedBitCount = sharedStream.getBitPosition();
+      U32 byteCount = (mSharedBitCount + 7) >> 3;
+      mSharedData = (U8 *) malloc(byteCount ? byteCount : 1);
+      memcpy(mSharedData, sharedStream.getBuffer(), byteCount);
+   }
+   bstream->writeBits(mSharedBitCount, mSharedData);
+
+   // the reader's string buffer now holds the last string in the shared
+   // data, which this stream never saw.  Clearing the writer's buffer
+   // keeps the next string from being compressed against the wrong one.
+   bstream->clearStringBuffer();
+}
+
+//-----------------------------------------------------------------------------
+
 ClassChunker<EventConnection::EventNote> EventConnection::mEventNoteChunker;
 
 EventConnection::EventConnection()
@@ -130,6 +169,7 @@ bool EventConnection::readConnectAccept(BitStream *stream, const char **errorStr
    if(!NetClassRep::isVersionBorderCount(getNetClassGroup(), NetClassTypeEvent, mEventClassCount))
       return false;
 
+   mEventClassVersion = NetClassRep::getClass(getNetClassGroup(), NetClassTypeEvent, mEventClassCount-1)->getClassVersion();
    mEventClassBitSize = getNextBinLog2(mEventClassCount);
    return true;
 }
@@ -230,6 +270,14 @@ void EventConnection::packetReceived(PacketNotify *pnotify)
    }
 }
 
+static void profileEvent(NetConnectionProfile &profile, NetEvent *theEvent, U32 bitCount, F64 packMs)
+{
+   NetProfiler::recordEvent(theEvent->getClassRep(), bitCount, packMs);
+   profile.eventCount++;
+   profile.eventBits += bitCount;
+   profile.addSample(packMs);
+}
+
 void EventConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
 {
    Parent::writePacket(bstream, pnotify);
@@ -248,6 +296,9 @@ void EventConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
       // get the first event
       EventNote *ev = mUnorderedSendEventQueueHead;
 
+      ConnectionStringTable::WriteMark stringMark;
+      getStringWriteMark(stringMark);
+
       bstream->writeFlag(true);
       S32 start = bstream->getBitPosition();
 
@@ -257,7 +308,10 @@ void EventConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
       S32 classId = ev->mEvent->getClassId(getNetClassGroup());
       bstream->writeInt(classId, mEventClassBitSize);
 
+      NetProfileSample sample;
       ev->mEvent->pack(this, bstream);
+      F64 packMs = sample.getElapsedMs();
+      U32 eventBits = bstream->getBitPosition() - start;
       TNLLogMessageV(LogEventConnection, ("EventConnection %s: WroteEvent %s - %d bits", getNetAddressString(), ev->mEvent->getDebugName(), bstream->getBitPosition() - start));
 
       if(mConnectionParameters.mDebugObjectSizes)
@@ -268,9 +322,12 @@ void EventConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
          // rewind to before the event, and break out of the loop:
          bstream->setBitPosition(start - 1);
          bstream->clearError();
+         rewindStringWrites(stringMark);
          break;
       }
 
+      profileEvent(getProfile(), ev->mEvent, eventBits, packMs);
+
       // dequeue the event and add this event onto the packet queue
       mUnorderedSendEventQueueHead = ev->mNextEvent;
       ev->mNextEvent = NULL;
@@ -297,6 +354,8 @@ void EventConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
       // get the first event
       EventNote *ev = mSendEventQueueHead;
       S32 eventStart = bstream->getBitPosition();
+      ConnectionStringTable::WriteMark stringMark;
+      getStringWriteMark(stringMark);
 
       bstream->writeFlag(true);
 
@@ -311,9 +370,13 @@ void EventConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
 
       S32 classId = ev->mEvent->getClassId(getNetClassGroup());
       bstream->writeInt(classId, mEventClassBitSize);
+
+      NetProfileSample sample;
       ev->mEvent->pack(this, bstream);
+      F64 packMs = sample.getElapsedMs();
+      U32 eventBits = bstream->getBitPosition() - start;
 
-      ev->mEvent->getClassRep()->addInitialUpdate(bstream->getBitPosition() - start);
+      ev->mEvent->getClassRep()->addInitialUpdate(eventBits);
       TNLLogMessageV(LogEventConnection, ("EventConnection %s: WroteEvent %s - %d bits", getNetAddressString(), ev->mEvent->getDebugName(), bstream->getBitPosition() - start));
 
       if(mConnectionParameters.mDebugObjectSizes)
@@ -324,9 +387,12 @@ void EventConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
          // rewind to before the event, and break out of the loop:
          bstream->setBitPosition(eventStart);
          bstream->clearError();
+         rewindStringWrites(stringMark);
          break;
       }
 
+      profileEvent(getProfile(), ev->mEvent, eventBits, packMs);
+
       // dequeue the event:
       mSendEventQueueHead = ev->mNextEvent;      
       ev->mNextEvent = NULL;
@@ -462,6 +528,7 @@ bool EventConnection::postNetEvent(NetEvent *theEvent)
       return false;
 
    theEvent->notifyPosted(this);
+   theEvent->mPostCount++;
 
    EventNote *event = mEventNoteChunker.alloc();
    event->mEvent = theEvent;
@@ -0,0 +1,484 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "tnl.h"
+#include "tnlFieldCoder.h"
+#include "tnlBitStream.h"
+
+namespace TNL {
+
+CodedField *CodedField::mFirstField = NULL;
+U32 CodedField::mFieldCount = 0;
+
+CodedField::CodedField(const char *name, U32 symbolBits)
+{
+   TNLAssert(symbolBits >= 1 && symbolBits <= MaxSymbolBits, "CodedField symbols must be 1 to 8 bits.");
+   mName = name;
+   mSymbolBits = symbolBits;
+   mIndex = mFieldCount++;
+   mNextField = mFirstField;
+   mFirstField = this;
+}
+
+//--------------------------------------------------------------------
+
+void RangeEncoder::reset()
+{
+   mState.low = 0;
+   mState.range = 0xFFFFFFFF;
+   mState.cacheSize = 1;
+   mState.size = 0;
+   mState.shiftCount = 0;
+   mState.cache = 0;
+   mState.started = false;
+}
+
+void RangeEncoder::writeByte(U8 value)
+{
+   // the first byte out only holds the carry out of the top of the
+   // interval, which there never is, so it isn't kept.
+   if(!mState.started)
+   {
+      mState.started = true;
+      return;
+   }
+   TNLAssert(mState.size < MaxBytes, "Range coded block overflow.");
+   if(mState.size < MaxBytes)
+      mBuffer[mState.size++] = value;
+}
+
+// the top byte of low can't be written out until it's known whether a
+// carry will reach it.  A byte that isn't 0xFF can take a carry itself, so
+// the pending byte is written when one comes along, with any 0xFF bytes
+// between them, which a carry would have turned into 0x00.
+void RangeEncoder::shiftLow()
+{
+   mState.shiftCount++;
+   if(U32(mState.low) < 0xFF000000 || U32(mState.low >> 32) != 0)
+   {
+      U8 carry = U8(mState.low >> 32);
+      U8 temp = mState.cache;
+      do
+      {
+         writeByte(U8(temp + carry));
+         temp = 0xFF;
+      } while(--mState.cacheSize != 0);
+      mState.cache = U8(U32(mState.low) >> 24);
+   }
+   mState.cacheSize++;
+   mState.low = U32(U32(mState.low) << 8);
+}
+
+void RangeEncoder::encode(U32 start, U32 size, U32 total)
+{
+   U32 scale = mState.range / total;
+   mState.low += U64(scale) * start;
+   mState.range = scale * size;
+   while(mState.range < TopValue)
+   {
+      mState.range <<= 8;
+      shiftLow();
+   }
+}
+
+void RangeEncoder::flush()
+{
+   // end on the value in the final interval with the most zero bits at
+   // the bottom, since the decoder reads zeros past the end of the block.
+   for(U32 shift = 32; shift > 0; shift--)
+   {
+      U64 mask = (U64(1) << shift) - 1;
+      U64 value = (mState.low + mask) & ~mask;
+      if(value < mState.low + mState.range)
+      {
+         mState.low = value;
+         break;
+      }
+   }
+   for(U32 i = 0; i < 5; i++)
+      shiftLow();
+   while(mState.size && mBuffer[mState.size - 1] == 0)
+      mState.size--;
+}
+
+U32 RangeEncoder::getBitSize()
+{
+   if(!mState.size)
+      return 0;
+   U32 bitSize = mState.size << 3;
+   for(U8 last = mBuffer[mState.size - 1]; !(last & 1); last >>= 1)
+      bitSize--;
+   return bitSize;
+}
+
+U32 RangeEncoder::getBitCount()
+{
+   // every shift took 8 bits out of the range, which has narrowed from
+   // 2^32 by the rest.
+   U32 rangeBits = 24 + getBinLog2(mState.range >> 24);
+   return (mState.shiftCount << 3) + 31 - rangeBits;
+}
+
+//--------------------------------------------------------------------
+
+void RangeDecoder::begin(const U8 *buffer, U32 size)
+{
+   mBuffer = buffer;
+   mSize = size;
+   mPosition = 0;
+   mRange = 0xFFFFFFFF;
+   mCode = 0;
+   mScale = 1;
+   for(U32 i = 0; i < 4; i++)
+      mCode = (mCode << 8) | readByte();
+}
+
+U32 RangeDecoder::getFrequency(U32 total)
+{
+   mScale = mRange / total;
+   U32 frequency = mCode / mScale;
+   return frequency < total ? frequency : total - 1;
+}
+
+void RangeDecoder::decode(U32 start, U32 size)
+{
+   mCode -= mScale * start;
+   mRange = mScale * size;
+   while(mRange < RangeEncoder::TopValue)
+   {
+      mCode = (mCode << 8) | readByte();
+      mRange <<= 8;
+   }
+}
+
+//--------------------------------------------------------------------
+
+void ConnectionFieldCoder::PacketList::add(U32 symbol)
+{
+   if(count < U32(symbols.size()))
+      symbols[count] = symbol;
+   else
+      symbols.push_back(symbol);
+   count++;
+}
+
+ConnectionFieldCoder::Model::Model(U32 symbolBits)
+{
+   symbolCount = 1 << symbolBits;
+   frequency.setSize(symbolCount);
+   cumulative.setSize(symbolCount + 1);
+   for(U32 i = 0; i < symbolCount; i++)
+      frequency[i] = 1;
+   total = symbolCount;
+   dirty = true;
+}
+
+void ConnectionFieldCoder::Model::add(U32 symbol)
+{
+   frequency[symbol] += FrequencyIncrement;
+   total += FrequencyIncrement;
+
+   // halve the counts when they get too big for the coder, which also lets
+   // the model follow a field whose values change over a game.
+   if(total >= MaxTotalFrequency)
+   {
+      total = 0;
+      for(U32 i = 0; i < symbolCount; i++)
+      {
+         frequency[i] = (frequency[i] + 1) >> 1;
+         total += frequency[i];
+      }
+   }
+   dirty = true;
+}
+
+void ConnectionFieldCoder::Model::buildCumulative()
+{
+   U32 sum = 0;
+   for(U32 i = 0; i < symbolCount; i++)
+   {
+      cumulative[i] = sum;
+      sum += frequency[i];
+   }
+   cumulative[symbolCount] = sum;
+   dirty = false;
+}
+
+//--------------------------------------------------------------------
+
+ConnectionFieldCoder::ConnectionFieldCoder()
+{
+   for(U32 i = 0; i < HistorySize; i++)
+   {
+      mHistory[i].sequence = 0;
+      mHistory[i].pending = false;
+   }
+   mWriteChecksum = 0;
+   mReadChecksum = 0;
+   mWriteList = NULL;
+   mWriteSymbolBits = 0;
+   mWriteStart = 0;
+   mBlockPosition = 0;
+   mReadList = NULL;
+   mReadBlockBits = 0;
+}
+
+ConnectionFieldCoder::~ConnectionFieldCoder()
+{
+   for(S32 i = 0; i < mWriteModels.size(); i++)
+      delete mWriteModels[i];
+   for(S32 i = 0; i < mReadModels.size(); i++)
+      delete mReadModels[i];
+}
+
+ConnectionFieldCoder::Model *ConnectionFieldCoder::getModel(Vector<Model *> &models, CodedField &field)
+{
+   U32 index = field.getIndex();
+   if(index >= U32(models.size()))
+   {
+      U32 oldSize = models.size();
+      models.setSize(CodedField::getFieldCount());
+      for(U32 i = oldSize; i < U32(models.size()); i++)
+         models[i] = NULL;
+   }
+
+   Model *model = models[index];
+   if(!model)
+      model = models[index] = new Model(field.getSymbolBits());
+
+   // models only change between packets, so the table is built at most
+   // once a packet.
+   if(model->dirty)
+      model->buildCumulative();
+   return model;
+}
+
+void ConnectionFieldCoder::fold(Vector<Model *> &models, U32 &checksum, PacketList *list)
+{
+   for(U32 i = 0; i < list->count; i++)
+   {
+      U32 record = list->symbols[i];
+      models[record >> 8]->add(record & 0xFF);
+      checksum = checksum * 31 + (record & 0xFF) + 1;
+   }
+   list->count = 0;
+}
+
+//--------------------------------------------------------------------
+
+// a packet's coding header is the distance back to its basis and an
+// optional model checksum.  The coded block, its size in bits and then
+// the bits, follows the header, ahead of the packet's ghost updates.
+void ConnectionFieldCoder::beginWritePacket(BitStream *stream, PacketList *note, U32 sequence, U32 basis, bool writeChecksum)
+{
+   TNLAssert(sequence - basis < HistorySize, "Field coder basis out of the packet window.");
+
+   mWriteStart = stream->getBitPosition();
+   stream->writeInt(sequence - basis, BasisBitSize);
+   if(writeChecksum)
+      stream->writeInt(getChecksumBits(mWriteChecksum), ChecksumBitSize);
+   mBlockPosition = stream->getBitPosition();
+
+   mEncoder.reset();
+   mWriteList = note;
+   mWriteList->count = 0;
+   mWriteSymbolBits = 0;
+}
+
+void ConnectionFieldCoder::endWritePacket(BitStream *stream)
+{
+   mStats.codedBits += mEncoder.getBitCount();
+   mEncoder.flush();
+   U32 blockBits = mEncoder.getBitSize();
+
+   // take out the updates written after the header...
+   U32 updateEnd = stream->getBitPosition();
+   U32 updateBits = updateEnd - mBlockPosition;
+   TNLAssert(updateBits <= MaxPacketDataSize << 3, "Ghost updates too large to move.");
+   U8 updates[MaxPacketDataSize];
+   BitStream source(stream->getBuffer(), (updateEnd + 7) >> 3);
+   source.setBitPosition(mBlockPosition);
+   source.readBits(updateBits, updates);
+
+   // ...and put them back after the block.
+   stream->setBitPosition(mBlockPosition);
+   if(stream->writeFlag(blockBits < (1 << ShortSizeBitSize)))
+      stream->writeInt(blockBits, ShortSizeBitSize);
+   else
+      stream->writeInt(blockBits, SizeBitSize);
+   if(blockBits)
+   {
+      // the bits of the last byte that are used are the top ones.
+      U32 fullBytes = (blockBits - 1) >> 3;
+      U32 lastBits = blockBits - (fullBytes << 3);
+      stream->writeBits(fullBytes << 3, mEncoder.getBuffer());
+      stream->writeInt(mEncoder.getBuffer()[fullBytes] >> (8 - lastBits), lastBits);
+   }
+   stream->writeBits(updateBits, updates);
+
+   mStats.packets++;
+   mStats.symbols += mWriteList->count;
+   mStats.symbolBits += mWriteSymbolBits;
+   mStats.blockBits += stream->getBitPosition() - updateBits - mWriteStart;
+   mWriteList = NULL;
+}
+
+void ConnectionFieldCoder::getWriteMark(WriteMark &mark)
+{
+   mark.encoderState = mEncoder.getState();
+   mark.symbolCount = mWriteList->count;
+   mark.symbolBits = mWriteSymbolBits;
+}
+
+void ConnectionFieldCoder::rewindToWriteMark(const WriteMark &mark)
+{
+   mEncoder.setState(mark.encoderState);
+   mWriteList->count = mark.symbolCount;
+   mWriteSymbolBits = mark.symbolBits;
+}
+
+void ConnectionFieldCoder::writeInt(BitStream *stream, U32 value, U8 bitCount, CodedField &field)
+{
+   if(!bitCount)
+      return;
+
+   U32 symbolBits = getMin(U32(bitCount), field.getSymbolBits());
+   U32 rawBits = bitCount - symbolBits;
+   if(rawBits)
+      stream->writeInt(value & ((1 << rawBits) - 1), rawBits);
+
+   U32 symbol = (value >> rawBits) & ((1 << symbolBits) - 1);
+   Model *model = getModel(mWriteModels, field);
+   mEncoder.encode(model->cumulative[symbol], model->frequency[symbol], model->total);
+
+   mWriteList->add((field.getIndex() << 8) | symbol);
+   mWriteSymbolBits += symbolBits;
+}
+
+//--------------------------------------------------------------------
+
+bool ConnectionFieldCoder::beginReadPacket(BitStream *stream, U32 sequence, bool readChecksum)
+{
+   U32 basis = sequence - stream->readInt(BasisBitSize);
+
+   // fold in the packets the sender knew had arrived when it wrote this
+   // one, oldest first, as it did.  A packet stays pending until one with
+   // a coded block arrives, which may be long after the packet window has
+   // moved past it, when ghosting stops for a level change, so every
+   // pending packet up to the basis is folded, however old.
+   for(;;)
+   {
+      ReceivedPacket *oldest = NULL;
+      for(U32 i = 0; i < HistorySize; i++)
+      {
+         ReceivedPacket &packet = mHistory[i];
+         if(packet.pending && S32(basis - packet.sequence) >= 0 &&
+               (!oldest || S32(oldest->sequence - packet.sequence) > 0))
+            oldest = &packet;
+      }
+      if(!oldest)
+         break;
+      fold(mReadModels, mReadChecksum, &oldest->list);
+      oldest->pending = false;
+   }
+
+   if(readChecksum && stream->readInt(ChecksumBitSize) != getChecksumBits(mReadChecksum))
+      return false;
+
+   U32 blockPosition = stream->getBitPosition();
+   U32 blockBits = stream->readFlag() ? stream->readInt(ShortSizeBitSize) : stream->readInt(SizeBitSize);
+   if(blockBits > RangeEncoder::MaxBytes << 3)
+      return false;
+
+   U32 size = 0;
+   if(blockBits)
+   {
+      U32 fullBytes = (blockBits - 1) >> 3;
+      U32 lastBits = blockBits - (fullBytes << 3);
+      stream->readBits(fullBytes << 3, mReadBlock);
+      mReadBlock[fullBytes] = U8(stream->readInt(lastBits) << (8 - lastBits));
+      size = fullBytes + 1;
+   }
+   if(!stream->isValid())
+      return false;
+   mReadBlockBits = stream->getBitPosition() - blockPosition;
+
+   // a packet still pending in this slot would be lost to the models, so
+   // the connection can't stay in step with the sender any more.
+   ReceivedPacket &packet = mHistory[sequence % HistorySize];
+   if(packet.pending)
+      return false;
+   packet.sequence = sequence;
+   packet.pending = true;
+   packet.list.count = 0;
+   mReadList = &packet.list;
+
+   mDecoder.begin(mReadBlock, size);
+   return true;
+}
+
+U32 ConnectionFieldCoder::readInt(BitStream *stream, U8 bitCount, CodedField &field)
+{
+   if(!bitCount)
+      return 0;
+
+   U32 symbolBits = getMin(U32(bitCount), field.getSymbolBits());
+   U32 rawBits = bitCount - symbolBits;
+   U32 raw = rawBits ? stream->readInt(rawBits) : 0;
+
+   Model *model = getModel(mReadModels, field);
+   U32 frequency = mDecoder.getFrequency(model->total);
+
+   // find the symbol whose share of the model holds frequency.
+   U32 low = 0;
+   U32 high = model->symbolCount - 1;
+   while(low < high)
+   {
+      U32 mid = (low + high + 1) >> 1;
+      if(model->cumulative[mid] <= frequency)
+         low = mid;
+      else
+         high = mid - 1;
+   }
+   mDecoder.decode(model->cumulative[low], model->frequency[low]);
+
+   mReadList->add((field.getIndex() << 8) | low);
+   return (low << rawBits) | raw;
+}
+
+//--------------------------------------------------------------------
+
+void ConnectionFieldCoder::packetReceived(PacketList *note)
+{
+   fold(mWriteModels, mWriteChecksum, note);
+}
+
+void ConnectionFieldCoder::packetDropped(PacketList *note)
+{
+   note->count = 0;
+}
+
+};
@@ -33,6 +33,8 @@
 
 namespace TNL {
 
+ClassChunker<GhostConnection::GhostRef> GhostConnection::mGhostRefChunker;
+
 GhostConnection::GhostConnection()
 {
    // ghost management data:
@@ -45,11 +47,13 @@ GhostConnection::GhostConnection()
    mGhostLookupTable = NULL;
    mLocalGhosts = NULL;
    mGhostZeroUpdateIndex = 0;
+   mFieldCoder = NULL;
 }
 
 GhostConnection::~GhostConnection()
 {
    clearAllPacketNotifies();
+   delete mFieldCoder;
 
    // delete any ghosts that may exist for this connection, but aren't added
    if(mGhostArray)
@@ -97,11 +101,58 @@ void GhostConnection::setGhostFrom(bool ghostFrom)
    }
 }
 
+void GhostConnection::setFieldCoding(bool enabled)
+{
+   if(enabled && !mFieldCoder)
+      mFieldCoder = new ConnectionFieldCoder;
+   else if(!enabled)
+   {
+      delete mFieldCoder;
+      mFieldCoder = NULL;
+   }
+}
+
+void GhostConnection::writeConnectRequest(BitStream *stream)
+{
+   Parent::writeConnectRequest(stream);
+   stream->writeFlag(mFieldCoder != NULL);
+}
+
+bool GhostConnection::readConnectRequest(BitStream *stream, const char **errorString)
+{
+   if(!Parent::readConnectRequest(stream, errorString))
+      return false;
+
+   // fields are only coded if both sides want them to be.
+   if(!stream->readFlag())
+      setFieldCoding(false);
+   return true;
+}
+
+void GhostConnection::writeConnectAccept(BitStream *stream)
+{
+   Parent::writeConnectAccept(stream);
+   stream->writeFlag(mFieldCoder != NULL);
+}
+
+bool GhostConnection::readConnectAccept(BitStream *stream, const char **errorString)
+{
+   if(!Parent::readConnectAccept(stream, errorString))
+      return false;
+
+   if(!stream->readFlag())
+      setFieldCoding(false);
+   return true;
+}
+
 void GhostConnection::packetDropped(PacketNotify *pnotify)
 {
    Parent::packetDropped(pnotify);
    GhostPacketNotify *notify = static_cast<GhostPacketNotify *>(pnotify);
 
+   if(mFieldCoder)
+      mFieldCoder->packetDropped(&notify->fieldList);
+
    GhostRef *packRef = notify->ghostList;
    // loop through all the packRefs in the packet
  
@@ -151,7 +202,7 @@ void GhostConnection::packetDropped(PacketNotify *pnotify)
          packRef->ghost->flags &= ~GhostInfo::KillingGhost;
       }
 
-      delete packRef;
+      mGhostRefChunker.free(packRef);
       packRef = temp;
    }
 }
@@ -161,6 +212,9 @@ void GhostConnection::packetReceived(PacketNotify *pnotify)
    Parent::packetReceived(pnotify);
    GhostPacketNotify *notify = static_cast<GhostPacketNotify *>(pnotify);
 
+   if(mFieldCoder)
+      mFieldCoder->packetReceived(&notify->fieldList);
+
    GhostRef *packRef = notify->ghostList;
 
    // loop through all the notifies in this packet
@@ -185,7 +239,7 @@ void GhostConnection::packetReceived(PacketNotify *pnotify)
       else if(packRef->ghostInfoFlags & GhostInfo::KillingGhost)
          freeGhostInfo(packRef->ghost);
 
-      delete packRef;
+      mGhostRefChunker.free(packRef);
       packRef = temp;
    }
 }
@@ -306,6 +360,15 @@ void GhostConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
 
    bstream->writeInt(sendSize - 3, 3); // 0-7 3 bit number
 
+   // the updates' coded fields use models that have learned from every
+   // packet acknowledged so far.
+   if(mFieldCoder)
+   {
+      mFieldCoder->beginWritePacket(bstream, &notify->fieldList, getLastSendSequence(),
+            getHighestAckedSequence(), mConnectionParameters.mDebugObjectSizes);
+      bstream->setFieldCoder(mFieldCoder);
+   }
+
    U32 count = 0;
    // 
    for(S32 i = mGhostZeroUpdateIndex - 1; i >= 0 && !bstream->isFull(); i--)
@@ -315,8 +378,16 @@ void GhostConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
 		   continue;
 
       U32 updateStart = bstream->getBitPosition();
+      ConnectionStringTable::WriteMark stringMark;
+      getStringWriteMark(stringMark);
+      ConnectionFieldCoder::WriteMark fieldMark;
+      if(mFieldCoder)
+         mFieldCoder->getWriteMark(fieldMark);
       U32 updateMask = walk->updateMask;
       U32 retMask;
+      U32 updateBits = 0;
+      F64 packMs = -1;
+      bool initialUpdate = false;
 		   
       bstream->writeFlag(true);
       bstream->writeInt(walk->index, sendSize);
@@ -327,6 +398,7 @@ void GhostConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
             bstream->advanceBitPosition(BitStreamPosBitSize);
 
          S32 startPos = bstream->getBitPosition();
+         U32 codedStartPos = bstream->getCodedBitPosition();
 
          if(walk->flags & GhostInfo::NotYetGhosted)
          {
@@ -336,15 +408,20 @@ void GhostConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
          }
 
          // update the object
+         NetProfileSample sample;
+         NetProfiler::beginUpdate(sample.isTimed());
          retMask = walk->obj->packUpdate(this, updateMask, bstream);
+         packMs = sample.getElapsedMs();
+         updateBits = bstream->getCodedBitPosition() - codedStartPos;
 
          if(NetObject::mIsInitialUpdate)
          {
             NetObject::mIsInitialUpdate = false;
-            walk->obj->getClassRep()->addInitialUpdate(bstream->getBitPosition() - startPos);
+            initialUpdate = true;
+            walk->obj->getClassRep()->addInitialUpdate(updateBits);
          }
          else
-            walk->obj->getClassRep()->addPartialUpdate(bstream->getBitPosition() - startPos);
+            walk->obj->getClassRep()->addPartialUpdate(updateBits);
 
          if(mConnectionParameters.mDebugObjectSizes)
             bstream->writeIntAt(bstream->getBitPosition(), BitStreamPosBitSize, startPos - BitStreamPosBitSize);
@@ -355,17 +432,21 @@ void GhostConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
       }
 
       // check for packet overrun, and rewind this update if there
-      // was one:
-      if(bstream->getBitSpaceAvailable() < MinimumPaddingBits)
+      // was one.  The coded block still has to fit after the updates.
+      U32 blockBits = mFieldCoder ? mFieldCoder->getMaxBlockBits() : 0;
+      if(bstream->getBitSpaceAvailable() < MinimumPaddingBits + blockBits)
       {
          bstream->setBitPosition(updateStart);
          bstream->clearError();
+         rewindStringWrites(stringMark);
+         if(mFieldCoder)
+            mFieldCoder->rewindToWriteMark(fieldMark);
          break;
       }
 
       // otherwise, create a record of this ghost update and
       // attach it to the packet.
-      GhostRef *upd = new GhostRef;
+      GhostRef *upd = mGhostRefChunker.alloc();
 
       upd->nextRef = updateList;
       updateList = upd;
@@ -401,6 +482,12 @@ void GhostConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
          upd->mask = updateMask & ~retMask;
          walk->updateSkipCount = 0;
          count++;
+
+         NetProfiler::recordUpdate(walk->obj->getClassRep(), initialUpdate, upd->mask, updateBits, packMs);
+         NetConnectionProfile &profile = getProfile();
+         profile.ghostCount++;
+         profile.ghostBits += updateBits;
+         profile.addSample(packMs);
       }
    }
    // count # of ghosts have been updated,
@@ -408,6 +495,12 @@ void GhostConnection::writePacket(BitStream *bstream, PacketNotify *pnotify)
    // no more objects...
    bstream->writeFlag(false);
    notify->ghostList = updateList;
+
+   if(mFieldCoder)
+   {
+      bstream->setFieldCoder(NULL);
+      mFieldCoder->endWritePacket(bstream);
+   }
 }
 
 void GhostConnection::readPacket(BitStream *bstream)
@@ -429,6 +522,16 @@ void GhostConnection::readPacket(BitStream *bstream)
    idSize = bstream->readInt( 3 );
    idSize += 3;
 
+   if(mFieldCoder)
+   {
+      if(!mFieldCoder->beginReadPacket(bstream, getLastRecvSequence(), mConnectionParameters.mDebugObjectSizes))
+      {
+         setLastError("Invalid packet.");
+         return;
+      }
+      bstream->setFieldCoder(mFieldCoder);
+   }
+
    // while there's an object waiting...
 
    while(bstream->readFlag())
@@ -450,8 +553,15 @@ void GhostConnection::readPacket(BitStream *bstream)
       {
          U32 endPosition = 0;
          if(mConnectionParameters.mDebugObjectSizes)
+         {
             endPosition = bstream->readInt(BitStreamPosBitSize);
 
+            // the coded block was put in front of the updates after they
+            // were written, moving them along by its size.
+            if(mFieldCoder)
+               endPosition += mFieldCoder->getReadBlockBits();
+         }
+
          if(!mLocalGhosts[index]) // it's a new ghost... cool
          {
             S32 classId = bstream->readClassId(NetClassTypeObject, getNetClassGroup());
@@ -507,6 +617,8 @@ void GhostConnection::readPacket(BitStream *bstream)
             return;
       }
    }
+
+   bstream->setFieldCoder(NULL);
 }
 
 //-----------------------------------------------------------------------------
@@ -765,7 +877,7 @@ void GhostConnection::clearGhostInfo()
       while(delWalk)
       {
          GhostRef *next = delWalk->nextRef;
-         delete delWalk;
+         mGhostRefChunker.free(delWalk);
          delWalk = next;
       }
    }
@@ -26,6 +26,7 @@
 
 #include "tnlBitStream.h"
 #include "tnlVector.h"
+#include "tnlEndian.h"
 #include "tnlHuffmanStringProcessor.h"
 
 namespace TNL {
@@ -47,10 +48,27 @@ namespace HuffmanStringProcessor {
       U8  numBits;
       U8  symbol;
       U32 code;   // no code should be longer than 32 bits.
+      U32 streamCode; // code as an integer, first bit in the low bit.
+   };
+
+   enum {
+      DecodeTableBits = 10,
+      DecodeTableSize = 1 << DecodeTableBits,
+   };
+
+   /// Entry in the decode table, indexed by the next DecodeTableBits bits
+   /// of the stream.  If a code of numBits bits or less matches, it decodes
+   /// to symbol.  Otherwise numBits is 0 and the code continues from tree
+   /// node index.
+   struct DecodeEntry {
+      U8  numBits;
+      U8  symbol;
+      S16 node;
    };
 
    Vector<HuffNode> mHuffNodes;
    Vector<HuffLeaf> mHuffLeaves;
+   DecodeEntry mDecodeTable[DecodeTableSize];
 
    void buildTables();
 
@@ -72,6 +90,9 @@ namespace HuffmanStringProcessor {
    S16 determineIndex(HuffWrap&);
 
    void generateCodes(BitStream&, S32, S32);
+   void buildDecodeTable();
+   U32 peekBits(const U8 *buffer, U32 bitPos);
+   U8 decodeLongCode(const U8 *buffer, U32 &bitPos, S32 index);
 };
 
 //bool HuffmanStringProcessor::mTablesBuilt = false;
@@ -153,6 +174,30 @@ void HuffmanStringProcessor::buildTables()
    BitStream bs((U8 *) &code, 4);
 
    generateCodes(bs, 0, 0);
+   buildDecodeTable();
+}
+
+void HuffmanStringProcessor::buildDecodeTable()
+{
+   // walk the tree for every possible DecodeTableBits bit prefix.  The
+   // tree (not a canonical code) is kept so that the bitstream doesn't change.
+   for (U32 i = 0; i < DecodeTableSize; i++) {
+      DecodeEntry& rEntry = mDecodeTable[i];
+      S32 index = 0;
+      U32 bit;
+      for (bit = 0; bit < DecodeTableBits && index >= 0; bit++)
+         index = (i >> bit) & 1 ? mHuffNodes[index].index1 : mHuffNodes[index].index0;
+
+      if (index < 0) {
+         rEntry.numBits = bit;
+         rEntry.symbol  = mHuffLeaves[-(index + 1)].symbol;
+         rEntry.node    = 0;
+      } else {
+         rEntry.numBits = 0;
+         rEntry.symbol  = 0;
+         rEntry.node    = index;
+      }
+   }
 }
 
 void HuffmanStringProcessor::generateCodes(BitStream& rBS, S32 index, S32 depth)
@@ -163,6 +208,12 @@ void HuffmanStringProcessor::generateCodes(BitStream& rBS, S32 index, S32 depth)
 
       memcpy(&rLeaf.code, rBS.getBuffer(), sizeof(rLeaf.code));
       rLeaf.numBits = depth;
+
+      // the buffer still holds bits from deeper codes past this one's end.
+      // the mask is built in 64 bits, so that it is still defined for a
+      // full 32 bit code.
+      rLeaf.streamCode = convertLEndianToHost(rLeaf.code);
+      rLeaf.streamCode &= U32((U64(1) << depth) - 1);
    } else {
       HuffNode& rNode = mHuffNodes[index];
 
@@ -192,6 +243,27 @@ S16 HuffmanStringProcessor::determineIndex(HuffWrap& rWrap)
    }
 }
 
+/// Returns at least the next 25 bits of the buffer starting at bitPos,
+/// first bit in the low bit.  Reads the four bytes starting at the byte
+/// containing bitPos.
+inline U32 HuffmanStringProcessor::peekBits(const U8 *buffer, U32 bitPos)
+{
+   const U8 *ptr = buffer + (bitPos >> 3);
+   U32 bits = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (U32(ptr[3]) << 24);
+   return bits >> (bitPos & 7);
+}
+
+/// Finishes decoding a code longer than DecodeTableBits, a bit at a time
+/// from tree node index.
+U8 HuffmanStringProcessor::decodeLongCode(const U8 *buffer, U32 &bitPos, S32 index)
+{
+   while (index >= 0) {
+      index = (buffer[bitPos >> 3] >> (bitPos & 7)) & 1 ? mHuffNodes[index].index1 : mHuffNodes[index].index0;
+      bitPos++;
+   }
+   return mHuffLeaves[-(index+1)].symbol;
+}
+
 bool HuffmanStringProcessor::readHuffBuffer(BitStream* pStream, char* out_pBuffer)
 {
    if (mTablesBuilt == false)
@@ -199,7 +271,30 @@ bool HuffmanStringProcessor::readHuffBuffer(BitStream* pStream, char* out_pBuffe
 
    if (pStream->readFlag()) {
       U32 len = pStream->readInt(8);
-      for (U32 i = 0; i < len; i++) {
+      U32 i = 0;
+
+      // Decode DecodeTableBits bits at a time while there is room in the
+      // stream for the longest code.  Codes are at most 32 bits long.
+      const U8 *buffer = pStream->getBuffer();
+      U32 bitPos = pStream->getBitPosition();
+      U32 fastEnd = pStream->getMaxReadBitPosition();
+      fastEnd = fastEnd > 64 ? fastEnd - 64 : 0;
+
+      for (; i < len && bitPos <= fastEnd; i++) {
+         const DecodeEntry& rEntry = mDecodeTable[peekBits(buffer, bitPos) & (DecodeTableSize - 1)];
+         if (rEntry.numBits) {
+            out_pBuffer[i] = rEntry.symbol;
+            bitPos += rEntry.numBits;
+         } else {
+            bitPos += DecodeTableBits;
+            out_pBuffer[i] = decodeLongCode(buffer, bitPos, rEntry.node);
+         }
+      }
+      pStream->setBitPosition(bitPos);
+
+      // Near the end of the stream, go a bit at a time so overruns are
+      // caught by the stream.
+      for (; i < len; i++) {
          S32 index = 0;
          while (true) {
             if (index >= 0) {
@@ -253,9 +348,24 @@ bool HuffmanStringProcessor::writeHuffBuffer(BitStream* pStream, const char* out
    } else {
       pStream->writeFlag(true);
       pStream->writeInt(len, 8);
+
+      // Pack the codes into an accumulator and write them out a word at a time.
+      U64 accum = 0;
+      U32 accumBits = 0;
       for (i = 0; i < len; i++) {
          HuffLeaf& rLeaf = mHuffLeaves[((unsigned char)out_pBuffer[i])];
-         pStream->writeBits(rLeaf.numBits, &rLeaf.code);
+         accum |= U64(rLeaf.streamCode) << accumBits;
+         accumBits += rLeaf.numBits;
+         if (accumBits >= 32) {
+            U32 word = convertHostToLEndian(U32(accum));
+            pStream->writeBits(32, &word);
+            accum >>= 32;
+            accumBits -= 32;
+         }
+      }
+      if (accumBits) {
+         U32 word = convertHostToLEndian(U32(accum));
+         pStream->writeBits(accumBits, &word);
       }
    }
 
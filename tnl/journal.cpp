@@ -27,6 +27,8 @@
 #include "tnlJournal.h"
 #include "tnlEndian.h"
 #include "tnlLog.h"
+#include "tnlThread.h"
+#include "tnlPlatform.h"
 
 namespace TNL
 {
@@ -35,16 +37,185 @@ Vector<JournalEntryRecord *> *JournalEntryRecord::mEntryVector;
 
 bool Journal::mInsideEntrypoint = false;
 Journal::Mode Journal::mCurrentMode = Journal::Inactive;
-U32 Journal::mReadBreakBitPos = 0;
+U64 Journal::mReadBreakBitPos = 0;
 
 FILE *Journal::mJournalFile = NULL;
 BitStream Journal::mWriteStream;
 BitStream Journal::mReadStream;
 Journal *Journal::mJournal = NULL;
-U32 Journal::mWritePosition = 0;
 U32 Journal::mBreakBlockIndex = 0;
 U32 Journal::mBlockIndex = 0;
 
+JournalWriter *Journal::mWriter = NULL;
+JournalChunk *Journal::mWriteChunk = NULL;
+U64 Journal::mWritePosition = 0;
+U32 Journal::mEntryCount = 0;
+U32 Journal::mRecordStartTime = 0;
+U32 Journal::mLastFlushTime = 0;
+U32 Journal::mNextKeyframeTime = 0;
+
+Vector<Journal::ChunkInfo> Journal::mReadChunks;
+Vector<JournalKeyframe> Journal::mKeyframes;
+S32 Journal::mNextReadChunk = 0;
+U64 Journal::mReadWindowStart = 0;
+U32 Journal::mReadWindowSize = 0;
+U64 Journal::mReadTotalBits = 0;
+
+enum {
+   JournalFileTag = 0x4A4C4E54, ///< "TNLJ"
+   JournalVersion = 2,
+   JournalChunkTag = 0x4B48434A, ///< "JCHK"
+   JournalChunkHeaderWords = 4,
+   JournalKeyframeWords = 4,
+};
+
+/// A JournalChunk is a piece of the journal stream waiting to be written,
+/// along with the keyframes recorded while it was being filled.
+struct JournalChunk
+{
+   U8 *data;
+   U32 size;
+   U32 capacity;
+   U32 bitCount;
+   Vector<JournalKeyframe> keyframes;
+
+   JournalChunk(U32 initialCapacity)
+   {
+      capacity = initialCapacity;
+      data = (U8 *) malloc(capacity);
+      size = 0;
+      bitCount = 0;
+   }
+   ~JournalChunk()
+   {
+      free(data);
+   }
+   void append(const U8 *bytes, U32 byteCount)
+   {
+      if(size + byteCount > capacity)
+      {
+         while(size + byteCount > capacity)
+            capacity *= 2;
+         data = (U8 *) realloc(data, capacity);
+      }
+      memcpy(data + size, bytes, byteCount);
+      size += byteCount;
+   }
+};
+
+/// The JournalWriter thread writes completed chunks to the journal file
+/// so that recording never blocks on disk I/O.  Chunks are passed in
+/// through a mutex protected queue, and returned to a free list for
+/// reuse once written.  A NULL chunk in the queue tells the thread to
+/// flush the file and exit.
+class JournalWriter : public Thread
+{
+   FILE *mFile;
+   U32 mChunkSize;
+   Mutex mQueueLock;
+   Semaphore mQueueSemaphore;
+   Semaphore mFinishedSemaphore;
+   Vector<JournalChunk *> mQueue;
+   Vector<JournalChunk *> mFreeChunks;
+
+   void writeChunk(JournalChunk *chunk)
+   {
+      U32 header[JournalChunkHeaderWords];
+      header[0] = convertHostToLEndian(U32(JournalChunkTag));
+      header[1] = convertHostToLEndian(chunk->size);
+      header[2] = convertHostToLEndian(chunk->bitCount);
+      header[3] = convertHostToLEndian(U32(chunk->keyframes.size()));
+      fwrite(header, sizeof(U32), JournalChunkHeaderWords, mFile);
+
+      for(S32 i = 0; i < chunk->keyframes.size(); i++)
+      {
+         JournalKeyframe &key = chunk->keyframes[i];
+         U32 words[JournalKeyframeWords];
+         words[0] = convertHostToLEndian(key.entryCount);
+         words[1] = convertHostToLEndian(key.time);
+         words[2] = convertHostToLEndian(U32(key.bitPosition));
+         words[3] = convertHostToLEndian(U32(key.bitPosition >> 32));
+         fwrite(words, sizeof(U32), JournalKeyframeWords, mFile);
+      }
+      fwrite(chunk->data, 1, chunk->size, mFile);
+
+      // flushing here costs the recording thread nothing, and limits what
+      // is lost if the process crashes to the chunks still in memory.
+      fflush(mFile);
+   }
+public:
+   JournalWriter(FILE *file, U32 chunkSize) : mQueueSemaphore(0, 0x7FFFFFFF)
+   {
+      mFile = file;
+      mChunkSize = chunkSize;
+   }
+
+   ~JournalWriter()
+   {
+      for(S32 i = 0; i < mFreeChunks.size(); i++)
+         delete mFreeChunks[i];
+   }
+
+   U32 run()
+   {
+      for(;;)
+      {
+         mQueueSemaphore.wait();
+
+         mQueueLock.lock();
+         JournalChunk *chunk = mQueue[0];
+         mQueue.erase(0);
+         mQueueLock.unlock();
+
+         if(!chunk)
+            break;
+         writeChunk(chunk);
+
+         mQueueLock.lock();
+         mFreeChunks.push_back(chunk);
+         mQueueLock.unlock();
+      }
+      fflush(mFile);
+      mFinishedSemaphore.increment();
+      return 0;
+   }
+
+   /// Returns an empty chunk, reusing one already written if possible.
+   JournalChunk *allocChunk()
+   {
+      JournalChunk *chunk = NULL;
+      mQueueLock.lock();
+      if(mFreeChunks.size())
+      {
+         chunk = mFreeChunks[mFreeChunks.size() - 1];
+         mFreeChunks.pop_back();
+      }
+      mQueueLock.unlock();
+
+      if(!chunk)
+         return new JournalChunk(mChunkSize);
+      chunk->size = 0;
+      chunk->bitCount = 0;
+      chunk->keyframes.clear();
+      return chunk;
+   }
+
+   void queueChunk(JournalChunk *chunk)
+   {
+      mQueueLock.lock();
+      mQueue.push_back(chunk);
+      mQueueLock.unlock();
+      mQueueSemaphore.increment();
+   }
+
+   /// Writes everything still queued and waits for the thread to exit.
+   void shutdown()
+   {
+      queueChunk(NULL);
+      mFinishedSemaphore.wait();
+   }
+};
+
 JournalBlockTypeToken *JournalBlockTypeToken::mList = NULL;
 bool JournalBlockTypeToken::mInitialized = false;
 
@@ -129,79 +300,271 @@ Journal::Journal()
 }
 
 // the journal stream is written as a single continuous bit stream.
-// the first four bytes of the stream are the total number of bits in
-// the stream.  As a block is written, the bits in the write stream are
-// all erased except for those in the last byte, which are moved to the first.
+// As a block is written, the whole bytes in the write stream are moved
+// into the current chunk and the bits of the last partial byte are moved
+// to the start of the write stream.  Chunks are handed to the writer
+// thread when they fill up, or when they have been waiting too long, so
+// that a crash loses as little of the journal as possible.
 void Journal::syncWriteStream()
 {
-   if(mWriteStream.getBytePosition() == 0)
+   U32 bitPosition = mWriteStream.getBitPosition();
+   U32 wholeBytes = bitPosition >> 3;
+   if(!wholeBytes)
       return;
 
-   U32 totalBits = (mWritePosition << 3) + mWriteStream.getBitPosition();
-   
-   // seek back to the beginning
-   fseek(mJournalFile, 0, SEEK_SET);
+   U8 *buffer = mWriteStream.getBuffer();
+   mWriteChunk->append(buffer, wholeBytes);
+   mWritePosition += wholeBytes;
 
-   // write the new total bits
-   U32 writeBits = convertHostToLEndian(totalBits);
-   fwrite(&writeBits, 1, sizeof(U32), mJournalFile);
+   if(bitPosition & 7)
+      buffer[0] = buffer[wholeBytes];
+   mWriteStream.setBitPosition(bitPosition & 7);
 
-   // seek to the writing position
-   fseek(mJournalFile, mWritePosition, SEEK_SET);
+   if(mWriteChunk->size >= ChunkSize || Platform::getRealMilliseconds() - mLastFlushTime >= FlushInterval)
+      queueWriteChunk(false);
+}
 
-   U32 bytesToWrite = mWriteStream.getBytePosition();
-   // write the bytes to the file
-   fwrite(mWriteStream.getBuffer(), 1, bytesToWrite, mJournalFile);
-   fflush(mJournalFile);
+void Journal::queueWriteChunk(bool finalChunk)
+{
+   mWriteChunk->bitCount = mWriteChunk->size << 3;
 
-   // adjust the write stream
-   if(totalBits & 7)
+   // the final chunk also carries the trailing partial byte.
+   U32 partialBits = mWriteStream.getBitPosition() & 7;
+   if(finalChunk && partialBits)
    {
-      U8 *buffer = mWriteStream.getBuffer();
-      buffer[0] = buffer[bytesToWrite - 1];
-      mWriteStream.setBitPosition(totalBits & 7);
-      mWritePosition += bytesToWrite - 1;
+      mWriteChunk->append(mWriteStream.getBuffer(), 1);
+      mWriteChunk->bitCount += partialBits;
    }
-   else
+
+   if(mWriteChunk->size || mWriteChunk->keyframes.size())
    {
-      mWritePosition += bytesToWrite;
-      mWriteStream.setBitPosition(0);
+      mWriter->queueChunk(mWriteChunk);
+      mWriteChunk = finalChunk ? NULL : mWriter->allocChunk();
    }
+   mLastFlushTime = Platform::getRealMilliseconds();
 }
 
 void Journal::record(const char *fileName)
 {
    mJournalFile = fopen(fileName, "wb");
+   if(!mJournalFile)
+      return;
+
+   U32 header[2];
+   header[0] = convertHostToLEndian(U32(JournalFileTag));
+   header[1] = convertHostToLEndian(U32(JournalVersion));
+   fwrite(header, sizeof(U32), 2, mJournalFile);
+
+   mWriter = new JournalWriter(mJournalFile, ChunkSize);
+   mWriter->start();
+   mWriteChunk = mWriter->allocChunk();
+
+   mWritePosition = 0;
+   mEntryCount = 0;
+   mRecordStartTime = mLastFlushTime = Platform::getRealMilliseconds();
+   mNextKeyframeTime = 0;
+   mCurrentMode = Record;
+
+   atexit(close);
+}
+
+void Journal::close()
+{
+   if(mCurrentMode == Record)
+   {
+      syncWriteStream();
+      queueWriteChunk(true);
+      mWriter->shutdown();
+      delete mWriter;
+      mWriter = NULL;
+      delete mWriteChunk;
+      mWriteChunk = NULL;
+   }
    if(mJournalFile)
    {
-      mCurrentMode = Record;
-      mWritePosition = sizeof(U32);
+      fclose(mJournalFile);
+      mJournalFile = NULL;
    }
+   mCurrentMode = Inactive;
 }
 
-void Journal::load(const char *fileName)
+// journals written before the chunked format are a bit count followed
+// by the bit stream, and are read into memory in one piece.
+bool Journal::loadLegacy(FILE *theJournal)
 {
-   FILE *theJournal = fopen(fileName, "rb");
-   if(!theJournal)
-      return;
-
    fseek(theJournal, 0, SEEK_END);
    U32 fileSize = ftell(theJournal);
    fseek(theJournal, 0, SEEK_SET);
 
    mReadStream.resize(fileSize);
    U32 bitCount;
-   fread(mReadStream.getBuffer(), 1, fileSize, theJournal);
+   if(fread(mReadStream.getBuffer(), 1, fileSize, theJournal) != fileSize)
+      return false;
    mReadStream.read(&bitCount);
    mReadStream.setMaxBitSizes(bitCount);
 
-   if(!mReadBreakBitPos || mReadBreakBitPos > bitCount)
-      mReadBreakBitPos = bitCount;
+   mReadWindowStart = 0;
+   mReadWindowSize = fileSize;
+   mReadTotalBits = bitCount;
+   return true;
+}
+
+void Journal::load(const char *fileName)
+{
+   FILE *theJournal = fopen(fileName, "rb");
+   if(!theJournal)
+      return;
+
+   U32 header[2];
+   if(fread(header, sizeof(U32), 2, theJournal) != 2 ||
+         convertLEndianToHost(header[0]) != JournalFileTag)
+   {
+      bool loaded = loadLegacy(theJournal);
+      fclose(theJournal);
+      if(!loaded)
+         return;
+   }
+   else
+   {
+      if(convertLEndianToHost(header[1]) != JournalVersion)
+      {
+         logprintf("Journal %s has unsupported version %d.", fileName, convertLEndianToHost(header[1]));
+         fclose(theJournal);
+         return;
+      }
+
+      // scan the chunk headers to build the keyframe index, skipping
+      // over the stream data itself.
+      mReadChunks.clear();
+      mKeyframes.clear();
+      mReadTotalBits = 0;
+      for(;;)
+      {
+         U32 chunkHeader[JournalChunkHeaderWords];
+         if(fread(chunkHeader, sizeof(U32), JournalChunkHeaderWords, theJournal) != JournalChunkHeaderWords)
+            break;
+         if(convertLEndianToHost(chunkHeader[0]) != JournalChunkTag)
+         {
+            logprintf("Journal %s is corrupt after %d chunks.", fileName, mReadChunks.size());
+            break;
+         }
+         ChunkInfo info;
+         info.payloadSize = convertLEndianToHost(chunkHeader[1]);
+         info.bitCount = convertLEndianToHost(chunkHeader[2]);
+         info.keyframeCount = convertLEndianToHost(chunkHeader[3]);
+
+         for(U32 i = 0; i < info.keyframeCount; i++)
+         {
+            U32 words[JournalKeyframeWords];
+            if(fread(words, sizeof(U32), JournalKeyframeWords, theJournal) != JournalKeyframeWords)
+               break;
+            JournalKeyframe key;
+            key.entryCount = convertLEndianToHost(words[0]);
+            key.time = convertLEndianToHost(words[1]);
+            key.bitPosition = convertLEndianToHost(words[2]) | (U64(convertLEndianToHost(words[3])) << 32);
+            mKeyframes.push_back(key);
+         }
+         if(fseek(theJournal, info.payloadSize, SEEK_CUR))
+            break;
+         mReadChunks.push_back(info);
+         mReadTotalBits += info.bitCount;
+      }
+
+      // rewind to the first chunk and stream from there.
+      fseek(theJournal, sizeof(header), SEEK_SET);
+      mJournalFile = theJournal;
+      mNextReadChunk = 0;
+      mReadWindowStart = 0;
+      mReadWindowSize = 0;
+      mReadStream.setBitPosition(0);
+      mReadStream.setMaxBitSizes(0);
+      fillReadWindow();
+   }
+
+   if(!mReadBreakBitPos || mReadBreakBitPos > mReadTotalBits)
+      mReadBreakBitPos = mReadTotalBits;
 
-   fclose(theJournal);
    mCurrentMode = Playback;
 }
 
+// keeps at least ReadAheadSize bytes of the stream in the read window
+// past the current read position, by sliding the unread part of the
+// window to the front and reading in more chunks behind it.
+void Journal::fillReadWindow()
+{
+   if(mNextReadChunk >= mReadChunks.size())
+      return;
+
+   U32 bitPosition = mReadStream.getBitPosition();
+   U32 readByte = bitPosition >> 3;
+   U32 remaining = mReadWindowSize - readByte;
+   if(remaining >= ReadAheadSize)
+      return;
+
+   U8 *buffer = mReadStream.getBuffer();
+   memmove(buffer, buffer + readByte, remaining);
+   mReadWindowStart += readByte;
+   mReadWindowSize = remaining;
+   bitPosition -= readByte << 3;
+
+   while(mReadWindowSize < ReadAheadSize * 2 && mNextReadChunk < mReadChunks.size())
+   {
+      ChunkInfo &info = mReadChunks[mNextReadChunk++];
+
+      fseek(mJournalFile, (JournalChunkHeaderWords + info.keyframeCount * JournalKeyframeWords) * sizeof(U32), SEEK_CUR);
+      mReadStream.resize(mReadWindowSize + info.payloadSize);
+      U32 bytesRead = fread(mReadStream.getBuffer() + mReadWindowSize, 1, info.payloadSize, mJournalFile);
+      mReadWindowSize += bytesRead;
+
+      if(bytesRead != info.payloadSize)
+      {
+         // the journal was cut off while it was being written.
+         logprintf("Journal is truncated, playback will end early.");
+         mNextReadChunk = mReadChunks.size();
+         mReadTotalBits = (mReadWindowStart + mReadWindowSize) << 3;
+         if(mReadBreakBitPos > mReadTotalBits)
+            mReadBreakBitPos = mReadTotalBits;
+      }
+   }
+
+   U32 windowBits = mReadWindowSize << 3;
+   if(mNextReadChunk >= mReadChunks.size())
+      windowBits = U32(mReadTotalBits - (mReadWindowStart << 3));
+   mReadStream.setMaxBitSizes(windowBits);
+   mReadStream.setBitPosition(bitPosition);
+}
+
+const JournalKeyframe *Journal::findKeyframe(U32 time)
+{
+   if(!mKeyframes.size() || mKeyframes[0].time > time)
+      return NULL;
+
+   // keyframes are recorded in time order
+   S32 low = 0;
+   S32 high = mKeyframes.size() - 1;
+   while(low < high)
+   {
+      S32 mid = (low + high + 1) >> 1;
+      if(mKeyframes[mid].time <= time)
+         low = mid;
+      else
+         high = mid - 1;
+   }
+   return &mKeyframes[low];
+}
+
+void Journal::setBreakTime(U32 time)
+{
+   const JournalKeyframe *key = findKeyframe(time);
+   if(!key)
+   {
+      logprintf("Journal has no keyframe at %d ms.", time);
+      return;
+   }
+   logprintf("Journal will break at entry %d, %d ms.", key->entryCount, key->time);
+   mReadBreakBitPos = key->bitPosition;
+}
+
 void Journal::callEntry(const char *funcName, Functor *theCall)
 {
    if(mCurrentMode == Playback)
@@ -220,6 +583,18 @@ void Journal::callEntry(const char *funcName, Functor *theCall)
 
    if(mCurrentMode == Record)
    {
+      U32 time = Platform::getRealMilliseconds() - mRecordStartTime;
+      if(time >= mNextKeyframeTime)
+      {
+         JournalKeyframe key;
+         key.entryCount = mEntryCount;
+         key.time = time;
+         key.bitPosition = (mWritePosition << 3) + mWriteStream.getBitPosition();
+         mWriteChunk->keyframes.push_back(key);
+         mNextKeyframeTime = time + KeyframeInterval;
+      }
+      mEntryCount++;
+
 #ifdef TNL_ENABLE_BIG_JOURNALS
       TNL_JOURNAL_WRITE( (U16(0x1234)) );
 #endif
@@ -236,7 +611,8 @@ void Journal::callEntry(const char *funcName, Functor *theCall)
 
 void Journal::checkReadPosition()
 {
-   if(!mReadStream.isValid() || mReadStream.getBitPosition() >= mReadBreakBitPos)
+   U64 bitPosition = (mReadWindowStart << 3) + mReadStream.getBitPosition();
+   if(!mReadStream.isValid() || bitPosition >= mReadBreakBitPos)
       TNL_DEBUGBREAK();
 }
 
@@ -250,6 +626,7 @@ void Journal::beginBlock(U32 blockId, bool writeBlock)
    }
    else
    {
+      fillReadWindow();
       mBlockIndex++;
       if(mBreakBlockIndex && mBlockIndex >= mBreakBlockIndex)
          TNL_DEBUGBREAK();
@@ -295,6 +672,8 @@ void Journal::processNextJournalEntry()
    if(mCurrentMode != Playback)
       return;
 
+   fillReadWindow();
+
 #ifdef TNL_ENABLE_BIG_JOURNALS
    U16 token;
    TNL_JOURNAL_READ( (&token) );
@@ -302,7 +681,7 @@ void Journal::processNextJournalEntry()
       TNL_DEBUGBREAK();
 #endif
 
-   U32 index = mReadStream.readRangedU32(0, JournalEntryRecord::mEntryVector->size());
+   U32 index = mReadStream.readRangedU32(0, JournalEntryRecord::mEntryVector->size() - 1);
 
    JournalEntryRecord *theEntry = (*JournalEntryRecord::mEntryVector)[index];
 
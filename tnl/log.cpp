@@ -26,6 +26,7 @@
 
 #include "tnlLog.h"
 #include "tnlDataChunker.h"
+#include "tnlThread.h"
 #include <stdarg.h>
 
 namespace TNL
@@ -83,9 +84,645 @@ void LogConsumer::logString(const char *string)
 #endif
 }
 
+static void dispatchLogString(const char *string)
+{
+   for(LogConsumer *walk = LogConsumer::getLinkedList(); walk; walk = walk->getNext())
+      walk->logString(string);
+   Platform::outputDebugString(string);
+   Platform::outputDebugString("\n");
+}
+
+static void flushLogConsumers()
+{
+   for(LogConsumer *walk = LogConsumer::getLinkedList(); walk; walk = walk->getNext())
+      walk->flush();
+}
+
+//-----------------------------------------------------------------------------
+// Asynchronous log records
+//-----------------------------------------------------------------------------
+
+enum {
+   LogBufferSize = 4096,
+   MaxLogArgs = 32,
+   LogRecordAlign = 32, ///< Every record (and so every gap at the end of a ring) can hold a header.
+   LogFlushInterval = 2, ///< Milliseconds the log thread waits after a batch, so records are dispatched in batches.
+};
+
+/// Argument types a printf conversion can consume.
+enum LogArgType {
+   LogArgNone,       ///< %% - consumes nothing.
+   LogArgInt,
+   LogArgLong,
+   LogArgInt64,
+   LogArgSizeT,
+   LogArgDouble,
+   LogArgLongDouble,
+   LogArgPointer,
+   LogArgString,
+   LogArgInvalid,    ///< Unsupported conversion - it and the rest of the format are copied verbatim.
+};
+
+struct LogArg
+{
+   U32 type;
+   U32 length;  ///< For strings, length in bytes including the terminator.
+   union {
+      int i;
+      long l;
+      S64 ll;
+      size_t z;
+      F64 d;
+      long double ld;
+      const void *p;
+      const char *s;
+   };
+};
+
+/// Header of a record in a LogRing.  A record with a NULL format is padding
+/// that skips to the start of the ring.
+struct LogRecord
+{
+   U32 size;            ///< Total size of the record, a multiple of LogRecordAlign.
+   U32 sequence;        ///< Global order of the record, for merging the rings.
+   const char *format;
+   const char *typeName;
+   U32 argCount;
+};
+
+/// Single producer, single consumer record ring.  Only the owning thread
+/// writes records and advances mHead; only the log thread reads them and
+/// advances mTail.  Rings stay on the ring list for good; when the owning
+/// thread exits the ring is released, and once drained it is handed to
+/// the next thread that needs one.
+struct LogRing
+{
+   U8 *mBuffer;
+   U32 mSize;
+   volatile U32 mHead;
+   volatile U32 mTail;
+   volatile U32 mDropped;
+   U32 mReportedDropped;
+   volatile bool mOwned;
+   LogRing *mNext;
+
+   LogRing(U32 size)
+   {
+      mSize = size;
+      mBuffer = new U8[size];
+      mHead = mTail = 0;
+      mDropped = mReportedDropped = 0;
+      mOwned = true;
+      mNext = NULL;
+   }
+
+   /// Returns space for a record of the given size, or NULL if the ring is full.
+   U8 *reserve(U32 size)
+   {
+      U32 offset = mHead & (mSize - 1);
+      U32 gap = offset + size > mSize ? mSize - offset : 0;
+      if(mSize - (mHead - mTail) < size + gap)
+         return NULL;
+      if(gap)
+      {
+         LogRecord *pad = (LogRecord *) (mBuffer + offset);
+         pad->size = gap;
+         pad->format = NULL;
+         offset = 0;
+      }
+      return mBuffer + offset;
+   }
+
+   /// Publishes the record returned by the last reserve.
+   void commit(U32 size)
+   {
+      U32 offset = mHead & (mSize - 1);
+      U32 gap = offset + size > mSize ? mSize - offset : 0;
+      memoryBarrier();
+      mHead = mHead + gap + size;
+   }
+
+   /// Returns the oldest unread record, skipping padding, or NULL.
+   LogRecord *peek()
+   {
+      for(;;)
+      {
+         if(mTail == mHead)
+            return NULL;
+         memoryBarrier();
+         LogRecord *record = (LogRecord *) (mBuffer + (mTail & (mSize - 1)));
+         if(record->format)
+            return record;
+         mTail = mTail + record->size;
+      }
+   }
+
+   void pop(LogRecord *record)
+   {
+      memoryBarrier();
+      mTail = mTail + record->size;
+   }
+};
+
+/// Drains every thread's LogRing in sequence order.
+class LogThread : public Thread
+{
+public:
+   volatile bool mStopRequested;
+   volatile bool mFlushRequested;
+   volatile S32 mSleeping;
+   Semaphore mWake;
+   Semaphore mFlushed;
+   Semaphore mStopped;
+
+   LogThread() : mWake(0), mFlushed(0), mStopped(0) { mStopRequested = mFlushRequested = false; mSleeping = 0; }
+   U32 run();
+
+   /// Wakes the thread if it's waiting for records.
+   void wake()
+   {
+      if(mSleeping && atomicCompareAndSwap(&mSleeping, 1, 0))
+         mWake.increment();
+   }
+
+   /// Waits for a wake call, unless there is already work to do.
+   void waitForRecords();
+};
+
+static void releaseLogRing(void *ring);
+
+static ThreadStorage gLogRingStorage(releaseLogRing);
+static Mutex gLogRingLock;
+static LogRing * volatile gLogRings = NULL;
+static LogThread * volatile gLogThread = NULL;
+static U32 gLogRingSize = 0;
+static volatile bool gAsyncLogging = false;
+static volatile S32 gLogSequence = 0;
+static Mutex gLogFlushLock;
+
+/// Parses the conversion starting just after a '%', returning the character
+/// after it.  starCount is set to the number of '*' width and precision
+/// arguments the conversion takes before its value.
+static const char *parseConversion(const char *format, U32 &type, U32 &starCount)
+{
+   starCount = 0;
+   while(*format && strchr("-+ #0", *format))
+      format++;
+   for(U32 part = 0; part < 2; part++)
+   {
+      if(part && *format == '.')
+         format++;
+      else if(part)
+         break;
+      if(*format == '*')
+      {
+         starCount++;
+         format++;
+      }
+      else
+         while(*format >= '0' && *format <= '9')
+            format++;
+   }
+
+   U32 length = LogArgInt;
+   bool longDouble = false;
+   bool wide = false;
+   switch(*format)
+   {
+      case 'h':
+         format += format[1] == 'h' ? 2 : 1;
+         break;
+      case 'l':
+         if(format[1] == 'l')
+         {
+            length = LogArgInt64;
+            format += 2;
+         }
+         else
+         {
+            length = LogArgLong;
+            wide = true;
+            format++;
+         }
+         break;
+      case 'q':
+      case 'j':
+         length = LogArgInt64;
+         format++;
+         break;
+      case 'L':
+         length = LogArgInt64;
+         longDouble = true;
+         format++;
+         break;
+      case 'z':
+      case 't':
+         length = LogArgSizeT;
+         format++;
+         break;
+      case 'I':
+         if(format[1] == '6' && format[2] == '4')
+         {
+            length = LogArgInt64;
+            format += 3;
+         }
+         else if(format[1] == '3' && format[2] == '2')
+            format += 3;
+         else
+         {
+            length = LogArgSizeT;
+            format++;
+         }
+         break;
+   }
+
+   switch(*format)
+   {
+      case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+         type = (*format == 'c' && wide) ? LogArgInvalid : LogArgType(length);
+         break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+         type = longDouble ? LogArgLongDouble : LogArgDouble;
+         break;
+      case 's':
+         type = wide ? LogArgInvalid : LogArgString;
+         break;
+      case 'p':
+         type = LogArgPointer;
+         break;
+      case '%':
+         type = LogArgNone;
+         break;
+      default:
+         type = LogArgInvalid;
+         return format;
+   }
+   return format + 1;
+}
+
+static void wakeLogThread()
+{
+   LogThread *thread = gLogThread;
+   if(thread)
+      thread->wake();
+}
+
+/// Called as a thread that has logged exits; the log thread still drains
+/// whatever the thread left in the ring.
+static void releaseLogRing(void *ring)
+{
+   memoryBarrier();
+   ((LogRing *) ring)->mOwned = false;
+}
+
+/// Returns a drained ring released by an exited thread, or a new one.
+static LogRing *acquireLogRing()
+{
+   gLogRingLock.lock();
+   for(LogRing *walk = gLogRings; walk; walk = walk->mNext)
+   {
+      if(!walk->mOwned && walk->mHead == walk->mTail && walk->mSize >= gLogRingSize)
+      {
+         walk->mOwned = true;
+         memoryBarrier();
+         gLogRingLock.unlock();
+         return walk;
+      }
+   }
+
+   LogRing *ring = new LogRing(gLogRingSize);
+   ring->mNext = gLogRings;
+   memoryBarrier();
+   gLogRings = ring;
+   gLogRingLock.unlock();
+   return ring;
+}
+
+/// Captures the arguments of a logprintf into the calling thread's ring.
+static void logRecordV(const char *format, va_list args)
+{
+   LogRing *ring = (LogRing *) gLogRingStorage.get();
+   if(!ring)
+   {
+      ring = acquireLogRing();
+      gLogRingStorage.set(ring);
+   }
+
+   LogArg argList[MaxLogArgs];
+   U32 argCount = 0;
+   U32 stringBytes = 0;
+
+   for(const char *walk = format; *walk && argCount < MaxLogArgs; )
+   {
+      if(*walk++ != '%')
+         continue;
+      U32 type, starCount;
+      walk = parseConversion(walk, type, starCount);
+      if(type == LogArgInvalid)
+         break;
+      if(argCount + starCount + 1 > MaxLogArgs)
+         break;
+      for(U32 i = 0; i < starCount; i++)
+      {
+         argList[argCount].type = LogArgInt;
+         argList[argCount++].i = va_arg(args, int);
+      }
+      LogArg &arg = argList[argCount];
+      arg.type = type;
+      switch(type)
+      {
+         case LogArgNone:       continue;
+         case LogArgInt:        arg.i = va_arg(args, int); break;
+         case LogArgLong:       arg.l = va_arg(args, long); break;
+         case LogArgInt64:      arg.ll = va_arg(args, S64); break;
+         case LogArgSizeT:      arg.z = va_arg(args, size_t); break;
+         case LogArgDouble:     arg.d = va_arg(args, double); break;
+         case LogArgLongDouble: arg.ld = va_arg(args, long double); break;
+         case LogArgPointer:    arg.p = va_arg(args, void *); break;
+         case LogArgString:
+            arg.s = va_arg(args, const char *);
+            if(!arg.s)
+               arg.s = "(null)";
+            arg.length = U32(strlen(arg.s)) + 1;
+            if(arg.length > LogBufferSize - stringBytes)
+               arg.length = LogBufferSize - stringBytes;
+            stringBytes += arg.length;
+            break;
+      }
+      argCount++;
+   }
+
+   U32 headerBytes = (sizeof(LogRecord) + 15) & ~15;
+   U32 size = (headerBytes + argCount * sizeof(LogArg) + stringBytes + LogRecordAlign - 1) & ~(LogRecordAlign - 1);
+   U8 *dest = ring->reserve(size);
+   if(!dest)
+   {
+      ring->mDropped = ring->mDropped + 1;
+      wakeLogThread();
+      return;
+   }
+
+   LogRecord *record = (LogRecord *) dest;
+   record->size = size;
+   record->sequence = U32(atomicIncrement(&gLogSequence));
+   record->format = format;
+   record->typeName = LogType::current ? LogType::current->typeName : NULL;
+   record->argCount = argCount;
+
+   LogArg *destArgs = (LogArg *) (dest + headerBytes);
+   char *strings = (char *) (destArgs + argCount);
+   for(U32 i = 0; i < argCount; i++)
+   {
+      destArgs[i] = argList[i];
+      if(argList[i].type == LogArgString)
+      {
+         memcpy(strings, argList[i].s, argList[i].length - 1);
+         strings[argList[i].length - 1] = 0;
+         destArgs[i].s = strings;
+         strings += argList[i].length;
+      }
+   }
+   ring->commit(size);
+   wakeLogThread();
+}
+
+/// Formats a single conversion with its captured arguments.
+template <class T> static S32 formatLogArg(char *buffer, U32 size, const char *spec, const LogArg *stars, U32 starCount, T value)
+{
+   if(starCount == 2)
+      return dSprintf(buffer, size, spec, stars[0].i, stars[1].i, value);
+   else if(starCount == 1)
+      return dSprintf(buffer, size, spec, stars[0].i, value);
+   return dSprintf(buffer, size, spec, value);
+}
+
+/// Rebuilds the text of a record on the log thread.
+static void formatLogRecord(const LogRecord *record, char *buffer)
+{
+   char *out = buffer;
+   char *end = buffer + LogBufferSize - 1;
+
+   if(record->typeName)
+   {
+      dSprintf(out, LogBufferSize, "%s: ", record->typeName);
+      out += strlen(out);
+   }
+
+   const LogArg *args = (const LogArg *) ((const U8 *) record + ((sizeof(LogRecord) + 15) & ~15));
+   U32 argIndex = 0;
+   const char *walk = record->format;
+   while(*walk && out < end)
+   {
+      if(*walk != '%')
+      {
+         *out++ = *walk++;
+         continue;
+      }
+      const char *specStart = walk;
+      U32 type, starCount;
+      walk = parseConversion(walk + 1, type, starCount);
+      if(type == LogArgNone)
+      {
+         *out++ = '%';
+         continue;
+      }
+      if(type == LogArgInvalid || argIndex + starCount + 1 > record->argCount || walk - specStart > 31)
+      {
+         // copy the rest of the format as is, like the argument capture did.
+         while(*specStart && out < end)
+            *out++ = *specStart++;
+         break;
+      }
+
+      char spec[32];
+      memcpy(spec, specStart, walk - specStart);
+      spec[walk - specStart] = 0;
+
+      const LogArg *stars = args + argIndex;
+      const LogArg &arg = args[argIndex + starCount];
+      argIndex += starCount + 1;
+
+      U32 remaining = U32(end - out) + 1;
+      S32 len = 0;
+      switch(type)
+      {
+         case LogArgInt:        len = formatLogArg(out, remaining, spec, stars, starCount, arg.i); break;
+         case LogArgLong:       len = formatLogArg(out, remaining, spec, stars, starCount, arg.l); break;
+         case LogArgInt64:      len = formatLogArg(out, remaining, spec, stars, starCount, arg.ll); break;
+         case LogArgSizeT:      len = formatLogArg(out, remaining, spec, stars, starCount, arg.z); break;
+         case LogArgDouble:     len = formatLogArg(out, remaining, spec, stars, starCount, arg.d); break;
+         case LogArgLongDouble: len = formatLogArg(out, remaining, spec, stars, starCount, arg.ld); break;
+         case LogArgPointer:    len = formatLogArg(out, remaining, spec, stars, starCount, arg.p); break;
+         case LogArgString:     len = formatLogArg(out, remaining, spec, stars, starCount, arg.s); break;
+      }
+      if(len < 0 || U32(len) >= remaining)
+         len = remaining - 1;
+      out += len;
+   }
+   *out = 0;
+}
+
+void LogThread::waitForRecords()
+{
+   mSleeping = 1;
+   memoryBarrier();
+
+   bool pending = mFlushRequested || mStopRequested;
+   for(LogRing *walk = gLogRings; walk && !pending; walk = walk->mNext)
+      pending = walk->mHead != walk->mTail || walk->mDropped != walk->mReportedDropped;
+
+   // if a producer got in first and cleared the flag, it has posted (or is
+   // about to post) the semaphore, and the wait returns immediately.
+   if(!pending || !atomicCompareAndSwap(&mSleeping, 1, 0))
+      mWake.wait();
+}
+
+U32 LogThread::run()
+{
+   char buffer[LogBufferSize];
+
+   for(;;)
+   {
+      // any flush or stop request covers everything logged before it was made,
+      // so note the requests before draining.
+      bool flushRequested = mFlushRequested;
+      bool stopRequested = mStopRequested;
+      memoryBarrier();
+
+      U32 dispatched = 0;
+      for(;;)
+      {
+         // merge the rings by picking the oldest record at the head of any of them.
+         LogRing *oldestRing = NULL;
+         LogRecord *oldest = NULL;
+         for(LogRing *walk = gLogRings; walk; walk = walk->mNext)
+         {
+            LogRecord *record = walk->peek();
+            if(record && (!oldest || S32(record->sequence - oldest->sequence) < 0))
+            {
+               oldest = record;
+               oldestRing = walk;
+            }
+         }
+         if(!oldest)
+            break;
+
+         formatLogRecord(oldest, buffer);
+         oldestRing->pop(oldest);
+         dispatchLogString(buffer);
+         dispatched++;
+      }
+
+      for(LogRing *walk = gLogRings; walk; walk = walk->mNext)
+      {
+         U32 dropped = walk->mDropped;
+         if(dropped != walk->mReportedDropped)
+         {
+            dSprintf(buffer, sizeof(buffer), "Log: %d records dropped, log ring full.", dropped - walk->mReportedDropped);
+            walk->mReportedDropped = dropped;
+            dispatchLogString(buffer);
+            dispatched++;
+         }
+      }
+
+      if(dispatched)
+         flushLogConsumers();
+
+      if(flushRequested)
+      {
+         mFlushRequested = false;
+         mFlushed.increment();
+      }
+      if(stopRequested)
+         break;
+      if(dispatched)
+         Platform::sleep(LogFlushInterval);
+      else
+         waitForRecords();
+   }
+   mStopped.increment();
+   return 0;
+}
+
+static void stopAsyncLoggingAtExit()
+{
+   stopAsyncLogging();
+}
+
+void startAsyncLogging(U32 ringSize)
+{
+   if(gLogThread)
+      return;
+
+   // the ring must at least hold the largest possible record.
+   gLogRingSize = 16384;
+   while(gLogRingSize < ringSize)
+      gLogRingSize <<= 1;
+
+   static bool registeredAtExit = false;
+   if(!registeredAtExit)
+   {
+      atexit(stopAsyncLoggingAtExit);
+      registeredAtExit = true;
+   }
+
+   gLogThread = new LogThread;
+   gLogThread->start();
+   memoryBarrier();
+   gAsyncLogging = true;
+}
+
+void stopAsyncLogging()
+{
+   if(!gLogThread)
+      return;
+
+   gAsyncLogging = false;
+   memoryBarrier();
+   gLogThread->mStopRequested = true;
+   gLogThread->wake();
+   gLogThread->mStopped.wait();
+
+   // the rings stay around for the threads that own them, so a later
+   // startAsyncLogging picks them up again.
+   gLogThread = NULL;
+}
+
+void flushLog()
+{
+   if(!gAsyncLogging)
+      return;
+
+   gLogFlushLock.lock();
+   memoryBarrier();
+   gLogThread->mFlushRequested = true;
+   gLogThread->wake();
+   gLogThread->mFlushed.wait();
+   gLogFlushLock.unlock();
+}
+
+U32 getDroppedLogRecords()
+{
+   U32 dropped = 0;
+   gLogRingLock.lock();
+   for(LogRing *walk = gLogRings; walk; walk = walk->mNext)
+      dropped += walk->mDropped;
+   gLogRingLock.unlock();
+   return dropped;
+}
+
 void logprintf(const char *format, ...)
 {
-   char buffer[4096];
+   va_list s;
+   va_start( s, format );
+   if(gAsyncLogging)
+   {
+      logRecordV(format, s);
+      va_end(s);
+      return;
+   }
+
+   char buffer[LogBufferSize];
    U32 bufferStart = 0;
    if(LogType::current)
    {
@@ -96,14 +733,10 @@ void logprintf(const char *format, ...)
       buffer[bufferStart+1] = ' ';
       bufferStart += 2;
    }
-   va_list s;
-   va_start( s, format );
    dVsprintf(buffer + bufferStart, sizeof(buffer) - bufferStart, format, s);
-   for(LogConsumer *walk = LogConsumer::getLinkedList(); walk; walk = walk->getNext())
-      walk->logString(buffer);
    va_end(s);
-   Platform::outputDebugString(buffer);
-   Platform::outputDebugString("\n");
+   dispatchLogString(buffer);
+   flushLogConsumers();
 }
 
 };
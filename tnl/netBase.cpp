@@ -37,6 +37,7 @@ namespace TNL
 NetClassRep *NetClassRep::mClassLinkList = NULL;
 U32 NetClassRep::mNetClassBitSize[NetClassGroupCount][NetClassTypeCount] = {{0, },};
 Vector<NetClassRep *> NetClassRep::mClassTable[NetClassGroupCount][NetClassTypeCount];
+Vector<NetClassRep *> NetClassRep::mNameTable;
 U32 NetClassRep::mClassCRC[NetClassGroupCount] = {INITIAL_CRC_VALUE, };
 
 bool NetClassRep::mInitialized = false;
@@ -47,15 +48,35 @@ NetClassRep::NetClassRep()
    mInitialUpdateBitsUsed = 0;
    mPartialUpdateCount = 0;
    mPartialUpdateBitsUsed = 0;
+   mProfile.clear();
 }
 
-Object* NetClassRep::create(const char* className)
+U32 NetClassRep::hashClassName(const char *className)
 {
-   TNLAssert(mInitialized, "creating an object before NetClassRep::initialize.");
+   // FNV-1a
+   U32 hash = 2166136261U;
+   for(const U8 *walk = (const U8 *) className; *walk; walk++)
+      hash = (hash ^ *walk) * 16777619U;
+   return hash;
+}
 
-   for (NetClassRep *walk = mClassLinkList; walk; walk = walk->mNextClass)
-      if (!strcmp(walk->getClassName(), className))
-         return walk->create();
+NetClassRep *NetClassRep::findClass(const char *className)
+{
+   TNLAssert(mInitialized, "finding a class before NetClassRep::initialize.");
+
+   U32 mask = mNameTable.size() - 1;
+   U32 hash = hashClassName(className);
+   for(U32 i = hash & mask; mNameTable[i]; i = (i + 1) & mask)
+      if(mNameTable[i]->mClassNameHash == hash && !strcmp(mNameTable[i]->getClassName(), className))
+         return mNameTable[i];
+   return NULL;
+}
+
+Object* NetClassRep::create(const char* className)
+{
+   NetClassRep *rep = findClass(className);
+   if(rep)
+      return rep->create();
 
    TNLAssertV(0,("Couldn't find class rep for dynamic class: %s", className));
    return NULL;
@@ -125,6 +146,23 @@ void NetClassRep::initialize()
          dynamicTable.clear();
       }
    }
+
+   // build the name table, at most half full so probes stay short.
+   U32 classCount = 0;
+   for(walk = mClassLinkList; walk; walk = walk->mNextClass)
+      classCount++;
+   U32 tableSize = getNextPow2(classCount * 2 + 1);
+   mNameTable.setSize(tableSize);
+   for(U32 i = 0; i < tableSize; i++)
+      mNameTable[i] = NULL;
+   for(walk = mClassLinkList; walk; walk = walk->mNextClass)
+   {
+      walk->mClassNameHash = hashClassName(walk->getClassName());
+      U32 i = walk->mClassNameHash & (tableSize - 1);
+      while(mNameTable[i])
+         i = (i + 1) & (tableSize - 1);
+      mNameTable[i] = walk;
+   }
    mInitialized = true;
 }
 
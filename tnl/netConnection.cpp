@@ -41,22 +41,45 @@ namespace TNL {
 
 NetConnectionRep *NetConnectionRep::mLinkedList = NULL;
 
-NetConnection *NetConnectionRep::create(const char *name)
+Vector<NetConnectionRep *> NetConnectionRep::mNameTable;
+
+NetConnectionRep *NetConnectionRep::find(const char *name)
 {
-   for(NetConnectionRep *walk = mLinkedList; walk; walk = walk->mNext)
-      if(walk->mCanRemoteCreate && !strcmp(name, walk->mClassRep->getClassName()))
+   if(!mNameTable.size())
+   {
+      // the reps are all constructed statically, so the table never
+      // needs rebuilding.
+      U32 count = 0;
+      for(NetConnectionRep *walk = mLinkedList; walk; walk = walk->mNext)
+         count++;
+      U32 tableSize = getNextPow2(count * 2 + 1);
+      mNameTable.setSize(tableSize);
+      for(U32 i = 0; i < tableSize; i++)
+         mNameTable[i] = NULL;
+      for(NetConnectionRep *walk = mLinkedList; walk; walk = walk->mNext)
       {
-         Object *obj = walk->mClassRep->create();
-         NetConnection *ret = dynamic_cast<NetConnection *>(obj);
-         TNLAssert(ret != NULL, "Invalid TNL_IMPLEMENT_NETCONNECTION");
-         if(!ret)
-            delete obj;
-         return ret;
+         U32 i = NetClassRep::hashClassName(walk->mClassRep->getClassName()) & (tableSize - 1);
+         while(mNameTable[i])
+            i = (i + 1) & (tableSize - 1);
+         mNameTable[i] = walk;
       }
+   }
 
+   U32 mask = mNameTable.size() - 1;
+   for(U32 i = NetClassRep::hashClassName(name) & mask; mNameTable[i]; i = (i + 1) & mask)
+      if(!strcmp(name, mNameTable[i]->mClassRep->getClassName()))
+         return mNameTable[i];
    return NULL;
 }
 
+NetConnection *NetConnectionRep::create(const char *name)
+{
+   NetConnectionRep *rep = find(name);
+   if(!rep || !rep->mCanRemoteCreate)
+      return NULL;
+   return rep->mCreate();
+}
+
 static const char *packetTypeNames[] = 
 {
    "DataPacket",
@@ -74,6 +97,12 @@ NetConnection::NetConnection()
    mSimulatedLatency = 0;
    mSimulatedPacketLoss = 0;
 
+   mPacketsSent = 0;
+   mPacketsReceived = 0;
+   mBytesSent = 0;
+   mBytesReceived = 0;
+   mProfile.clear();
+
    mLastPacketRecvTime = 0;
    mLastUpdateTime = 0;
    mRoundTripTime = 0;
@@ -82,6 +111,7 @@ NetConnection::NetConnection()
    
    mNotifyQueueHead = NULL;
    mNotifyQueueTail = NULL;
+   mNotifyFreeList = NULL;
    
    mLocalRate.maxRecvBandwidth = DefaultFixedBandwidth;
    mLocalRate.maxSendBandwidth = DefaultFixedBandwidth;
@@ -105,6 +135,23 @@ NetConnection::NetConnection()
    cwnd = 2;
    ssthresh = 30;
    mLastSeqRecvdAck = 0;
+   mLastAckTime = 0;
+
+   // Paced
+   mPacedRate = 0;
+   mPacedStartup = true;
+   mNextPacedSendTime = 0;
+   mPacedWindow = PacedMinWindow;
+   mDelivered = 0;
+   mDeliveredTime = 0;
+   mMinRTT = 0;
+   mMinRTTTime = 0;
+   mRoundStartTime = 0;
+   mRoundMinRTT = 0;
+   mRoundDeliveryRate = 0;
+   mRoundAcked = 0;
+   mRoundLost = 0;
+   mRoundAppLimited = false;
 
    mPingTimeout = DefaultPingTimeout;
    mPingRetryCount = DefaultPingRetryCount;
@@ -125,6 +172,12 @@ void NetConnection::clearAllPacketNotifies()
 NetConnection::~NetConnection()
 {
    clearAllPacketNotifies();
+   while(mNotifyFreeList)
+   {
+      PacketNotify *next = mNotifyFreeList->nextPacket;
+      delete mNotifyFreeList;
+      mNotifyFreeList = next;
+   }
    delete mStringTable;
 
    TNLAssert(mNotifyQueueHead == NULL, "Uncleared notifies remain.");
@@ -145,6 +198,19 @@ NetConnection::PacketNotify::PacketNotify()
 {
    rateChanged = false;
    sendTime = 0;
+   sendSize = 0;
+   deliveredAtSend = 0;
+   deliveredTimeAtSend = 0;
+}
+
+void NetConnection::PacketNotify::reset()
+{
+   rateChanged = false;
+   sendTime = 0;
+   sendSize = 0;
+   deliveredAtSend = 0;
+   deliveredTimeAtSend = 0;
+   stringList.stringHead = stringList.stringTail = NULL;
 }
 
 bool NetConnection::checkTimeout(U32 time)
@@ -207,10 +273,19 @@ void NetConnection::setLastError(const char *fmt, ...)
 
 void NetConnection::writeRawPacket(BitStream *bstream, NetPacketType packetType)
 {
+   PacketNotify *note = NULL;
    writePacketHeader(bstream, packetType);
    if(packetType == DataPacket)
    {
-      PacketNotify *note = allocNotify();
+      note = mNotifyFreeList;
+      if(note)
+      {
+         mNotifyFreeList = note->nextPacket;
+         note->reset();
+      }
+      else
+         note = allocNotify();
+
       if(!mNotifyQueueHead)
          mNotifyQueueHead = note;
       else
@@ -219,9 +294,19 @@ void NetConnection::writeRawPacket(BitStream *bstream, NetPacketType packetType)
       note->nextPacket = NULL;
       note->sendTime = mInterface->getCurrentTime();
 
+      // delivery rate samples shouldn't count time the connection sat
+      // with nothing in flight.  This packet's sequence has already been
+      // counted in mLastSendSeq.
+      if(mLastSendSeq - 1 == mHighestAckedSeq)
+         mDeliveredTime = note->sendTime;
+      note->deliveredAtSend = mDelivered;
+      note->deliveredTimeAtSend = mDeliveredTime;
+
       writePacketRateInfo(bstream, note);
       S32 start = bstream->getBitPosition();
       bstream->setStringTable(mStringTable);
+      if(mStringTable)
+         mStringTable->beginWritePacket();
 
       TNLLogMessageV(LogNetConnection, ("NetConnection %s: START %s", mNetAddress.toString(), getClassName()) );
       writePacket(bstream, note);
@@ -232,17 +317,25 @@ void NetConnection::writeRawPacket(BitStream *bstream, NetPacketType packetType)
       mSymmetricCipher->setupCounter(mLastSendSeq, mLastSeqRecvd, packetType, 0);
       bstream->hashAndEncrypt(MessageSignatureBytes, PacketHeaderByteSize, mSymmetricCipher);
    }
+   if(note)
+      note->sendSize = bstream->getBytePosition();
+
+   mProfile.packetCount++;
+   mProfile.packetBits += bstream->getBitPosition();
 }
 
 void NetConnection::readRawPacket(BitStream *bstream)
 {
-   if(mSimulatedPacketLoss && Random::readF() < mSimulatedPacketLoss)
+   if(mSimulatedPacketLoss && FastRandom::get().readF() < mSimulatedPacketLoss)
    {
       TNLLogMessageV(LogNetConnection, ("NetConnection %s: RECVDROP - %d", mNetAddress.toString(), getLastSendSequence()));
       return;
    }
    TNLLogMessageV(LogNetConnection, ("NetConnection %s: RECV- %d bytes", mNetAddress.toString(), bstream->getMaxReadBitPosition() >> 3));
 
+   mPacketsReceived++;
+   mBytesReceived += bstream->getMaxReadBitPosition() >> 3;
+
    mErrorBuffer[0] = 0;
    if(readPacketHeader(bstream))
    {
@@ -250,6 +343,8 @@ void NetConnection::readRawPacket(BitStream *bstream)
 
       readPacketRateInfo(bstream);
       bstream->setStringTable(mStringTable);
+      if(mStringTable)
+         mStringTable->beginReadPacket();
       readPacket(bstream);
 
       if(!bstream->isValid() && !mErrorBuffer[0])
@@ -458,6 +553,8 @@ bool NetConnection::readPacketHeader(BitStream *pstream)
          mRoundTripTime = mRoundTripTime * 0.9f + roundTripDelta * 0.1f;
          if(mRoundTripTime < 0)
             mRoundTripTime = 0;
+         if(isPaced())
+            updatePacedRate(roundTripDelta);
       }      
       if(packetTransmitSuccess)
          mLastRecvAckAck = mLastSeqRecvdAtSend[notifyIndex & PacketWindowMask];
@@ -542,7 +639,7 @@ void NetConnection::setIsAdaptive()
 
 void NetConnection::setFixedRateParameters(U32 minPacketSendPeriod, U32 minPacketRecvPeriod, U32 maxSendBandwidth, U32 maxRecvBandwidth)
 {
-   mTypeFlags.clear(ConnectionAdaptive);
+   mTypeFlags.clear(ConnectionAdaptive | ConnectionPaced);
    if(maxRecvBandwidth > MaxFixedBandwidth)
       maxRecvBandwidth = MaxFixedBandwidth;
    if(maxSendBandwidth > MaxFixedBandwidth)
@@ -556,6 +653,150 @@ void NetConnection::setFixedRateParameters(U32 minPacketSendPeriod, U32 minPacke
    computeNegotiatedRate();
 }
 
+void NetConnection::setPacedRateParameters(U32 minPacketSendPeriod, U32 minPacketRecvPeriod, U32 maxSendBandwidth, U32 maxRecvBandwidth)
+{
+   setFixedRateParameters(minPacketSendPeriod, minPacketRecvPeriod, maxSendBandwidth, maxRecvBandwidth);
+   mTypeFlags.set(ConnectionPaced);
+}
+
+void NetConnection::writePacedRequest(BitStream *stream)
+{
+   stream->writeFlag(mTypeFlags.test(ConnectionPaced));
+}
+
+void NetConnection::readPacedRequest(BitStream *stream)
+{
+   if(stream->readFlag())
+      mTypeFlags.set(ConnectionRemotePaced);
+   else
+      mTypeFlags.clear(ConnectionRemotePaced);
+}
+
+//--------------------------------------------------------------------
+
+U32 NetConnection::getPacedPacketSize()
+{
+   // send a period's worth of data at the current rate in each packet,
+   // so that a slower rate sends smaller packets rather than bursts of
+   // full ones with gaps between.
+   U32 size = U32(mPacedRate * mCurrentPacketSendPeriod * 0.001f);
+   if(size < PacedMinPacketSize)
+      size = PacedMinPacketSize;
+   if(size > mCurrentPacketSendSize)
+      size = mCurrentPacketSendSize;
+   return size;
+}
+
+void NetConnection::updatePacedWindow()
+{
+   // allow twice the packets the path holds at the current rate, which
+   // covers ack delays without letting a standing queue build.
+   U32 rtt = mMinRTT ? mMinRTT : U32(PacedInitialRTT);
+   F32 packetsPerSecond = mPacedRate / getPacedPacketSize();
+   U32 window = U32(2 * rtt * packetsPerSecond * 0.001f) + 2;
+   if(window < PacedMinWindow)
+      window = PacedMinWindow;
+   if(window > MaxPacketWindowSize - 2)
+      window = MaxPacketWindowSize - 2;
+   mPacedWindow = window;
+}
+
+void NetConnection::recordPacedDelivery(PacketNotify *note, bool recvd)
+{
+   if(!recvd)
+   {
+      mRoundLost++;
+      return;
+   }
+   mRoundAcked++;
+
+   U32 time = mInterface->getCurrentTime();
+   mDelivered += note->sendSize;
+   mDeliveredTime = time;
+
+   // the rate data was delivered at over this packet's flight.
+   U32 interval = time - note->deliveredTimeAtSend;
+   if(interval)
+   {
+      F32 rate = (mDelivered - note->deliveredAtSend) * 1000.0f / interval;
+      if(rate > mRoundDeliveryRate)
+         mRoundDeliveryRate = rate;
+   }
+}
+
+void NetConnection::updatePacedRate(S32 roundTripTime)
+{
+   U32 time = mInterface->getCurrentTime();
+   U32 rtt = roundTripTime > 0 ? roundTripTime : 0;
+
+   if(!mMinRTT || rtt < mMinRTT)
+   {
+      mMinRTT = rtt ? rtt : 1;
+      mMinRTTTime = time;
+   }
+   if(!mRoundMinRTT || rtt < mRoundMinRTT)
+      mRoundMinRTT = rtt ? rtt : 1;
+
+   U32 roundLength = getMax(U32(mRoundTripTime), U32(PacedMinRound));
+   if(time - mRoundStartTime < roundLength)
+      return;
+
+   // judge the round by its smallest sample, which is the one least
+   // affected by the remote host holding its acks.
+   U32 queueDelay = mRoundMinRTT - mMinRTT;
+   U32 queueTarget = getMax(mMinRTT / 4, U32(PacedMinQueueDelay));
+   bool heavyLoss = mRoundLost * 10 > mRoundAcked + mRoundLost;
+
+   if(queueDelay > queueTarget || heavyLoss)
+   {
+      // a queue is building, so drop below the rate the path is
+      // delivering at to drain it.  If the connection didn't have enough
+      // data to fill its rate the delivery rate says nothing about the
+      // path, so just back off.
+      F32 rate = mPacedRate * 0.85f;
+      if(!mRoundAppLimited && mRoundDeliveryRate > 0 && mRoundDeliveryRate * 0.9f < rate)
+         rate = mRoundDeliveryRate * 0.9f;
+      mPacedRate = rate;
+      mPacedStartup = false;
+   }
+   else if(mPacedStartup)
+      mPacedRate *= 2;
+   else
+      mPacedRate = mPacedRate * 1.0625f + PacedMinBandwidth * 0.25f;
+
+   F32 maxRate = F32(getMin(mLocalRate.maxSendBandwidth, mRemoteRate.maxRecvBandwidth));
+   if(mPacedRate > maxRate)
+      mPacedRate = maxRate;
+   if(mPacedRate < PacedMinBandwidth)
+      mPacedRate = PacedMinBandwidth;
+
+   // measure the smallest round trip afresh now and then, in case the
+   // path has changed.
+   if(time - mMinRTTTime > PacedMinRTTExpiry)
+   {
+      mMinRTT = mRoundMinRTT;
+      mMinRTTTime = time;
+   }
+   updatePacedWindow();
+
+   mRoundStartTime = time;
+   mRoundMinRTT = 0;
+   mRoundDeliveryRate = 0;
+   mRoundAcked = 0;
+   mRoundLost = 0;
+   mRoundAppLimited = false;
+}
+
+void NetConnection::checkPacedAck(U32 curTime)
+{
+   if(mLastSeqRecvdAck != mLastSeqRecvd && curTime - mLastAckTime >= PacedAckDelay)
+   {
+      mLastSeqRecvdAck = mLastSeqRecvd;
+      mLastAckTime = curTime;
+      sendAckPacket();
+   }
+}
+
 //--------------------------------------------------------------------
 
 void NetConnection::sendPingPacket()
@@ -589,6 +830,9 @@ void NetConnection::handleNotify(U32 sequence, bool recvd)
    if(note->rateChanged && !recvd)
       mLocalRateChanged = true;
 
+   if(isPaced())
+      recordPacedDelivery(note, recvd);
+
    if(recvd)
    {
       mHighestAckedSendTime = note->sendTime;
@@ -638,7 +882,8 @@ void NetConnection::handleNotify(U32 sequence, bool recvd)
 
       packetDropped(note);
    }
-   delete note;
+   note->nextPacket = mNotifyFreeList;
+   mNotifyFreeList = note;
 }
 
 //--------------------------------------------------------------------
@@ -647,9 +892,27 @@ void NetConnection::checkPacketSend(bool force, U32 curTime)
 {
    U32 delay = mCurrentPacketSendPeriod;
 
+   if(isPaced() && !mPacedRate)
+   {
+      // start at half the limit, and double from there until the path
+      // shows signs of a queue.
+      mPacedRate = getMax(getMin(mLocalRate.maxSendBandwidth, mRemoteRate.maxRecvBandwidth) * 0.5f, F32(PacedMinBandwidth));
+      mRoundStartTime = curTime;
+      mNextPacedSendTime = curTime;
+      updatePacedWindow();
+   }
+
    if(!force)
    {
-      if(!isAdaptive())
+      if(isPaced())
+      {
+         if(S32(curTime - mNextPacedSendTime) < 0)
+         {
+            checkPacedAck(curTime);
+            return;
+         }
+      }
+      else if(!isAdaptive())
       {
          if(curTime - mLastUpdateTime + mSendDelayCredit < delay)
             return;
@@ -663,7 +926,13 @@ void NetConnection::checkPacketSend(bool force, U32 curTime)
    if(windowFull() || !isDataToTransmit())
    {
       // there is nothing to transmit, or the window is full
-      if(isAdaptive())
+      if(isPaced())
+      {
+         if(!windowFull())
+            mRoundAppLimited = true;
+         checkPacedAck(curTime);
+      }
+      else if(isAdaptive())
       {
          // Still, on an adaptive connection, we may need to send an ack here...
 
@@ -685,11 +954,25 @@ void NetConnection::checkPacketSend(bool force, U32 curTime)
       }
       return;
    }
-   PacketStream stream(mCurrentPacketSendSize);
+   PacketStream stream(isPaced() ? getPacedPacketSize() : mCurrentPacketSendSize);
    mLastUpdateTime = curTime;
 
    writeRawPacket(&stream, DataPacket);   
 
+   if(isPaced())
+   {
+      // the packet carries our acks as well.
+      mLastSeqRecvdAck = mLastSeqRecvd;
+      mLastAckTime = curTime;
+
+      // space the next packet out by this one's size at the current rate,
+      // but never closer than the send period.  A late send doesn't earn
+      // a burst to catch up.
+      U32 interval = getMax(U32(stream.getBytePosition() * 1000 / mPacedRate), mCurrentPacketSendPeriod);
+      if(S32(curTime - mNextPacedSendTime) > S32(interval))
+         mNextPacedSendTime = curTime;
+      mNextPacedSendTime += interval;
+   }
    sendPacket(&stream);
 }
 
@@ -699,12 +982,14 @@ bool NetConnection::windowFull()
       return true;
    if(isAdaptive())
       return mLastSendSeq - mHighestAckedSeq >= cwnd;
+   if(isPaced())
+      return mLastSendSeq - mHighestAckedSeq >= mPacedWindow;
    return false;
 }
 
 NetError NetConnection::sendPacket(BitStream *stream)
 {
-   if(mSimulatedPacketLoss && Random::readF() < mSimulatedPacketLoss)
+   if(mSimulatedPacketLoss && FastRandom::get().readF() < mSimulatedPacketLoss)
    {
       TNLLogMessageV(LogNetConnection, ("NetConnection %s: SENDDROP - %d", mNetAddress.toString(), getLastSendSequence()));
       return NoError;
@@ -712,6 +997,9 @@ NetError NetConnection::sendPacket(BitStream *stream)
 
    TNLLogMessageV(LogNetConnection, ("NetConnection %s: SEND - %d bytes", mNetAddress.toString(), stream->getBytePosition()));
 
+   mPacketsSent++;
+   mBytesSent += stream->getBytePosition();
+
    // do nothing on send if this is a demo replay.
    if(isLocalConnection())
    {
@@ -770,10 +1058,12 @@ void NetConnection::packetDropped(PacketNotify *note)
 
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
-void NetConnection::setTranslatesStrings()
+void NetConnection::setTranslatesStrings(U32 entryBitSize)
 {
    if(!mStringTable) 
-      mStringTable = new ConnectionStringTable(this);
+      mStringTable = new ConnectionStringTable(this, entryBitSize);
+   else
+      mStringTable->setEntryBitSize(entryBitSize);
 }
 
 void NetConnection::setInterface(NetInterface *myInterface)
@@ -873,11 +1163,36 @@ bool NetConnection::readConnectAccept(BitStream *stream, const char **errorStrin
    return true;
 }
 
+void NetConnection::writeStringTableRequest(BitStream *stream)
+{
+   stream->writeInt(mStringTable->getEntryBitSize(), ConnectionStringTable::EntryBitSizeBitSize);
+}
+
+void NetConnection::readStringTableRequest(BitStream *stream)
+{
+   // both sides use the smaller of the two tables.
+   U32 entryBitSize = stream->readInt(ConnectionStringTable::EntryBitSizeBitSize);
+   if(entryBitSize < mStringTable->getEntryBitSize())
+      mStringTable->setEntryBitSize(entryBitSize);
+}
+
+void NetConnection::writeStringTableAccept(BitStream *stream)
+{
+   stream->writeInt(mStringTable->getEntryBitSize(), ConnectionStringTable::EntryBitSizeBitSize);
+   mStringTable->writeSeeds(stream);
+}
+
+void NetConnection::readStringTableAccept(BitStream *stream)
+{
+   mStringTable->setEntryBitSize(stream->readInt(ConnectionStringTable::EntryBitSizeBitSize));
+   mStringTable->readSeeds(stream);
+}
+
 bool NetConnection::connectLocal(NetInterface *connectionInterface, NetInterface *serverInterface)
 {
-   Object *co = Object::create(getClassName());
+   NetConnectionRep *rep = NetConnectionRep::find(getClassName());
    NetConnection *client = this;
-   NetConnection *server = dynamic_cast<NetConnection *>(co);
+   NetConnection *server = rep ? rep->mCreate() : NULL;
    const char *error = NULL;
    PacketStream stream;
 
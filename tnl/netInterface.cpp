@@ -33,6 +33,7 @@
 #include "tnlNetObject.h"
 #include "tnlClientPuzzle.h"
 #include "tnlCertificate.h"
+#include "tnlVirtualNetwork.h"
 #include "tomcrypt.h"
 
 namespace TNL {
@@ -49,13 +50,18 @@ NetInterface::NetInterface(const Address &bindAddress) : mSocket(bindAddress)
    mAllowConnections = true;
    mRequiresKeyExchange = false;
 
-   Random::read(mRandomHashData, sizeof(mRandomHashData));
-
    mConnectionHashTable.setSize(129);
    for(S32 i = 0; i < mConnectionHashTable.size(); i++)
       mConnectionHashTable[i] = NULL;
    mSendPacketList = NULL;
-   mCurrentTime = Platform::getRealMilliseconds();
+   mProfileDumpCount = NetProfiler::getDumpCount();
+   updateCurrentTime();
+}
+
+void NetInterface::updateCurrentTime()
+{
+   VirtualNetwork *network = mSocket.getVirtualNetwork();
+   mCurrentTime = network ? network->getCurrentTime() : Platform::getRealMilliseconds();
 }
 
 NetInterface::~NetInterface()
@@ -125,16 +131,11 @@ void NetInterface::sendtoDelayed(const Address &address, BitStream *stream, U32
 
 U32 NetInterface::computeClientIdentityToken(const Address &address, const Nonce &theNonce)
 {
-   hash_state hashState;
-   U32 hash[8];
-
-   sha256_init(&hashState);
-   sha256_process(&hashState, (const U8 *) &address, sizeof(Address));
-   sha256_process(&hashState, theNonce.data, Nonce::NonceSize);
-   sha256_process(&hashState, mRandomHashData, sizeof(mRandomHashData));
-   sha256_done(&hashState, (U8 *) hash);
+   U8 buffer[sizeof(Address) + Nonce::NonceSize];
+   memcpy(buffer, &address, sizeof(Address));
+   memcpy(buffer + sizeof(Address), theNonce.data, Nonce::NonceSize);
 
-   return hash[0];
+   return U32(mIdentityHash.hash(buffer, sizeof(buffer)));
 }
 
 //-----------------------------------------------------------------------------
@@ -303,8 +304,16 @@ void NetInterface::addConnection(NetConnection *conn)
 
 void NetInterface::processConnections()
 {
-   mCurrentTime = Platform::getRealMilliseconds();
+   updateCurrentTime();
    mPuzzleManager.tick(mCurrentTime);
+   NetProfiler::checkDump(mCurrentTime);
+   if(mProfileDumpCount != NetProfiler::getDumpCount())
+   {
+      mProfileDumpCount = NetProfiler::getDumpCount();
+      NetProfiler::dumpConnections(mConnectionList);
+      for(S32 i = 0; i < mConnectionList.size(); i++)
+         mConnectionList[i]->resetProfile();
+   }
 
    // first see if there are any delayed packets that need to be sent...
    while(mSendPacketList && mSendPacketList->sendTime < getCurrentTime())
@@ -415,7 +424,7 @@ void NetInterface::checkIncomingPackets()
    NetError error;
    Address sourceAddress;
 
-   mCurrentTime = Platform::getRealMilliseconds();
+   updateCurrentTime();
 
    // read out all the available packets:
    while((error = stream.recvfrom(mSocket, &sourceAddress)) == NoError)
@@ -623,11 +632,20 @@ void NetInterface::handleConnectChallengeResponse(const Address &address, BitStr
 void NetInterface::continuePuzzleSolution(NetConnection *conn)
 {
    ConnectionParameters &theParams = conn->getConnectionParameters();
-   bool solved = ClientPuzzleManager::solvePuzzle(&theParams.mPuzzleSolution, theParams.mNonce, theParams.mServerNonce, theParams.mPuzzleDifficulty, theParams.mClientIdentity);
+   bool solved;
+
+   // solvePuzzle stops after a slice of real time, so on a virtual network,
+   // where no time passes while it works, solve it in one go; otherwise
+   // the speed of the CPU would decide when the connect request goes out.
+   do
+   {
+      solved = ClientPuzzleManager::solvePuzzle(&theParams.mPuzzleSolution, theParams.mNonce, theParams.mServerNonce, theParams.mPuzzleDifficulty, theParams.mClientIdentity);
+   } while(!solved && mSocket.getVirtualNetwork());
 
    if(solved)
    {
-      logprintf("Client puzzle solved in %d ms.", Platform::getRealMilliseconds() - conn->mConnectLastSendTime);
+      updateCurrentTime();
+      logprintf("Client puzzle solved in %d ms.", getCurrentTime() - conn->mConnectLastSendTime);
       conn->setConnectionState(NetConnection::AwaitingConnectResponse);
       sendConnectRequest(conn);
    }
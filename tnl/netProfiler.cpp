@@ -0,0 +1,242 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "tnl.h"
+#include "tnlNetProfiler.h"
+#include "tnlNetBase.h"
+#include "tnlNetConnection.h"
+#include "tnlBitStream.h"
+#include "tnlLog.h"
+
+namespace TNL
+{
+
+U32 NetProfiler::mSampleInterval = NetProfiler::DefaultSampleInterval;
+U32 NetProfiler::mSampleCountdown = NetProfiler::DefaultSampleInterval;
+U32 NetProfiler::mDumpInterval = 0;
+U32 NetProfiler::mLastDumpTime = 0;
+bool NetProfiler::mDumpTimeSet = false;
+U32 NetProfiler::mDumpCount = 0;
+bool NetProfiler::mTimingUpdate = false;
+U32 NetProfiler::mScopeMask = 0;
+U32 NetProfiler::mScopeBits[NetClassProfile::MaskBitCount];
+F64 NetProfiler::mScopeMs[NetClassProfile::MaskBitCount];
+
+void NetClassProfile::clear()
+{
+   memset(this, 0, sizeof(NetClassProfile));
+}
+
+void NetConnectionProfile::clear()
+{
+   memset(this, 0, sizeof(NetConnectionProfile));
+}
+
+void NetProfiler::setSampleInterval(U32 interval)
+{
+   mSampleInterval = interval;
+   mSampleCountdown = interval;
+}
+
+void NetProfiler::recordUpdate(NetClassRep *classRep, bool initial, U32 sentMask, U32 bitCount, F64 packMs)
+{
+   NetClassProfile &profile = classRep->getProfile();
+   profile.count++;
+   profile.bits += bitCount;
+   profile.addSample(packMs);
+
+   // initial updates send every mask bit whether the object uses it or
+   // not, so only partial updates say anything about what a bit costs.
+   if(initial)
+   {
+      profile.initialCount++;
+      profile.initialBits += bitCount;
+      return;
+   }
+
+   bool timed = packMs >= 0;
+   U32 scopeMask = mScopeMask & sentMask;
+   U32 remaining = bitCount;
+   F64 remainingMs = packMs;
+   U32 unscopedCount = 0;
+   for(U32 i = 0; i < NetClassProfile::MaskBitCount; i++)
+   {
+      U32 bit = 1 << i;
+      if(!(sentMask & bit))
+         continue;
+      profile.maskCount[i]++;
+      if(timed)
+         profile.maskSampleCount[i]++;
+      if(scopeMask & bit)
+      {
+         U32 scopeBits = getMin(mScopeBits[i], remaining);
+         profile.maskBits[i] += scopeBits;
+         remaining -= scopeBits;
+         if(timed)
+         {
+            profile.maskSampleMs[i] += mScopeMs[i];
+            remainingMs -= mScopeMs[i];
+         }
+      }
+      else
+         unscopedCount++;
+   }
+
+   if(!unscopedCount)
+   {
+      profile.unattributedBits += remaining;
+      return;
+   }
+
+   // split what's left between the bits that had no scope; the first one
+   // takes the remainder.
+   U32 share = remaining / unscopedCount;
+   U32 extra = remaining - share * unscopedCount;
+   F64 shareMs = getMax(remainingMs, 0.0) / unscopedCount;
+   for(U32 i = 0; i < NetClassProfile::MaskBitCount; i++)
+   {
+      U32 bit = 1 << i;
+      if((sentMask & bit) && !(scopeMask & bit))
+      {
+         profile.maskBits[i] += share + extra;
+         extra = 0;
+         if(timed)
+            profile.maskSampleMs[i] += shareMs;
+      }
+   }
+}
+
+void NetProfiler::recordEvent(NetClassRep *classRep, U32 bitCount, F64 packMs)
+{
+   NetClassProfile &profile = classRep->getProfile();
+   profile.count++;
+   profile.bits += bitCount;
+   profile.initialCount++;
+   profile.initialBits += bitCount;
+   profile.addSample(packMs);
+}
+
+static S32 QSORT_CALLBACK ClassEntryCompare(const void *aptr, const void *bptr)
+{
+   const NetProfiler::ClassEntry *a = (const NetProfiler::ClassEntry *) aptr;
+   const NetProfiler::ClassEntry *b = (const NetProfiler::ClassEntry *) bptr;
+
+   if(a->profile.bits != b->profile.bits)
+      return a->profile.bits > b->profile.bits ? -1 : 1;
+   return strcmp(a->classRep->getClassName(), b->classRep->getClassName());
+}
+
+void NetProfiler::getSnapshot(Vector<ClassEntry> &entries)
+{
+   entries.clear();
+   for(NetClassRep *walk = NetClassRep::mClassLinkList; walk; walk = walk->mNextClass)
+   {
+      if(!walk->mProfile.count)
+         continue;
+      ClassEntry entry;
+      entry.classRep = walk;
+      entry.profile = walk->mProfile;
+      entries.push_back(entry);
+   }
+   if(entries.size())
+      qsort(entries.address(), entries.size(), sizeof(ClassEntry), ClassEntryCompare);
+}
+
+void NetProfiler::reset()
+{
+   for(NetClassRep *walk = NetClassRep::mClassLinkList; walk; walk = walk->mNextClass)
+      walk->mProfile.clear();
+}
+
+void NetProfiler::dump(const Vector<NetConnection *> *connections)
+{
+   Vector<ClassEntry> entries;
+   getSnapshot(entries);
+
+   U64 totalBits = 0;
+   for(S32 i = 0; i < entries.size(); i++)
+      totalBits += entries[i].profile.bits;
+
+   logprintf("Net Profile: %d classes, %g kbytes", entries.size(), totalBits / 8192.0);
+   for(S32 i = 0; i < entries.size(); i++)
+   {
+      NetClassProfile &p = entries[i].profile;
+      logprintf("%s - Count: %d (%d initial)   Avg Size: %g   Share: %.1f%%   Pack Time: %.3f ms",
+            entries[i].classRep->getClassName(), p.count, p.initialCount, p.bits / F64(p.count),
+            p.bits * 100.0 / totalBits, p.getEstimatedMs());
+
+      for(U32 j = 0; j < NetClassProfile::MaskBitCount; j++)
+         if(p.maskCount[j])
+            logprintf("   Mask Bit %d - Count: %d   Avg Size: %g   Pack Time: %.3f ms", j, p.maskCount[j],
+                  p.maskBits[j] / F64(p.maskCount[j]), p.getEstimatedMaskMs(j));
+      if(p.unattributedBits)
+         logprintf("   Unattributed - %g bits per partial update", p.unattributedBits / F64(p.count - p.initialCount));
+   }
+
+   if(connections)
+      dumpConnections(*connections);
+}
+
+void NetProfiler::dumpConnections(const Vector<NetConnection *> &connections)
+{
+   for(S32 i = 0; i < connections.size(); i++)
+   {
+      NetConnectionProfile &p = connections[i]->getProfile();
+      logprintf("Connection %s - Packets: %d (%g kbytes)   Ghosts: %d (%g kbytes)   Events: %d (%g kbytes)   Pack Time: %.3f ms",
+            connections[i]->getNetAddressString(), p.packetCount, p.packetBits / 8192.0,
+            p.ghostCount, p.ghostBits / 8192.0, p.eventCount, p.eventBits / 8192.0, p.getEstimatedMs());
+   }
+}
+
+void NetProfiler::setDumpInterval(U32 interval)
+{
+   mDumpInterval = interval;
+   mDumpTimeSet = false;
+}
+
+//--------------------------------------
+
+NetProfileScope::NetProfileScope(BitStream *stream, U32 mask)
+{
+   TNLAssert(mask != 0, "NetProfileScope needs a mask bit.");
+   mStream = stream;
+   mStart = stream->getCodedBitPosition();
+   mMaskBit = 0;
+   while(!(mask & (1 << mMaskBit)))
+      mMaskBit++;
+   if(NetProfiler::isTimingUpdate())
+      mStartTime = Platform::getHighPrecisionTimerValue();
+}
+
+NetProfileScope::~NetProfileScope()
+{
+   F64 ms = 0;
+   if(NetProfiler::isTimingUpdate())
+      ms = Platform::getHighPrecisionMilliseconds(Platform::getHighPrecisionTimerValue() - mStartTime);
+   NetProfiler::addMaskBits(mMaskBit, mStream->getCodedBitPosition() - mStart, ms);
+}
+
+};
@@ -30,6 +30,8 @@
 #include "tnlNetStringTable.h"
 #include "tnlDataChunker.h"
 #include "tnlNetInterface.h"
+#include "tnlThread.h"
+#include "tnlPlatform.h"
 
 namespace TNL {
 
@@ -39,56 +41,116 @@ namespace StringTable
 /// @name Implementation details
 /// @{
 
-/// This is internal to the _StringTable class.
+// The string table is split into ShardCount independent shards, chosen
+// by string hash.  Each shard has its own lock, which is only taken to
+// add or remove a string.  Finding a string that is already in the table,
+// and getting the string for an id, take no locks at all:
+//
+// - Freed nodes go onto per shard, per size class free lists and are
+//   reused for new strings, so a reader walking a hash chain never touches
+//   freed memory, and the string data never needs compacting.
+// - Each thread counts its way in and out of the lock free paths, so the
+//   count is odd while it is inside one.  compact() hands replaced hash
+//   tables and free nodes too big for the node pool back to the system,
+//   once every thread that was inside a lock free path when they were
+//   unlinked has left it.  Pooled nodes stay on the free lists.
+// - Nodes are completely filled in before they are linked into a chain,
+//   and their reference count is set last, so a node can't be referenced
+//   until it is complete.
+// - A reader that walks into a node while it is being removed or reused
+//   can take a wrong turn in the chain.  Any miss on the lock free path is
+//   retried under the shard lock, and a hit is only trusted once the
+//   reader holds a reference to the node and has checked the string again.
+// - Node ids are (slot << ShardBits) | shard.  Slots are kept in fixed
+//   size pages that never move, so getString is a pair of array lookups.
+// - Strings with more than PinThreshold references are pinned and never
+//   freed.  Copying a pinned StringTableEntry only reads the node, so the
+//   most heavily shared strings don't bounce between processor caches.
+
+/// This is internal to the StringTable.
 struct Node
 {
-   StringTableEntryId masterIndex; ///< index of the Node pointer in the master list
-   StringTableEntryId nextIndex; ///< next string in this hash bucket.
+   Node *nextNode; ///< next string in this hash bucket, or the next free node of this size class.
+   StringTableEntryId id; ///< id of this node, 0 if the node is free.
    U32 hash; ///< stored hash value of this string.
+   volatile S32 refCount; ///< number of StringTableEntry's that reference this node
    U16 stringLen; ///< length of string in this node.
-   U16 refCount; ///< number of StringTableEntry's that reference this node
-   char stringData[1]; ///< String data, with space for the NULL token.  Node structure is allocated as strlen + sizeof(Node);
+   U16 sizeClass; ///< allocation size class of this node.
+   char stringData[1]; ///< String data, with space for the NULL token.
 };
 
 enum {
-   InitialHashTableSize = 1237, ///< Initial size of string hash table
-   InitialNodeListSize = 2048, ///< Initial size of node id remap table
-   CompactThreshold = 32768, ///< Number of string bytes freed before compaction occurs.
+   ShardBits = 4,
+   ShardCount = 1 << ShardBits, ///< Number of independently locked shards
+   InitialHashTableSize = 79, ///< Initial size of each shard's hash table
+   SlotPageBits = 10,
+   SlotPageSize = 1 << SlotPageBits, ///< Number of node slots in a slot page
+   MaxSlotPages = 4096, ///< Maximum number of slot pages in a shard
+   SmallSizeClassCount = 16, ///< Node sizes up to 256 bytes are rounded up to a multiple of 16
+   SmallSizeClassStep = 16,
+   SizeClassCount = 32, ///< Larger node sizes are rounded up to a power of two
+   MaxPooledNodeSize = 2048, ///< Larger nodes are allocated individually
+   PinThreshold = 4096, ///< Reference count at which a string is pinned
+   PinnedRefCount = 0x40000000, ///< Reference count of a pinned string
+   MaxLockFreeSteps = 64, ///< Longest chain walk before falling back to the locked path
 };
 
-Node **mNodeList = NULL; ///< Master list of string table entry nodes
-StringTableEntryId *mBuckets = NULL; ///< Hash table buckets, organized by string index
+/// Hash bucket array for a shard.  When a shard's table is resized the
+/// old array is kept, since a lock free reader may still be using it.
+struct BucketTable
+{
+   U32 size;
+   Node *buckets[1];
+};
 
-U32 mNumBuckets = 0; ///< number of hash buckets in the table
-U32 mNodeListSize = 0; ///< number of elements in the node list
-StringTableEntryId mNodeListFreeEntry = 0; ///< index of first free entry in the node list
+struct Shard
+{
+   Mutex lock; ///< Held while adding or removing strings in this shard
+   BucketTable * volatile table; ///< Current hash table
+   Vector<BucketTable *> oldTables; ///< Tables replaced by resizes
+   Node **slotPages[MaxSlotPages]; ///< Node pointers, indexed by slot
+   U32 slotCount; ///< Number of slots handed out so far
+   Vector<U32> freeSlots; ///< Slots of removed nodes
+   U32 itemCount; ///< Number of strings in the shard
+   Node *freeNodes[SizeClassCount]; ///< Removed nodes, by size class
+   DataChunker nodePool; ///< Memory pool for nodes up to MaxPooledNodeSize
+};
 
-U32 mItemCount = 0; ///< number of strings in the table
+/// Lock free path count for one thread, odd while the thread is in a
+/// lock free path.  Records are reused once their thread exits.
+struct ReaderState
+{
+   volatile U32 sequence;
+   volatile bool owned;
+   ReaderState *next;
+};
 
-DataChunker *mMemPool = NULL; ///< memory pool from which string table data is allocated
-U32 mFreeStringDataSize = 0; ///< number of bytes freed by deallocated strings.  When this number exceeds CompactThreshold, the table is compacted.
+/// Memory unlinked by compact(), with the readers that were in a lock
+/// free path at the time.  It is freed once they have all moved on.
+struct RetiredBatch
+{
+   Vector<void *> memory;
+   Vector<ReaderState *> readers;
+   Vector<U32> sequences;
+};
 
-// a little note about the free list...
-// the free list is essentially an index linked list encoded in the node
-// list.  The first entry in the list is mNodeListFreeEntry.
-// When the string table is compacted, we need to know which elements
-// in the node list actually point to nodes, and which ones are members
-// of the free list... so, what we do is, free list entries are
-// actually coded with the next index shifted left 1 and or'd with a 1
-// so we have the lowest bit set.  We know that pointers allocated by the
-// data chunker are on at least 4-byte boundaries, so any pointer with
-// the low bit set is assumed to be a free list entry.
+Shard *mShards[ShardCount]; ///< The table shards, allocated on first use
+volatile S32 mInitState = 0; ///< 0 before init, 1 during, 2 once the shards exist
 
+// these are created by init(), since strings may be added by static
+// constructors in other modules.
+ThreadStorage *mReaderStorage; ///< This thread's ReaderState
+Mutex *mCompactLock; ///< Held while changing the reader list or retired batches
+ReaderState *mReaders; ///< All reader records
+Vector<RetiredBatch *> *mRetired; ///< Batches waiting for their readers
+U32 mCompactShard; ///< Next shard for compact() to look at
 
-/// Resize the StringTable to be able to hold newSize items. This 
-/// is called automatically by the StringTable when the table is
-/// full past a certain threshhold.
+/// Resize the hash table of a shard to be able to hold newSize items. This 
+/// is called automatically when the shard is full past a certain threshhold.
 ///
+/// @param shard     Shard to resize, which must be locked.
 /// @param newSize   Number of new items to allocate space for.
-void resizeHashTable(const U32 newSize);
-
-/// compacts the string data associated with the string table.
-void compact();
+void resizeHashTable(Shard *shard, const U32 newSize);
 
 //---------------------------------------------------------------
 //
@@ -141,42 +203,220 @@ U32 hashStringn(const char* str, S32 len)
 }
 
 //--------------------------------------
-void init()
+void releaseReaderState(void *reader)
 {
-   mMemPool = new DataChunker;
-   mBuckets = (StringTableEntryId *) malloc(InitialHashTableSize * sizeof(StringTableEntryId));
-   for(U32 i = 0; i < InitialHashTableSize; i++)
-      mBuckets[i] = 0;
-
-   mNumBuckets = InitialHashTableSize;
-   mItemCount = 1;
-
-   mNodeList = (Node **) malloc(InitialNodeListSize * sizeof(Node *));
-   for(U32 i = 1; i < InitialNodeListSize; i++)
-      mNodeList[i] = (Node *) (( (i + 1) << 1) | 1); // see the doco in stringTable.h for how free list entries are coded
-   
-   mNodeList[InitialNodeListSize - 1] = NULL;
-   mNodeList[0] = (Node *) mMemPool->alloc(sizeof(Node));
-   mNodeList[0]->stringData[0] = 0;
-   mNodeList[0]->stringLen = 0;
-   mNodeList[0]->refCount = 1;
-   mNodeList[0]->masterIndex = mNodeList[0]->nextIndex = 0;
-   mNodeListSize = InitialNodeListSize;
-
-   mNodeListFreeEntry = (1 << 1) | 1;
-   mFreeStringDataSize = 0;
+   memoryBarrier();
+   ((ReaderState *) reader)->owned = false;
 }
 
-void destroy()
+/// Returns a record released by an exited thread, or a new one.
+ReaderState *acquireReaderState()
 {
-   free(mBuckets);
-   mBuckets = NULL;
-   free(mNodeList);
-   mNodeList = NULL;
-   delete mMemPool;
+   mCompactLock->lock();
+   ReaderState *reader;
+   for(reader = mReaders; reader; reader = reader->next)
+      if(!reader->owned)
+         break;
+   if(!reader)
+   {
+      reader = new ReaderState;
+      reader->sequence = 0;
+      reader->next = mReaders;
+      mReaders = reader;
+   }
+   reader->owned = true;
+   mCompactLock->unlock();
+   mReaderStorage->set(reader);
+   return reader;
+}
+
+/// Marks this thread as inside a lock free path.
+inline ReaderState *beginLockFree()
+{
+   ReaderState *reader = (ReaderState *) mReaderStorage->get();
+   if(!reader)
+      reader = acquireReaderState();
+   reader->sequence++;
+   memoryBarrier();
+   return reader;
+}
+
+inline void endLockFree(ReaderState *reader)
+{
+   memoryBarrier();
+   reader->sequence++;
 }
 
 //--------------------------------------
+BucketTable *allocBucketTable(U32 size)
+{
+   BucketTable *table = (BucketTable *) malloc(sizeof(BucketTable) + (size - 1) * sizeof(Node *));
+   table->size = size;
+   for(U32 i = 0; i < size; i++)
+      table->buckets[i] = NULL;
+   return table;
+}
+
+void init()
+{
+   initToLowerTable();
+   mReaderStorage = new ThreadStorage(releaseReaderState);
+   mCompactLock = new Mutex;
+   mReaders = NULL;
+   mRetired = new Vector<RetiredBatch *>;
+   mCompactShard = 0;
+   for(U32 i = 0; i < ShardCount; i++)
+   {
+      Shard *shard = new Shard;
+      shard->table = allocBucketTable(InitialHashTableSize);
+      for(U32 j = 0; j < MaxSlotPages; j++)
+         shard->slotPages[j] = NULL;
+      for(U32 j = 0; j < SizeClassCount; j++)
+         shard->freeNodes[j] = NULL;
+      shard->slotCount = 0;
+      shard->itemCount = 0;
+      mShards[i] = shard;
+   }
+   // slot 0 of shard 0 is id 0, the empty string.
+   mShards[0]->slotPages[0] = (Node **) malloc(SlotPageSize * sizeof(Node *));
+   mShards[0]->slotPages[0][0] = NULL;
+   mShards[0]->slotCount = 1;
+}
+
+/// Makes sure the table exists.  The first thread in builds it, any others
+/// wait for it to finish.
+inline void checkInit()
+{
+   if(mInitState == 2)
+      return;
+   if(atomicCompareAndSwap(&mInitState, 0, 1))
+   {
+      init();
+      memoryBarrier();
+      mInitState = 2;
+   }
+   else
+   {
+      while(mInitState != 2)
+         Platform::sleep(0);
+   }
+}
+
+inline U32 getShardIndex(U32 hash)
+{
+   return (hash * 0x9E3779B1) >> (32 - ShardBits);
+}
+
+inline Shard *getShard(U32 hash)
+{
+   return mShards[getShardIndex(hash)];
+}
+
+inline Node *getNode(StringTableEntryId index)
+{
+   Shard *shard = mShards[index & (ShardCount - 1)];
+   U32 slot = index >> ShardBits;
+   return shard->slotPages[slot >> SlotPageBits][slot & (SlotPageSize - 1)];
+}
+
+inline bool matches(Node *node, U32 hash, const char *val, S32 len, bool caseSens)
+{
+   if(node->hash != hash || node->stringLen != len)
+      return false;
+   if(caseSens)
+      return !strncmp(node->stringData, val, len);
+   return !strnicmp(node->stringData, val, len);
+}
+
+/// Walks the chain for a string without taking the shard lock.  The
+/// result is only a hint, see the notes above.
+Node *findLockFree(Shard *shard, U32 hash, const char *val, S32 len, bool caseSens)
+{
+   BucketTable *table = shard->table;
+   Node *walk = table->buckets[hash % table->size];
+   for(U32 steps = 0; walk && steps < MaxLockFreeSteps; steps++)
+   {
+      if(matches(walk, hash, val, len, caseSens))
+         return walk;
+      walk = walk->nextNode;
+   }
+   return NULL;
+}
+
+/// Walks the chain for a string with the shard lock held.
+Node *findLocked(Shard *shard, U32 hash, const char *val, S32 len, bool caseSens)
+{
+   BucketTable *table = shard->table;
+   for(Node *walk = table->buckets[hash % table->size]; walk; walk = walk->nextNode)
+      if(matches(walk, hash, val, len, caseSens))
+         return walk;
+   return NULL;
+}
+
+/// Adds a reference to a node found without the lock.  Fails if the
+/// node is free or on its way to being freed.
+bool tryAcquire(Node *node)
+{
+   for(;;)
+   {
+      S32 count = node->refCount;
+      if(count <= 0)
+         return false;
+      if(count >= PinThreshold)
+         return true;
+      if(atomicCompareAndSwap(&node->refCount, count, count + 1))
+      {
+         if(count + 1 >= PinThreshold)
+            node->refCount = PinnedRefCount;
+         return true;
+      }
+   }
+}
+
+U32 getSizeClass(U32 allocSize, U32 &classSize)
+{
+   if(allocSize <= SmallSizeClassCount * SmallSizeClassStep)
+   {
+      U32 sizeClass = (allocSize + SmallSizeClassStep - 1) / SmallSizeClassStep - 1;
+      classSize = (sizeClass + 1) * SmallSizeClassStep;
+      return sizeClass;
+   }
+   U32 sizeClass = SmallSizeClassCount;
+   classSize = SmallSizeClassCount * SmallSizeClassStep * 2;
+   while(classSize < allocSize)
+   {
+      classSize <<= 1;
+      sizeClass++;
+   }
+   return sizeClass;
+}
+
+/// Returns the node size of a size class.
+U32 getClassSize(U32 sizeClass)
+{
+   if(sizeClass < SmallSizeClassCount)
+      return (sizeClass + 1) * SmallSizeClassStep;
+   return (SmallSizeClassCount * SmallSizeClassStep * 2) << (sizeClass - SmallSizeClassCount);
+}
+
+Node *allocNode(Shard *shard, S32 len)
+{
+   U32 classSize;
+   U32 sizeClass = getSizeClass(sizeof(Node) + len, classSize);
+   Node *node = shard->freeNodes[sizeClass];
+   if(node)
+      shard->freeNodes[sizeClass] = node->nextNode;
+   else
+   {
+      if(classSize <= MaxPooledNodeSize)
+         node = (Node *) shard->nodePool.alloc(classSize);
+      else
+         node = (Node *) malloc(classSize);
+      node->refCount = 0;
+   }
+   node->sizeClass = sizeClass;
+   return node;
+}
 
 //--------------------------------------
 StringTableEntryId insert(const char* val, const bool caseSens)
@@ -189,38 +429,29 @@ StringTableEntryId insert(const char* val, const bool caseSens)
 //--------------------------------------
 void validate()
 {
-   // count all the nodes in the node list:
-   U32 nodeCount = 0;
-   for(U32 i = 0; i < mNodeListSize; i++)
-   {
-      if(mNodeList[i] && !(U32(mNodeList[i]) & 1))
-        nodeCount++;
-   }
-   TNLAssert(nodeCount == mItemCount, "Error!!!");
-   U32 freeListCount = 0;
-   StringTableEntryId walk = mNodeListFreeEntry;
-   while(walk)
-   {
-      walk = StringTableEntryId(mNodeList[walk >> 1]);
-      if(!((walk >> 1) < mNodeListSize))
-         TNLAssert((walk >> 1) < mNodeListSize, "Out of range node index!!!");
-      freeListCount++;
-   }
-   TNLAssert(freeListCount + nodeCount == mNodeListSize, "Error!!!!");
-   // walk through all the bucket chains...
-   // and make sure there are no free entries...
-
-   for(U32 i = 0; i < mNumBuckets; i++)
+   for(U32 i = 0; i < ShardCount; i++)
    {
-      StringTableEntryId walk = mBuckets[i];
-      while(walk)
+      Shard *shard = mShards[i];
+      shard->lock.lock();
+
+      // walk through all the bucket chains, making sure every node is
+      // live and in the right shard and bucket.
+      U32 nodeCount = 0;
+      BucketTable *table = shard->table;
+      for(U32 j = 0; j < table->size; j++)
       {
-        TNLAssert(walk < mNodeListSize, "Out of range node index!!!");
-        Node *node = mNodeList[walk];
-        TNLAssert((U32(node) & 1) == 0, "Free list entry in node chain!!!");
-        TNLAssert(walk == node->masterIndex, "Master/node index mismatch.");
-        walk = node->nextIndex;
+         for(Node *walk = table->buckets[j]; walk; walk = walk->nextNode)
+         {
+            TNLAssert(walk->refCount > 0, "Free node in node chain!!!");
+            TNLAssert(getShard(walk->hash) == shard, "Node in the wrong shard!!!");
+            TNLAssert(walk->hash % table->size == j, "Node in the wrong bucket!!!");
+            TNLAssert(getNode(walk->id) == walk, "Slot/node mismatch.");
+            nodeCount++;
+         }
       }
+      TNLAssert(nodeCount == shard->itemCount, "Error!!!");
+      TNLAssert(shard->itemCount + shard->freeSlots.size() + (i == 0) == shard->slotCount, "Error!!!!");
+      shard->lock.unlock();
    }
 }
 
@@ -228,213 +459,311 @@ StringTableEntryId insertn(const char* val, S32 len, const bool caseSens)
 {
    if(!val || !*val || len == 0)
       return 0;
-   if(!mBuckets)
-      init();
-   StringTableEntryId *walk;
-   Node *stringNode;
+
+   // the string stops at the first NULL, if there's one before len.
+   S32 stringLen = 0;
+   while(stringLen < len && val[stringLen])
+      stringLen++;
+   len = stringLen;
+
+   checkInit();
    U32 key = hashStringn(val, len);
-   walk = &mBuckets[key % mNumBuckets]; // find the bucket that the string would belong in
+   Shard *shard = getShard(key);
+
+   // most strings are already in the table, so try without the lock first.
+   ReaderState *reader = beginLockFree();
+   Node *stringNode = findLockFree(shard, key, val, len, caseSens);
+   bool acquired = stringNode && tryAcquire(stringNode);
+   endLockFree(reader);
+   if(acquired)
+   {
+      // now that the node can't go away, make sure it's still the right one.
+      if(matches(stringNode, key, val, len, caseSens))
+         return stringNode->id;
+      decRef(stringNode->id);
+   }
 
-   // walk all the nodes in the bucket to see if the string is already in the table
-   while(*walk)
+   shard->lock.lock();
+
+   // the string may be in the table with no references, waiting for the
+   // lock to be removed.  If so it can be picked back up.
+   stringNode = findLocked(shard, key, val, len, caseSens);
+   if(stringNode)
    {
-      stringNode = mNodeList[*walk];
-      if((caseSens && !strncmp(stringNode->stringData, val, len) && stringNode->stringData[len] == 0) ||
-         (!caseSens && !strnicmp(stringNode->stringData, val, len) && stringNode->stringData[len] == 0) )
-      {
-         // the string was found, so bump the reference count and return the node id
-         stringNode->refCount++;
-         return *walk;
-      }
-      // step to the next node in the hash bucket.
-      walk = &(stringNode->nextIndex);
+      if(stringNode->refCount < PinThreshold && atomicIncrement(&stringNode->refCount) >= PinThreshold)
+         stringNode->refCount = PinnedRefCount;
+      StringTableEntryId id = stringNode->id;
+      shard->lock.unlock();
+      return id;
    }
-   
+
    // the string was not found in the table.  So allocate a new node for the string
 
-   // first, make sure there is a free node pointer:
-   if(!mNodeListFreeEntry)
+   // first, find a free slot for it:
+   U32 slot;
+   if(shard->freeSlots.size())
    {
-      U32 oldNodeListSize = mNodeListSize;
-      mNodeListSize += InitialNodeListSize;
-      mNodeList = (Node **) realloc(mNodeList, mNodeListSize * sizeof(Node *));
-      for(U32 i = oldNodeListSize; i < mNodeListSize; i++)
-         mNodeList[i] = (Node *) (((i + 1) << 1) | 1);
-      mNodeList[mNodeListSize - 1] = 0;
-      mNodeListFreeEntry = (oldNodeListSize << 1) | 1;
+      slot = shard->freeSlots[shard->freeSlots.size() - 1];
+      shard->freeSlots.pop_back();
    }
-   // now allocate a new string node, and fill it in.
-   stringNode = (Node *) mMemPool->alloc(sizeof(Node) + len);
+   else
+   {
+      slot = shard->slotCount++;
+      U32 page = slot >> SlotPageBits;
+      TNLAssert(page < MaxSlotPages, "String table shard is full!");
+      if(!shard->slotPages[page])
+         shard->slotPages[page] = (Node **) malloc(SlotPageSize * sizeof(Node *));
+   }
+
+   // now fill in the new string node.  The reference count goes in last,
+   // so that no lock free reader can pick up the node before it's done.
+   stringNode = allocNode(shard, len);
    stringNode->stringLen = len;
-   stringNode->refCount = 1;
-   stringNode->masterIndex = mNodeListFreeEntry >> 1; // shift off the low bit flag for the free list
-   stringNode->nextIndex = 0;
+   stringNode->id = (slot << ShardBits) | getShardIndex(key);
    stringNode->hash = key;
-   *walk = stringNode->masterIndex;
-
-   // dequeue the next free entry in the node list
-   mNodeListFreeEntry = (StringTableEntryId) mNodeList[mNodeListFreeEntry >> 1];
-   TNLAssert(!mNodeListFreeEntry || (mNodeListFreeEntry & 1), "Error in freeList!!");
-   mNodeList[stringNode->masterIndex] = stringNode;
-   
+   stringNode->nextNode = NULL;
    strncpy(stringNode->stringData, val, len);
    stringNode->stringData[len] = 0;
-   mItemCount++;
+   memoryBarrier();
+   stringNode->refCount = 1;
+   memoryBarrier();
+
+   shard->slotPages[slot >> SlotPageBits][slot & (SlotPageSize - 1)] = stringNode;
+
+   // new strings are added at the end of the bucket list so that case
+   // sensitive strings are always after their corresponding case
+   // insensitive strings.
+   BucketTable *table = shard->table;
+   Node **walk = &table->buckets[key % table->size];
+   while(*walk)
+      walk = &((*walk)->nextNode);
+   *walk = stringNode;
+   shard->itemCount++;
 
    // check for hash table resize
-   if(mItemCount > 2 * mNumBuckets) {
-      resizeHashTable(4 * mNumBuckets - 1);
-   }
-   return stringNode->masterIndex;
+   if(shard->itemCount > 2 * table->size)
+      resizeHashTable(shard, 4 * table->size - 1);
+
+   StringTableEntryId id = stringNode->id;
+   shard->lock.unlock();
+   return id;
 }
 
 //--------------------------------------
-StringTableEntryId lookup(const char* val, const bool  caseSens)
+StringTableEntryId lookupn(const char* val, S32 len, const bool caseSens)
 {
-   StringTableEntryId *walk;
-   Node *stringNode;
-   U32 key = hashString(val);
-   walk = &mBuckets[key % mNumBuckets];
-   while(*walk)
+   if(!val)
+      return 0;
+   S32 stringLen = 0;
+   while(stringLen < len && val[stringLen])
+      stringLen++;
+   len = stringLen;
+   if(!len)
+      return 0;
+
+   checkInit();
+   U32 key = hashStringn(val, len);
+   Shard *shard = getShard(key);
+
+   ReaderState *reader = beginLockFree();
+   Node *stringNode = findLockFree(shard, key, val, len, caseSens);
+   if(stringNode)
    {
-      stringNode = mNodeList[*walk];
-      if((caseSens && !strcmp(stringNode->stringData, val)) ||
-         (!caseSens && !stricmp(stringNode->stringData, val)) )
-         return *walk;
-      walk = &(stringNode->nextIndex);
+      StringTableEntryId id = stringNode->id;
+      memoryBarrier();
+      bool found = stringNode->refCount > 0 && matches(stringNode, key, val, len, caseSens);
+      endLockFree(reader);
+      if(found)
+         return id;
    }
-   return 0;
+   else
+      endLockFree(reader);
+
+   shard->lock.lock();
+   stringNode = findLocked(shard, key, val, len, caseSens);
+   StringTableEntryId id = stringNode ? stringNode->id : 0;
+   shard->lock.unlock();
+   return id;
 }
 
 //--------------------------------------
-StringTableEntryId lookupn(const char* val, S32 len, const bool  caseSens)
+StringTableEntryId lookup(const char* val, const bool caseSens)
 {
-   StringTableEntryId *walk;
-   Node *stringNode;
-   U32 key = hashStringn(val, len);
-   walk = &mBuckets[key % mNumBuckets];
-   while(*walk)
-   {
-      stringNode = mNodeList[*walk];
-      if((caseSens && !strncmp(stringNode->stringData, val, len) && stringNode->stringData[len] == 0) ||
-         (!caseSens && !strnicmp(stringNode->stringData, val, len) && stringNode->stringData[len] == 0) )
-         return *walk;
-      walk = &(stringNode->nextIndex);
-   }
-   return 0; 
+   if(!val)
+      return 0;
+   return lookupn(val, strlen(val), caseSens);
 }
 
 //--------------------------------------
-void resizeHashTable(const U32 newSize)
+void resizeHashTable(Shard *shard, const U32 newSize)
 {
-   StringTableEntryId walk;
-   StringTableEntryId head = 0;
-   StringTableEntryId temp;
-
-   U32 i;
-   // reverse individual bucket lists
-   // we do this because new strings are added at the end of bucket
-   // lists so that case sens strings are always after their
-   // corresponding case insens strings
-
-   for(i = 0; i < mNumBuckets; i++) {
-      walk = mBuckets[i];
+   BucketTable *oldTable = shard->table;
+   BucketTable *newTable = allocBucketTable(newSize);
+
+   // rehash each old bucket in order, appending to the new buckets, so
+   // that case sensitive strings stay after their case insensitive
+   // versions.  Lock free readers may get lost while the chains are
+   // being relinked, and will fall back to the locked path.
+   Node ***tails = (Node ***) malloc(newSize * sizeof(Node **));
+   for(U32 i = 0; i < newSize; i++)
+      tails[i] = &newTable->buckets[i];
+
+   for(U32 i = 0; i < oldTable->size; i++)
+   {
+      Node *walk = oldTable->buckets[i];
       while(walk)
       {
-         temp = mNodeList[walk]->nextIndex;
-         mNodeList[walk]->nextIndex = head;
-         head = walk;
-         walk = temp;
+         Node *next = walk->nextNode;
+         U32 bucket = walk->hash % newSize;
+         walk->nextNode = NULL;
+         *tails[bucket] = walk;
+         tails[bucket] = &walk->nextNode;
+         walk = next;
       }
    }
-   mBuckets = (StringTableEntryId *) realloc(mBuckets, newSize * sizeof(StringTableEntryId));
-   for(i = 0; i < newSize; i++) {
-      mBuckets[i] = 0;
-   }
-   mNumBuckets = newSize;
-   walk = head;
-   while(walk)
-   {
-      U32 key;
-      Node *temp = mNodeList[walk];
-      
-      walk = temp->nextIndex;
-      key = temp->hash;
-      temp->nextIndex = mBuckets[key % newSize];
-      mBuckets[key % newSize] = temp->masterIndex;
-   }
-}
+   free(tails);
 
-void compact()
-{
-   DataChunker *newData = new DataChunker;
-   for(U32 i = 1; i < mNodeListSize; i++)
-   {
-      Node *theNode, *newNode;
-      theNode = mNodeList[i];
-      
-      // if the low bit is set, it's an entry in the free list.
-      // if it is NULL it is the last entry (see the constructor)
-      // this *may* not be the best fix, but it was a crash -pw
-      if(((StringTableEntryId) theNode) & 1 || theNode == NULL)
-         continue;
-      newNode = (Node *) newData->alloc(sizeof(Node) + theNode->stringLen);
-      newNode->stringLen = theNode->stringLen;
-      newNode->refCount = theNode->refCount;
-      newNode->masterIndex = theNode->masterIndex;
-      newNode->nextIndex = theNode->nextIndex;
-      newNode->hash = theNode->hash;
-      strcpy(newNode->stringData, theNode->stringData);
-      mNodeList[i] = newNode; 
-   }
-   delete mMemPool;
-   mMemPool = newData;
-   mFreeStringDataSize = 0;
+   memoryBarrier();
+   shard->table = newTable;
+   shard->oldTables.push_back(oldTable);
 }
 
 void incRef(StringTableEntryId index)
 {
-   mNodeList[index]->refCount++;
+   Node *node = getNode(index);
+   if(node->refCount >= PinThreshold)
+      return;
+   if(atomicIncrement(&node->refCount) >= PinThreshold)
+      node->refCount = PinnedRefCount;
 }
 
 void decRef(StringTableEntryId index)
 {
-   Node *theNode = mNodeList[index];
-   if(--theNode->refCount)
+   Node *theNode = getNode(index);
+   if(theNode->refCount >= PinThreshold)
       return;
+   if(atomicDecrement(&theNode->refCount))
+      return;
+
+   Shard *shard = mShards[index & (ShardCount - 1)];
+   shard->lock.lock();
+
+   // another thread may have picked the string back up, or freed it,
+   // before we got the lock.
+   theNode = getNode(index);
+   if(theNode->id != index || theNode->refCount != 0)
+   {
+      shard->lock.unlock();
+      return;
+   }
 
    // remove from the hash table first:
-   StringTableEntryId *walk = &mBuckets[theNode->hash % mNumBuckets];
-   Node *stringNode;
+   BucketTable *table = shard->table;
+   Node **walk = &table->buckets[theNode->hash % table->size];
    while(*walk)
    {
-      stringNode = mNodeList[*walk];
-      if(stringNode == theNode)
+      if(*walk == theNode)
       {
-         *walk = theNode->nextIndex;
+         *walk = theNode->nextNode;
          break;
       }
-      walk = &(stringNode->nextIndex);
+      walk = &((*walk)->nextNode);
    }
 
-   mFreeStringDataSize += mNodeList[index]->stringLen + sizeof(Node);
-   mNodeList[index] = (Node *) mNodeListFreeEntry;
-   mNodeListFreeEntry = (index << 1) | 1;
+   theNode->id = 0;
+   theNode->nextNode = shard->freeNodes[theNode->sizeClass];
+   shard->freeNodes[theNode->sizeClass] = theNode;
+   shard->freeSlots.push_back(index >> ShardBits);
+   shard->itemCount--;
+   shard->lock.unlock();
+}
 
-   if(mFreeStringDataSize > CompactThreshold)
-      compact();
-   mItemCount--;
-   if(!mItemCount)
-      destroy();
+//--------------------------------------
+/// Frees the memory of retired batches whose readers have all left the
+/// lock free path they were in.  mCompactLock must be held.
+void freeRetiredBatches()
+{
+   Vector<RetiredBatch *> &retired = *mRetired;
+   for(S32 i = 0; i < retired.size(); )
+   {
+      RetiredBatch *batch = retired[i];
+      bool readersDone = true;
+      for(S32 j = 0; j < batch->readers.size() && readersDone; j++)
+         readersDone = batch->readers[j]->sequence != batch->sequences[j];
+      if(!readersDone)
+      {
+         i++;
+         continue;
+      }
+      for(S32 j = 0; j < batch->memory.size(); j++)
+         free(batch->memory[j]);
+      delete batch;
+      retired.erase_fast(i);
+   }
+}
+
+void compact()
+{
+   if(mInitState != 2)
+      return;
+
+   mCompactLock->lock();
+   memoryBarrier();
+   freeRetiredBatches();
+
+   Shard *shard = mShards[mCompactShard];
+   mCompactShard = (mCompactShard + 1) & (ShardCount - 1);
+
+   // unlink the shard's old tables and its free nodes that came from
+   // malloc.  Free nodes are only reachable by readers that took a wrong
+   // turn before the nodes were removed.
+   RetiredBatch *batch = new RetiredBatch;
+   shard->lock.lock();
+   for(S32 i = 0; i < shard->oldTables.size(); i++)
+      batch->memory.push_back(shard->oldTables[i]);
+   shard->oldTables.clear();
+   for(U32 sizeClass = 0; sizeClass < SizeClassCount; sizeClass++)
+   {
+      if(getClassSize(sizeClass) <= MaxPooledNodeSize)
+         continue;
+      for(Node *walk = shard->freeNodes[sizeClass]; walk; walk = walk->nextNode)
+         batch->memory.push_back(walk);
+      shard->freeNodes[sizeClass] = NULL;
+   }
+   shard->lock.unlock();
+
+   if(!batch->memory.size())
+   {
+      delete batch;
+      mCompactLock->unlock();
+      return;
+   }
+
+   // any reader that enters a lock free path from here on can't reach
+   // the batch, so it only has to wait for the ones inside one now.
+   memoryBarrier();
+   for(ReaderState *reader = mReaders; reader; reader = reader->next)
+   {
+      U32 sequence = reader->sequence;
+      if(sequence & 1)
+      {
+         batch->readers.push_back(reader);
+         batch->sequences.push_back(sequence);
+      }
+   }
+   mRetired->push_back(batch);
+   freeRetiredBatches();
+   mCompactLock->unlock();
 }
 
 const char *getString(StringTableEntryId index)
 {
    if(!index)
       return "";
-   return mNodeList[index]->stringData;
+   return getNode(index)->stringData;
 }
 
+/// @}
 
 };
 
@@ -360,6 +360,8 @@ U32 x86UNIXGetTickCount()
    return (secs * 1000) + (uSecs / 1000);
 }
 
+// Counts microseconds, so short intervals like a single packUpdate can be
+// timed.
 class UnixTimer
 {
    public:
@@ -368,11 +370,13 @@ class UnixTimer
       }
       S64 getCurrentTime()
       {
-         return x86UNIXGetTickCount();
+         timeval t;
+         ::gettimeofday(&t, NULL);
+         return S64(t.tv_sec) * 1000000 + t.tv_usec;
       }
       F64 convertToMS(S64 delta)
       {
-         return F64(delta);
+         return F64(delta) / 1000.0;
       }
 };
 
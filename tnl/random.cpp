@@ -29,6 +29,7 @@
 #include "tnl.h"
 #include "tnlRandom.h"
 #include "tnlJournal.h"
+#include "tnlThread.h"
 
 namespace TNL {
 
@@ -106,4 +107,38 @@ bool readB()
 }
 }; 
 
+void FastRandom::setSeed(U32 seed)
+{
+   // expand the seed with splitmix64, so that similar seeds still give
+   // unrelated sequences and the state is never all zero.
+   const U64 increment = (U64(0x9E3779B9) << 32) | 0x7F4A7C15;
+   const U64 mix1 = (U64(0xBF58476D) << 32) | 0x1CE4E5B9;
+   const U64 mix2 = (U64(0x94D049BB) << 32) | 0x133111EB;
+
+   U64 x = seed;
+   for(U32 i = 0; i < 4; i += 2)
+   {
+      x += increment;
+      U64 z = x;
+      z = (z ^ (z >> 30)) * mix1;
+      z = (z ^ (z >> 27)) * mix2;
+      z ^= z >> 31;
+      mState[i] = U32(z);
+      mState[i + 1] = U32(z >> 32);
+   }
+}
+
+static ThreadStorage gFastRandomStorage;
+
+FastRandom &FastRandom::get()
+{
+   FastRandom *generator = (FastRandom *) gFastRandomStorage.get();
+   if(!generator)
+   {
+      generator = new FastRandom(Random::readI());
+      gFastRandomStorage.set(generator);
+   }
+   return *generator;
+}
+
 };
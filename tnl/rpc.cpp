@@ -38,14 +38,21 @@ RPCEvent::RPCEvent(RPCGuaranteeType gType, RPCDirection dir) :
 {
 }
 
+void RPCEvent::packShared(BitStream *bstream)
+{
+   mFunctor->writeArguments(*bstream, Types::SharedArguments);
+}
+
 void RPCEvent::pack(EventConnection *ps, BitStream *bstream)
 {
-   mFunctor->write(*bstream);
+   writeShared(bstream);
+   mFunctor->writeArguments(*bstream, Types::ConnectionArguments);
 }
 
 void RPCEvent::unpack(EventConnection *ps, BitStream *bstream)
 {
-   mFunctor->read(*bstream);
+   mFunctor->readArguments(*bstream, Types::SharedArguments);
+   mFunctor->readArguments(*bstream, Types::ConnectionArguments);
 }
 
 void RPCEvent::process(EventConnection *ps)
@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU 
+//   General Public License, alternative licensing options are available 
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+
+#include "tnl.h"
+#include "tnlSipHash.h"
+#include "tnlRandom.h"
+
+namespace TNL {
+
+static inline U64 readU64LittleEndian(const U8 *buf)
+{
+   U64 value = 0;
+   for(S32 i = 7; i >= 0; i--)
+      value = (value << 8) | buf[i];
+   return value;
+}
+
+static inline U64 rotateLeft(U64 value, U32 bits)
+{
+   return (value << bits) | (value >> (64 - bits));
+}
+
+#define SIPROUND \
+   v0 += v1; v1 = rotateLeft(v1, 13); v1 ^= v0; v0 = rotateLeft(v0, 32); \
+   v2 += v3; v3 = rotateLeft(v3, 16); v3 ^= v2; \
+   v0 += v3; v3 = rotateLeft(v3, 21); v3 ^= v0; \
+   v2 += v1; v1 = rotateLeft(v1, 17); v1 ^= v2; v2 = rotateLeft(v2, 32);
+
+SipHash::SipHash()
+{
+   U8 key[KeySize];
+   Random::read(key, KeySize);
+   setKey(key);
+}
+
+void SipHash::setKey(const U8 *key)
+{
+   mKey[0] = readU64LittleEndian(key);
+   mKey[1] = readU64LittleEndian(key + 8);
+}
+
+U64 SipHash::hash(const void *data, U32 size) const
+{
+   // the constants are built from 32 bit halves, since Visual C++ 6
+   // doesn't accept 64 bit literals.
+   U64 v0 = mKey[0] ^ ((U64(0x736f6d65) << 32) | 0x70736575);
+   U64 v1 = mKey[1] ^ ((U64(0x646f7261) << 32) | 0x6e646f6d);
+   U64 v2 = mKey[0] ^ ((U64(0x6c796765) << 32) | 0x6e657261);
+   U64 v3 = mKey[1] ^ ((U64(0x74656462) << 32) | 0x79746573);
+
+   const U8 *bytes = (const U8 *) data;
+   const U8 *end = bytes + (size & ~7);
+
+   for(; bytes != end; bytes += 8)
+   {
+      U64 m = readU64LittleEndian(bytes);
+      v3 ^= m;
+      SIPROUND;
+      SIPROUND;
+      v0 ^= m;
+   }
+
+   // the last block holds the remaining bytes with the length in the top byte
+   U64 last = U64(size) << 56;
+   for(U32 i = 0; i < (size & 7); i++)
+      last |= U64(bytes[i]) << (i * 8);
+
+   v3 ^= last;
+   SIPROUND;
+   SIPROUND;
+   v0 ^= last;
+
+   v2 ^= 0xFF;
+   SIPROUND;
+   SIPROUND;
+   SIPROUND;
+   SIPROUND;
+   return v0 ^ v1 ^ v2 ^ v3;
+}
+
+};
@@ -76,7 +76,7 @@ bool Mutex::tryLock()
    return false;//   return TryEnterCriticalSection(&mLock);
 }
 
-ThreadStorage::ThreadStorage()
+ThreadStorage::ThreadStorage(void (*threadExit)(void *data))
 {
    mTlsIndex = TlsAlloc();
 }
@@ -177,9 +177,9 @@ bool Mutex::tryLock()
    return false;//   return TryEnterCriticalSection(&mLock);
 }
 
-ThreadStorage::ThreadStorage()
+ThreadStorage::ThreadStorage(void (*threadExit)(void *data))
 {
-   pthread_key_create(&mThreadKey, NULL);
+   pthread_key_create(&mThreadKey, threadExit);
 }
 
 ThreadStorage::~ThreadStorage()
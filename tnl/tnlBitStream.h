@@ -35,6 +35,10 @@
 #include "tnlConnectionStringTable.h"
 #endif
 
+#ifndef _TNL_FIELDCODER_H_
+#include "tnlFieldCoder.h"
+#endif
+
 namespace TNL {
 
 class SymmetricCipher;
@@ -73,6 +77,7 @@ protected:
    U32  maxReadBitNum;        ///< Last valid read bit position.
    U32  maxWriteBitNum;       ///< Last valid write bit position.
    ConnectionStringTable *mStringTable; ///< String table used to compress StringTableEntries over the network.
+   ConnectionFieldCoder *mFieldCoder;   ///< Coder used to entropy code CodedFields, while ghost updates are written or read.
    /// String buffer holds the last string written into the stream for substring compression.
    char mStringBuffer[256];
 
@@ -112,6 +117,9 @@ public:
    /// sets the ConnectionStringTable for compressing string table entries across the network
    void setStringTable(ConnectionStringTable *table) { mStringTable = table; }
 
+   /// sets the ConnectionFieldCoder for entropy coding CodedFields
+   void setFieldCoder(ConnectionFieldCoder *coder) { mFieldCoder = coder; }
+
    /// clears the error state from an attempted read or write overrun
    void clearError() { mError = false; }
 
@@ -251,6 +259,34 @@ public:
    /// Reads a string table entry from the stream
    void readStringTableEntry(StringTableEntry *ste);
 
+   /// @name Entropy Coded Fields
+   ///
+   /// These write and read values like the calls they are named after, but
+   /// when the stream has a field coder, as a GhostConnection's ghost updates
+   /// do, the top bits of each value are coded against an adaptive model of
+   /// field.  Without one they write exactly what the uncoded calls would.
+   ///
+   /// @see CodedField
+   /// @{
+
+   void writeCodedInt(U32 value, U8 bitCount, CodedField &field);
+   U32 readCodedInt(U8 bitCount, CodedField &field);
+
+   void writeCodedRangedU32(U32 value, U32 rangeStart, U32 rangeEnd, CodedField &field);
+   U32 readCodedRangedU32(U32 rangeStart, U32 rangeEnd, CodedField &field);
+
+   void writeCodedFloat(F32 f, U8 bitCount, CodedField &field);
+   F32 readCodedFloat(U8 bitCount, CodedField &field);
+
+   bool writeCodedFlag(bool val, CodedField &field);
+   bool readCodedFlag(CodedField &field);
+
+   /// Returns the bit position plus the bits of information coded so far in
+   /// the current packet, for measuring what a write costs.
+   U32 getCodedBitPosition() { return bitNum + (mFieldCoder ? mFieldCoder->getCodedBitCount() : 0); }
+
+   /// @}
+
    /// Writes byte data into the stream.
    bool write(const U32 in_numBytes, const void* in_pBuffer);
    /// Reads byte data from the stream.
@@ -390,6 +426,51 @@ inline U32 BitStream::readRangedU32(U32 rangeStart, U32 rangeEnd)
    return val;
 }
 
+inline void BitStream::writeCodedRangedU32(U32 value, U32 rangeStart, U32 rangeEnd, CodedField &field)
+{
+   TNLAssert(value >= rangeStart && value <= rangeEnd, "Out of bounds value!");
+   U32 rangeSize = rangeEnd - rangeStart + 1;
+   U32 rangeBits = getNextBinLog2(rangeSize);
+
+   writeCodedInt(value - rangeStart, U8(rangeBits), field);
+}
+
+inline U32 BitStream::readCodedRangedU32(U32 rangeStart, U32 rangeEnd, CodedField &field)
+{
+   TNLAssert(rangeEnd >= rangeStart, "error, end of range less than start");
+   U32 rangeSize = rangeEnd - rangeStart + 1;
+   U32 rangeBits = getNextBinLog2(rangeSize);
+
+   U32 val = readCodedInt(U8(rangeBits), field) + rangeStart;
+   if(val > rangeEnd)
+   {
+      setError();
+      return rangeStart;
+   }
+   return val;
+}
+
+inline void BitStream::writeCodedFloat(F32 f, U8 bitCount, CodedField &field)
+{
+   writeCodedInt(U32(f * ((1 << bitCount) - 1)), bitCount, field);
+}
+
+inline F32 BitStream::readCodedFloat(U8 bitCount, CodedField &field)
+{
+   return readCodedInt(bitCount, field) / F32((1 << bitCount) - 1);
+}
+
+inline bool BitStream::writeCodedFlag(bool val, CodedField &field)
+{
+   writeCodedInt(val, 1, field);
+   return val;
+}
+
+inline bool BitStream::readCodedFlag(CodedField &field)
+{
+   return readCodedInt(1, field) != 0;
+}
+
 inline void BitStream::writeEnum(U32 enumValue, U32 enumRange)
 {
    writeInt(enumValue, getNextBinLog2(enumRange));
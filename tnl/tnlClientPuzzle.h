@@ -27,8 +27,8 @@
 #ifndef _TNL_CLIENTPUZZLE_H_
 #define _TNL_CLIENTPUZZLE_H_
 
-#include "tnlDataChunker.h"
 #include "tnlNonce.h"
+#include "tnlSipHash.h"
 
 // JMQ: work around X.h header file
 #if defined(TNL_OS_LINUX) && defined(Success)
@@ -47,45 +47,70 @@ private:
    /// have constructed valid puzzle solutions for the current server
    /// nonce.  There are 2 nonce tables in the ClientPuzzleManager -
    /// one for the current nonce and one for the previous nonce.
+   ///
+   /// The table is a fixed size open addressed set, so a flood of
+   /// solutions can't grow it past MaxEntries.  Client nonces are
+   /// chosen by the remote host, so slots are picked with the manager's
+   /// keyed hash rather than from the nonce bits directly.
 
    class NonceTable {
-    private:
-      struct Entry {
-         Nonce mNonce;
-         Entry *mHashNext;
-      };
+    public:
       enum {
-         MinHashTableSize = 127,
-         MaxHashTableSize = 387,
+         TableSize = 8192,  ///< Number of slots, a power of two.
+         MaxEntries = 6144, ///< The table is full at 3/4 of its slots.
       };
+    private:
+      U64 *mTable;         ///< Slots holding nonces, 0 for an empty slot.
+      U32 mEntryCount;
+      bool mHasZeroNonce;  ///< The all zero nonce can't be stored in a slot.
+      const SipHash *mHash;
 
-      Entry **mHashTable;
-      U32 mHashTableSize;
-      DataChunker mChunker;
-
+      U32 findSlot(U64 nonce) const;
     public:
       /// NonceTable constructor
-      NonceTable() { reset(); }
+      NonceTable(const SipHash *hash);
+      ~NonceTable();
 
       /// Resets and clears the nonce table
       void reset();
 
-      /// checks if the given nonce is already in the table and adds it
-      /// if it is not.  Returns true if the nonce was not in the table
-      /// when the function was called.
-      bool checkAdd(Nonce &theNonce);
+      /// Returns true if the given nonce is in the table.
+      bool contains(const Nonce &theNonce) const;
+
+      /// Adds the given nonce to the table.  Returns false if the
+      /// table is full.
+      bool add(const Nonce &theNonce);
+
+      /// Returns true if the table can take no more nonces.
+      bool isFull() const { return mEntryCount >= MaxEntries; }
    };
 
    U32 mCurrentDifficulty;
+   U32 mLastDifficulty;       ///< Difficulty required for solutions to the previous nonce.
    U32 mLastUpdateTime;
    U32 mLastTickTime;
 
+   U32 mLoadIntervalStart;    ///< Start of the current handshake rate measurement.
+   U32 mIntervalSolutions;    ///< Solutions accepted in the current measurement.
+   U32 mQuietIntervals;       ///< Consecutive measurements below LowerDifficultyRate.
+
+   U32 mSolutionsChecked;     ///< Puzzle solutions hashed since startup.
+   U32 mSolutionsAccepted;    ///< Puzzle solutions accepted since startup.
+
    Nonce mCurrentNonce;
    Nonce mLastNonce;
 
+   SipHash mNonceHash;
    NonceTable *mCurrentNonceTable;
    NonceTable *mLastNonceTable;
    static bool checkOneSolution(U32 solution, Nonce &clientNonce, Nonce &serverNonce, U32 puzzleDifficulty, U32 clientIdentity);
+
+   /// Moves the current nonce and its table into the last slot and
+   /// starts a new server nonce.
+   void refreshNonce(U32 currentTime);
+
+   /// Adjusts the puzzle difficulty to the rate of accepted solutions.
+   void updateDifficulty(U32 currentTime);
 public:
    ClientPuzzleManager();
    ~ClientPuzzleManager();
@@ -112,9 +137,18 @@ public:
       MaxPuzzleDifficulty        = 26, ///< Maximum puzzle difficulty is approx 1 minute to solve on ~2004 hardware.
       MaxSolutionComputeFragment = 30, ///< Number of milliseconds spent computing solution per call to solvePuzzle.
       SolutionFragmentIterations = 50000, ///< Number of attempts to spend on the client puzzle per call to solvePuzzle.
+
+      MaxAdaptiveDifficulty      = 21, ///< Highest difficulty the server raises the puzzle to under load, about 16x the initial work.
+      LoadInterval               = 1000, ///< Milliseconds over which the rate of accepted solutions is measured.
+      RaiseDifficultyRate        = 30, ///< Accepted solutions per LoadInterval above which the difficulty goes up.
+      LowerDifficultyRate        = 5,  ///< Accepted solutions per LoadInterval below which the difficulty may come down.
+      LowerDifficultyDelay       = 10, ///< Number of quiet LoadIntervals before the difficulty comes down a step.
    };
 
-   /// Checks a puzzle solution submitted by a client to see if it is a valid solution for the current or previous puzzle nonces
+   /// Checks a puzzle solution submitted by a client to see if it is a valid solution for the current or previous puzzle nonces.
+   ///
+   /// The cheap checks, that the server nonce is known, the difficulty is at least what was asked for with that nonce, and
+   /// the client nonce hasn't been used, all come before the solution is hashed, so replayed and stale requests cost no SHA-256.
    ErrorCode checkSolution(U32 solution, Nonce &clientNonce, Nonce &serverNonce, U32 puzzleDifficulty, U32 clientIdentity);
 
    /// Computes a puzzle solution value for the given puzzle difficulty and server nonce.  If the execution time of this function
@@ -137,6 +171,12 @@ public:
 
    /// Returns the current client puzzle difficulty
    U32 getCurrentDifficulty() { return mCurrentDifficulty; }
+
+   /// Returns the number of puzzle solutions hashed by checkSolution.
+   U32 getSolutionsChecked() { return mSolutionsChecked; }
+
+   /// Returns the number of puzzle solutions accepted by checkSolution.
+   U32 getSolutionsAccepted() { return mSolutionsAccepted; }
 };
 
 };
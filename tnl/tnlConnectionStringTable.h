@@ -31,18 +31,34 @@
 #include "tnlNetStringTable.h"
 #endif
 
+#ifndef _TNL_VECTOR_H_
+#include "tnlVector.h"
+#endif
+
 namespace TNL {
 
 class NetConnection;
 class BitStream;
 
-/// ConnectionStringTable is a helper class to EventConnection for reducing duplicated string data sends
+/// ConnectionStringTable is a helper class to EventConnection for reducing duplicated string data sends.
+///
+/// Each side of a connection keeps a dictionary of strings the other side
+/// has already been sent, so that a StringTableEntry can be written as a
+/// short index once it has been sent and confirmed.  The dictionary size is
+/// negotiated when the connection is made, and the accepting side can seed
+/// the dictionary with strings it expects to send (player names, level and
+/// team names) so they go out once in the connect accept.  Indexes are
+/// delta coded against the previous index written in the same packet.
 class ConnectionStringTable
 {
 public:
    enum StringTableConstants{
-      EntryCount = 1024,
-      EntryBitSize = 10,
+      DefaultEntryBitSize = 10,
+      MinEntryBitSize = 6,
+      MaxEntryBitSize = 14,
+      EntryBitSizeBitSize = 4, ///< Bits used to send an entry bit size in the connect handshake
+      DeltaBitSize = 4, ///< Bits used for a delta coded index
+      SeedBitBudget = 4096, ///< Approximate limit on the size of the seed strings in the connect accept
    };
 
    struct Entry; 
@@ -74,12 +90,32 @@ public:
       bool receiveConfirmed;
    };
 
+   /// Counters for the strings written through this table.
+   struct Stats {
+      U32 hits;            ///< Strings sent as just an index.
+      U32 misses;          ///< Strings not in the table, sent in full.
+      U32 unconfirmed;     ///< Strings in the table but not yet confirmed, sent in full again.
+      U32 seeds;           ///< Strings sent in the connect accept.
+      U32 bitsSent;        ///< Total bits written for strings.
+      U32 bytesSaved;      ///< Approximate string bytes not sent because of hits.
+
+      Stats() { hits = misses = unconfirmed = seeds = bitsSent = bytesSaved = 0; }
+   };
+
 private:
-   Entry mEntryTable[EntryCount];
-   Entry *mHashTable[EntryCount];
-   StringTableEntry mRemoteStringTable[EntryCount];
+   U32 mEntryBitSize;
+   U32 mEntryCount;
+   Entry *mEntryTable;
+   Entry **mHashTable;
+   StringTableEntry *mRemoteStringTable;
    Entry mLRUHead, mLRUTail;
 
+   U32 mLastWriteIndex; ///< Last index written in the current packet, for delta coding.
+   U32 mLastReadIndex;  ///< Last index read in the current packet.
+   Vector<Entry *> mSeeds; ///< Seeded entries, to be sent in the connect accept.
+   U32 mSeedBits;
+   Stats mStats;
+
    NetConnection *mParent;
 
    /// Pushes an entry to the back of the LRU list.
@@ -92,8 +128,52 @@ private:
       entry->nextLink->prevLink = entry;
       entry->prevLink->nextLink = entry;
    }
+
+   /// Finds the entry for a string, or takes the least recently used
+   /// entry for it.  Returns true if the string was already in the table.
+   bool findEntry(StringTableEntryRef string, Entry *&entry);
+
+   void allocTables();
+   void freeTables();
+   void writeIndex(BitStream *stream, U32 index);
+   U32 readIndex(BitStream *stream);
 public:
-   ConnectionStringTable(NetConnection *parent);
+   ConnectionStringTable(NetConnection *parent, U32 entryBitSize = DefaultEntryBitSize);
+   ~ConnectionStringTable();
+
+   /// Changes the number of entries in the table, which must not have
+   /// been used yet.  Called when the connection parameters are negotiated.
+   void setEntryBitSize(U32 entryBitSize);
+   U32 getEntryBitSize() { return mEntryBitSize; }
+
+   /// Adds a string to be sent to the other side in the connect accept.
+   /// Must be called before anything is written to the table.  Returns
+   /// false once the seed budget is used up.
+   bool addSeed(StringTableEntryRef string);
+   void writeSeeds(BitStream *stream);
+   void readSeeds(BitStream *stream);
+
+   /// Resets the index delta coding at the start of each packet.
+   void beginWritePacket() { mLastWriteIndex = 0; }
+   void beginReadPacket() { mLastReadIndex = 0; }
+
+   /// The write state of the table within the current packet.
+   struct WriteMark {
+      U32 lastIndex;
+      PacketEntry *tail;
+   };
+
+   /// Records the write state, before writing something that may be
+   /// rewound out of the packet if it doesn't fit.
+   void getWriteMark(WriteMark &mark);
+
+   /// Undoes the effect of strings written since mark was taken on the
+   /// current packet, after the stream has been rewound.  The strings
+   /// are not recorded as sent in the packet, so they won't be treated
+   /// as received when the packet is acknowledged.
+   void rewindToWriteMark(const WriteMark &mark);
+
+   const Stats &getStats() { return mStats; }
 
    void writeStringTableEntry(BitStream *stream, StringTableEntryRef string);
    StringTableEntry readStringTableEntry(BitStream *stream);
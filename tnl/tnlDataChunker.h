@@ -131,6 +131,78 @@ public:
    }
 };
 
+//----------------------------------------------------------------------------
+
+/// Fixed size block allocator with a free list.
+///
+/// Unlike ClassChunker, FreeListChunker does not construct its elements, so it
+/// can be used to implement a class's operator new and operator delete (see
+/// TNL_DECLARE_FREE_LIST_ALLOCATOR).  Freed blocks are kept on a free list and
+/// handed out again before any new memory is carved from the DataChunker.
+/// Requests for a size other than the element size - from a subclass that does
+/// not declare its own allocator, for instance - are passed on to the heap.
+class FreeListChunker: private DataChunker
+{
+   U32 elementSize;    ///< size of each block, rounded up to keep the blocks 8 byte aligned
+   U32 objectSize;     ///< the object size this chunker was created for
+   S32 numAllocated;   ///< number of blocks currently handed out
+   void *freeListHead; ///< linked list of freed blocks for reuse
+public:
+   FreeListChunker(U32 size, S32 chunkSize = DataChunker::ChunkSize) : DataChunker(chunkSize)
+   {
+      objectSize = size;
+      elementSize = (getMax(size, U32(sizeof(void *))) + 7) & ~7;
+      numAllocated = 0;
+      freeListHead = NULL;
+   }
+
+   /// Returns a block of at least size bytes.
+   void *alloc(size_t size)
+   {
+      if(size != objectSize)
+         return ::operator new(size);
+
+      numAllocated++;
+      if(freeListHead == NULL)
+         return DataChunker::alloc(elementSize);
+      void *ret = freeListHead;
+      freeListHead = *(reinterpret_cast<void **>(freeListHead));
+      return ret;
+   }
+
+   /// Returns a block allocated with alloc to the free list.
+   void free(void *ptr, size_t size)
+   {
+      if(!ptr)
+         return;
+      if(size != objectSize)
+      {
+         ::operator delete(ptr);
+         return;
+      }
+      numAllocated--;
+      *(reinterpret_cast<void **>(ptr)) = freeListHead;
+      freeListHead = ptr;
+   }
+
+   /// Returns the number of blocks currently in use.
+   S32 getAllocatedCount() { return numAllocated; }
+};
+
+/// Declares a class specific operator new and operator delete for className
+/// that allocate from a FreeListChunker, so that frequently created and
+/// destroyed objects reuse their memory rather than going to the heap.  The
+/// class must have a virtual destructor if it is deleted through a base class
+/// pointer, so that operator delete is passed the correct size.
+#define TNL_DECLARE_FREE_LIST_ALLOCATOR(className) \
+   static TNL::FreeListChunker mFreeListChunker; \
+   void *operator new(size_t size) { return mFreeListChunker.alloc(size); } \
+   void operator delete(void *ptr, size_t size) { mFreeListChunker.free(ptr, size); }
+
+/// Defines the FreeListChunker declared by TNL_DECLARE_FREE_LIST_ALLOCATOR.
+#define TNL_IMPLEMENT_FREE_LIST_ALLOCATOR(className) \
+   TNL::FreeListChunker className::mFreeListChunker(sizeof(className));
+
 };
 
 #endif
@@ -69,6 +69,7 @@ public:
    {
       EventNote *eventList; ///< linked list of events sent with this packet
       EventPacketNotify() { eventList = NULL; }
+      void reset() { PacketNotify::reset(); eventList = NULL; }
    };
 
    EventConnection();
@@ -0,0 +1,347 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _TNL_FIELDCODER_H_
+#define _TNL_FIELDCODER_H_
+
+#ifndef _TNL_TYPES_H_
+#include "tnlTypes.h"
+#endif
+
+#ifndef _TNL_VECTOR_H_
+#include "tnlVector.h"
+#endif
+
+namespace TNL {
+
+class BitStream;
+
+/// CodedField describes one field of a NetObject's updates that can be
+/// entropy coded.
+///
+/// Each class that opts a field into coding declares a static CodedField for
+/// it, and passes it to BitStream::writeCodedInt() and the other coded
+/// reads and writes.  Every GhostConnection keeps an adaptive model of the
+/// values sent for each field, so a field whose values are skewed - a health
+/// that's mostly full, a flag that's mostly clear - costs a fraction of the
+/// bits it would take written directly.
+///
+/// The top symbolBits bits of each value are coded against the model, and
+/// any bits below those are written directly, since the low bits of a
+/// position or a speed are close to random and only make the model bigger.
+///
+/// @code
+/// static CodedField ShipHealthField("Ship health", 6);
+///
+/// stream->writeCodedFloat(mHealth, 6, ShipHealthField);
+/// ...
+/// mHealth = stream->readCodedFloat(6, ShipHealthField);
+/// @endcode
+class CodedField
+{
+   const char *mName;
+   U32 mSymbolBits;
+   U32 mIndex;
+   CodedField *mNextField;
+
+   static CodedField *mFirstField;
+   static U32 mFieldCount;
+public:
+   enum {
+      MaxSymbolBits = 8,
+   };
+
+   /// Declares a field whose values have their top symbolBits bits coded.
+   /// CodedFields must be static, so they are all declared before any
+   /// connection is made.
+   CodedField(const char *name, U32 symbolBits);
+
+   const char *getName() { return mName; }
+   U32 getSymbolBits() { return mSymbolBits; }
+
+   /// Returns the index of this field's model in every connection.  Indexes
+   /// are assigned at startup and may differ between builds, so they are
+   /// never sent over the network.
+   U32 getIndex() { return mIndex; }
+
+   CodedField *getNextField() { return mNextField; }
+   static CodedField *getFirstField() { return mFirstField; }
+   static U32 getFieldCount() { return mFieldCount; }
+};
+
+/// RangeEncoder is a byte oriented range coder, after the one in LZMA.
+///
+/// Symbols are encoded from their cumulative frequency, frequency and the
+/// total frequency of their model, which must be less than 2^16.  The
+/// coded bytes are held in the encoder until the block is flushed.
+class RangeEncoder
+{
+public:
+   enum {
+      TopValue = 1 << 24,     ///< The range is renormalized when it drops below this.
+      MaxBytes = 2047,        ///< Most coded bytes a block can hold, more than a packet can.
+   };
+
+   /// Everything an encoder needs to go back to an earlier point in the block.
+   struct State
+   {
+      U64 low;
+      U32 range;
+      U32 cacheSize;
+      U32 size;
+      U32 shiftCount;
+      U8 cache;
+      bool started;
+   };
+
+private:
+   State mState;
+   U8 mBuffer[MaxBytes];
+
+   void shiftLow();
+   void writeByte(U8 value);
+public:
+   RangeEncoder() { reset(); }
+
+   /// Starts a new block.
+   void reset();
+
+   /// Encodes a symbol occupying [start, start + size) of total.
+   void encode(U32 start, U32 size, U32 total);
+
+   /// Writes out the last of the block, with as few bits as a decoder
+   /// that reads zeros past the end of the block needs.
+   void flush();
+
+   const State &getState() { return mState; }
+   void setState(const State &state) { mState = state; }
+
+   /// Returns the bits of information encoded so far, which, unlike the
+   /// size of the block, grows with every symbol.
+   U32 getBitCount();
+
+   /// Returns the most bytes the block could hold once it is flushed.
+   U32 getMaxFlushSize() { return mState.size + mState.cacheSize + 4; }
+
+   const U8 *getBuffer() { return mBuffer; }
+   U32 getSize() { return mState.size; }
+
+   /// Returns the size of the flushed block in bits, which leaves off the
+   /// zero bits at the bottom of its last byte.
+   U32 getBitSize();
+};
+
+/// RangeDecoder decodes a block written by RangeEncoder.
+class RangeDecoder
+{
+   const U8 *mBuffer;
+   U32 mSize;
+   U32 mPosition;
+   U32 mRange;
+   U32 mCode;
+   U32 mScale;
+
+   U8 readByte() { return mPosition < mSize ? mBuffer[mPosition++] : 0; }
+public:
+   RangeDecoder() { begin(NULL, 0); }
+
+   /// Starts decoding the size bytes at buffer.
+   void begin(const U8 *buffer, U32 size);
+
+   /// Returns the cumulative frequency of the next symbol, for a model with
+   /// the given total.  decode() must be called with the symbol found from
+   /// it before the next one is read.
+   U32 getFrequency(U32 total);
+
+   /// Removes the symbol occupying [start, start + size) from the stream.
+   void decode(U32 start, U32 size);
+};
+
+/// ConnectionFieldCoder is a helper class to GhostConnection that entropy
+/// codes the CodedField values written into ghost updates.
+///
+/// The coded values of a packet's ghost updates go into a single range
+/// coded block, which is put in front of the updates once they have all
+/// been written, so the reader has it before it needs it.  Each side keeps an
+/// adaptive frequency model for every field, which must match the other
+/// side's exactly when a packet is decoded, even though packets are lost.
+/// So models only learn from packets that are known to have arrived: the
+/// sender folds a packet's values into its models when the packet is
+/// acknowledged, and throws them away if it's dropped, and each packet
+/// names the last acknowledged packet its models include, so the receiver
+/// folds in the packets it has received up to that one before decoding.
+/// A lost packet never reaches either side's models, so nothing has to be
+/// reset when one is dropped.
+///
+/// A connection that ghosts both ways keeps separate models for the updates
+/// it writes and the ones it reads.
+class ConnectionFieldCoder
+{
+public:
+   enum {
+      HistorySize = 32,          ///< Received packets remembered for folding; the size of the packet window.
+      BasisBitSize = 5,          ///< Bits used to send how far back the models' last packet is.
+      ShortSizeBitSize = 7,      ///< Bits used to send the size in bits of a small coded block.
+      SizeBitSize = 14,          ///< Bits used to send the size in bits of any other coded block.
+      ChecksumBitSize = 8,       ///< Bits of the model checksum sent on connections that debug object sizes.
+      MaxTotalFrequency = 1 << 16,
+      FrequencyIncrement = 24,   ///< Frequency added to a symbol each time it is received.
+   };
+
+   /// The values coded in one packet, kept by its notify until it is
+   /// acknowledged or dropped.
+   struct PacketList {
+      Vector<U32> symbols;    ///< Model index and symbol of each value coded, as (index << 8) | symbol.
+      U32 count;
+
+      PacketList() { count = 0; }
+      void add(U32 symbol);
+   };
+
+   /// The write state of the coder within the current packet.
+   struct WriteMark {
+      RangeEncoder::State encoderState;
+      U32 symbolCount;
+      U32 symbolBits;
+   };
+
+   /// Counters for the values coded by this side of the connection.
+   struct Stats {
+      U32 packets;         ///< Packets with a coded block.
+      U32 symbols;         ///< Values coded.
+      U32 symbolBits;      ///< Bits the coded part of those values would have taken written directly.
+      U32 codedBits;       ///< Bits of information in the coded values, by their models.
+      U32 blockBits;       ///< Bits used by the coded blocks, their headers included.
+
+      Stats() { packets = symbols = symbolBits = codedBits = blockBits = 0; }
+   };
+
+private:
+   struct Model
+   {
+      U32 symbolCount;
+      U32 total;
+      bool dirty;             ///< The frequencies changed since the cumulative table was built.
+      Vector<U32> frequency;
+      Vector<U32> cumulative;
+
+      Model(U32 symbolBits);
+      void add(U32 symbol);
+      void buildCumulative();
+   };
+
+   struct ReceivedPacket
+   {
+      U32 sequence;
+      bool pending;           ///< Received, but not yet folded into the models.
+      PacketList list;
+   };
+
+   Vector<Model *> mWriteModels;    ///< Models of the values this side sends.
+   Vector<Model *> mReadModels;     ///< Models of the values the other side sends.
+   RangeEncoder mEncoder;
+   RangeDecoder mDecoder;
+   U8 mReadBlock[RangeEncoder::MaxBytes];
+   ReceivedPacket mHistory[HistorySize];
+   U32 mWriteChecksum;        ///< Hash of every value folded into the write models.
+   U32 mReadChecksum;         ///< Hash of every value folded into the read models.
+   Stats mStats;
+
+   PacketList *mWriteList;    ///< Values coded in the packet being written.
+   U32 mWriteSymbolBits;      ///< Bits the values coded in the packet would have taken written directly.
+   U32 mWriteStart;           ///< Position of the packet's coding header.
+   U32 mBlockPosition;        ///< Position the coded block goes in, at the end of the header.
+
+   PacketList *mReadList;     ///< Values decoded from the packet being read.
+   U32 mReadBlockBits;        ///< Bits taken by the coded block of the packet being read.
+
+   static Model *getModel(Vector<Model *> &models, CodedField &field);
+   static void fold(Vector<Model *> &models, U32 &checksum, PacketList *list);
+
+   /// Returns the low bits of a hash of every value a set of models has
+   /// learned, which only match the other side's if the models do.
+   static U32 getChecksumBits(U32 checksum) { return checksum & ((1 << ChecksumBitSize) - 1); }
+public:
+   ConnectionFieldCoder();
+   ~ConnectionFieldCoder();
+
+   /// @name Writing
+   /// @{
+
+   /// Writes the coding header of packet sequence, whose values will be
+   /// coded with models that include the packets up to basis, and starts
+   /// coding them, recording them in note.  writeChecksum must be the same
+   /// on both sides.
+   void beginWritePacket(BitStream *stream, PacketList *note, U32 sequence, U32 basis, bool writeChecksum);
+
+   /// Writes the packet's coded block in front of its updates, moving
+   /// them along.
+   void endWritePacket(BitStream *stream);
+
+   /// Returns the most bits endWritePacket() could add to the packet.
+   U32 getMaxBlockBits() { return (mEncoder.getMaxFlushSize() << 3) + SizeBitSize + 1; }
+
+   /// Returns the bits of information coded in the current packet so far.
+   U32 getCodedBitCount() { return mEncoder.getBitCount(); }
+
+   /// Records the write state, before writing something that may be
+   /// rewound out of the packet if it doesn't fit.
+   void getWriteMark(WriteMark &mark);
+
+   /// Undoes the values coded since mark was taken.
+   void rewindToWriteMark(const WriteMark &mark);
+
+   void writeInt(BitStream *stream, U32 value, U8 bitCount, CodedField &field);
+
+   /// @}
+
+   /// @name Reading
+   /// @{
+
+   /// Reads the coding header of packet sequence, folds the packets
+   /// received up to its basis into the models and loads its coded block,
+   /// leaving the stream at the packet's updates.  Returns false if the
+   /// block is invalid or the models don't match the other side's.
+   bool beginReadPacket(BitStream *stream, U32 sequence, bool readChecksum);
+
+   /// Returns the bits the coded block took in the packet being read.
+   /// The updates were written before the block was put in front of them,
+   /// so positions recorded in them are this far short.
+   U32 getReadBlockBits() { return mReadBlockBits; }
+
+   U32 readInt(BitStream *stream, U8 bitCount, CodedField &field);
+
+   /// @}
+
+   const Stats &getStats() { return mStats; }
+
+   void packetReceived(PacketList *note);
+   void packetDropped(PacketList *note);
+};
+
+};
+
+#endif
@@ -35,6 +35,10 @@
 #include "tnlRPC.h"
 #endif
 
+#ifndef _TNL_FIELDCODER_H_
+#include "tnlFieldCoder.h"
+#endif
+
 namespace TNL {
 
 struct GhostInfo;
@@ -96,10 +100,13 @@ public:
    struct GhostPacketNotify : public EventConnection::EventPacketNotify
    {
       GhostRef *ghostList; ///< list of ghosts updated in this packet
+      ConnectionFieldCoder::PacketList fieldList; ///< Values entropy coded in this packet's ghost updates
       GhostPacketNotify() { ghostList = NULL; }
+      void reset() { EventPacketNotify::reset(); ghostList = NULL; fieldList.count = 0; }
    };
 
 protected:
+   static ClassChunker<GhostRef> mGhostRefChunker; ///< Quick memory allocator for ghost update records
 
    /// Override of EventConnection's allocNotify, to use the GhostPacketNotify structure.
    PacketNotify *allocNotify() { return new GhostPacketNotify; }
@@ -122,6 +129,18 @@ protected:
    /// Override to check if there is data pending on this GhostConnection.
    bool isDataToTransmit();
 
+   /// Writes whether this side wants to entropy code ghost update fields.
+   void writeConnectRequest(BitStream *stream);
+
+   /// Turns field coding off unless both sides want it.
+   bool readConnectRequest(BitStream *stream, const char **errorString);
+
+   /// Writes whether the connection entropy codes ghost update fields.
+   void writeConnectAccept(BitStream *stream);
+
+   /// Turns field coding off if the accepting side didn't agree to it.
+   bool readConnectAccept(BitStream *stream, const char **errorString);
+
 //----------------------------------------------------------------
 // ghost manager functions/code:
 //----------------------------------------------------------------
@@ -148,6 +167,8 @@ protected:
    SafePtr<NetObject> mScopeObject; ///< The local NetObject that performs scoping queries to determine what
                                     ///  objects to ghost to the client.
 
+   ConnectionFieldCoder *mFieldCoder; ///< Entropy coder for the CodedFields in ghost updates, or NULL if they're written directly.
+
    void clearGhostInfo();
    void deleteLocalGhosts();
    bool validateGhostArray();
@@ -173,6 +194,14 @@ public:
    /// Returns the sequence number of this ghosting session.
    U32 getGhostingSequence() { return mGhostingSequence; }
 
+   /// Sets whether the CodedFields in ghost updates are entropy coded.  Both
+   /// sides must enable it before the connection is made for it to be used.
+   void setFieldCoding(bool enabled);
+
+   /// Returns the field coder of this connection, or NULL if it doesn't
+   /// entropy code ghost updates.
+   ConnectionFieldCoder *getFieldCoder() { return mFieldCoder; }
+
    enum GhostConstants {
       GhostIdBitSize = 10,            ///< Size, in bits, of the integer used to transmit ghost IDs
       GhostLookupTableSizeShift = 10, ///< The size of the hash table used to lookup source NetObjects by remote ghost ID is 1 << GhostLookupTableSizeShift.
@@ -40,16 +40,75 @@ namespace TNL
 /// marked Journal methods will be intercepted and potentially recorded for later playback.
 /// If TNL_ENABLE_JOURNALING is not defined, all of the interception code will be disabled.
 
+class JournalWriter;
+struct JournalChunk;
+
+/// A JournalKeyframe marks the start of an entrypoint call in the journal
+/// stream.  Keyframes are recorded at a fixed real time interval and
+/// stored alongside the chunk they were recorded in, so a journal can be
+/// indexed without reading the stream itself.
+struct JournalKeyframe
+{
+   U32 entryCount;  ///< Number of entrypoint calls recorded before this one.
+   U32 time;        ///< Real milliseconds since recording started.
+   U64 bitPosition; ///< Absolute bit position of the entry in the journal stream.
+};
+
+/// The Journal class represents the recordable entry point(s) into program execution.
+/// When journaling is enabled by the TNL_ENABLE_JOURNALING macro, any calls into specially
+/// marked Journal methods will be intercepted and potentially recorded for later playback.
+/// If TNL_ENABLE_JOURNALING is not defined, all of the interception code will be disabled.
+///
+/// A journal file is a header followed by a sequence of chunks.  Each chunk
+/// holds the next piece of the continuous journal bit stream, preceded by
+/// the keyframes recorded while it was filled.  While recording, the stream
+/// is appended to an in-memory chunk and full chunks are handed to a
+/// background thread for writing, so an entrypoint call costs no file I/O.
+/// Playback scans the chunk headers to build the keyframe index and then
+/// streams the chunk contents through a sliding read window.
 class Journal : public Object
 {
+   enum {
+      ChunkSize = 1 << 20,          ///< Size of an in-memory write chunk.
+      FlushInterval = 500,          ///< Max milliseconds a partially filled chunk waits before being written.
+      KeyframeInterval = 1000,      ///< Milliseconds between recorded keyframes.
+      ReadAheadSize = 1 << 20,      ///< Minimum bytes kept in the read window ahead of the read position.
+   };
+
    static FILE *mJournalFile;
    static BitStream mReadStream;
    static BitStream mWriteStream;
    static Journal *mJournal;
-   static U32 mWritePosition;
-   static U32 mReadBreakBitPos;
+   static U64 mReadBreakBitPos;
    static U32 mBreakBlockIndex;
    static U32 mBlockIndex;
+
+   /// @name Recording state
+   /// @{
+   static JournalWriter *mWriter;
+   static JournalChunk *mWriteChunk;
+   static U64 mWritePosition;    ///< Bytes of the stream moved out of mWriteStream so far.
+   static U32 mEntryCount;
+   static U32 mRecordStartTime;
+   static U32 mLastFlushTime;
+   static U32 mNextKeyframeTime;
+   /// @}
+
+   /// @name Playback state
+   /// @{
+   struct ChunkInfo
+   {
+      U32 payloadSize;   ///< Payload size in bytes.
+      U32 bitCount;      ///< Valid bits in the payload.
+      U32 keyframeCount; ///< Keyframes stored between the chunk header and the payload.
+   };
+   static Vector<ChunkInfo> mReadChunks;
+   static Vector<JournalKeyframe> mKeyframes;
+   static S32 mNextReadChunk;
+   static U64 mReadWindowStart;  ///< Absolute byte position of the start of the read window.
+   static U32 mReadWindowSize;   ///< Bytes of the stream currently held in the read window.
+   static U64 mReadTotalBits;
+   /// @}
 public:
    enum Mode
    {
@@ -62,11 +121,18 @@ protected:
    static bool mInsideEntrypoint;
    static void checkReadPosition();
    static void syncWriteStream();
+   static void queueWriteChunk(bool finalChunk);
+   static void fillReadWindow();
+   static bool loadLegacy(FILE *theJournal);
 public:
    Journal();
    void record(const char *fileName);
    void load(const char *fileName);
 
+   /// Writes out everything recorded so far and closes the journal file.
+   /// This is registered to run at exit when recording starts.
+   static void close();
+
    void callEntry(const char *funcName, Functor *theCall);
    void processNextJournalEntry();
 
@@ -76,6 +142,18 @@ public:
    static BitStream *getWriteStream() { return &mWriteStream; }
    static bool isInEntrypoint() { return mInsideEntrypoint; }
 
+   /// Returns the keyframe index of the journal being played back.
+   static const Vector<JournalKeyframe> &getKeyframes() { return mKeyframes; }
+
+   /// Finds the last keyframe recorded at or before the given time, in
+   /// milliseconds from the start of the recording.  Returns NULL if
+   /// there are no keyframes.
+   static const JournalKeyframe *findKeyframe(U32 time);
+
+   /// Breaks into the debugger when playback reaches the given time, in
+   /// milliseconds from the start of the recording.
+   static void setBreakTime(U32 time);
+
    static void beginBlock(U32 blockId, bool writeBlock);
    static void endBlock(U32 blockId, bool writeBlock);
 };
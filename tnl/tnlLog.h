@@ -44,6 +44,39 @@ namespace TNL
 /// @see LogConsumer
 extern void logprintf(const char *format, ...);
 
+/// @name Asynchronous logging
+///
+/// By default logprintf formats the message and hands it to every LogConsumer
+/// before returning.  Once startAsyncLogging has been called, logprintf only
+/// copies the format string pointer and its arguments into a lock-free ring
+/// owned by the calling thread; a background thread formats the records and
+/// dispatches them to the consumers in the order they were logged.
+///
+/// While asynchronous logging is active the format string passed to logprintf
+/// must outlive the call (a string literal, in practice) - %s arguments are
+/// copied, the format itself is not.  When a thread's ring is full new records
+/// from that thread are dropped, and the log thread reports how many were lost.
+///
+/// @{
+
+/// Starts the log thread.  ringSize is the size in bytes of each thread's
+/// record ring, rounded up to a power of two.  Asynchronous logging is stopped
+/// automatically at exit.
+extern void startAsyncLogging(U32 ringSize = 256 * 1024);
+
+/// Dispatches all pending records and stops the log thread; logprintf goes
+/// back to logging synchronously.
+extern void stopAsyncLogging();
+
+/// Blocks until every record logged before the call has been dispatched to
+/// the consumers.  Does nothing if asynchronous logging isn't active.
+extern void flushLog();
+
+/// Returns the total number of records dropped because a ring was full.
+extern U32 getDroppedLogRecords();
+
+/// @}
+
 
 /// LogConsumer is the base class for the message logging system in TNL.
 ///
@@ -77,6 +110,12 @@ public:
    /// By default the string is sent to the Platform::outputDebugString function. Subclasses
    /// might log to a file, a remote service, or even a message box.
    virtual void logString(const char *string);
+
+   /// Called after a batch of strings has been written with logString.
+   ///
+   /// Consumers that buffer their output (a file, for example) should flush
+   /// it here rather than after every string.
+   virtual void flush() {}
 };
 
 struct LogType
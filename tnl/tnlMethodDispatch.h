@@ -159,6 +159,52 @@ namespace Types
    {
       s.writeSignedFloat(val.value, BitCount);
    }
+
+   /// Selects which of a Functor's arguments are read or written.
+   ///
+   /// Arguments written through a connection's string table encode
+   /// differently on every connection.  RPC events pack the arguments
+   /// before the first such argument once and share them between every
+   /// connection the event is posted to, then write the rest for each
+   /// connection, so the arguments stay in declaration order on the wire.
+   enum ArgumentSet {
+      AllArguments,        ///< Every argument, in declaration order.
+      SharedArguments,     ///< The arguments before the first one that depends on the connection's string table.
+      ConnectionArguments, ///< The first argument that depends on the connection's string table, and every one after it.
+      NoArguments,         ///< Used internally once the shared arguments have ended.
+   };
+
+   /// Returns true if values of a type are written through the connection's string table.
+   template <typename T> inline bool isConnectionSpecific(T *) { return false; }
+   inline bool isConnectionSpecific(TNL::StringTableEntry *) { return true; }
+   template <typename T> inline bool isConnectionSpecific(TNL::Vector<T> *) { return isConnectionSpecific((T *) NULL); }
+
+   /// Returns true if the next argument is in the set, and moves the set on
+   /// past the end of the shared arguments.
+   inline bool selectArgument(bool connectionSpecific, ArgumentSet &set)
+   {
+      if(connectionSpecific)
+      {
+         if(set == SharedArguments)
+            set = NoArguments;
+         else if(set == ConnectionArguments)
+            set = AllArguments;
+      }
+      return set == AllArguments || set == SharedArguments;
+   }
+
+   /// Reads an argument from a BitStream if it's in the given set.
+   template <typename T> inline void read(TNL::BitStream &s, T *val, ArgumentSet &set)
+   {
+      if(selectArgument(isConnectionSpecific(val), set))
+         read(s, val);
+   }
+   /// Writes an argument into a BitStream if it's in the given set.
+   template <typename T> inline void write(TNL::BitStream &s, T &val, ArgumentSet &set)
+   {
+      if(selectArgument(isConnectionSpecific(&val), set))
+         write(s, val);
+   }
 };
 
 namespace TNL {
@@ -175,9 +221,13 @@ struct Functor {
    /// Destruct the Functor.
    virtual ~Functor() {}
    /// Reads this Functor from a BitStream.
-   virtual void read(BitStream &stream) = 0;
+   void read(BitStream &stream) { readArguments(stream, Types::AllArguments); }
    /// Writes this Functor to a BitStream.
-   virtual void write(BitStream &stream) = 0;
+   void write(BitStream &stream) { writeArguments(stream, Types::AllArguments); }
+   /// Reads the given set of this Functor's arguments from a BitStream.
+   virtual void readArguments(BitStream &stream, Types::ArgumentSet set) = 0;
+   /// Writes the given set of this Functor's arguments to a BitStream.
+   virtual void writeArguments(BitStream &stream, Types::ArgumentSet set) = 0;
    /// Dispatch the function represented by the Functor.
    virtual void dispatch(Object *t) = 0;
 };
@@ -190,8 +240,8 @@ template <class T>
 struct FunctorDecl : public Functor {
    FunctorDecl() {}
    void set() {}
-   void read(BitStream &stream) {}
-   void write(BitStream &stream) {}
+   void readArguments(BitStream &stream, Types::ArgumentSet set) {}
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) {}
    void dispatch(Object *t) { }
 };
 template <class T> 
@@ -200,8 +250,8 @@ struct FunctorDecl<void (T::*)()> : public Functor {
    FuncPtr ptr;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set() {}
-   void read(BitStream &stream) {}
-   void write(BitStream &stream) {}
+   void readArguments(BitStream &stream, Types::ArgumentSet set) {}
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) {}
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(); }
 };
 template <class T, class A> 
@@ -210,8 +260,8 @@ struct FunctorDecl<void (T::*)(A)> : public Functor {
    FuncPtr ptr; A a;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a) { a = _a; }
-   void read(BitStream &stream) { Types::read(stream, &a); }
-   void write(BitStream &stream) { Types::write(stream, a); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a); }
 };
 template <class T, class A, class B>
@@ -220,8 +270,8 @@ struct FunctorDecl<void (T::*)(A,B)>: public Functor {
    FuncPtr ptr; A a; B b;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b) { a = _a; b = _b;}
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b); }
 };
 
@@ -231,8 +281,8 @@ struct FunctorDecl<void (T::*)(A,B,C)>: public Functor {
    FuncPtr ptr; A a; B b; C c;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c) { a = _a; b = _b; c = _c;}
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c); }
 };
 
@@ -242,8 +292,8 @@ struct FunctorDecl<void (T::*)(A,B,C,D)>: public Functor {
    FuncPtr ptr; A a; B b; C c; D d;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c, D &_d) { a = _a; b = _b; c = _c; d = _d; }
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); Types::read(stream, &d); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); Types::write(stream, d); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); Types::read(stream, &d, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); Types::write(stream, d, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c, d); }
 };
 
@@ -253,8 +303,8 @@ struct FunctorDecl<void (T::*)(A,B,C,D,E)>: public Functor {
    FuncPtr ptr; A a; B b; C c; D d; E e;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c, D &_d, E &_e) { a = _a; b = _b; c = _c; d = _d; e = _e; }
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); Types::read(stream, &d); Types::read(stream, &e); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); Types::write(stream, d); Types::write(stream, e); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); Types::read(stream, &d, set); Types::read(stream, &e, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); Types::write(stream, d, set); Types::write(stream, e, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c, d, e); }
 };
 
@@ -264,8 +314,8 @@ struct FunctorDecl<void (T::*)(A,B,C,D,E,F)>: public Functor {
    FuncPtr ptr; A a; B b; C c; D d; E e; F f;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c, D &_d, E &_e, F &_f) { a = _a; b = _b; c = _c; d = _d; e = _e; f = _f; }
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); Types::read(stream, &d); Types::read(stream, &e); Types::read(stream, &f); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); Types::write(stream, d); Types::write(stream, e); Types::write(stream, f); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); Types::read(stream, &d, set); Types::read(stream, &e, set); Types::read(stream, &f, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); Types::write(stream, d, set); Types::write(stream, e, set); Types::write(stream, f, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c, d, e, f); }
 };
 
@@ -275,8 +325,8 @@ struct FunctorDecl<void (T::*)(A,B,C,D,E,F,G)>: public Functor {
    FuncPtr ptr; A a; B b; C c; D d; E e; F f; G g;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c, D &_d, E &_e, F &_f, G &_g) { a = _a; b = _b; c = _c; d = _d; e = _e; f = _f; g = _g; }
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); Types::read(stream, &d); Types::read(stream, &e); Types::read(stream, &f); Types::read(stream, &g); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); Types::write(stream, d); Types::write(stream, e); Types::write(stream, f); Types::write(stream, g); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); Types::read(stream, &d, set); Types::read(stream, &e, set); Types::read(stream, &f, set); Types::read(stream, &g, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); Types::write(stream, d, set); Types::write(stream, e, set); Types::write(stream, f, set); Types::write(stream, g, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c, d, e, f, g); }
 };
 
@@ -286,8 +336,8 @@ struct FunctorDecl<void (T::*)(A,B,C,D,E,F,G,H)>: public Functor {
    FuncPtr ptr; A a; B b; C c; D d; E e; F f; G g; H h;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c, D &_d, E &_e, F &_f, G &_g, H &_h) { a = _a; b = _b; c = _c; d = _d; e = _e; f = _f; g = _g; h = _h; }
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); Types::read(stream, &d); Types::read(stream, &e); Types::read(stream, &f); Types::read(stream, &g); Types::read(stream, &h); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); Types::write(stream, d); Types::write(stream, e); Types::write(stream, f); Types::write(stream, g); Types::write(stream, h); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); Types::read(stream, &d, set); Types::read(stream, &e, set); Types::read(stream, &f, set); Types::read(stream, &g, set); Types::read(stream, &h, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); Types::write(stream, d, set); Types::write(stream, e, set); Types::write(stream, f, set); Types::write(stream, g, set); Types::write(stream, h, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c, d, e, f, g, h); }
 };
 
@@ -297,8 +347,8 @@ struct FunctorDecl<void (T::*)(A,B,C,D,E,F,G,H,I)>: public Functor {
    FuncPtr ptr; A a; B b; C c; D d; E e; F f; G g; H h; I i;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c, D &_d, E &_e, F &_f, G &_g, H &_h, I &_i) { a = _a; b = _b; c = _c; d = _d; e = _e; f = _f; g = _g; h = _h; i = _i; }
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); Types::read(stream, &d); Types::read(stream, &e); Types::read(stream, &f); Types::read(stream, &g); Types::read(stream, &h); Types::read(stream, &i); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); Types::write(stream, d); Types::write(stream, e); Types::write(stream, f); Types::write(stream, g); Types::write(stream, h); Types::write(stream, i); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); Types::read(stream, &d, set); Types::read(stream, &e, set); Types::read(stream, &f, set); Types::read(stream, &g, set); Types::read(stream, &h, set); Types::read(stream, &i, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); Types::write(stream, d, set); Types::write(stream, e, set); Types::write(stream, f, set); Types::write(stream, g, set); Types::write(stream, h, set); Types::write(stream, i, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c, d, e, f, g, h, i); }
 };
 
@@ -308,8 +358,8 @@ struct FunctorDecl<void (T::*)(A,B,C,D,E,F,G,H,I,J)>: public Functor {
    FuncPtr ptr; A a; B b; C c; D d; E e; F f; G g; H h; I i; J j;
    FunctorDecl(FuncPtr p) : ptr(p) {}
    void set(A &_a, B &_b, C &_c, D &_d, E &_e, F &_f, G &_g, H &_h, I &_i, J &_j) { a = _a; b = _b; c = _c; d = _d; e = _e; f = _f; g = _g; h = _h; i = _i; j = _j; }
-   void read(BitStream &stream) { Types::read(stream, &a); Types::read(stream, &b); Types::read(stream, &c); Types::read(stream, &d); Types::read(stream, &e); Types::read(stream, &f); Types::read(stream, &g); Types::read(stream, &h); Types::read(stream, &i); Types::read(stream, &j); }
-   void write(BitStream &stream) { Types::write(stream, a); Types::write(stream, b); Types::write(stream, c); Types::write(stream, d); Types::write(stream, e); Types::write(stream, f); Types::write(stream, g); Types::write(stream, h); Types::write(stream, i); Types::write(stream, j); }
+   void readArguments(BitStream &stream, Types::ArgumentSet set) { Types::read(stream, &a, set); Types::read(stream, &b, set); Types::read(stream, &c, set); Types::read(stream, &d, set); Types::read(stream, &e, set); Types::read(stream, &f, set); Types::read(stream, &g, set); Types::read(stream, &h, set); Types::read(stream, &i, set); Types::read(stream, &j, set); }
+   void writeArguments(BitStream &stream, Types::ArgumentSet set) { Types::write(stream, a, set); Types::write(stream, b, set); Types::write(stream, c, set); Types::write(stream, d, set); Types::write(stream, e, set); Types::write(stream, f, set); Types::write(stream, g, set); Types::write(stream, h, set); Types::write(stream, i, set); Types::write(stream, j, set); }
    void dispatch(Object *t) { (static_cast<T *>(t)->*ptr)(a, b, c, d, e, f, g, h, i, j); }
 };
 
@@ -49,6 +49,10 @@
 #include "tnlVector.h"
 #endif
 
+#ifndef _TNL_NETPROFILER_H_
+#include "tnlNetProfiler.h"
+#endif
+
 namespace TNL
 {
 
@@ -181,11 +185,14 @@ class Object;
 /// the list and perform the following tasks:
 ///      - Assigns network IDs for classes based on their NetGroup membership. Determines
 ///        bit allocations for network ID fields.
+///      - Builds a hash table of the classes by name, so that creating an object by
+///        name doesn't depend on the number of registered classes.
 ///
 /// @nosubgrouping
 class NetClassRep
 {
    friend class Object;
+   friend class NetProfiler;
 
 protected:
    NetClassRep();
@@ -200,13 +207,17 @@ protected:
    U32 mPartialUpdateBitsUsed; ///< Number of bits used on partial updates of objects of this class.
    U32 mInitialUpdateCount; ///< Number of objects of this class constructed over a connection.
    U32 mPartialUpdateCount; ///< Number of objects of this class updated over a connection.
+   NetClassProfile mProfile; ///< Bandwidth and pack time of objects or events of this class, see NetProfiler.
 
    /// Next declared NetClassRep.
    ///
    /// These are stored in a linked list built by the macro constructs.
    NetClassRep *mNextClass;
 
+   U32 mClassNameHash;                 ///< Hash of mClassName, set by initialize.
+
    static NetClassRep *mClassLinkList;                                      ///< Head of the linked class list.
+   static Vector<NetClassRep *> mNameTable;                                 ///< Open addressed hash table of all the classes, by name.
    static Vector<NetClassRep *> mClassTable[NetClassGroupCount][NetClassTypeCount]; ///< Table of NetClassReps for construction by class ID.
    static U32 mClassCRC[NetClassGroupCount];                                ///< Internally computed class group CRC.
    static bool mInitialized;                                                ///< Set once the class tables are built, from initialize.
@@ -246,6 +257,9 @@ public:
       mPartialUpdateBitsUsed += bitCount;
    }
 
+   /// Returns the NetProfiler statistics for this class.
+   NetClassProfile &getProfile() { return mProfile; }
+
    virtual Object *create() const = 0;             ///< Creates an instance of the class this represents.
 
    /// Returns the number of classes registered under classGroup and classType.
@@ -268,6 +282,12 @@ public:
    /// Returns a CRC of class data, for checking on connection.
    static U32 getClassGroupCRC(NetClassGroup classGroup);
 
+   /// Returns the class with the given name, or NULL if there isn't one.
+   static NetClassRep *findClass(const char *className);
+
+   /// Hashes a class name for findClass.
+   static U32 hashClassName(const char *className);
+
    /// Initializes the class table and associated data - called from TNL::init().
    static void initialize();
 
@@ -494,9 +514,12 @@ public:
    /// Assigns this reference object from an existing Object instance.
    void set(Object *object)
    {
+      // reference the new object first, so that assigning an object
+      // to the reference that already holds it doesn't destroy it.
+      if(object)
+         object->incRef();
       decRef();
       mObject = object;
-      incRef();
    }
 };
 
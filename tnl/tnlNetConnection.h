@@ -57,21 +57,39 @@ class AsymmetricKey;
 class Certificate;
 
 /// NetConnectionRep maintians a linked list of valid connection classes.
+///
+/// Each rep holds a factory function for its class, so creating a
+/// connection needs no cast, and reps are found by name through a hash
+/// table built the first time one is looked up.
 struct NetConnectionRep
 {
+   typedef NetConnection *(*CreateFunction)();
+
    static NetConnectionRep *mLinkedList;
+   static Vector<NetConnectionRep *> mNameTable;
 
    NetConnectionRep *mNext;
    NetClassRep *mClassRep;
+   CreateFunction mCreate;
    bool mCanRemoteCreate;
 
-   NetConnectionRep(NetClassRep *classRep, bool canRemoteCreate)
+   NetConnectionRep(NetClassRep *classRep, CreateFunction create, bool canRemoteCreate)
    {
       mNext = mLinkedList;
       mLinkedList = this;
       mClassRep = classRep;
+      mCreate = create;
       mCanRemoteCreate = canRemoteCreate;
    }
+
+   /// Factory used by TNL_IMPLEMENT_NETCONNECTION.
+   template <class T> static NetConnection *createInstance() { return new T; }
+
+   /// Returns the rep for the named connection class, or NULL.
+   static NetConnectionRep *find(const char *name);
+
+   /// Creates an instance of the named connection class, if it may be
+   /// created at the request of a remote host.
    static NetConnection *create(const char *name);
 };
 
@@ -83,7 +101,7 @@ struct NetConnectionRep
    TNL::NetClassRep* className::getClassRep() const { return &className::dynClassRep; } \
    TNL::NetClassRepInstance<className> className::dynClassRep(#className, 0, TNL::NetClassTypeNone, 0); \
    TNL::NetClassGroup className::getNetClassGroup() const { return classGroup; } \
-   static TNL::NetConnectionRep g##className##Rep(&className::dynClassRep, canRemoteCreate)
+   static TNL::NetConnectionRep g##className##Rep(&className::dynClassRep, &TNL::NetConnectionRep::createInstance<className>, canRemoteCreate)
 
 
 /// All data associated with the negotiation of the connection
@@ -281,6 +299,8 @@ protected:
    ///
    /// If you need to track additional notification information, you'll have to
    /// override this so you allocate a subclass of PacketNotify with extra fields.
+   /// Notifies are only allocated until the packet window has filled once;
+   /// after that, notified ones are reset() and reused.
    virtual PacketNotify *allocNotify() { return new PacketNotify; }
 
 public:
@@ -291,6 +311,13 @@ public:
    /// the current packet's send sequence if called from within writePacket().
    U32 getLastSendSequence() { return mLastSendSeq; }
 
+   /// Returns the sequence of the last packet the remote host acknowledged.
+   U32 getHighestAckedSequence() { return mHighestAckedSeq; }
+
+   /// Returns the sequence of the last packet received, or the current
+   /// packet's sequence if called from within readPacket().
+   U32 getLastRecvSequence() { return mLastSeqRecvd; }
+
 protected:
    /// Reads a raw packet from a BitStream, as dispatched from NetInterface.
    void readRawPacket(BitStream *bstream);
@@ -354,10 +381,20 @@ public:
       // packet stream notify stuff:
       bool rateChanged;  ///< True if this packet requested a change of rate.
       U32  sendTime;     ///< Platform::getRealMilliseconds() when packet was sent.
+      U32  sendSize;     ///< Size of the packet in bytes, for the paced protocol's delivery rate estimate.
+      U32  deliveredAtSend;     ///< Bytes the remote host had acknowledged when this packet was sent.
+      U32  deliveredTimeAtSend; ///< Time the last of those bytes was acknowledged.
       ConnectionStringTable::PacketList stringList; ///< List of string table entries sent in this packet
 
       PacketNotify *nextPacket; ///< Pointer to the next packet sent on this connection
       PacketNotify();
+      virtual ~PacketNotify() {}
+
+      /// Clears the notify so it can be reused for another packet.
+      ///
+      /// Subclasses that add fields should override this to clear them as
+      /// well, calling the parent's reset().
+      virtual void reset();
    };
 
 //----------------------------------------------------------------
@@ -370,6 +407,8 @@ public:
       ConnectionToClient = BIT(1), ///< A connection to a "client"
       ConnectionAdaptive = BIT(2), ///< Indicates that this connection uses the adaptive protocol.
       ConnectionRemoteAdaptive = BIT(3), ///< Indicates that the remote side of this connection requested the adaptive protocol.
+      ConnectionPaced = BIT(4), ///< Indicates that this connection uses the paced protocol.
+      ConnectionRemotePaced = BIT(5), ///< Indicates that the remote side of this connection requested the paced protocol.
    };
 
 private:
@@ -381,6 +420,12 @@ private:
    U32 mSimulatedLatency;    ///< Amount of additional time this connection delays its packet sends to simulate latency in the connection
    F32 mSimulatedPacketLoss; ///< Function to simulate packet loss on a network
 
+   U32 mPacketsSent;     ///< Number of packets sent on this connection.
+   U32 mPacketsReceived; ///< Number of packets received on this connection.
+   U32 mBytesSent;       ///< Number of packet bytes sent on this connection.
+   U32 mBytesReceived;   ///< Number of packet bytes received on this connection.
+   NetConnectionProfile mProfile; ///< Bandwidth and pack time of this connection, see NetProfiler.
+
    enum RateDefaults {
       DefaultFixedBandwidth  = 2500,  ///< The default send/receive bandwidth - 2.5 Kb per second.
       DefaultFixedSendPeriod = 96,    ///< The default delay between each packet send - approx 10 packets per second.
@@ -413,6 +458,7 @@ private:
 protected:
    PacketNotify *mNotifyQueueHead;  ///< Linked list of structures representing the data in sent packets
    PacketNotify *mNotifyQueueTail;  ///< Tail of the notify queue linked list.  New packets are added to the end of the tail.
+   PacketNotify *mNotifyFreeList;   ///< Notifies from packets already notified, kept for reuse, so at most a window's worth are ever allocated.
 
    /// Returns the notify structure for the current packet write, or last written packet.
    PacketNotify *getCurrentWritePacketNotify() { return mNotifyQueueTail; }
@@ -489,6 +535,24 @@ public:
    F32 getOneWayTime()
       { return mRoundTripTime * 0.5f; }
 
+   /// Returns the number of packets sent on this connection.
+   U32 getPacketsSent() { return mPacketsSent; }
+
+   /// Returns the number of packets received on this connection.
+   U32 getPacketsReceived() { return mPacketsReceived; }
+
+   /// Returns the number of packet bytes sent on this connection.
+   U32 getBytesSent() { return mBytesSent; }
+
+   /// Returns the number of packet bytes received on this connection.
+   U32 getBytesReceived() { return mBytesReceived; }
+
+   /// Returns the NetProfiler statistics for this connection.
+   NetConnectionProfile &getProfile() { return mProfile; }
+
+   /// Clears this connection's NetProfiler statistics.
+   void resetProfile() { mProfile.clear(); }
+
    /// Returns the remote address of the host we're connected or trying to connect to.
    const Address &getNetAddress();
 
@@ -587,11 +651,112 @@ private:
    U32 mLastAckTime;
 
    /// @}
+
+   /// @name Paced Protocol
+   ///
+   /// The paced protocol is a rate based alternative to the adaptive
+   /// protocol, meant for connections where latency matters more than
+   /// throughput.
+   ///
+   /// Rather than growing a window until packets are lost, the sender
+   /// spaces its packets out at a send rate it adjusts once per round trip.
+   /// Each acked packet gives a round trip time sample, with the remote
+   /// host's send delay taken out, and a sample of the rate data is being
+   /// delivered at.  When the smallest round trip time seen in a round
+   /// rises above the smallest seen on the connection by more than a small
+   /// target, a queue is building somewhere on the path, so the rate drops
+   /// to just under the measured delivery rate to drain it; otherwise the
+   /// rate creeps up, doubling each round until the first sign of a queue.
+   /// The fixed rate parameters still cap the rate and packet size.
+   ///
+   /// The receiving side acks promptly when it has nothing of its own to
+   /// send, so the sender's samples aren't held up.
+   ///
+   /// @{
+
+public:
+   enum PacedConstants {
+      PacedMinBandwidth = 250,   ///< Lowest rate, in bytes per second, a paced connection backs off to.
+      PacedMinPacketSize = 128,  ///< Smallest packet a paced connection sends to fit its rate.
+      PacedMinWindow = 4,        ///< Fewest packets a paced connection may have in flight.
+      PacedMinRound = 20,        ///< Shortest round, in milliseconds, between rate adjustments.
+      PacedMinQueueDelay = 10,   ///< Smallest round trip time increase, in milliseconds, taken as a queue.
+      PacedMinRTTExpiry = 10000, ///< Milliseconds before the smallest round trip time is measured afresh.
+      PacedAckDelay = 10,        ///< Most milliseconds a paced connection holds an ack when it has nothing to send.
+      PacedInitialRTT = 200,     ///< Round trip time assumed for the window before any have been measured.
+   };
+
+   /// Enables the paced protocol, with the given fixed rate parameters as
+   /// its limits.  The connection is paced if either side requests it,
+   /// unless either side requests the adaptive protocol.  The request is
+   /// exchanged when connecting, so it must be made before then, by a
+   /// connection class that calls writePacedRequest and readPacedRequest.
+   void setPacedRateParameters(U32 minPacketSendPeriod, U32 minPacketRecvPeriod, U32 maxSendBandwidth, U32 maxRecvBandwidth);
+
+   /// Exchange the paced protocol request.  A connection class that may use
+   /// the paced protocol calls these from both its connect request and its
+   /// connect accept methods; other connections don't carry the request.
+   void writePacedRequest(BitStream *stream);
+   void readPacedRequest(BitStream *stream);
+
+   /// Query the paced status of the connection.
+   bool isPaced() { return !isAdaptive() && mTypeFlags.test(ConnectionPaced | ConnectionRemotePaced); }
+
+   /// Returns the paced protocol's current send rate, in bytes per second.
+   F32 getPacedRate() { return mPacedRate; }
+
+private:
+   F32 mPacedRate;             ///< Current send rate, in bytes per second, or 0 before the first paced send.
+   bool mPacedStartup;         ///< True until the first sign of a queue.
+   U32 mNextPacedSendTime;     ///< Earliest time the next data packet may be sent.
+   U32 mPacedWindow;           ///< Most packets allowed in flight.
+   U32 mDelivered;             ///< Total bytes acknowledged by the remote host.
+   U32 mDeliveredTime;         ///< Time mDelivered was last increased.
+   U32 mMinRTT;                ///< Smallest round trip time measured, or 0 for none yet.
+   U32 mMinRTTTime;            ///< When mMinRTT was measured.
+
+   U32 mRoundStartTime;        ///< Start of the current rate adjustment round.
+   U32 mRoundMinRTT;           ///< Smallest round trip time measured this round, or 0 for none yet.
+   F32 mRoundDeliveryRate;     ///< Highest delivery rate measured this round.
+   U32 mRoundAcked;            ///< Packets acked this round.
+   U32 mRoundLost;             ///< Packets lost this round.
+   bool mRoundAppLimited;      ///< True if the connection ran out of data to send this round.
+
+   U32 getPacedPacketSize();
+   void updatePacedWindow();
+   void recordPacedDelivery(PacketNotify *note, bool recvd);
+   void updatePacedRate(S32 roundTripTime);
+   void checkPacedAck(U32 curTime);
+
+   /// @}
 private:
    ConnectionStringTable *mStringTable; ///< Helper for managing translation between global NetStringTable ids to local ids for this connection.
+protected:
+   /// Records the string table write state, before writing something into
+   /// a packet that may be rewound if it doesn't fit.
+   void getStringWriteMark(ConnectionStringTable::WriteMark &mark) { if(mStringTable) mStringTable->getWriteMark(mark); }
+
+   /// Undoes string table writes rewound out of the current packet.
+   void rewindStringWrites(const ConnectionStringTable::WriteMark &mark) { if(mStringTable) mStringTable->rewindToWriteMark(mark); }
+
+   /// Negotiate the string table size and seeds.  A connection class that
+   /// translates strings on both sides calls these from its connect
+   /// request and accept methods; other connections don't carry them.
+   void writeStringTableRequest(BitStream *stream);
+   void readStringTableRequest(BitStream *stream);
+   void writeStringTableAccept(BitStream *stream);
+   void readStringTableAccept(BitStream *stream);
 public:
-   /// Enables string tag translation on this connection.
-   void setTranslatesStrings();
+   /// Enables string tag translation on this connection.  entryBitSize is
+   /// the log2 of the largest string table this side will use; the actual
+   /// size is the smaller of the two sides' sizes, negotiated by the
+   /// string table request and accept methods above.
+   void setTranslatesStrings(U32 entryBitSize = ConnectionStringTable::DefaultEntryBitSize);
+
+   /// Returns the string table of this connection, or NULL if it doesn't
+   /// translate strings.  The accepting side of a connection can seed the
+   /// table from readConnectRequest.
+   ConnectionStringTable *getStringTable() { return mStringTable; }
 };
 
 static const U32 MinimumPaddingBits = 128;       ///< Padding space that is required at the end of each packet for bit flag writes and such.
@@ -192,11 +192,49 @@ class BitStream;
 /// sent over the wire, in EventConnection::eventWritePacket(). notifyDelivered() is called
 /// when the packet is finally received or (in the case of Unguaranteed packets) dropped.
 ///
+/// An event that is posted to many connections, like a chat message going
+/// to every player, can avoid being packed once per connection by writing
+/// the part of its data that is the same on every connection in packShared(),
+/// and calling writeShared() from pack() at the point that data belongs.
+/// Once the event has been posted to more than one connection, writeShared()
+/// packs the shared data the first time it's called and copies the packed bits
+/// into every later packet, including resends.  pack() then only writes what
+/// really depends on the connection, such as ghost indexes.
+///
+/// @code
+/// void SimpleMessageEvent::packShared(BitStream *bstream)
+/// {
+///   bstream->writeString(msg);
+/// }
+///
+/// void SimpleMessageEvent::pack(EventConnection *conn, BitStream *bstream)
+/// {
+///   writeShared(bstream);
+/// }
+/// @endcode
+///
+/// packShared() is called on a stream with no connection, so it must not write
+/// StringTableEntries, which are encoded through each connection's string table.
+/// RPC events do this split automatically; see Types::ArgumentSet.
+///
 /// @note the TNL_IMPLEMENT_NETEVENT groupMask specifies which "group" of EventConnections
 /// the event can be sent over.  See TNL::Object for a further discussion of this.
 class NetEvent : public Object
 {
    friend class EventConnection;
+
+   U32 mPostCount;      ///< Number of times this event has been posted to a connection.
+   U8 *mSharedData;     ///< Bits written by packShared(), once the event is posted more than once.
+   U32 mSharedBitCount; ///< Size of mSharedData, in bits.
+protected:
+   /// Writes the part of the event that encodes the same way on every
+   /// connection.  See writeShared().
+   virtual void packShared(BitStream *bstream) {}
+
+   /// Writes the event's shared data into bstream.  If the event has been
+   /// posted to more than one connection the shared data is packed once
+   /// and copied from then on.
+   void writeShared(BitStream *bstream);
 public:
    enum EventDirection {
       DirUnset,          ///< Default value - NetConnection will Assert if an event is posted without a valid direction set.
@@ -223,8 +261,13 @@ public:
    {
       mGuaranteeType = gType;
       mEventDirection = evDir;
+      mPostCount = 0;
+      mSharedData = NULL;
+      mSharedBitCount = 0;
    }
 
+   ~NetEvent();
+
    /// Pack is called on the origin side of the connection to write an event's
    /// data into a packet.
    virtual void pack(EventConnection *ps, BitStream *bstream) = 0;
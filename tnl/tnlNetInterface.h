@@ -178,6 +178,7 @@ protected:
    RefPtr<AsymmetricKey> mPrivateKey;  ///< The private key used by this NetInterface for secure key exchange.
    RefPtr<Certificate> mCertificate;   ///< A certificate, signed by some Certificate Authority, to authenticate this host.
    ClientPuzzleManager mPuzzleManager; ///< The object that tracks the current client puzzle difficulty, current puzzle and solutions for this NetInterface.
+   U32 mProfileDumpCount; ///< NetProfiler::getDumpCount() when this interface last dumped its connections' profiles.
 
    /// @name NetInterfaceSocket Socket
    ///
@@ -193,9 +194,13 @@ protected:
    U32 mCurrentTime;            ///< Current time tracked by this NetInterface.
    bool mRequiresKeyExchange;   ///< True if all connections outgoing and incoming require key exchange.
    U32  mLastTimeoutCheckTime;  ///< Last time all the active connections were checked for timeouts.
-   U8  mRandomHashData[12];    ///< Data that gets hashed with connect challenge requests to prevent connection spoofing.
+   SipHash mIdentityHash;       ///< Keyed hash of connect challenge requests, used to prevent connection spoofing.
    bool mAllowConnections;      ///< Set if this NetInterface allows connections from remote instances.
 
+   /// Sets mCurrentTime from the platform's clock, or from the virtual
+   /// network's if the socket is bound to one.
+   void updateCurrentTime();
+
    /// Structure used to track packets that are delayed in sending for simulating a high-latency connection.
    ///
    /// The DelaySendPacket is allocated as sizeof(DelaySendPacket) + packetSize;
@@ -224,7 +229,8 @@ protected:
    };
 
    /// Computes an identity token for the connecting client based on the address of the client and the
-   /// client's unique nonce value.
+   /// client's unique nonce value.  The token is checked before anything else in a connect request, so it
+   /// uses the cheap keyed SipHash rather than SHA-256.
    U32 computeClientIdentityToken(const Address &theAddress, const Nonce &theNonce);
 
    /// Finds a connection instance that this NetInterface has initiated.
@@ -379,6 +385,9 @@ public:
 
    /// returns the current process time for this NetInterface
    U32 getCurrentTime() { return mCurrentTime; }
+
+   /// Returns the client puzzle manager, for its difficulty and solution counts.
+   ClientPuzzleManager &getPuzzleManager() { return mPuzzleManager; }
 };
 
 };
@@ -0,0 +1,325 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _TNL_NETPROFILER_H_
+#define _TNL_NETPROFILER_H_
+
+#ifndef _TNL_TYPES_H_
+#include "tnlTypes.h"
+#endif
+
+#ifndef _TNL_PLATFORM_H_
+#include "tnlPlatform.h"
+#endif
+
+#ifndef _TNL_VECTOR_H_
+#include "tnlVector.h"
+#endif
+
+namespace TNL
+{
+
+class BitStream;
+class NetClassRep;
+class NetConnection;
+
+/// Bandwidth and pack time used by one NetObject or NetEvent class.
+///
+/// For NetObject classes, every update sent counts, and the initial
+/// updates are counted again on their own.  For NetEvent classes every
+/// event sent counts as an initial update.  Only updates and events that
+/// made it into a packet count; ones rewound on a packet overrun don't.
+struct NetClassProfile
+{
+   enum {
+      MaskBitCount = 32,
+   };
+   U32 count;              ///< Updates or events sent.
+   U64 bits;               ///< Bits used by all of them, class id included.
+   U32 initialCount;       ///< Initial updates sent.
+   U64 initialBits;        ///< Bits used by initial updates.
+   U32 sampleCount;        ///< Packs that were timed.
+   F64 sampleMs;           ///< Milliseconds spent in the timed packs.
+
+   /// @name Mask Bit Usage
+   ///
+   /// Partial updates have their bits split across the update mask bits
+   /// they sent.  Bits written inside a NetProfileScope go to that scope's
+   /// mask bit; the rest are divided evenly between the sent mask bits that
+   /// had no scope, or go to unattributedBits if they all did.  The time
+   /// of a timed partial update is split the same way, except that time
+   /// no mask bit claims isn't kept.
+   /// @{
+
+   U32 maskCount[MaskBitCount];  ///< Partial updates that sent each mask bit.
+   U64 maskBits[MaskBitCount];   ///< Bits attributed to each mask bit.
+   U64 unattributedBits;         ///< Partial update bits no mask bit claimed.
+   U32 maskSampleCount[MaskBitCount]; ///< Timed partial updates that sent each mask bit.
+   F64 maskSampleMs[MaskBitCount];    ///< Milliseconds attributed to each mask bit in the timed updates.
+
+   /// @}
+
+   void clear();
+
+   /// Adds the time of a pack, if it was timed.
+   void addSample(F64 ms)
+   {
+      if(ms >= 0)
+      {
+         sampleCount++;
+         sampleMs += ms;
+      }
+   }
+
+   /// Estimates the milliseconds spent packing all count updates, from the
+   /// timed ones.
+   F64 getEstimatedMs() const { return sampleCount ? sampleMs * count / sampleCount : 0; }
+
+   /// Estimates the milliseconds spent packing mask bit maskBit in all the
+   /// partial updates that sent it.
+   F64 getEstimatedMaskMs(U32 maskBit) const
+   {
+      return maskSampleCount[maskBit] ? maskSampleMs[maskBit] * maskCount[maskBit] / maskSampleCount[maskBit] : 0;
+   }
+};
+
+/// Bandwidth and pack time of a single NetConnection.
+struct NetConnectionProfile
+{
+   U32 packetCount;        ///< Packets written, of every type.
+   U64 packetBits;         ///< Bits in those packets, headers included.
+   U32 ghostCount;         ///< Ghost updates sent.
+   U64 ghostBits;          ///< Bits used by ghost updates.
+   U32 eventCount;         ///< Events sent.
+   U64 eventBits;          ///< Bits used by events.
+   U32 sampleCount;        ///< Ghost and event packs that were timed.
+   F64 sampleMs;           ///< Milliseconds spent in the timed packs.
+
+   void clear();
+
+   /// Adds the time of a pack, if it was timed.
+   void addSample(F64 ms)
+   {
+      if(ms >= 0)
+      {
+         sampleCount++;
+         sampleMs += ms;
+      }
+   }
+
+   /// Estimates the milliseconds spent packing all the ghost updates and
+   /// events, from the timed ones.
+   F64 getEstimatedMs() const { return sampleCount ? sampleMs * (ghostCount + eventCount) / sampleCount : 0; }
+};
+
+/// NetProfiler collects the bandwidth and CPU used by every NetObject and
+/// NetEvent class, and by every connection.
+///
+/// Bits are counted for every update and event.  Packing is timed on one
+/// in every getSampleInterval() packs, and the totals estimated from those,
+/// so profiling can stay on in production.  None of this changes what is
+/// written to the network, unlike NetConnection's debug object sizes.
+///
+/// Profiles are kept on each NetClassRep and NetConnection, and can be
+/// read with getSnapshot(), NetClassRep::getProfile() and
+/// NetConnection::getProfile(), logged with dump(), or logged periodically
+/// with setDumpInterval().
+class NetProfiler
+{
+   static U32 mSampleInterval;
+   static U32 mSampleCountdown;
+   static U32 mDumpInterval;
+   static U32 mLastDumpTime;
+   static bool mDumpTimeSet;   ///< False until checkDump has seen the time once.
+   static U32 mDumpCount;      ///< Number of periodic dumps so far.
+
+   static bool mTimingUpdate;                      ///< True if the current update is being timed.
+   static U32 mScopeMask;                          ///< Mask bits with a NetProfileScope in the current update.
+   static U32 mScopeBits[NetClassProfile::MaskBitCount]; ///< Bits written by each mask bit's scopes.
+   static F64 mScopeMs[NetClassProfile::MaskBitCount];   ///< Milliseconds spent in each mask bit's scopes.
+public:
+   enum {
+      DefaultSampleInterval = 32,
+   };
+
+   /// A class's profile, as returned by getSnapshot().
+   struct ClassEntry
+   {
+      NetClassRep *classRep;
+      NetClassProfile profile;
+   };
+
+   /// Times one in every interval packs; 0 turns timing off.
+   static void setSampleInterval(U32 interval);
+   static U32 getSampleInterval() { return mSampleInterval; }
+
+   /// Returns true if the pack about to happen should be timed.
+   static bool shouldSample()
+   {
+      if(!mSampleInterval || --mSampleCountdown)
+         return false;
+      mSampleCountdown = mSampleInterval;
+      return true;
+   }
+
+   /// @name Recording
+   ///
+   /// These are called by GhostConnection and EventConnection as they
+   /// write packets.
+   /// @{
+
+   /// Starts an object update; clears the bits recorded by scopes.  If
+   /// timed is true the scopes are timed as well.
+   static void beginUpdate(bool timed) { mScopeMask = 0; mTimingUpdate = timed; }
+
+   /// Returns true if the current update's scopes should be timed.
+   static bool isTimingUpdate() { return mTimingUpdate; }
+
+   /// Adds bits written for mask bit maskBit of the current update, and
+   /// the time spent writing them if the update is timed.
+   static void addMaskBits(U32 maskBit, U32 bitCount, F64 ms)
+   {
+      if(!(mScopeMask & (1 << maskBit)))
+      {
+         mScopeMask |= 1 << maskBit;
+         mScopeBits[maskBit] = 0;
+         mScopeMs[maskBit] = 0;
+      }
+      mScopeBits[maskBit] += bitCount;
+      mScopeMs[maskBit] += ms;
+   }
+
+   /// Records an object update that was sent.  sentMask is the mask bits
+   /// the update cleared, and packMs the time spent packing it, or less than
+   /// zero if it wasn't timed.
+   static void recordUpdate(NetClassRep *classRep, bool initial, U32 sentMask, U32 bitCount, F64 packMs);
+
+   /// Records an event that was sent.
+   static void recordEvent(NetClassRep *classRep, U32 bitCount, F64 packMs);
+
+   /// @}
+
+   /// Fills entries with the profile of every class that has sent anything,
+   /// most bits first.
+   static void getSnapshot(Vector<ClassEntry> &entries);
+
+   /// Clears the profile of every class.  Connections are reset with
+   /// NetConnection::resetProfile().
+   static void reset();
+
+   /// Logs the class profiles, most bits first, followed by the profile
+   /// of each connection in connections, if it's given.
+   static void dump(const Vector<NetConnection *> *connections = NULL);
+
+   /// Logs the profile of each connection in connections.
+   static void dumpConnections(const Vector<NetConnection *> &connections);
+
+   /// Dumps and resets the class profiles every interval milliseconds;
+   /// 0 turns the periodic dump off.  Each NetInterface then dumps and
+   /// resets its connections' profiles on its next processConnections().
+   static void setDumpInterval(U32 interval);
+
+   /// Returns the number of periodic dumps so far.
+   static U32 getDumpCount() { return mDumpCount; }
+
+   /// Dumps the class profiles if the dump interval has passed; called from
+   /// NetInterface::processConnections() with the interface's current time.
+   /// The interval starts at the first call, so it runs on the same clock.
+   static void checkDump(U32 currentTime)
+   {
+      if(!mDumpInterval)
+         return;
+      if(!mDumpTimeSet)
+      {
+         mDumpTimeSet = true;
+         mLastDumpTime = currentTime;
+      }
+      else if(currentTime - mLastDumpTime >= mDumpInterval)
+      {
+         mLastDumpTime = currentTime;
+         mDumpCount++;
+         dump();
+         reset();
+      }
+   }
+};
+
+/// NetProfileScope attributes the bits written while it's in scope to one
+/// of the update mask bits.
+///
+/// Put one around the fields written for a mask bit in packUpdate, so the
+/// profiler can tell exactly what each mask bit costs:
+///
+/// @code
+/// if(stream->writeFlag(updateMask & HealthMask))
+/// {
+///    NetProfileScope scope(stream, HealthMask);
+///    stream->writeFloat(mHealth, 6);
+/// }
+/// @endcode
+///
+/// Masks with more than one bit set are counted against the lowest one.
+class NetProfileScope
+{
+   BitStream *mStream;
+   U32 mMaskBit;
+   U32 mStart;
+   S64 mStartTime;
+public:
+   NetProfileScope(BitStream *stream, U32 mask);
+   ~NetProfileScope();
+};
+
+/// NetProfileSample times a pack, if NetProfiler says this pack should be
+/// timed.
+class NetProfileSample
+{
+   S64 mStart;
+   bool mTimed;
+public:
+   NetProfileSample()
+   {
+      mTimed = NetProfiler::shouldSample();
+      if(mTimed)
+         mStart = Platform::getHighPrecisionTimerValue();
+   }
+
+   /// Returns true if this pack is being timed.
+   bool isTimed() const { return mTimed; }
+
+   /// Returns the milliseconds since the sample started, or -1 if this
+   /// pack isn't being timed.
+   F64 getElapsedMs()
+   {
+      if(!mTimed)
+         return -1;
+      return Platform::getHighPrecisionMilliseconds(Platform::getHighPrecisionTimerValue() - mStart);
+   }
+};
+
+};
+
+#endif
@@ -73,6 +73,13 @@ namespace StringTable
    /// Hash a string of given length into a U32.
    U32 hashStringn(const char* in_pString, S32 len);
 
+   /// Gives memory the table no longer needs back to the system: hash
+   /// tables replaced by resizes, and freed nodes too large for the node
+   /// pool.  Each call looks at one shard, and memory a lock free lookup
+   /// may still be reading is freed by a later call, so this is meant to
+   /// be called regularly, e.g. once a tick, from any thread.
+   void compact();
+
    void incRef(StringTableEntryId index);   
    void decRef(StringTableEntryId index);
    const char *getString(StringTableEntryId index);
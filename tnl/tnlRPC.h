@@ -157,7 +157,7 @@ public: \
    TNL::FunctorDecl<void (className::*) args > mFunctorDecl;\
    RPC_##className##_##name() : TNL::RPCEvent(guaranteeType, eventDirection), mFunctorDecl(&className::name##_remote) { mFunctor = &mFunctorDecl; } \
    TNL_DECLARE_CLASS( RPC_##className##_##name ); \
-   bool checkClassType(TNL::Object *theObject) { return dynamic_cast<className *>(theObject) != NULL; } }; \
+   bool checkClassType(TNL::Object *theObject) { return TNL::ClassTypeCheck<className>::check(theObject); } }; \
    TNL_IMPLEMENT_NETEVENT( RPC_##className##_##name, groupMask, rpcVersion ); \
    void className::name args { RPC_##className##_##name *theEvent = new RPC_##className##_##name; theEvent->mFunctorDecl.set argNames ; postNetEvent(theEvent); } \
    TNL::NetEvent * className::name##_construct args { RPC_##className##_##name *theEvent = new RPC_##className##_##name; theEvent->mFunctorDecl.set argNames ; return theEvent; } \
@@ -166,9 +166,15 @@ public: \
 
 /// Base class for RPC events.
 ///
-/// All declared RPC methods create subclasses of RPCEvent to send data across the wire
+/// All declared RPC methods create subclasses of RPCEvent to send data across the wire.
+/// The arguments before the first one that goes through the connection's string
+/// table are the event's shared data, so an RPC constructed once and posted to many
+/// connections only marshals them once.  Arguments are always sent in declaration
+/// order.
 class RPCEvent : public NetEvent
 {
+protected:
+   void packShared(BitStream *bstream);
 public:
    Functor *mFunctor;
    /// Constructor call from within the rpc<i>Something</i> method generated by the TNL_IMPLEMENT_RPC macro.
@@ -180,6 +186,46 @@ public:
    void process(EventConnection *ps);
 };
 
+/// ClassTypeCheck answers whether an object is a T for the RPC macros, which
+/// need to know the object an RPC arrives on has the method being called.
+///
+/// The object's type is only known at run time, but a given RPC only ever
+/// arrives on a handful of classes, so the classes seen to pass are kept
+/// by class rep and the dynamic_cast is only done the first time each one
+/// is seen.
+template <class T> class ClassTypeCheck
+{
+   enum {
+      CacheSize = 4,
+   };
+   static NetClassRep *mPassed[CacheSize];
+   static U32 mPassedCount;
+public:
+   static bool check(Object *theObject)
+   {
+      NetClassRep *rep = theObject->getClassRep();
+      if(rep)
+      {
+         for(U32 i = 0; i < mPassedCount; i++)
+         {
+            if(mPassed[i] == rep)
+            {
+               TNLAssert(dynamic_cast<T *>(theObject) != NULL, "Class rep doesn't match class.");
+               return true;
+            }
+         }
+      }
+      if(!dynamic_cast<T *>(theObject))
+         return false;
+      if(rep && mPassedCount < CacheSize)
+         mPassed[mPassedCount++] = rep;
+      return true;
+   }
+};
+
+template <class T> NetClassRep *ClassTypeCheck<T>::mPassed[ClassTypeCheck<T>::CacheSize];
+template <class T> U32 ClassTypeCheck<T>::mPassedCount = 0;
+
 /// Declares an RPC method within a class declaration.  Creates two method prototypes - one for the host side of the RPC call, and one for the receiver, which performs the actual method.
 #define TNL_DECLARE_RPC(name, args) void name args; void name##_test args; virtual TNL::NetEvent * name##_construct args; virtual void name##_remote args
 
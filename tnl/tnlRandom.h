@@ -62,6 +62,66 @@ bool readB();
 void *getState();
 };
 
+/// FastRandom is a small, fast, seedable pseudo random number generator
+/// (xoshiro128**) for simulation, effects and testing.
+///
+/// Unlike the Random namespace, FastRandom is <b>not</b> cryptographically
+/// secure - anything an attacker could exploit by predicting it (nonces,
+/// keys, sequence numbers) must still come from Random.  In exchange it
+/// costs a few nanoseconds per number, and a generator seeded with the same
+/// value always produces the same sequence, so simulations that draw from
+/// it can be replayed exactly.
+///
+/// Each thread has its own generator, returned by FastRandom::get(), which
+/// is seeded from Random the first time it is used unless setSeed is called
+/// first.  Separate FastRandom instances can also be created for independent
+/// sequences.
+class FastRandom
+{
+   U32 mState[4];
+
+   static U32 rotateLeft(U32 value, U32 count) { return (value << count) | (value >> (32 - count)); }
+public:
+   /// Constructs a generator with the given seed.
+   FastRandom(U32 seed = 0) { setSeed(seed); }
+
+   /// Resets the generator to the start of the sequence for seed.
+   void setSeed(U32 seed);
+
+   /// Returns a 0...U32_MAX random number.
+   U32 readI()
+   {
+      U32 result = rotateLeft(mState[1] * 5, 7) * 9;
+      U32 t = mState[1] << 9;
+
+      mState[2] ^= mState[0];
+      mState[3] ^= mState[1];
+      mState[1] ^= mState[2];
+      mState[0] ^= mState[3];
+      mState[2] ^= t;
+      mState[3] = rotateLeft(mState[3], 11);
+      return result;
+   }
+
+   /// Returns a random number between rangeStart and rangeEnd inclusive.
+   U32 readI(U32 rangeStart, U32 rangeEnd)
+   {
+      U32 range = rangeEnd - rangeStart + 1;
+      if(!range)
+         return readI();
+      return U32((U64(readI()) * range) >> 32) + rangeStart;
+   }
+
+   /// Returns a floating point value from 0 up to (but not including) 1.
+   F32 readF() { return F32(readI() >> 8) * (1.0f / 16777216.0f); }
+
+   /// Returns a single random bit.
+   bool readB() { return (readI() >> 31) != 0; }
+
+   /// Returns the calling thread's generator.
+   static FastRandom &get();
+};
+
 };
 
 #endif //_TNL_RANDOM_H_
@@ -0,0 +1,65 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU 
+//   General Public License, alternative licensing options are available 
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+
+#ifndef _TNL_SIPHASH_H_
+#define _TNL_SIPHASH_H_
+
+#ifndef _TNL_TYPES_H_
+#include "tnlTypes.h"
+#endif
+
+namespace TNL {
+
+/// SipHash is a keyed hash function (SipHash-2-4) for short messages.
+///
+/// Without the key an attacker can neither predict a hash value nor
+/// choose inputs that collide, which makes SipHash suitable for tokens
+/// handed to unauthenticated hosts and for hash tables keyed on data
+/// that a remote host controls.  It is many times cheaper than SHA-256
+/// on inputs of a few dozen bytes, but it is not a cryptographic digest.
+class SipHash
+{
+public:
+   enum {
+      KeySize = 16,
+   };
+private:
+   U64 mKey[2];
+public:
+   /// Constructs a SipHash with a key read from the Random generator.
+   SipHash();
+
+   /// Sets the hash key from KeySize bytes.
+   void setKey(const U8 *key);
+
+   /// Returns the 64 bit hash of size bytes of data.
+   U64 hash(const void *data, U32 size) const;
+};
+
+};
+
+#endif
@@ -41,6 +41,106 @@
 namespace TNL
 {
 
+/// @name Atomic operations
+///
+/// Platform independent atomic integer operations, for counters and
+/// flags that are shared between threads without a Mutex.  Each of these
+/// also acts as a full memory barrier.
+///
+/// @{
+
+#if defined(TNL_OS_WIN32)
+
+/// Atomically increments value, returning the incremented value.
+inline S32 atomicIncrement(volatile S32 *value) { return InterlockedIncrement((LONG *) value); }
+/// Atomically decrements value, returning the decremented value.
+inline S32 atomicDecrement(volatile S32 *value) { return InterlockedDecrement((LONG *) value); }
+/// Sets value to newValue if it is currently equal to expected.  Returns true if the swap happened.
+inline bool atomicCompareAndSwap(volatile S32 *value, S32 expected, S32 newValue)
+{
+#if defined(_MSC_VER) && _MSC_VER < 1300
+   // the Visual C++ 6 Platform SDK only declares the PVOID version.
+   return (S32) InterlockedCompareExchange((PVOID *) value, (PVOID) newValue, (PVOID) expected) == expected;
+#else
+   return InterlockedCompareExchange((LONG *) value, newValue, expected) == expected;
+#endif
+}
+/// Makes sure all memory writes before the barrier are visible before any after it.
+inline void memoryBarrier()
+{
+   // any interlocked operation is a full barrier, and unlike MemoryBarrier
+   // this is in every Platform SDK.
+   LONG barrier;
+   InterlockedExchange(&barrier, 0);
+}
+
+#elif defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+
+inline S32 atomicIncrement(volatile S32 *value) { return __sync_add_and_fetch(value, 1); }
+inline S32 atomicDecrement(volatile S32 *value) { return __sync_sub_and_fetch(value, 1); }
+inline bool atomicCompareAndSwap(volatile S32 *value, S32 expected, S32 newValue)
+{
+   return __sync_bool_compare_and_swap(value, expected, newValue);
+}
+inline void memoryBarrier() { __sync_synchronize(); }
+
+#elif defined(TNL_SUPPORTS_GCC_INLINE_X86_ASM)
+
+inline S32 atomicAdd(volatile S32 *value, S32 amount)
+{
+   S32 previous = amount;
+   __asm__ __volatile__("lock; xaddl %0, %1" : "+r" (previous), "+m" (*value) : : "memory");
+   return previous + amount;
+}
+inline S32 atomicIncrement(volatile S32 *value) { return atomicAdd(value, 1); }
+inline S32 atomicDecrement(volatile S32 *value) { return atomicAdd(value, -1); }
+inline bool atomicCompareAndSwap(volatile S32 *value, S32 expected, S32 newValue)
+{
+   S32 previous;
+   __asm__ __volatile__("lock; cmpxchgl %2, %1" : "=a" (previous), "+m" (*value) : "r" (newValue), "0" (expected) : "memory");
+   return previous == expected;
+}
+inline void memoryBarrier() { __asm__ __volatile__("lock; addl $0, 0(%%esp)" : : : "memory"); }
+
+#elif defined(TNL_SUPPORTS_GCC_INLINE_PPC_ASM)
+
+inline S32 atomicAdd(volatile S32 *value, S32 amount)
+{
+   S32 result;
+   __asm__ __volatile__(
+      "sync\n"
+      "1: lwarx %0, 0, %1\n"
+      "   add %0, %0, %2\n"
+      "   stwcx. %0, 0, %1\n"
+      "   bne- 1b\n"
+      "   isync"
+      : "=&r" (result) : "r" (value), "r" (amount) : "cc", "memory");
+   return result;
+}
+inline S32 atomicIncrement(volatile S32 *value) { return atomicAdd(value, 1); }
+inline S32 atomicDecrement(volatile S32 *value) { return atomicAdd(value, -1); }
+inline bool atomicCompareAndSwap(volatile S32 *value, S32 expected, S32 newValue)
+{
+   S32 previous;
+   __asm__ __volatile__(
+      "sync\n"
+      "1: lwarx %0, 0, %1\n"
+      "   cmpw %0, %2\n"
+      "   bne- 2f\n"
+      "   stwcx. %3, 0, %1\n"
+      "   bne- 1b\n"
+      "2: isync"
+      : "=&r" (previous) : "r" (value), "r" (expected), "r" (newValue) : "cc", "memory");
+   return previous == expected;
+}
+inline void memoryBarrier() { __asm__ __volatile__("sync" : : : "memory"); }
+
+#else
+#  error "TNL: No atomic operations for this compiler and CPU"
+#endif
+
+/// @}
+
 /// Platform independent semaphore class.
 ///
 /// The semaphore class wraps OS specific semaphore functionality for thread synchronization.
@@ -131,8 +231,11 @@ class ThreadStorage
    pthread_key_t mThreadKey;
 #endif
 public:
-   /// ThreadStorage constructor.
-   ThreadStorage();
+   /// ThreadStorage constructor.  If threadExit is set, it is called with
+   /// a thread's stored pointer when that thread exits with a non-NULL
+   /// value stored.  threadExit is not supported on Win32 and is ignored
+   /// there.
+   ThreadStorage(void (*threadExit)(void *data) = NULL);
    /// ThreadStorage destructor.
    ~ThreadStorage();
 
@@ -145,11 +145,19 @@ enum NetError {
    UnknownError,          ///< There was some other, unknown error.
 };
 
+class VirtualNetwork;
+struct VirtualEndpoint;
+
 /// The Socket class encapsulates a platform's network socket.
+///
+/// If a VirtualNetwork is installed when the Socket is created, the socket
+/// is bound to that network instead of the platform's, see VirtualNetwork.
 class Socket
 {
    S32 mPlatformSocket;    ///< The OS-level socket
    U32 mTransportProtocol; ///< The transport type this socket uses.
+   VirtualNetwork *mVirtualNetwork;    ///< The virtual network this socket is bound to, or NULL.
+   VirtualEndpoint *mVirtualEndpoint;  ///< This socket's binding on mVirtualNetwork.
 public:
    enum {
       DefaultBufferSize = 32768, ///< The default send and receive buffer sizes
@@ -181,6 +189,10 @@ public:
    /// Returns the Address corresponding to this socket, as bound on the local machine.
    Address getBoundAddress();
 
+   /// Returns the virtual network this socket is bound to, or NULL if it's
+   /// a platform socket.
+   VirtualNetwork *getVirtualNetwork() { return mVirtualNetwork; }
+
    /// Returns the list of network addresses this host can be bound to.  Currently this only
    /// returns IP addresses, with the port field set to 0.
    static void getInterfaceAddresses(Vector<Address> *addressVector);
@@ -0,0 +1,234 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _TNL_VIRTUALNETWORK_H_
+#define _TNL_VIRTUALNETWORK_H_
+
+#ifndef _TNL_UDP_H_
+#include "tnlUDP.h"
+#endif
+
+#ifndef _TNL_RANDOM_H_
+#include "tnlRandom.h"
+#endif
+
+namespace TNL
+{
+
+struct VirtualEndpoint;
+struct VirtualLink;
+struct VirtualDatagram;
+
+/// VirtualNetwork is an in-process network that Sockets can be bound to in
+/// place of the platform's network stack.
+///
+/// While a VirtualNetwork is installed, every Socket created binds to it,
+/// and so does every NetInterface, through its Socket.  Datagrams sent
+/// between them are carried through a simulated link, which can add
+/// latency, jitter, loss, reordering and a bandwidth cap, and are delivered
+/// as the network's virtual clock is advanced.  NetInterfaces on a virtual
+/// network take their current time from that clock, so a test that calls
+/// advanceTime() and then processes its interfaces runs as fast as the CPU
+/// allows.  All of the simulation's randomness comes from the network's own
+/// seeded FastRandom, so a run that sends the same packets is repeated
+/// exactly.
+///
+/// Only the IP transport is simulated.  A socket bound to the Any address
+/// or to localhost gets 127.0.0.1, and one bound to any other address gets
+/// that address, so a test can give each simulated host its own address.
+/// Port 0 binds to a free port.  Sending to the Any address reaches
+/// 127.0.0.1, sending to the broadcast address reaches every socket bound
+/// to the port, and sending to an address nobody is bound to drops the
+/// datagram, as UDP would.
+///
+/// @code
+/// VirtualNetwork network(seed);
+/// network.install();
+/// VirtualNetwork::LinkParams link;
+/// link.latency = 50;
+/// link.packetLoss = 0.02f;
+/// network.setDefaultLink(link);
+///
+/// ... create the server and client NetInterfaces ...
+///
+/// for(;;)
+/// {
+///    network.advanceTime(10);
+///    server->checkIncomingPackets();
+///    server->processConnections();
+///    ...
+/// }
+/// @endcode
+class VirtualNetwork
+{
+public:
+   enum {
+      DefaultStartTime = 1000,   ///< The virtual clock's time when the network is created.
+      FirstEphemeralPort = 49152,
+      DefaultQueueDelay = 500,   ///< Default longest wait for a capped link, in milliseconds.
+   };
+
+   /// The behavior of the link a datagram is sent over.
+   struct LinkParams
+   {
+      U32 latency;         ///< One way delay, in milliseconds.
+      U32 jitter;          ///< Most random delay added on top of the latency, in milliseconds.
+      F32 packetLoss;      ///< Fraction of datagrams dropped.
+      F32 reorder;         ///< Fraction of datagrams held back so later ones can pass them.
+      U32 bandwidth;       ///< Bytes per second the link carries, or 0 for no cap.
+      U32 maxQueueDelay;   ///< Datagrams that would wait longer than this for a capped link are dropped.
+      bool sharedQueue;    ///< Every socket pair the link covers waits in one queue for the cap, as hosts behind one router do.
+
+      LinkParams();
+   };
+
+   /// Counts of what happened to datagrams sent on the network.
+   struct Stats
+   {
+      U32 packetsSent;        ///< Datagrams passed to sendto.
+      U32 packetsDelivered;   ///< Datagrams queued at their destination socket.
+      U32 packetsLost;        ///< Datagrams dropped by a link's packetLoss.
+      U32 packetsQueueDropped; ///< Datagrams dropped waiting for a capped link.
+      U32 packetsUnroutable;  ///< Datagrams sent to or arriving at an address with no socket.
+      U32 packetsOverflowed;  ///< Datagrams dropped because the receiving socket's buffer was full.
+      U32 bytesDelivered;     ///< Bytes in the delivered datagrams.
+
+      Stats() { memset(this, 0, sizeof(Stats)); }
+   };
+
+private:
+   struct LinkRule
+   {
+      Address from;
+      Address to;
+      LinkParams params;
+      F64 busyUntil;       ///< End of the queue the rule's socket pairs share, if sharedQueue is set.
+   };
+
+   static VirtualNetwork *mInstalled;
+
+   U32 mCurrentTime;
+   U32 mSequence;                         ///< Orders datagrams due at the same time by when they were sent.
+   FastRandom mRandom;
+   Stats mStats;
+
+   Vector<VirtualEndpoint *> mEndpointTable;   ///< Chained hash table of bound sockets, by address.
+   U32 mEndpointCount;
+   U16 mNextPort;
+
+   Vector<VirtualLink *> mLinkTable;           ///< Chained hash table of the links datagrams have used.
+   U32 mLinkCount;
+   LinkParams mDefaultLink;
+   F64 mDefaultBusyUntil;                      ///< End of the default link's shared queue.
+   Vector<LinkRule> mLinkRules;
+   U32 mLinkRulesVersion;                      ///< Bumped when the rules change, so links look them up again.
+
+   Vector<VirtualDatagram *> mInFlight;        ///< Datagrams on their way, as a heap ordered by delivery time.
+
+   VirtualEndpoint *findEndpoint(const Address &address);
+   VirtualLink *findLink(const Address &from, const Address &to);
+   void resolveLinkParams(VirtualLink *link);
+   void growTable(Vector<VirtualEndpoint *> &table);
+   void growTable(Vector<VirtualLink *> &table);
+   void send(VirtualEndpoint *source, const Address &to, const U8 *buffer, S32 bufferSize);
+   void deliverPackets();
+
+public:
+   /// Creates a network whose simulated links draw from a FastRandom
+   /// seeded with seed.
+   VirtualNetwork(U32 seed = 0);
+
+   /// Destroys the network and any datagrams still in flight.  Every socket
+   /// bound to it must be destroyed first.
+   ~VirtualNetwork();
+
+   /// Makes this the network Sockets created from now on bind to.
+   void install();
+
+   /// Goes back to creating Sockets on the platform's network stack.
+   static void uninstall();
+
+   /// Returns the installed network, or NULL if Sockets use the platform's
+   /// network stack.
+   static VirtualNetwork *getInstalled() { return mInstalled; }
+
+   /// @name Link Model
+   /// @{
+
+   /// Sets the link used between sockets no setLink() rule covers.
+   void setDefaultLink(const LinkParams &params);
+
+   /// Sets the link datagrams sent from from to to go over.  An address of
+   /// Any matches every address, and a port of 0 every port, so a rule can
+   /// cover a single socket pair, a host or everything sent to one port.
+   /// When more than one rule matches, the one set last wins.  Each socket
+   /// pair has a bandwidth cap to itself unless the link sets sharedQueue.
+   void setLink(const Address &from, const Address &to, const LinkParams &params);
+
+   /// Removes all the setLink() rules.
+   void clearLinks();
+
+   /// @}
+
+   /// @name Virtual Clock
+   /// @{
+
+   /// Returns the virtual time, in milliseconds.
+   U32 getCurrentTime() { return mCurrentTime; }
+
+   /// Moves the clock forward and delivers the datagrams that have arrived
+   /// by the new time.
+   void advanceTime(U32 milliseconds);
+
+   /// Sets time to when the next datagram in flight arrives and returns
+   /// true, or returns false if none are in flight.
+   bool getNextDeliveryTime(U32 *time);
+
+   /// @}
+
+   /// Returns the counts of what happened to datagrams so far.
+   const Stats &getStats() { return mStats; }
+
+   /// @name Socket Interface
+   ///
+   /// Socket calls these when it's bound to a virtual network.
+   /// @{
+
+   /// Binds a socket, returning NULL if the address is taken or not an IP
+   /// address.  recvBufferSize is the most bytes held for the socket to
+   /// read.
+   VirtualEndpoint *bind(const Address &bindAddress, U32 recvBufferSize);
+   void unbind(VirtualEndpoint *endpoint);
+   NetError sendto(VirtualEndpoint *endpoint, const Address &address, const U8 *buffer, S32 bufferSize);
+   NetError recvfrom(VirtualEndpoint *endpoint, Address *address, U8 *buffer, S32 bufferSize, S32 *bytesRead);
+   Address getBoundAddress(VirtualEndpoint *endpoint);
+
+   /// @}
+};
+
+};
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "tnl.h"
 #include "tnlJournal.h"
+#include "tnlVirtualNetwork.h"
 
 #if defined ( TNL_OS_XBOX )
 
@@ -206,6 +207,16 @@ static void SocketToTNLAddress(const SOCKADDR *sockAddr, Address *address)
 
 Socket::Socket(const Address &bindAddress, U32 sendBufferSize, U32 recvBufferSize, bool acceptsBroadcast, bool nonblockingIO)
 {
+   mVirtualNetwork = VirtualNetwork::getInstalled();
+   mVirtualEndpoint = NULL;
+   if(mVirtualNetwork)
+   {
+      mPlatformSocket = INVALID_SOCKET;
+      mTransportProtocol = bindAddress.transport;
+      mVirtualEndpoint = mVirtualNetwork->bind(bindAddress, recvBufferSize);
+      return;
+   }
+
    TNL_JOURNAL_READ_BLOCK(Socket::Socket,
          TNL_JOURNAL_READ( (&mPlatformSocket) );
       return;
@@ -317,6 +328,13 @@ Socket::Socket(const Address &bindAddress, U32 sendBufferSize, U32 recvBufferSiz
 
 Socket::~Socket()
 {
+   if(mVirtualNetwork)
+   {
+      if(mVirtualEndpoint)
+         mVirtualNetwork->unbind(mVirtualEndpoint);
+      return;
+   }
+
    TNL_JOURNAL_READ_BLOCK(Socket::~Socket,
       return;
    )
@@ -330,6 +348,9 @@ Socket::~Socket()
 
 NetError Socket::sendto(const Address &address, const U8 *buffer, S32 bufferSize)
 {
+   if(mVirtualNetwork)
+      return mVirtualEndpoint ? mVirtualNetwork->sendto(mVirtualEndpoint, address, buffer, bufferSize) : UnknownError;
+
    TNL_JOURNAL_READ_BLOCK(Socket::sendto,
       return NoError;
    )
@@ -353,6 +374,9 @@ NetError Socket::sendto(const Address &address, const U8 *buffer, S32 bufferSize
 
 NetError Socket::recvfrom(Address *address, U8 *buffer, S32 bufferSize, S32 *outSize)
 {
+   if(mVirtualNetwork)
+      return mVirtualEndpoint ? mVirtualNetwork->recvfrom(mVirtualEndpoint, address, buffer, bufferSize, outSize) : WouldBlock;
+
    TNL_JOURNAL_READ_BLOCK(Socket::recvfrom,
       bool wouldBlock;
       TNL_JOURNAL_READ( (&wouldBlock) );
@@ -429,6 +453,9 @@ NetError Socket::recv(U8 *buffer, S32 bufferSize, S32 *bytesRead)
 
 Address Socket::getBoundAddress()
 {
+   if(mVirtualEndpoint)
+      return mVirtualNetwork->getBoundAddress(mVirtualEndpoint);
+
    SOCKADDR address;
    Address returnAddress;
 
@@ -441,6 +468,8 @@ Address Socket::getBoundAddress()
 
 bool Socket::isValid()
 {
+   if(mVirtualNetwork)
+      return mVirtualEndpoint != NULL;
    return mPlatformSocket != INVALID_SOCKET;
 }
 
@@ -610,7 +639,7 @@ Address::Address(TransportProtocol type, Address::NamedAddress name, U16 aPort)
             netNum[0] = 0;
             break;
          case Localhost:
-            netNum[0] = htonl(0x7F000001);
+            netNum[0] = 0x7F000001;
             break;
          case Broadcast:
             netNum[0] = htonl(INADDR_BROADCAST);
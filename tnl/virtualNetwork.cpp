@@ -0,0 +1,553 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "tnl.h"
+#include "tnlVirtualNetwork.h"
+#include "tnlLog.h"
+
+namespace TNL
+{
+
+static const U32 LocalhostAddress = 0x7F000001;
+static const U32 BroadcastAddress = 0xFFFFFFFF;
+
+/// A socket bound to a virtual network, and the datagrams waiting for it to
+/// read them.
+struct VirtualEndpoint
+{
+   VirtualEndpoint *nextInTable;
+   Address address;
+   VirtualDatagram *queueHead;
+   VirtualDatagram *queueTail;
+   U32 queuedBytes;
+   U32 recvBufferSize;
+};
+
+/// The state of the link between two addresses.
+struct VirtualLink
+{
+   VirtualLink *nextInTable;
+   Address from;
+   Address to;
+   VirtualNetwork::LinkParams params;
+   U32 rulesVersion;    ///< mLinkRulesVersion params were looked up at.
+   F64 busyUntil;       ///< Time a capped link finishes sending what it has queued.
+   F64 *queue;          ///< The busyUntil datagrams wait on; a rule's when its queue is shared.
+   U32 lastDelivery;    ///< Delivery time of the last datagram kept in order.
+};
+
+/// A datagram in flight or waiting to be read.
+struct VirtualDatagram
+{
+   VirtualDatagram *nextPacket;  ///< Next datagram in the receiving socket's queue.
+   Address from;
+   Address to;
+   U32 deliveryTime;
+   U32 sequence;
+   U32 packetSize;
+   U8 packetData[1];
+};
+
+VirtualNetwork *VirtualNetwork::mInstalled = NULL;
+
+VirtualNetwork::LinkParams::LinkParams()
+{
+   latency = 0;
+   jitter = 0;
+   packetLoss = 0;
+   reorder = 0;
+   bandwidth = 0;
+   maxQueueDelay = DefaultQueueDelay;
+   sharedQueue = false;
+}
+
+static U32 hashAddress(const Address &address)
+{
+   return address.netNum[0] * 2654435761U ^ address.port;
+}
+
+static bool isSameAddress(const Address &a, const Address &b)
+{
+   return a.netNum[0] == b.netNum[0] && a.port == b.port;
+}
+
+// rules match Any to any address and port 0 to any port.
+static bool matchesRule(const Address &rule, const Address &address)
+{
+   return (!rule.netNum[0] || rule.netNum[0] == address.netNum[0]) &&
+          (!rule.port || rule.port == address.port);
+}
+
+//--------------------------------------
+
+VirtualNetwork::VirtualNetwork(U32 seed) : mRandom(seed)
+{
+   mCurrentTime = DefaultStartTime;
+   mSequence = 0;
+   mEndpointCount = 0;
+   mNextPort = FirstEphemeralPort;
+   mLinkCount = 0;
+   mLinkRulesVersion = 0;
+   mDefaultBusyUntil = 0;
+
+   mEndpointTable.setSize(127);
+   for(S32 i = 0; i < mEndpointTable.size(); i++)
+      mEndpointTable[i] = NULL;
+   mLinkTable.setSize(127);
+   for(S32 i = 0; i < mLinkTable.size(); i++)
+      mLinkTable[i] = NULL;
+}
+
+VirtualNetwork::~VirtualNetwork()
+{
+   TNLAssert(mEndpointCount == 0, "Destroying a virtual network with sockets still bound to it.");
+   if(mInstalled == this)
+      uninstall();
+
+   for(S32 i = 0; i < mInFlight.size(); i++)
+      free(mInFlight[i]);
+   for(S32 i = 0; i < mLinkTable.size(); i++)
+   {
+      while(mLinkTable[i])
+      {
+         VirtualLink *next = mLinkTable[i]->nextInTable;
+         delete mLinkTable[i];
+         mLinkTable[i] = next;
+      }
+   }
+}
+
+void VirtualNetwork::install()
+{
+   mInstalled = this;
+   TNLLogMessageV(LogUDP, ("Sockets will bind to a virtual network."));
+}
+
+void VirtualNetwork::uninstall()
+{
+   mInstalled = NULL;
+}
+
+//--------------------------------------
+
+void VirtualNetwork::setDefaultLink(const LinkParams &params)
+{
+   mDefaultLink = params;
+   mLinkRulesVersion++;
+}
+
+void VirtualNetwork::setLink(const Address &from, const Address &to, const LinkParams &params)
+{
+   LinkRule rule;
+   rule.from = from;
+   rule.to = to;
+   rule.params = params;
+   rule.busyUntil = 0;
+   mLinkRules.push_back(rule);
+   mLinkRulesVersion++;
+}
+
+void VirtualNetwork::clearLinks()
+{
+   mLinkRules.clear();
+   mLinkRulesVersion++;
+}
+
+void VirtualNetwork::resolveLinkParams(VirtualLink *link)
+{
+   link->params = mDefaultLink;
+   link->queue = mDefaultLink.sharedQueue ? &mDefaultBusyUntil : &link->busyUntil;
+   for(S32 i = mLinkRules.size() - 1; i >= 0; i--)
+   {
+      if(matchesRule(mLinkRules[i].from, link->from) && matchesRule(mLinkRules[i].to, link->to))
+      {
+         link->params = mLinkRules[i].params;
+         link->queue = link->params.sharedQueue ? &mLinkRules[i].busyUntil : &link->busyUntil;
+         break;
+      }
+   }
+   // the rules only move when they change, which bumps the version, so
+   // the queue pointer stays good until the link is resolved again.
+   link->rulesVersion = mLinkRulesVersion;
+}
+
+VirtualLink *VirtualNetwork::findLink(const Address &from, const Address &to)
+{
+   U32 index = (hashAddress(from) * 31 + hashAddress(to)) % mLinkTable.size();
+   for(VirtualLink *walk = mLinkTable[index]; walk; walk = walk->nextInTable)
+   {
+      if(isSameAddress(walk->from, from) && isSameAddress(walk->to, to))
+      {
+         if(walk->rulesVersion != mLinkRulesVersion)
+            resolveLinkParams(walk);
+         return walk;
+      }
+   }
+
+   if(mLinkCount >= U32(mLinkTable.size()))
+   {
+      growTable(mLinkTable);
+      index = (hashAddress(from) * 31 + hashAddress(to)) % mLinkTable.size();
+   }
+
+   VirtualLink *link = new VirtualLink;
+   link->from = from;
+   link->to = to;
+   link->busyUntil = 0;
+   link->lastDelivery = 0;
+   resolveLinkParams(link);
+   link->nextInTable = mLinkTable[index];
+   mLinkTable[index] = link;
+   mLinkCount++;
+   return link;
+}
+
+void VirtualNetwork::growTable(Vector<VirtualLink *> &table)
+{
+   Vector<VirtualLink *> oldTable = table;
+   table.setSize(oldTable.size() * 2 + 1);
+   for(S32 i = 0; i < table.size(); i++)
+      table[i] = NULL;
+   for(S32 i = 0; i < oldTable.size(); i++)
+   {
+      VirtualLink *walk = oldTable[i];
+      while(walk)
+      {
+         VirtualLink *next = walk->nextInTable;
+         U32 index = (hashAddress(walk->from) * 31 + hashAddress(walk->to)) % table.size();
+         walk->nextInTable = table[index];
+         table[index] = walk;
+         walk = next;
+      }
+   }
+}
+
+void VirtualNetwork::growTable(Vector<VirtualEndpoint *> &table)
+{
+   Vector<VirtualEndpoint *> oldTable = table;
+   table.setSize(oldTable.size() * 2 + 1);
+   for(S32 i = 0; i < table.size(); i++)
+      table[i] = NULL;
+   for(S32 i = 0; i < oldTable.size(); i++)
+   {
+      VirtualEndpoint *walk = oldTable[i];
+      while(walk)
+      {
+         VirtualEndpoint *next = walk->nextInTable;
+         U32 index = hashAddress(walk->address) % table.size();
+         walk->nextInTable = table[index];
+         table[index] = walk;
+         walk = next;
+      }
+   }
+}
+
+//--------------------------------------
+
+VirtualEndpoint *VirtualNetwork::findEndpoint(const Address &address)
+{
+   for(VirtualEndpoint *walk = mEndpointTable[hashAddress(address) % mEndpointTable.size()]; walk; walk = walk->nextInTable)
+      if(isSameAddress(walk->address, address))
+         return walk;
+   return NULL;
+}
+
+VirtualEndpoint *VirtualNetwork::bind(const Address &bindAddress, U32 recvBufferSize)
+{
+   if(bindAddress.transport != IPProtocol)
+   {
+      TNLLogMessageV(LogUDP, ("Virtual network error: only IP sockets can be bound."));
+      return NULL;
+   }
+
+   Address address = bindAddress;
+   if(!address.netNum[0])
+      address.netNum[0] = LocalhostAddress;
+
+   if(address.port)
+   {
+      if(findEndpoint(address))
+      {
+         TNLLogMessageV(LogUDP, ("Virtual network error: %s is already bound.", address.toString()));
+         return NULL;
+      }
+   }
+   else
+   {
+      // hand out the ephemeral ports in turn, skipping ones in use.
+      for(U32 i = FirstEphemeralPort; ; i++)
+      {
+         if(i == 65536)
+         {
+            TNLLogMessageV(LogUDP, ("Virtual network error: no free ports."));
+            return NULL;
+         }
+         address.port = mNextPort;
+         mNextPort = mNextPort == 65535 ? U16(FirstEphemeralPort) : mNextPort + 1;
+         if(!findEndpoint(address))
+            break;
+      }
+   }
+
+   if(mEndpointCount >= U32(mEndpointTable.size()))
+      growTable(mEndpointTable);
+
+   VirtualEndpoint *endpoint = new VirtualEndpoint;
+   endpoint->address = address;
+   endpoint->queueHead = NULL;
+   endpoint->queueTail = NULL;
+   endpoint->queuedBytes = 0;
+   endpoint->recvBufferSize = recvBufferSize;
+
+   U32 index = hashAddress(address) % mEndpointTable.size();
+   endpoint->nextInTable = mEndpointTable[index];
+   mEndpointTable[index] = endpoint;
+   mEndpointCount++;
+
+   TNLLogMessageV(LogUDP, ("Virtual socket bound to address: %s", address.toString()));
+   return endpoint;
+}
+
+void VirtualNetwork::unbind(VirtualEndpoint *endpoint)
+{
+   VirtualEndpoint **walk = &mEndpointTable[hashAddress(endpoint->address) % mEndpointTable.size()];
+   while(*walk != endpoint)
+   {
+      TNLAssert(*walk != NULL, "Unbinding a socket that isn't bound to this network.");
+      walk = &(*walk)->nextInTable;
+   }
+   *walk = endpoint->nextInTable;
+   mEndpointCount--;
+
+   while(endpoint->queueHead)
+   {
+      VirtualDatagram *next = endpoint->queueHead->nextPacket;
+      free(endpoint->queueHead);
+      endpoint->queueHead = next;
+   }
+   delete endpoint;
+}
+
+Address VirtualNetwork::getBoundAddress(VirtualEndpoint *endpoint)
+{
+   return endpoint->address;
+}
+
+//--------------------------------------
+
+// mInFlight is a binary heap with the earliest delivery at the top; ties
+// go in the order the datagrams were sent, so runs repeat exactly.
+static bool arrivesBefore(VirtualDatagram *a, VirtualDatagram *b)
+{
+   if(a->deliveryTime != b->deliveryTime)
+      return a->deliveryTime < b->deliveryTime;
+   return a->sequence < b->sequence;
+}
+
+NetError VirtualNetwork::sendto(VirtualEndpoint *endpoint, const Address &address, const U8 *buffer, S32 bufferSize)
+{
+   if(address.transport != IPProtocol)
+      return InvalidPacketProtocol;
+
+   if(address.netNum[0] != BroadcastAddress)
+   {
+      send(endpoint, address, buffer, bufferSize);
+      return NoError;
+   }
+
+   // a broadcast goes to every socket bound to the port.  Collect them
+   // first so the order doesn't depend on the hash table.
+   Vector<Address> destinations;
+   for(S32 i = 0; i < mEndpointTable.size(); i++)
+      for(VirtualEndpoint *walk = mEndpointTable[i]; walk; walk = walk->nextInTable)
+         if(walk != endpoint && walk->address.port == address.port)
+            destinations.push_back(walk->address);
+   for(S32 i = 0; i < destinations.size(); i++)
+      send(endpoint, destinations[i], buffer, bufferSize);
+   return NoError;
+}
+
+void VirtualNetwork::send(VirtualEndpoint *source, const Address &to, const U8 *buffer, S32 bufferSize)
+{
+   mStats.packetsSent++;
+
+   Address destination = to;
+   if(!destination.netNum[0])
+      destination.netNum[0] = LocalhostAddress;
+
+   VirtualLink *link = findLink(source->address, destination);
+   LinkParams &params = link->params;
+
+   if(params.packetLoss > 0 && mRandom.readF() < params.packetLoss)
+   {
+      mStats.packetsLost++;
+      return;
+   }
+
+   // a capped link sends one datagram at a time, so datagrams queue
+   // behind the ones still going out.
+   F64 sendTime = mCurrentTime;
+   if(params.bandwidth)
+   {
+      F64 &busyUntil = *link->queue;
+      F64 startTime = getMax(sendTime, busyUntil);
+      if(startTime - sendTime > params.maxQueueDelay)
+      {
+         mStats.packetsQueueDropped++;
+         return;
+      }
+      busyUntil = startTime + bufferSize * 1000.0 / params.bandwidth;
+      sendTime = busyUntil;
+   }
+
+   U32 deliveryTime = U32(sendTime + 0.5) + params.latency;
+   if(params.jitter)
+      deliveryTime += mRandom.readI(0, params.jitter);
+
+   if(params.reorder > 0 && mRandom.readF() < params.reorder)
+      deliveryTime += mRandom.readI(1, params.latency + params.jitter + 1);
+   else
+   {
+      // otherwise the link keeps datagrams in order, however they were
+      // jittered.
+      if(deliveryTime < link->lastDelivery)
+         deliveryTime = link->lastDelivery;
+      link->lastDelivery = deliveryTime;
+   }
+
+   VirtualDatagram *datagram = (VirtualDatagram *) malloc(sizeof(VirtualDatagram) + bufferSize);
+   datagram->nextPacket = NULL;
+   datagram->from = source->address;
+   datagram->to = destination;
+   datagram->deliveryTime = deliveryTime;
+   datagram->sequence = mSequence++;
+   datagram->packetSize = bufferSize;
+   memcpy(datagram->packetData, buffer, bufferSize);
+
+   S32 index = mInFlight.size();
+   mInFlight.push_back(datagram);
+   while(index > 0)
+   {
+      S32 parent = (index - 1) / 2;
+      if(!arrivesBefore(datagram, mInFlight[parent]))
+         break;
+      mInFlight[index] = mInFlight[parent];
+      index = parent;
+   }
+   mInFlight[index] = datagram;
+}
+
+void VirtualNetwork::deliverPackets()
+{
+   while(mInFlight.size() && mInFlight[0]->deliveryTime <= mCurrentTime)
+   {
+      VirtualDatagram *datagram = mInFlight[0];
+
+      // pop the heap's top
+      VirtualDatagram *last = mInFlight.last();
+      mInFlight.pop_back();
+      S32 count = mInFlight.size();
+      if(count)
+      {
+         S32 index = 0;
+         for(;;)
+         {
+            S32 child = index * 2 + 1;
+            if(child >= count)
+               break;
+            if(child + 1 < count && arrivesBefore(mInFlight[child + 1], mInFlight[child]))
+               child++;
+            if(!arrivesBefore(mInFlight[child], last))
+               break;
+            mInFlight[index] = mInFlight[child];
+            index = child;
+         }
+         mInFlight[index] = last;
+      }
+
+      VirtualEndpoint *endpoint = findEndpoint(datagram->to);
+      if(!endpoint)
+      {
+         mStats.packetsUnroutable++;
+         free(datagram);
+         continue;
+      }
+      if(endpoint->queuedBytes + datagram->packetSize > endpoint->recvBufferSize)
+      {
+         mStats.packetsOverflowed++;
+         free(datagram);
+         continue;
+      }
+      mStats.packetsDelivered++;
+      mStats.bytesDelivered += datagram->packetSize;
+      endpoint->queuedBytes += datagram->packetSize;
+      if(endpoint->queueTail)
+         endpoint->queueTail->nextPacket = datagram;
+      else
+         endpoint->queueHead = datagram;
+      endpoint->queueTail = datagram;
+   }
+}
+
+NetError VirtualNetwork::recvfrom(VirtualEndpoint *endpoint, Address *address, U8 *buffer, S32 bufferSize, S32 *bytesRead)
+{
+   deliverPackets();
+
+   VirtualDatagram *datagram = endpoint->queueHead;
+   if(!datagram)
+      return WouldBlock;
+
+   endpoint->queueHead = datagram->nextPacket;
+   if(!endpoint->queueHead)
+      endpoint->queueTail = NULL;
+   endpoint->queuedBytes -= datagram->packetSize;
+
+   // like recvfrom, a datagram too big for the buffer is truncated.
+   S32 size = getMin(S32(datagram->packetSize), bufferSize);
+   memcpy(buffer, datagram->packetData, size);
+   *address = datagram->from;
+   *bytesRead = size;
+   free(datagram);
+   return NoError;
+}
+
+//--------------------------------------
+
+void VirtualNetwork::advanceTime(U32 milliseconds)
+{
+   mCurrentTime += milliseconds;
+   deliverPackets();
+}
+
+bool VirtualNetwork::getNextDeliveryTime(U32 *time)
+{
+   if(!mInFlight.size())
+      return false;
+   *time = mInFlight[0]->deliveryTime;
+   return true;
+}
+
+};
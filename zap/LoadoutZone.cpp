@@ -52,6 +52,8 @@ public:
 
    void render()
    {
+      if(!getGame()->getGameType())
+         return;
       renderLoadoutZone(getGame()->getGameType()->getTeamColor(getTeam()), mPolyBounds, getExtent());
    }
 
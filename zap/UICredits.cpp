@@ -69,10 +69,10 @@ void CreditsUserInterface::onActivate()
    // aside from CreditsScroller to activate
    if(fxList.size() > 1)
    {
-      U32 rand = Random::readI(0, fxList.size() - 1);
+      U32 rand = FastRandom::get().readI(0, fxList.size() - 1);
       while(fxList[rand]->isActive())
       {
-         rand = Random::readI(0, fxList.size() - 1);
+         rand = FastRandom::get().readI(0, fxList.size() - 1);
       }
       fxList[rand]->setActive(true);
    }
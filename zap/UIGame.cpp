@@ -704,7 +704,6 @@ GameUserInterface::VoiceRecorder::VoiceRecorder()
    mRecordingAudio = false;
    mMaxAudioSample = 0;
    mMaxForGain = 0;
-   mVoiceEncoder = new LPC10VoiceEncoder;
 }
 
 void GameUserInterface::VoiceRecorder::idle(U32 timeDelta)
@@ -717,6 +716,9 @@ void GameUserInterface::VoiceRecorder::idle(U32 timeDelta)
          process();
       }
    }
+   // encoding finishes on the voice pipeline's thread, possibly after
+   // recording has stopped.
+   sendEncodedVoice();
 }
 
 void GameUserInterface::VoiceRecorder::render()
@@ -758,6 +760,7 @@ void GameUserInterface::VoiceRecorder::start()
          return;
 
       mUnusedAudio = new ByteBuffer(0);
+      gVoicePipeline->resetCapture();
       mRecordingAudio = true;
       mMaxAudioSample = 0;
       mVoiceAudioTimer.reset(FirstVoiceAudioSampleTime);
@@ -821,7 +824,15 @@ void GameUserInterface::VoiceRecorder::process()
       mMaxAudioSample = U32(mMaxAudioSample * gain);
    }
 
-   ByteBufferPtr sendBuffer = mVoiceEncoder->compressBuffer(mUnusedAudio);
+   // hand the samples to the pipeline to encode, and reuse the capture
+   // buffer for the next batch.
+   gVoicePipeline->queueCapture(samplePtr, sampleCount);
+   mUnusedAudio->resize(0);
+}
+
+void GameUserInterface::VoiceRecorder::sendEncodedVoice()
+{
+   ByteBufferPtr sendBuffer = gVoicePipeline->readEncoded();
 
    if(sendBuffer.isValid())
    {
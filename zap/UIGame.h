@@ -34,7 +34,7 @@
 #include "loadoutSelect.h"
 #include "timer.h"
 #include "sfx.h"
-#include "voiceCodec.h"
+#include "voicePipeline.h"
 
 namespace Zap
 {
@@ -99,7 +99,6 @@ class GameUserInterface : public UserInterface
 
       Timer mVoiceAudioTimer;
       RefPtr<SFXObject> mVoiceSfx;
-      RefPtr<VoiceEncoder> mVoiceEncoder;
       bool mRecordingAudio;
       S32 mMaxAudioSample;
       S32 mMaxForGain;
@@ -109,6 +108,7 @@ class GameUserInterface : public UserInterface
 
       void idle(U32 timeDelta);
       void process();
+      void sendEncodedVoice();
       void start();
       void stop();
       void render();
@@ -26,7 +26,6 @@
 
 #include "UIQueryServers.h"
 #include "UIMenus.h"
-#include "tnlRandom.h"
 #include "masterConnection.h"
 #include "gameNetInterface.h"
 #include "glutInclude.h"
@@ -39,199 +38,50 @@ QueryServersUserInterface gQueryServersUserInterface;
 
 void QueryServersUserInterface::onActivate()
 {
-   servers.clear();
-   /*for(U32 i = 0;i < 512; i++)
-   {
-      ServerRef s;
-      dSprintf(s.serverName, MaxServerNameLen, "Svr%8x", Random::readI());
-      s.id = i;
-      s.pingTime = Random::readF() * 512;
-      s.serverAddress.port = 28000;
-      s.serverAddress.netNum[0] = Random::readI();
-      s.maxPlayers = Random::readF() * 16 + 8;
-      s.playerCount = Random::readF() * s.maxPlayers;
-      servers.push_back(s);
-   }*/
    sortColumn = 0;
-   pendingPings = 0;
-   pendingQueries = 0;
    sortAscending = true;
-   mNonce.getRandom();
+
+   mBrowser.clear();
+   mBrowser.setInterface(gClientGame->getNetInterface());
+   gClientGame->getNetInterface()->setServerBrowser(&mBrowser);
 
    logprintf("pinging broadcast servers...");
-   Address broadcastAddress(IPProtocol, Address::Broadcast, 28000);
-   broadcastPingSendTime = Platform::getRealMilliseconds();
+   mBrowser.sendBroadcastPing(28000);
 
-   gClientGame->getNetInterface()->sendPing(broadcastAddress, mNonce);
    if(gClientGame->getConnectionToMaster())
-      gClientGame->getConnectionToMaster()->startGameTypesQuery();
+      gClientGame->getConnectionToMaster()->startServerListUpdates();
 }
 
-void QueryServersUserInterface::addPingServers(const Vector<IPAddress> &ipList)
+void QueryServersUserInterface::stopServerListUpdates()
 {
-   for(S32 i = 0; i < ipList.size(); i++)
-   {
-      ServerRef s;
-      s.state = ServerRef::Start;
-      s.id = ++lastUsedServerId;
-      s.sendNonce.getRandom();
-      s.serverAddress.set(ipList[i]);
-      s.sendCount = 0;
-      s.pingTime = 9999;
-      s.playerCount = s.maxPlayers = -1;
-      s.isFromMaster = true;
-      strcpy(s.serverName, "Internet Server");
-      servers.push_back(s);
-   }
+   if(gClientGame->getConnectionToMaster())
+      gClientGame->getConnectionToMaster()->stopServerListUpdates();
 }
 
-void QueryServersUserInterface::gotPingResponse(const Address &theAddress, const Nonce &theNonce, U32 clientIdentityToken)
+void QueryServersUserInterface::addPingServers(const Vector<IPAddress> &ipList)
 {
-   // see if this ping is a server from the local broadcast ping:
-   if(mNonce == theNonce)
-   {
-      for(S32 i = 0; i < servers.size(); i++)
-         if(servers[i].sendNonce == theNonce && servers[i].serverAddress == theAddress)
-            return;
-
-      // it was from a local ping
-      ServerRef s;
-      s.pingTime = Platform::getRealMilliseconds() - broadcastPingSendTime;
-      s.state = ServerRef::ReceivedPing;
-      s.id = ++lastUsedServerId;
-      s.sendNonce = theNonce;
-      s.identityToken = clientIdentityToken;
-      s.serverAddress = theAddress;
-      s.sendCount = 0;
-      s.playerCount = -1;
-      s.maxPlayers = -1;
-      s.isFromMaster = false;
-      strcpy(s.serverName, "LAN Server");
-      servers.push_back(s);
-      return;
-   }
+   mBrowser.addServers(ipList);
+}
 
-   // see if this ping is in the list:
-   for(S32 i = 0; i < servers.size(); i++)
-   {
-      ServerRef &s = servers[i];
-      if(s.sendNonce == theNonce && s.serverAddress == theAddress &&
-            s.state == ServerRef::SentPing)
-      {
-         s.pingTime = Platform::getRealMilliseconds() - s.lastSendTime;
-         s.state = ServerRef::ReceivedPing;
-         s.identityToken = clientIdentityToken;
-         pendingPings--;
-         break;
-      }
-   }
-   shouldSort = true;
+void QueryServersUserInterface::updatePingServers(const Vector<IPAddress> &ipList)
+{
+   mBrowser.refreshServers(ipList);
 }
 
-void QueryServersUserInterface::gotQueryResponse(const Address &theAddress, const Nonce &clientNonce, const char *serverName, U32 playerCount, U32 maxPlayers, bool dedicated, bool passwordRequired)
+void QueryServersUserInterface::removePingServers(const Vector<IPAddress> &ipList)
 {
-   for(S32 i = 0; i < servers.size(); i++)
-   {
-      ServerRef &s = servers[i];
-      if(s.sendNonce == clientNonce && s.serverAddress == theAddress &&
-            s.state == ServerRef::SentQuery)
-      {
-         s.playerCount = playerCount;
-         s.maxPlayers = maxPlayers;
-         s.dedicated = dedicated;
-         s.passwordRequired = passwordRequired;
-
-         dSprintf(s.serverName, sizeof(s.serverName), "%s", serverName);
-         s.state = ServerRef::ReceivedQuery;
-         pendingQueries--;
-      }
-   }
-   shouldSort = true;
-   // find this 
+   mBrowser.removeServers(ipList);
 }
 
 void QueryServersUserInterface::idle(U32 t)
 {
-   U32 time = Platform::getRealMilliseconds();
-
-   for(S32 i = 0; i < servers.size(); i++)
-   {
-      ServerRef &s = servers[i];
-
-      if(s.state == ServerRef::SentPing && (time - s.lastSendTime) > PingQueryTimeout)
-      {
-         s.state = ServerRef::Start;
-         pendingPings--;
-      }
-      else if(s.state == ServerRef::SentQuery && (time - s.lastSendTime) > PingQueryTimeout)
-      {
-         s.state = ServerRef::ReceivedPing;
-         pendingQueries--;
-      }
-   }
-   if(pendingPings < MaxPendingPings)
-   {
-      for(S32 i = 0; i < servers.size() ; i++)
-      {
-         ServerRef &s = servers[i];
-         if(s.state == ServerRef::Start)
-         {
-            s.sendCount++;
-            if(s.sendCount > PingQueryRetryCount)
-            {
-               s.pingTime = 999;
-               strcpy(s.serverName, "PingTimedOut");
-               s.playerCount = 0;
-               s.maxPlayers = 0;
-               s.state = ServerRef::ReceivedQuery;
-               shouldSort = true;
-            }
-            else
-            {
-               s.state = ServerRef::SentPing;
-               s.lastSendTime = time;
-               s.sendNonce.getRandom();
-               gClientGame->getNetInterface()->sendPing(s.serverAddress, s.sendNonce);
-               pendingPings++;
-               if(pendingPings >= MaxPendingPings)
-                  break;
-            }
-         }
-      }
-   }
-   if(pendingPings == 0 && (pendingQueries < MaxPendingQueries))
-   {
-      for(S32 i = 0; i < servers.size(); i++)
-      {
-         ServerRef &s = servers[i];
-         if(s.state == ServerRef::ReceivedPing)
-         {
-            s.sendCount++;
-            if(s.sendCount > PingQueryRetryCount)
-            {
-               strcpy(s.serverName, "QueryTimedOut");
-               s.playerCount = s.maxPlayers = 0;
-               s.state = ServerRef::ReceivedQuery;
-               shouldSort = true;
-            }
-            else
-            {
-               s.state = ServerRef::SentQuery;
-               s.lastSendTime = time;
-               gClientGame->getNetInterface()->sendQuery(s.serverAddress, s.sendNonce, s.identityToken);
-               pendingQueries++;
-               if(pendingQueries >= MaxPendingQueries)
-                  break;  
-            }
-         }
-      }
-   }
+   if(mBrowser.idle())
+      shouldSort = true;
 }
 
 QueryServersUserInterface::QueryServersUserInterface()
 {
    
-   lastUsedServerId = 0;
    sortColumn = 0;
    lastSortColumn = 0;
    sortAscending = true;
@@ -250,10 +100,7 @@ QueryServersUserInterface::QueryServersUserInterface()
 
 S32 QueryServersUserInterface::findSelectedIndex()
 {
-   for(S32 i = 0; i < servers.size(); i++)
-      if(servers[i].id == selectedId)
-         return i;
-   return -1;
+   return mBrowser.findServer(selectedId);
 }
 
 static void renderDedicatedIcon()
@@ -340,7 +187,7 @@ void QueryServersUserInterface::render()
 
    U32 serversAboveBelow = totalRows >> 1;
 
-   if(servers.size())
+   if(mBrowser.getServerCount())
    {
       S32 selectedIndex = findSelectedIndex();
       if(selectedIndex == -1)
@@ -354,16 +201,16 @@ void QueryServersUserInterface::render()
          lastServer -= firstServer;
          firstServer = 0;
       }
-      if(lastServer >= servers.size())
+      if(lastServer >= mBrowser.getServerCount())
       {
-         lastServer = servers.size() - 1;
+         lastServer = mBrowser.getServerCount() - 1;
       }
 
       for(S32 i = firstServer; i <= lastServer; i++)
       {
          U32 y = top + (i - firstServer) * 24;
          U32 fontSize = 21;
-         ServerRef &s = servers[i];
+         ServerRef &s = mBrowser.getServer(i);
 
          if(i == selectedIndex)
          {
@@ -468,17 +315,20 @@ void QueryServersUserInterface::onKeyDown(U32 key)
             if(currentIndex == -1)
                currentIndex = 0;
 
-            if(servers.size() > currentIndex)
+            if(mBrowser.getServerCount() > currentIndex)
             {
                // join the selected game
-               joinGame(servers[currentIndex].serverAddress, servers[currentIndex].isFromMaster, false);
+               stopServerListUpdates();
+               ServerRef &s = mBrowser.getServer(currentIndex);
+               joinGame(s.serverAddress, s.isFromMaster, false);
 
                // and clear out the servers, so that we don't do any more pinging
-               servers.clear();
+               mBrowser.clear();
             }
          }
          break;
       case 27:
+         stopServerListUpdates();
          gMainMenuUserInterface.activate();
          break;
    }
@@ -486,7 +336,7 @@ void QueryServersUserInterface::onKeyDown(U32 key)
 
 void QueryServersUserInterface::onSpecialKeyDown(U32 key)
 {
-   if(!servers.size())
+   if(!mBrowser.getServerCount())
       return;
 
    S32 currentIndex = findSelectedIndex();
@@ -520,10 +370,10 @@ void QueryServersUserInterface::onSpecialKeyDown(U32 key)
    }
    if(currentIndex < 0)
       currentIndex = 0;
-   if(currentIndex >= servers.size())
-      currentIndex = servers.size() - 1;
+   if(currentIndex >= mBrowser.getServerCount())
+      currentIndex = mBrowser.getServerCount() - 1;
 
-   selectedId = servers[currentIndex].id;
+   selectedId = mBrowser.getServer(currentIndex).id;
 }
 
 static S32 QSORT_CALLBACK compareFuncName(const void *a, const void *b)
@@ -560,31 +410,18 @@ void QueryServersUserInterface::sort()
    switch(sortColumn)
    {
       case 0:
-         qsort(servers.address(), servers.size(), sizeof(ServerRef), compareFuncName);
+         mBrowser.sort(compareFuncName, sortAscending);
          break;
       case 2:
-         qsort(servers.address(), servers.size(), sizeof(ServerRef), compareFuncPing);
+         mBrowser.sort(compareFuncPing, sortAscending);
          break;
       case 3:
-         qsort(servers.address(), servers.size(), sizeof(ServerRef), compareFuncPlayers);
+         mBrowser.sort(compareFuncPlayers, sortAscending);
          break;
       case 4:
-         qsort(servers.address(), servers.size(), sizeof(ServerRef), compareFuncAddress);
+         mBrowser.sort(compareFuncAddress, sortAscending);
          break;
    }
-   if(!sortAscending)
-   {
-      S32 size = servers.size() / 2;
-      S32 totalSize = servers.size();
-
-      for(S32 i = 0; i < size; i++)
-      {
-         ServerRef temp = servers[i];
-         servers[i] = servers[totalSize - i - 1];
-         servers[totalSize - i - 1] = temp;
-      }
-   }
 }
 
 };
-
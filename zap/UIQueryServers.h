@@ -28,7 +28,7 @@
 #define _UIQUERYSERVERS_H_
 
 #include "UI.h"
-#include "tnlNonce.h"
+#include "serverBrowser.h"
 
 namespace Zap
 {
@@ -41,53 +41,21 @@ public:
    S32 lastSortColumn;
    bool sortAscending;
    bool shouldSort;
-   Nonce mNonce;
-   U32 pendingPings;
-   U32 pendingQueries;
-   U32 broadcastPingSendTime;
-   U32 lastUsedServerId;
+   ServerBrowser mBrowser;
 
    enum {
-      MaxServerNameLen = 20,
+      MaxServerNameLen = ServerBrowser::MaxServerNameLen,
       ServersPerScreen = 21,
       ServersAbove = 9,
       ServersBelow = 9,
-      MaxPendingPings = 15,
-      MaxPendingQueries = 10,
-      PingQueryTimeout = 1500,
-      PingQueryRetryCount = 3,
-   };
-   struct ServerRef
-   {
-      enum State
-      {
-         Start,
-         SentPing,
-         ReceivedPing,
-         SentQuery,
-         ReceivedQuery,
-      };
-      U32 state;
-      U32 id;
-      U32 pingTime;
-      U32 identityToken;
-      U32 lastSendTime;
-      U32 sendCount;
-      bool isFromMaster;
-      bool dedicated;
-      bool passwordRequired;
-      Nonce sendNonce;
-      char serverName[MaxServerNameLen+1];
-      Address serverAddress;
-      S32 playerCount, maxPlayers;
    };
+   typedef ServerBrowser::Server ServerRef;
    struct ColumnInfo
    {
       const char *name;
       U32 xStart;
       ColumnInfo(const char *nm = NULL, U32 xs = 0) { name = nm; xStart = xs; }
    };
-   Vector<ServerRef> servers;
    Vector<ColumnInfo> columns;
 
    QueryServersUserInterface();
@@ -103,11 +71,11 @@ public:
    void render();
 
    void addPingServers(const Vector<IPAddress> &ipList);
+   void updatePingServers(const Vector<IPAddress> &ipList);
+   void removePingServers(const Vector<IPAddress> &ipList);
+   void stopServerListUpdates();
 
    void sort();
-
-   void gotPingResponse(const Address &theAddress, const Nonce &clientNonce, U32 clientIdentityToken);
-   void gotQueryResponse(const Address &theAddress, const Nonce &clientNonce, const char *serverName, U32 playerCount, U32 maxPlayers, bool dedicated, bool passwordRequired);
 };
 
 extern QueryServersUserInterface gQueryServersUserInterface;
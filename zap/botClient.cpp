@@ -0,0 +1,310 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "botClient.h"
+#include "handshakeFlood.h"
+#include "fieldCodingStats.h"
+#include "game.h"
+#include "gameConnection.h"
+#include "gameNetInterface.h"
+#include "tnlLog.h"
+#include "tnlPlatform.h"
+#include <math.h>
+
+namespace Zap
+{
+
+BotLoadTest *gBotLoadTest = NULL;
+
+static const char *gBotScenarioNames[BotScenarioCount] = {
+   "idle",
+   "wander",
+   "combat",
+};
+
+BotClient::BotClient(U32 index, BotScenario scenario)
+{
+   mIndex = index;
+   mScenario = scenario;
+   mTime = 0;
+   mConnectStartTime = 0;
+   mConnectLatency = -1;
+
+   // spread the bots out over the script so they don't all fly in formation
+   mPhase = index * 2.39996f;
+
+   mGame = new ClientGame(Address(IPProtocol, Address::Any, 0));
+}
+
+BotClient::~BotClient()
+{
+   if(mConnection.isValid())
+      mConnection->disconnect("Load test complete.");
+   mGame->getNetInterface()->processConnections();
+
+   // the connection deletes its ghosts, which have to leave the game first.
+   mConnection = NULL;
+   delete mGame;
+}
+
+void BotClient::connect(const Address &serverAddress, F32 packetLoss, U32 latency)
+{
+   char name[32];
+   dSprintf(name, sizeof(name), "Bot%d", mIndex);
+
+   mConnection = new GameConnection();
+   mConnection->setClientName(name);
+   mConnection->setSimulatedNetParams(packetLoss, latency);
+   mConnection->connect(mGame->getNetInterface(), serverAddress);
+   mConnectStartTime = mTime;
+}
+
+bool BotClient::isConnected()
+{
+   return mConnection.isValid() && mConnection->getConnectionState() == NetConnection::Connected;
+}
+
+void BotClient::generateMove(Move &theMove)
+{
+   if(mScenario == BotScenarioIdle)
+      return;
+
+   F32 t = mTime * 0.001f;
+   F32 heading = mPhase + sin(t * 0.3f + mPhase) * FloatPi;
+   F32 x = cos(heading);
+   F32 y = sin(heading);
+
+   theMove.right = x > 0 ? x : 0;
+   theMove.left = x < 0 ? -x : 0;
+   theMove.down = y > 0 ? y : 0;
+   theMove.up = y < 0 ? -y : 0;
+   theMove.angle = heading;
+
+   if(mScenario == BotScenarioCombat)
+   {
+      theMove.angle = mPhase + t * 2;
+      theMove.fire = true;
+      theMove.module[0] = (U32(t + mPhase) % 5) == 0;
+   }
+}
+
+void BotClient::idle(U32 timeDelta)
+{
+   mTime += timeDelta;
+   mGame->getNetInterface()->checkIncomingPackets();
+
+   if(isConnected())
+   {
+      if(mConnectLatency == -1)
+         mConnectLatency = mTime - mConnectStartTime;
+
+      Move theMove;
+      generateMove(theMove);
+      // a stalled tick can be longer than a move may cover; the client
+      // game clamps its moves the same way.
+      theMove.time = getMin(timeDelta, U32(Move::MaxMoveTime));
+      theMove.prepare();
+      mConnection->addPendingMove(&theMove);
+   }
+   mGame->processDeleteList(timeDelta);
+   mGame->getNetInterface()->processConnections();
+}
+
+//-----------------------------------------------------------------------------------
+
+BotLoadTest::Params::Params()
+{
+   botCount = 0;
+   scenario = BotScenarioWander;
+   duration = 60000;
+   connectInterval = 50;
+   reportInterval = 5000;
+   packetLoss = 0;
+   latency = 0;
+   floodRate = 0;
+}
+
+BotLoadTest::BotLoadTest(const Params &params, const Address &serverAddress)
+{
+   mParams = params;
+   mServerAddress = serverAddress;
+   mTime = 0;
+   mNextConnectTime = 0;
+   mNextReportTime = params.reportInterval;
+   sampleTraffic(mIntervalTraffic);
+
+   mFlood = NULL;
+   if(params.floodRate)
+      mFlood = new HandshakeFlood(serverAddress, params.floodRate);
+
+   logprintf("Load test: %d bots running the %s scenario against %s.",
+      params.botCount, gBotScenarioNames[params.scenario], serverAddress.toString());
+   if(mFlood)
+      logprintf("Load test: flooding the server with %d handshake packets/s.", params.floodRate);
+}
+
+BotLoadTest::~BotLoadTest()
+{
+   for(S32 i = 0; i < mBots.size(); i++)
+      delete mBots[i];
+   delete mFlood;
+}
+
+bool BotLoadTest::parseScenario(const char *name, BotScenario &scenario)
+{
+   for(U32 i = 0; i < BotScenarioCount; i++)
+   {
+      if(!stricmp(name, gBotScenarioNames[i]))
+      {
+         scenario = BotScenario(i);
+         return true;
+      }
+   }
+   return false;
+}
+
+void BotLoadTest::idle(U32 timeDelta)
+{
+   mTime += timeDelta;
+
+   // bring the bots in gradually so the connect handshakes are spread out
+   while(U32(mBots.size()) < mParams.botCount && mTime >= mNextConnectTime)
+   {
+      BotClient *bot = new BotClient(mBots.size(), mParams.scenario);
+      bot->connect(mServerAddress, mParams.packetLoss, mParams.latency);
+      mBots.push_back(bot);
+      mNextConnectTime += mParams.connectInterval;
+   }
+
+   if(mFlood)
+      mFlood->idle(timeDelta);
+
+   S64 startTime = Platform::getHighPrecisionTimerValue();
+   gServerGame->idle(timeDelta);
+   F64 tickTime = Platform::getHighPrecisionMilliseconds(Platform::getHighPrecisionTimerValue() - startTime);
+
+   TickStats *stats[2] = { &mRunStats, &mIntervalStats };
+   for(U32 i = 0; i < 2; i++)
+   {
+      stats[i]->ticks++;
+      stats[i]->totalTime += tickTime;
+      if(tickTime > stats[i]->maxTime)
+         stats[i]->maxTime = tickTime;
+   }
+
+   for(S32 i = 0; i < mBots.size(); i++)
+      mBots[i]->idle(timeDelta);
+
+   if(mParams.reportInterval && mTime >= mNextReportTime)
+   {
+      logReport("Interval", mIntervalStats, mIntervalTraffic);
+      mIntervalStats = TickStats(mTime);
+      sampleTraffic(mIntervalTraffic);
+      mNextReportTime += mParams.reportInterval;
+   }
+}
+
+bool BotLoadTest::isFinished()
+{
+   return mParams.duration && mTime >= mParams.duration;
+}
+
+void BotLoadTest::sampleTraffic(TrafficSample &sample)
+{
+   sample.packetsSent = 0;
+   sample.packetsReceived = 0;
+   sample.bytesSent = 0;
+   sample.bytesReceived = 0;
+
+   for(S32 i = 0; i < mBots.size(); i++)
+   {
+      GameConnection *conn = mBots[i]->getConnection();
+      if(!conn)
+         continue;
+      sample.packetsSent += conn->getPacketsSent();
+      sample.packetsReceived += conn->getPacketsReceived();
+      sample.bytesSent += conn->getBytesSent();
+      sample.bytesReceived += conn->getBytesReceived();
+   }
+}
+
+void BotLoadTest::logReport(const char *label, const TickStats &stats, const TrafficSample &startTraffic)
+{
+   TrafficSample traffic;
+   sampleTraffic(traffic);
+
+   U32 connected = 0;
+   U32 latencyCount = 0;
+   U32 totalLatency = 0;
+   S32 maxLatency = 0;
+   for(S32 i = 0; i < mBots.size(); i++)
+   {
+      if(mBots[i]->isConnected())
+         connected++;
+      S32 latency = mBots[i]->getConnectLatency();
+      if(latency >= 0)
+      {
+         latencyCount++;
+         totalLatency += latency;
+         if(latency > maxLatency)
+            maxLatency = latency;
+      }
+   }
+
+   F32 seconds = (mTime - stats.startTime) * 0.001f;
+   F32 clientSeconds = seconds * (connected ? connected : 1);
+   if(clientSeconds <= 0)
+      return;
+
+   logprintf("%s %.1fs: %d/%d bots connected, %d ticks, server tick avg %.3f ms, max %.3f ms",
+      label, seconds, connected, mBots.size(), stats.ticks,
+      stats.ticks ? stats.totalTime / stats.ticks : 0, stats.maxTime);
+   logprintf("   per client: down %.0f bytes/s %.1f packets/s, up %.0f bytes/s %.1f packets/s",
+      (traffic.bytesReceived - startTraffic.bytesReceived) / clientSeconds,
+      (traffic.packetsReceived - startTraffic.packetsReceived) / clientSeconds,
+      (traffic.bytesSent - startTraffic.bytesSent) / clientSeconds,
+      (traffic.packetsSent - startTraffic.packetsSent) / clientSeconds);
+   if(latencyCount)
+      logprintf("   connect time avg %d ms, max %d ms", totalLatency / latencyCount, maxLatency);
+
+   if(mFlood)
+   {
+      ClientPuzzleManager &puzzles = gServerGame->getNetInterface()->getPuzzleManager();
+      logprintf("   flood: %d packets sent, server hashed %d puzzle solutions, accepted %d, difficulty %d",
+         mFlood->getPacketsSent(), puzzles.getSolutionsChecked(), puzzles.getSolutionsAccepted(),
+         puzzles.getCurrentDifficulty());
+   }
+}
+
+void BotLoadTest::logSummary()
+{
+   TrafficSample start;
+   start.packetsSent = start.packetsReceived = start.bytesSent = start.bytesReceived = 0;
+   logReport("Load test total", mRunStats, start);
+   logFieldCodingStats();
+}
+
+};
@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _BOTCLIENT_H_
+#define _BOTCLIENT_H_
+
+#include "tnlTypes.h"
+#include "tnlVector.h"
+#include "tnlNetBase.h"
+#include "tnlUDP.h"
+#include "move.h"
+
+using namespace TNL;
+
+namespace Zap
+{
+
+class GameConnection;
+class GameNetInterface;
+class ClientGame;
+class HandshakeFlood;
+
+/// Scripted input patterns the load test bots can play.
+enum BotScenario
+{
+   BotScenarioIdle,    ///< Connect and sit still.
+   BotScenarioWander,  ///< Fly smooth curves around the level.
+   BotScenarioCombat,  ///< Wander while spinning, firing and boosting.
+   BotScenarioCount,
+};
+
+/// A BotClient is a single simulated player.  Each bot has its own
+/// ClientGame, and so its own GameNetInterface and UDP port, so that the
+/// server sees every bot as a separate remote host, just like real
+/// clients.  Bots have no user interface and do no client side
+/// prediction, they only feed scripted moves to the server and unpack
+/// the updates they get back into their game.  The ghosts are never
+/// simulated, so a bot's game costs little more than the unpacking.
+class BotClient
+{
+   U32 mIndex;
+   F32 mPhase;
+   BotScenario mScenario;
+   U32 mTime;
+   ClientGame *mGame;
+   RefPtr<GameConnection> mConnection;
+   U32 mConnectStartTime;
+   S32 mConnectLatency;  ///< Milliseconds from connect() to connected, -1 until then.
+public:
+   BotClient(U32 index, BotScenario scenario);
+   ~BotClient();
+
+   void connect(const Address &serverAddress, F32 packetLoss, U32 latency);
+   void idle(U32 timeDelta);
+   void generateMove(Move &theMove);
+
+   bool isConnected();
+   S32 getConnectLatency() { return mConnectLatency; }
+   GameConnection *getConnection() { return mConnection; }
+};
+
+/// BotLoadTest runs a server and a set of bots in one process.  Each
+/// idle() ticks the server, timing it on its own, then ticks every bot.
+/// At each report interval and at the end of the run it logs the server
+/// tick time and the per client bandwidth and packet rates as seen by
+/// the bots, along with how long the bots took to connect.  With a
+/// flood rate set, a HandshakeFlood runs alongside the bots.
+class BotLoadTest
+{
+public:
+   struct Params
+   {
+      U32 botCount;         ///< Number of bots to connect.
+      BotScenario scenario; ///< Input script for every bot.
+      U32 duration;         ///< Length of the run in milliseconds, 0 to run forever.
+      U32 connectInterval;  ///< Milliseconds between successive bot connects.
+      U32 reportInterval;   ///< Milliseconds between progress reports.
+      F32 packetLoss;       ///< Simulated packet loss on the bot connections.
+      U32 latency;          ///< Simulated one way latency on the bot connections.
+      U32 floodRate;        ///< Bogus handshake packets per second sent at the server, 0 for none.
+
+      Params();
+   };
+
+private:
+   struct TickStats
+   {
+      U32 startTime;
+      U32 ticks;
+      F64 totalTime;
+      F64 maxTime;
+
+      TickStats(U32 time = 0) { startTime = time; ticks = 0; totalTime = 0; maxTime = 0; }
+   };
+
+   struct TrafficSample
+   {
+      U32 packetsSent;
+      U32 packetsReceived;
+      U32 bytesSent;
+      U32 bytesReceived;
+   };
+
+   Params mParams;
+   Address mServerAddress;
+   Vector<BotClient *> mBots;
+   HandshakeFlood *mFlood;
+   U32 mTime;
+   U32 mNextConnectTime;
+   U32 mNextReportTime;
+   TickStats mRunStats;
+   TickStats mIntervalStats;
+   TrafficSample mIntervalTraffic;
+
+   void sampleTraffic(TrafficSample &sample);
+   void logReport(const char *label, const TickStats &stats, const TrafficSample &startTraffic);
+public:
+   BotLoadTest(const Params &params, const Address &serverAddress);
+   ~BotLoadTest();
+
+   void idle(U32 timeDelta);
+   bool isFinished();
+   void logSummary();
+
+   static bool parseScenario(const char *name, BotScenario &scenario);
+};
+
+extern BotLoadTest *gBotLoadTest;
+
+};
+
+#endif
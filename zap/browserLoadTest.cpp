@@ -0,0 +1,173 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "browserLoadTest.h"
+#include "gameNetInterface.h"
+#include "tnlLog.h"
+#include "tnlNonce.h"
+#include "tnlPlatform.h"
+
+namespace Zap
+{
+
+BrowserLoadTest::Params::Params()
+{
+   serverCount = 0;
+   windowSize = ServerBrowser::DefaultWindowSize;
+   sendRate = ServerBrowser::DefaultSendRate;
+   timeLimit = 120000;
+}
+
+BrowserLoadTest::BrowserLoadTest(const Params &params)
+{
+   mParams = params;
+   mBrowserTime = 0;
+   mServerTime = 0;
+
+   Vector<IPAddress> addresses;
+   for(U32 i = 0; i < params.serverCount; i++)
+   {
+      Socket *socket = new Socket(Address("IP:127.0.0.1:0"));
+      if(!socket->isValid())
+      {
+         logprintf("Browser test: could only open %d server sockets.", i);
+         delete socket;
+         break;
+      }
+      mServers.push_back(socket);
+
+      addresses.push_back(socket->getBoundAddress().toIPAddress());
+   }
+
+   mInterface = new GameNetInterface(Address("IP:127.0.0.1:0"), NULL);
+   mInterface->setServerBrowser(&mBrowser);
+   mBrowser.setInterface(mInterface);
+   mBrowser.setLimits(params.windowSize, params.sendRate);
+   mBrowser.addServers(addresses);
+
+   logprintf("Browser test: %d simulated servers, window %d, %d requests/s.",
+      mServers.size(), params.windowSize, params.sendRate);
+}
+
+BrowserLoadTest::~BrowserLoadTest()
+{
+   mInterface->setServerBrowser(NULL);
+   for(S32 i = 0; i < mServers.size(); i++)
+      delete mServers[i];
+}
+
+void BrowserLoadTest::serviceServer(Socket *socket)
+{
+   for(;;)
+   {
+      PacketStream request;
+      Address from;
+      if(request.recvfrom(*socket, &from) != NoError)
+         return;
+
+      U8 packetType;
+      request.read(&packetType);
+      Nonce nonce;
+      nonce.read(&request);
+
+      // the identity token only has to be something the browser can't
+      // make up, so a hash of the nonce does.
+      U32 token = 0;
+      for(U32 i = 0; i < Nonce::NonceSize; i++)
+         token = token * 31 + nonce.data[i];
+
+      PacketStream response;
+      if(packetType == GameNetInterface::Ping)
+      {
+         response.write(U8(GameNetInterface::PingResponse));
+         nonce.write(&response);
+         response.write(token);
+      }
+      else if(packetType == GameNetInterface::Query)
+      {
+         U32 clientToken;
+         request.read(&clientToken);
+         if(clientToken != token)
+            continue;
+
+         response.write(U8(GameNetInterface::QueryResponse));
+         nonce.write(&response);
+         response.writeString("Simulated", ServerBrowser::MaxServerNameLen);
+         response.write(U32(token % 16));
+         response.write(U32(16));
+         response.writeFlag(true);
+         response.writeFlag(false);
+      }
+      else
+         continue;
+      response.sendto(*socket, from);
+   }
+}
+
+void BrowserLoadTest::run()
+{
+   S64 startTime = Platform::getHighPrecisionTimerValue();
+   F64 elapsed = 0;
+
+   while(!mBrowser.isFinished() && elapsed < mParams.timeLimit)
+   {
+      S64 time = Platform::getHighPrecisionTimerValue();
+      mInterface->checkIncomingPackets();
+      mBrowser.idle();
+      S64 serverStart = Platform::getHighPrecisionTimerValue();
+      mBrowserTime += Platform::getHighPrecisionMilliseconds(serverStart - time);
+
+      for(S32 i = 0; i < mServers.size(); i++)
+         serviceServer(mServers[i]);
+
+      S64 serverEnd = Platform::getHighPrecisionTimerValue();
+      mServerTime += Platform::getHighPrecisionMilliseconds(serverEnd - serverStart);
+      elapsed = Platform::getHighPrecisionMilliseconds(serverEnd - startTime);
+   }
+
+   U32 answered = 0;
+   U32 totalPing = 0;
+   for(S32 i = 0; i < mBrowser.getServerCount(); i++)
+   {
+      ServerBrowser::Server &s = mBrowser.getServer(i);
+      if(s.state == ServerBrowser::Server::ReceivedQuery && s.maxPlayers > 0)
+      {
+         answered++;
+         totalPing += s.pingTime;
+      }
+   }
+
+   const ServerBrowser::Stats &stats = mBrowser.getStats();
+   logprintf("Browser test %s: %d/%d servers listed in %.0f ms.",
+      mBrowser.isFinished() ? "finished" : "timed out", answered, mBrowser.getServerCount(), elapsed);
+   logprintf("   %d pings, %d queries, %d responses, %d unmatched, %d timeouts, average ping %d ms",
+      stats.pingsSent, stats.queriesSent, stats.responses, stats.unmatchedResponses, stats.timeouts,
+      answered ? totalPing / answered : 0);
+   logprintf("   browser time %.1f ms, simulated server time %.1f ms",
+      mBrowserTime, mServerTime);
+}
+
+};
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _BROWSERLOADTEST_H_
+#define _BROWSERLOADTEST_H_
+
+#include "tnlTypes.h"
+#include "tnlVector.h"
+#include "tnlUDP.h"
+#include "serverBrowser.h"
+
+using namespace TNL;
+
+namespace Zap
+{
+
+class GameNetInterface;
+
+/// BrowserLoadTest times the server browser against a set of simulated
+/// game servers on the loopback interface.  Each simulated server is a
+/// bare UDP socket that answers pings and queries the way a real server
+/// does, so the browser sees the same traffic it would from the master's
+/// list.  The test runs until every server has answered or timed out,
+/// then logs the time to a full list along with the browser's counters.
+class BrowserLoadTest
+{
+public:
+   struct Params
+   {
+      U32 serverCount;      ///< Number of simulated servers.
+      U32 windowSize;       ///< Outstanding requests allowed by the browser.
+      U32 sendRate;         ///< Browser pings and queries per second.
+      U32 timeLimit;        ///< Milliseconds before the test gives up.
+
+      Params();
+   };
+
+private:
+   Params mParams;
+   Vector<Socket *> mServers;
+   RefPtr<GameNetInterface> mInterface;
+   ServerBrowser mBrowser;
+
+   F64 mBrowserTime;     ///< Milliseconds spent receiving responses and in the browser.
+   F64 mServerTime;      ///< Milliseconds spent in the simulated servers.
+
+   void serviceServer(Socket *socket);
+public:
+   BrowserLoadTest(const Params &params);
+   ~BrowserLoadTest();
+
+   /// Runs the test to completion and logs the results.
+   void run();
+};
+
+};
+
+#endif
@@ -31,6 +31,11 @@
 namespace Zap
 {
 
+// points relative to the control object are mostly near it, so the top
+// bits of their offsets are entropy coded.
+static CodedField RelativePointXField("Relative point x", 6);
+static CodedField RelativePointYField("Relative point y", 6);
+
 ControlObjectConnection::ControlObjectConnection()
 {
    highSendIndex[0] = 0;
@@ -55,7 +60,13 @@ void ControlObjectConnection::setControlObject(GameObject *theObject)
 void ControlObjectConnection::packetReceived(PacketNotify *notify)
 {
    for(; firstMoveIndex < ((GamePacketNotify *) notify)->firstUnsentMoveIndex; firstMoveIndex++)
+   {
+      // remember what we predicted after the last move the server
+      // has seen, so we can check its next control update against it.
+      mAckedMoveState = mPendingMoveStates[0];
       pendingMoves.erase(U32(0));
+      mPendingMoveStates.erase(U32(0));
+   }
    mServerPosition = ((GamePacketNotify *) notify)->lastControlObjectPosition;
    Parent::packetReceived(notify);
 }
@@ -74,6 +85,35 @@ U32 ControlObjectConnection::getControlCRC()
    return stream.calculateCRC(0, stream.getBytePosition());   
 }
 
+void ControlObjectConnection::writeControlSnapshot(ControlStateSnapshot &snapshot)
+{
+   memset(snapshot.data, 0, sizeof(snapshot.data));
+   BitStream stream(snapshot.data, ControlStateSnapshot::MaxStateBytes);
+   controlObject->writeControlState(&stream);
+   snapshot.bitCount = stream.getBitPosition();
+   snapshot.valid = stream.isValid();
+}
+
+void ControlObjectConnection::readControlSnapshot(ControlStateSnapshot &snapshot)
+{
+   BitStream stream(snapshot.data, ControlStateSnapshot::MaxStateBytes);
+   stream.setMaxBitSizes(snapshot.bitCount);
+   controlObject->readControlState(&stream);
+}
+
+void ControlObjectConnection::recordPendingMoveState()
+{
+   if(!mPendingMoveStates.size() || !controlObject.isValid())
+      return;
+
+   // only the move that was just added gets recorded -- if the
+   // pending move list is full, the last entry already belongs to
+   // an earlier move.
+   ControlStateSnapshot &snapshot = mPendingMoveStates.last();
+   if(!snapshot.valid)
+      writeControlSnapshot(snapshot);
+}
+
 void ControlObjectConnection::writePacket(BitStream *bstream, PacketNotify *notify)
 {
    if(isConnectionToServer())
@@ -176,18 +216,41 @@ void ControlObjectConnection::readPacket(BitStream *bstream)
 
       mCompressPointsRelative = controlObjectValid;
 
+#ifndef ZAP_DEDICATED
       gGameUserInterface.receivedControlUpdate(false);
+#endif
       // CRC mismatch...
       if(bstream->readFlag())
       {
          if(controlObjectValid)
          {
             U32 ghostIndex = bstream->readInt(GhostConnection::GhostIdBitSize);
-            controlObject = (GameObject *) resolveGhost(ghostIndex);
+            GameObject *newControlObject = (GameObject *) resolveGhost(ghostIndex);
+
+            // save off our current prediction -- if the server's state
+            // agrees with what we predicted for the last acknowledged
+            // move, the prediction stands and no replay is needed.
+            ControlStateSnapshot predictedState;
+            if(mAckedMoveState.valid && controlObject == newControlObject)
+               writeControlSnapshot(predictedState);
+
+            controlObject = newControlObject;
             controlObject->readControlState(bstream);
             mServerPosition = controlObject->getActualPos();
-            replayControlObjectMoves = true;
+
+            ControlStateSnapshot serverState;
+            writeControlSnapshot(serverState);
+
+            if(predictedState.valid && serverState.valid &&
+                  controlStatesMatch(serverState, mAckedMoveState))
+               readControlSnapshot(predictedState);
+            else
+               replayControlObjectMoves = true;
+
+            mAckedMoveState = serverState;
+#ifndef ZAP_DEDICATED
             gGameUserInterface.receivedControlUpdate(true);
+#endif
          }
          else
             controlObject = NULL;
@@ -203,11 +266,25 @@ void ControlObjectConnection::readPacket(BitStream *bstream)
          theMove.prepare();
          controlObject->setCurrentMove(theMove);
          controlObject->idle(GameObject::ClientIdleControlReplay);
+
+         // the corrected prediction replaces the old one, so that
+         // later server updates are checked against it.
+         writeControlSnapshot(mPendingMoveStates[i]);
       }
       controlObject->controlMoveReplayComplete();
    }
 }
 
+bool ControlObjectConnection::controlStatesMatch(ControlStateSnapshot &serverState, ControlStateSnapshot &predictedState)
+{
+   BitStream serverStream(serverState.data, ControlStateSnapshot::MaxStateBytes);
+   serverStream.setMaxBitSizes(serverState.bitCount);
+   BitStream predictedStream(predictedState.data, ControlStateSnapshot::MaxStateBytes);
+   predictedStream.setMaxBitSizes(predictedState.bitCount);
+
+   return controlObject->controlStateMatches(&serverStream, &predictedStream);
+}
+
 void ControlObjectConnection::writeCompressedPoint(Point &p, BitStream *stream)
 {
    if(!mCompressPointsRelative)
@@ -226,8 +303,8 @@ void ControlObjectConnection::writeCompressedPoint(Point &p, BitStream *stream)
 
    if(stream->writeFlag(dx >= 0 && dx <= maxx && dy >= 0 && dy <= maxy))
    {
-      stream->writeRangedU32(dx, 0, maxx);
-      stream->writeRangedU32(dy, 0, maxy);
+      stream->writeCodedRangedU32(dx, 0, maxx, RelativePointXField);
+      stream->writeCodedRangedU32(dy, 0, maxy, RelativePointYField);
    }
    else
    {
@@ -249,8 +326,8 @@ void ControlObjectConnection::readCompressedPoint(Point &p, BitStream *stream)
       U32 maxx = (Game::PlayerHorizVisDistance + Game::PlayerScopeMargin) * 2;
       U32 maxy = (Game::PlayerVertVisDistance + Game::PlayerScopeMargin) * 2;
 
-      F32 dx = F32(stream->readRangedU32(0, maxx)) - (Game::PlayerHorizVisDistance + Game::PlayerScopeMargin);
-      F32 dy = F32(stream->readRangedU32(0, maxy)) - (Game::PlayerVertVisDistance + Game::PlayerScopeMargin);
+      F32 dx = F32(stream->readCodedRangedU32(0, maxx, RelativePointXField)) - (Game::PlayerHorizVisDistance + Game::PlayerScopeMargin);
+      F32 dy = F32(stream->readCodedRangedU32(0, maxy, RelativePointYField)) - (Game::PlayerVertVisDistance + Game::PlayerScopeMargin);
 
       Point delta(dx, dy);
       p = mServerPosition + delta;
@@ -51,6 +51,33 @@ class ControlObjectConnection : public GhostConnection
    Vector<Move> pendingMoves;
    SafePtr<GameObject> controlObject;
 
+public:
+   /// ControlStateSnapshot holds the serialized control state of the
+   /// control object (as written by GameObject::writeControlState)
+   /// as it was predicted on the client after a particular move.
+   struct ControlStateSnapshot
+   {
+      enum {
+         MaxStateBytes = 64,
+      };
+      U8 data[MaxStateBytes];
+      U32 bitCount;
+      bool valid;
+      ControlStateSnapshot() { bitCount = 0; valid = false; }
+   };
+private:
+   /// Predicted control state after each move in pendingMoves.
+   Vector<ControlStateSnapshot> mPendingMoveStates;
+
+   /// Predicted control state after the last move the server has
+   /// acknowledged -- this is the state the server's next control
+   /// state update should agree with.
+   ControlStateSnapshot mAckedMoveState;
+
+   void writeControlSnapshot(ControlStateSnapshot &snapshot);
+   void readControlSnapshot(ControlStateSnapshot &snapshot);
+   bool controlStatesMatch(ControlStateSnapshot &serverState, ControlStateSnapshot &predictedState);
+
    U32 mLastClientControlCRC;
    Point mServerPosition;
    bool mCompressPointsRelative;
@@ -69,14 +96,22 @@ public:
    void addPendingMove(Move *theMove)
    {
       if(pendingMoves.size() < MaxPendingMoves)
+      {
          pendingMoves.push_back(*theMove);
+         mPendingMoveStates.push_back(ControlStateSnapshot());
+      }
    }
 
+   /// Records the predicted state of the control object after
+   /// the most recently added pending move has been processed.
+   void recordPendingMoveState();
+
    struct GamePacketNotify : public GhostConnection::GhostPacketNotify
    {
       U32 firstUnsentMoveIndex;
       Point lastControlObjectPosition;
       GamePacketNotify() { firstUnsentMoveIndex =  0; }
+      void reset() { GhostPacketNotify::reset(); firstUnsentMoveIndex = 0; lastControlObjectPosition = Point(); }
    };
    PacketNotify *allocNotify() { return new GamePacketNotify; }
 
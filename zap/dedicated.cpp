@@ -0,0 +1,297 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+// Entry point for the headless dedicated server (zapded).  This replaces
+// main.cpp in the ZAP_DEDICATED build, which contains only the server and
+// simulation code - no user interface screens, GLUT, OpenAL or input.
+
+#include "tnl.h"
+#include "tnlLog.h"
+#include "tnlRandom.h"
+#include "tnlNetInterface.h"
+#include "tnlNetProfiler.h"
+#include "tnlVirtualNetwork.h"
+
+#include "game.h"
+#include "gameNetInterface.h"
+#include "levelFile.h"
+#include "botClient.h"
+#include "browserLoadTest.h"
+
+#include <stdio.h>
+
+using namespace TNL;
+
+namespace Zap
+{
+
+const char *gHostName = "ZAP Game";
+U32 gMaxPlayers = 128;
+U32 gSimulatedPing = 0;
+F32 gSimulatedPacketLoss = 0;
+bool gDedicatedServer = true;
+bool gFieldCoding = true;
+
+const char *gMasterAddressString = "IP:master.opentnl.org:29005";
+const char *gServerPassword = NULL;
+const char *gAdminPassword = NULL;
+
+Address gMasterAddress;
+Address gBindAddress(IPProtocol, Address::Any, 28000);
+VirtualNetwork *gVirtualNetwork = NULL;
+
+const char *gLevelList = "retrieve1.txt "
+                         "retrieve2.txt "
+                         "retrieve3.txt "
+                         "football1.txt "
+                         "football2.txt "
+                         "football3.txt "
+                         "football4.txt "
+                         "football5.txt "
+                         "rabbit1.txt "
+                         "soccer1.txt "
+                         "ctf1.txt "
+                         "ctf2.txt "
+                         "ctf3.txt "
+                         "ctf4.txt "
+                         "hunters1.txt "
+                         "hunters2.txt "
+                         "zm1.txt "
+                         ;
+
+class StdoutLogConsumer : public LogConsumer
+{
+public:
+   void logString(const char *string)
+   {
+      printf("%s\n", string);
+   }
+} gStdoutLogConsumer;
+
+void hostGame(bool dedicated, Address bindAddress)
+{
+   gServerGame = new ServerGame(bindAddress, gMaxPlayers, gHostName);
+   gServerGame->setLevelList(gLevelList);
+}
+
+void joinGame(Address remoteAddress, bool isFromMaster, bool local)
+{
+}
+
+void endGame()
+{
+   delete gServerGame;
+   gServerGame = NULL;
+}
+
+void dedicatedServerLoop()
+{
+   // on a virtual network the load test runs on the network's clock, as
+   // fast as it can.
+   if(gVirtualNetwork)
+   {
+      for(;;)
+      {
+         gVirtualNetwork->advanceTime(10);
+         gBotLoadTest->idle(10);
+         if(gBotLoadTest->isFinished())
+            return;
+      }
+   }
+
+   S64 lastTimer = Platform::getHighPrecisionTimerValue();
+   F64 unusedFraction = 0;
+
+   for(;;)
+   {
+      S64 currentTimer = Platform::getHighPrecisionTimerValue();
+      F64 timeElapsed = Platform::getHighPrecisionMilliseconds(currentTimer - lastTimer) + unusedFraction;
+      U32 integerTime = U32(timeElapsed);
+
+      if(integerTime >= 10)
+      {
+         lastTimer = currentTimer;
+         unusedFraction = timeElapsed - integerTime;
+
+         if(gBotLoadTest)
+         {
+            gBotLoadTest->idle(integerTime);
+            if(gBotLoadTest->isFinished())
+               return;
+         }
+         else
+            gServerGame->idle(integerTime);
+      }
+      Platform::sleep(1);
+   }
+}
+
+};
+
+using namespace Zap;
+
+int main(int argc, char **argv)
+{
+   TNLLogEnable(LogNetInterface, true);
+   TNLLogEnable(LogPlatform, true);
+   TNLLogEnable(LogNetBase, true);
+   startAsyncLogging();
+
+   BotLoadTest::Params botParams;
+   BrowserLoadTest::Params browserParams;
+   VirtualNetwork::LinkParams linkParams;
+   bool virtualNetworkSet = false;
+   U32 virtualNetworkSeed = 0;
+   bool masterSet = false;
+
+   for(S32 i = 1; i < argc; i += 2)
+   {
+      bool hasAdditionalArg = (i != argc - 1);
+      const char *arg = hasAdditionalArg ? argv[i+1] : NULL;
+
+      if(!stricmp(argv[i], "-compilelevels"))
+      {
+         compileLevelList(arg ? arg : gLevelList);
+         return 0;
+      }
+      else if(!hasAdditionalArg)
+         break;
+      else if(!stricmp(argv[i], "-dedicated") || !stricmp(argv[i], "-server"))
+         gBindAddress.set(arg);
+      else if(!stricmp(argv[i], "-master"))
+      {
+         gMasterAddressString = arg;
+         masterSet = true;
+      }
+      else if(!stricmp(argv[i], "-password"))
+         gServerPassword = strdup(arg);
+      else if(!stricmp(argv[i], "-adminpassword"))
+         gAdminPassword = strdup(arg);
+      else if(!stricmp(argv[i], "-levels"))
+         gLevelList = strdup(arg);
+      else if(!stricmp(argv[i], "-hostname"))
+         gHostName = strdup(arg);
+      else if(!stricmp(argv[i], "-maxplayers"))
+         gMaxPlayers = atoi(arg);
+      else if(!stricmp(argv[i], "-seed"))
+         FastRandom::get().setSeed(U32(strtoul(arg, NULL, 10)));
+      else if(!stricmp(argv[i], "-loss"))
+         botParams.packetLoss = atof(arg);
+      else if(!stricmp(argv[i], "-lag"))
+         botParams.latency = atoi(arg);
+      else if(!stricmp(argv[i], "-jitter"))
+         linkParams.jitter = atoi(arg);
+      else if(!stricmp(argv[i], "-bandwidth"))
+         linkParams.bandwidth = atoi(arg);
+      else if(!stricmp(argv[i], "-virtualnet"))
+      {
+         virtualNetworkSet = true;
+         virtualNetworkSeed = U32(strtoul(arg, NULL, 10));
+      }
+      else if(!stricmp(argv[i], "-flood"))
+         botParams.floodRate = atoi(arg);
+      else if(!stricmp(argv[i], "-bots"))
+         botParams.botCount = atoi(arg);
+      else if(!stricmp(argv[i], "-botscenario"))
+      {
+         if(!BotLoadTest::parseScenario(arg, botParams.scenario))
+            logprintf("Unknown bot scenario %s, using wander.", arg);
+      }
+      else if(!stricmp(argv[i], "-bottime"))
+         botParams.duration = atoi(arg) * 1000;
+      else if(!stricmp(argv[i], "-botreport"))
+         botParams.reportInterval = atoi(arg) * 1000;
+      else if(!stricmp(argv[i], "-netprofile"))
+         NetProfiler::setDumpInterval(atoi(arg) * 1000);
+      else if(!stricmp(argv[i], "-fieldcoding"))
+         gFieldCoding = atoi(arg) != 0;
+      else if(!stricmp(argv[i], "-browsetest"))
+         browserParams.serverCount = atoi(arg);
+      else if(!stricmp(argv[i], "-browsewindow"))
+         browserParams.windowSize = atoi(arg);
+      else if(!stricmp(argv[i], "-browserate"))
+         browserParams.sendRate = atoi(arg);
+   }
+
+   if(browserParams.serverCount)
+   {
+      BrowserLoadTest browserTest(browserParams);
+      browserTest.run();
+      return 0;
+   }
+
+   // a load test doesn't advertise itself unless a master was asked for
+   if(!botParams.botCount || masterSet)
+      gMasterAddress.set(gMasterAddressString);
+
+   if(botParams.botCount && gMaxPlayers < botParams.botCount)
+      gMaxPlayers = botParams.botCount;
+
+   // the link options only shape the bots' traffic on a virtual network,
+   // so a real server never silently runs without them.
+   bool linkOptionsSet = linkParams.jitter || linkParams.bandwidth;
+   if(!botParams.botCount && (virtualNetworkSet || linkOptionsSet))
+      logprintf("-virtualnet, -jitter and -bandwidth only apply to a bot load test, ignoring them.");
+   else if(linkOptionsSet && !virtualNetworkSet)
+      logprintf("-jitter and -bandwidth need -virtualnet, ignoring them.");
+
+   // the virtual network carries the lag and loss in its links, instead of
+   // the bots' connections.
+   if(botParams.botCount && virtualNetworkSet)
+   {
+      linkParams.latency = botParams.latency;
+      linkParams.packetLoss = botParams.packetLoss;
+      botParams.latency = 0;
+      botParams.packetLoss = 0;
+      gVirtualNetwork = new VirtualNetwork(virtualNetworkSeed);
+      gVirtualNetwork->setDefaultLink(linkParams);
+      gVirtualNetwork->install();
+   }
+
+   hostGame(true, gBindAddress);
+
+   if(botParams.botCount)
+      gBotLoadTest = new BotLoadTest(botParams,
+            Address(IPProtocol, Address::Localhost, gBindAddress.port));
+
+   dedicatedServerLoop();
+
+   if(gBotLoadTest)
+   {
+      gBotLoadTest->logSummary();
+      if(gVirtualNetwork)
+      {
+         const VirtualNetwork::Stats &stats = gVirtualNetwork->getStats();
+         logprintf("Virtual network: %d packets sent, %d delivered, %d lost, %d dropped by the bandwidth cap, %d undeliverable.",
+            stats.packetsSent, stats.packetsDelivered, stats.packetsLost, stats.packetsQueueDropped,
+            stats.packetsUnroutable + stats.packetsOverflowed);
+      }
+      delete gBotLoadTest;
+      gBotLoadTest = NULL;
+   }
+   endGame();
+   return 0;
+}
@@ -257,12 +257,12 @@ void EngineeredObject::explode()
    SFXObject::play(SFXShipExplode, getActualPos(), Point());
 
    F32 a, b;
-   a = Random::readF() * 0.4 + 0.5;
-   b = Random::readF() * 0.2 + 0.9;
+   a = FastRandom::get().readF() * 0.4 + 0.5;
+   b = FastRandom::get().readF() * 0.2 + 0.9;
 
    F32 c, d;
-   c = Random::readF() * 0.15 + 0.125;
-   d = Random::readF() * 0.2 + 0.9;
+   c = FastRandom::get().readF() * 0.15 + 0.125;
+   d = FastRandom::get().readF() * 0.2 + 0.9;
 
    FXManager::emitExplosion(getActualPos(), 0.65, ShipExplosionColors, NumShipExplosionColors);
    FXManager::emitBurst(getActualPos(), Point(a,c) * 0.6, Color(1,1,0.25), Color(1,0,0));
@@ -390,15 +390,20 @@ void ForceFieldProjector::onDisabled()
 void ForceFieldProjector::onEnabled()
 {
    Point start = mAnchorPoint + mAnchorNormal * 15;
-   Point end = mAnchorPoint + mAnchorNormal * 500;
 
-   F32 t;
-   Point n;
+   if(!mFieldEndKnown)
+   {
+      mFieldEnd = mAnchorPoint + mAnchorNormal * 500;
 
-   if(findObjectLOS(BarrierType, 0, start, end, t, n))
-      end = start + (end - start) * t;
+      F32 t;
+      Point n;
+
+      if(findObjectLOS(BarrierType, 0, start, mFieldEnd, t, n))
+         mFieldEnd = start + (mFieldEnd - start) * t;
+      mFieldEndKnown = true;
+   }
 
-   mField = new ForceField(mTeam, start, end);
+   mField = new ForceField(mTeam, start, mFieldEnd);
    mField->addToGame(getGame());
 }
 
@@ -413,6 +418,8 @@ bool ForceFieldProjector::getCollisionPoly(Vector<Point> &polyPoints)
 
 void ForceFieldProjector::render()
 {
+   if(!getGame()->getGameType())
+      return;
    renderForceFieldProjector(mAnchorPoint, mAnchorNormal, getGame()->getGameType()->getTeamColor(getTeam()), isEnabled());
 }
 
@@ -525,6 +532,8 @@ bool ForceField::getCollisionPoly(Vector<Point> &p)
 
 void ForceField::render()
 {
+   if(!getGame()->getGameType())
+      return;
    Color c = getGame()->getGameType()->getTeamColor(mTeam);
    renderForceField(mStart, mEnd, c, mFieldUp);
 }
@@ -596,6 +605,10 @@ void Turret::idle(IdleCallPath path)
    Point aimPos = mAnchorPoint + mAnchorNormal * TurretAimOffset;
    Point cross(mAnchorNormal.y, -mAnchorNormal.x);
 
+   // barriers are all in place by the first tick, and never move.
+   if(!mOcclusion.isBuilt())
+      mOcclusion.build(getGame()->getGridDatabase(), aimPos, TurretPerceptionDistance * 1.5f);
+
    Rect queryRect(aimPos, aimPos);
    queryRect.unionPoint(aimPos + cross * TurretPerceptionDistance);
    queryRect.unionPoint(aimPos - cross * TurretPerceptionDistance);
@@ -648,16 +661,25 @@ void Turret::idle(IdleCallPath path)
       if(angleCheck.dot(mAnchorNormal) <= -0.1f)
          continue;
 
-      // See if we can see it...
+      // See if we can see it...  The occlusion map settles this without a
+      // ray cast unless the target is right by a barrier's outline.
       Point n;
-      if(findObjectLOS(BarrierType, 0, aimPos, potential->getActualPos(), t, n))
+      OcclusionMap::Visibility visibility = mOcclusion.test(potential->getActualPos());
+      if(visibility == OcclusionMap::Hidden)
+         continue;
+      if(visibility == OcclusionMap::Unknown && findObjectLOS(BarrierType, 0, aimPos, potential->getActualPos(), t, n))
          continue;
 
-      // See if we're gonna clobber our own stuff...
+      // See if we're gonna clobber our own stuff...  If no barrier can be
+      // in the line of fire, only the moving and engineered objects need
+      // testing.
       disableCollision();
       Point delta2 = delta;
       delta2.normalize(TurretRange);
-      GameObject *hitObject = findObjectLOS(ShipType | BarrierType | EngineeredType, 0, aimPos, aimPos + delta2, t, n);
+      U32 blockerMask = ShipType | EngineeredType;
+      if(mOcclusion.getClearDistance(delta2) < TurretRange)
+         blockerMask |= BarrierType;
+      GameObject *hitObject = findObjectLOS(blockerMask, 0, aimPos, aimPos + delta2, t, n);
       enableCollision();
 
       if(hitObject && hitObject->getTeam() == mTeam)
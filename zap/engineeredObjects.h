@@ -30,6 +30,7 @@
 #include "gameObject.h"
 #include "item.h"
 #include "barrier.h"
+#include "occlusionMap.h"
 
 namespace Zap
 {
@@ -115,9 +116,11 @@ class ForceFieldProjector : public EngineeredObject
    typedef EngineeredObject Parent;
 
    SafePtr<ForceField> mField;
+   Point mFieldEnd;        ///< Where the field meets a barrier; barriers never move, so it's found once.
+   bool mFieldEndKnown;
 public:
    ForceFieldProjector(S32 team = -1, Point anchorPoint = Point(), Point anchorNormal = Point()) :
-      EngineeredObject(team, anchorPoint, anchorNormal) { mNetFlags.set(Ghostable); }
+      EngineeredObject(team, anchorPoint, anchorNormal) { mNetFlags.set(Ghostable); mFieldEndKnown = false; }
 
    bool getCollisionPoly(Vector<Point> &polyPoints);
    void render();
@@ -131,6 +134,7 @@ class Turret : public EngineeredObject
    typedef EngineeredObject Parent;
    Timer mFireTimer;
    F32 mCurrentAngle;
+   OcclusionMap mOcclusion;   ///< Barrier visibility from the aim point, built on the first server tick.
 
 public:
    enum {
@@ -0,0 +1,55 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "fieldCodingStats.h"
+#include "gameConnection.h"
+#include "tnlLog.h"
+
+namespace Zap
+{
+
+void logFieldCodingStats()
+{
+   ConnectionFieldCoder::Stats total;
+   for(GameConnection *walk = GameConnection::getClientList(); walk; walk = walk->getNextClient())
+   {
+      ConnectionFieldCoder *coder = walk->getFieldCoder();
+      if(!coder)
+         continue;
+      const ConnectionFieldCoder::Stats &stats = coder->getStats();
+      total.packets += stats.packets;
+      total.symbols += stats.symbols;
+      total.symbolBits += stats.symbolBits;
+      total.codedBits += stats.codedBits;
+      total.blockBits += stats.blockBits;
+   }
+   if(total.symbols)
+      logprintf("   field coding: %d values in %d packets, %.2f bits each coded (%.2f before block overhead), %.2f written directly",
+         total.symbols, total.packets, F32(total.blockBits) / total.symbols,
+         F32(total.codedBits) / total.symbols, F32(total.symbolBits) / total.symbols);
+}
+
+};
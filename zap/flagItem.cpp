@@ -43,7 +43,13 @@ FlagItem::FlagItem(Point pos) : Item(pos, false, 20)
 
 void FlagItem::onAddedToGame(Game *theGame)
 {
-   theGame->getGameType()->addFlag(this);
+   if(theGame->getGameType())
+      onGameTypeAdded(theGame->getGameType());
+}
+
+void FlagItem::onGameTypeAdded(GameType *theGameType)
+{
+   theGameType->addFlag(this);
 }
 
 
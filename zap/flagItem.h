@@ -39,6 +39,7 @@ class FlagItem : public Item
 public:
    FlagItem(Point pos = Point());
    void onAddedToGame(Game *theGame);
+   void onGameTypeAdded(GameType *theGameType);
    void processArguments(S32 argc, const char **argv);
    void renderItem(Point pos);
    void sendHome();
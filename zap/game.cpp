@@ -29,6 +29,8 @@
 #include "../tnl/tnlRandom.h"
 #include "../tnl/tnlGhostConnection.h"
 #include "../tnl/tnlNetInterface.h"
+#include "../tnl/tnlByteBuffer.h"
+#include "../tnl/tnlThread.h"
 #include "gameNetInterface.h"
 #include "masterConnection.h"
 #include "glutInclude.h"
@@ -42,6 +44,7 @@ using namespace TNL;
 #include "sparkManager.h"
 #include "barrier.h"
 #include "gameLoader.h"
+#include "levelFile.h"
 #include "gameType.h"
 #include "sfx.h"
 #include "gameObjectRender.h"
@@ -94,6 +97,10 @@ U32 Game::getTeamCount()
 void Game::setGameType(GameType *theGameType)
 {
    mGameType = theGameType;
+
+   if(theGameType)
+      for(S32 i = 0; i < mGameObjects.size(); i++)
+         mGameObjects[i]->onGameTypeAdded(theGameType);
 }
 
 void Game::checkConnectionToMaster(U32 timeDelta)
@@ -126,38 +133,44 @@ void Game::addToDeleteList(GameObject *theObject, U32 delay)
 
 void Game::processDeleteList(U32 timeDelta)
 {
-   for(S32 i = 0; i < mPendingDeleteObjects.size(); )
+   // Delete everything that has expired in a single pass, sliding the
+   // survivors down so the list keeps its storage from tick to tick.
+   S32 count = 0;
+   for(S32 i = 0; i < mPendingDeleteObjects.size(); i++)
    {
       if(timeDelta > mPendingDeleteObjects[i].delay)
       {
          GameObject *g = mPendingDeleteObjects[i].theObject;
          delete g;
-         mPendingDeleteObjects.erase_fast(i);
       }
       else
       {
          mPendingDeleteObjects[i].delay -= timeDelta;
-         i++;
+         if(count != i)
+            mPendingDeleteObjects[count] = mPendingDeleteObjects[i];
+         count++;
       }
    }
+   while(mPendingDeleteObjects.size() > count)
+      mPendingDeleteObjects.pop_back();
 }
 
 void Game::addToGameObjectList(GameObject *theObject)
 {
+   theObject->mGameObjectIndex = mGameObjects.size();
    mGameObjects.push_back(theObject);
 }
 
 void Game::removeFromGameObjectList(GameObject *theObject)
 {
-   for(S32 i = 0; i < mGameObjects.size(); i++)
-   {
-      if(mGameObjects[i] == theObject)
-      {
-         mGameObjects.erase_fast(i);
-         return;
-      }
-   }
-   TNLAssert(0, "Object not in game's list!");
+   S32 index = theObject->mGameObjectIndex;
+   TNLAssert(index >= 0 && index < mGameObjects.size() && mGameObjects[index] == theObject,
+      "Object not in game's list!");
+
+   mGameObjects.erase_fast(index);
+   if(index < mGameObjects.size())
+      mGameObjects[index]->mGameObjectIndex = index;
+   theObject->mGameObjectIndex = -1;
 }
 
 void Game::deleteObjects(U32 typeMask)
@@ -181,6 +194,45 @@ Rect Game::computeWorldObjectExtents()
 //-----------------------------------------------------------------------------------
 //-----------------------------------------------------------------------------------
 
+/// Reads level files on its own thread, one request at a time, so the game
+/// thread doesn't wait on the disk.
+class LevelReadThread : public Thread
+{
+public:
+   char mSourceFile[256];
+   char mCompiledFile[256];
+   U8 *mSource;
+   U32 mSourceSize;
+   U8 *mCompiled;
+   U32 mCompiledSize;
+   volatile bool mStopRequested;
+   Semaphore mRequest;
+   Semaphore mDone;
+
+   LevelReadThread() : mRequest(0), mDone(0)
+   {
+      mSource = mCompiled = NULL;
+      mSourceSize = mCompiledSize = 0;
+      mStopRequested = false;
+   }
+
+   U32 run()
+   {
+      for(;;)
+      {
+         mRequest.wait();
+         if(mStopRequested)
+         {
+            mDone.increment();
+            return 0;
+         }
+         mSource = readLevelFileData(mSourceFile, mSourceSize);
+         mCompiled = readLevelFileData(mCompiledFile, mCompiledSize);
+         mDone.increment();
+      }
+   }
+};
+
 ServerGame::ServerGame(const Address &theBindAddress, U32 maxPlayers, const char *hostName)
  : Game(theBindAddress)
 {
@@ -189,6 +241,25 @@ ServerGame::ServerGame(const Address &theBindAddress, U32 maxPlayers, const char
    mHostName = hostName;
 
    mNetInterface->setAllowsConnections(true);
+
+   mPrefetchIndex = -1;
+   mPrefetchPending = false;
+   mPrefetchSource = NULL;
+   mPrefetchSourceSize = 0;
+   mPrefetchCompiled = NULL;
+   mPrefetchCompiledSize = 0;
+   mLevelReadThread = new LevelReadThread;
+   mLevelReadThread->start();
+}
+
+ServerGame::~ServerGame()
+{
+   freePrefetchedLevel();
+
+   mLevelReadThread->mStopRequested = true;
+   mLevelReadThread->mRequest.increment();
+   mLevelReadThread->mDone.wait();
+   delete mLevelReadThread;
 }
 
 void ServerGame::setLevelList(const char *levelList)
@@ -210,16 +281,36 @@ void ServerGame::setLevelList(const char *levelList)
    }
    for(S32 i = 0; i < mLevelList.size(); i++)
    {
-      loadLevel(mLevelList[i].getString());
-      StringTableEntry name = getGameType()->mLevelName;
-      StringTableEntry type(getGameType()->getGameTypeString()); 
+      StringTableEntry name;
+      StringTableEntry type;
+
+      // read the name and type from the compiled level's index if there
+      // is an up to date one (see -compilelevels), and from the text level
+      // if there isn't.
+      char sourceFile[256];
+      char compiledFile[256];
+      getLevelFileNames(mLevelList[i].getString(), sourceFile, compiledFile);
+
+      LevelFileIndex index;
+      if(readLevelFileIndex(compiledFile, computeLevelSourceCRC(sourceFile), index))
+      {
+         name = index.levelName;
+         type = index.gameType;
+      }
+      else
+      {
+         loadLevel(i);
+         name = getGameType()->mLevelName;
+         type.set(getGameType()->getGameTypeString());
+
+         // delete any objects that may exist
+         while(mGameObjects.size())
+            delete mGameObjects[0];
+
+         mScopeAlwaysList.clear();
+      }
       mLevelNames.push_back(name);
       mLevelTypes.push_back(type);
-      // delete any objects that may exist
-      while(mGameObjects.size())
-         delete mGameObjects[0];
-
-      mScopeAlwaysList.clear();
       logprintf ("Added level %s of type %s", name.getString(), type.getString());
    }
 
@@ -254,7 +345,7 @@ void ServerGame::cycleLevel(S32 nextLevel)
       mCurrentLevelIndex++;
    if(S32(mCurrentLevelIndex) >= mLevelList.size())
       mCurrentLevelIndex = 0;
-   loadLevel(mLevelList[mCurrentLevelIndex].getString());
+   loadLevel(mCurrentLevelIndex);
    Vector<GameConnection *> connectionList;
 
    for(GameConnection *walk = GameConnection::getClientList(); walk ; walk = walk->getNextClient())
@@ -263,7 +354,7 @@ void ServerGame::cycleLevel(S32 nextLevel)
    // now add the connections to the game type, in a random order
    while(connectionList.size())
    {
-      U32 index = Random::readI() % connectionList.size();
+      U32 index = FastRandom::get().readI() % connectionList.size();
       GameConnection *gc = connectionList[index];
       connectionList.erase(index);
 
@@ -273,21 +364,78 @@ void ServerGame::cycleLevel(S32 nextLevel)
    }
 }
 
-void ServerGame::loadLevel(const char *fileName)
+void ServerGame::getLevelFileNames(const char *fileName, char sourceFile[256], char compiledFile[256])
 {
-   mGridSize = DefaultGridSize;
-   char fileBuffer[256];
 #ifdef TNL_OS_XBOX
-   dSprintf(fileBuffer, sizeof(fileBuffer), "d:\\media\\levels\\%s", fileName);
+   dSprintf(sourceFile, 256, "d:\\media\\levels\\%s", fileName);
 #else
-   dSprintf(fileBuffer, sizeof(fileBuffer), "levels/%s", fileName);
+   dSprintf(sourceFile, 256, "levels/%s", fileName);
 #endif
-   initLevelFromFile(fileBuffer);
+   getCompiledLevelFileName(sourceFile, compiledFile, 256);
+}
+
+void ServerGame::prefetchLevel(S32 levelIndex)
+{
+   freePrefetchedLevel();
+
+   getLevelFileNames(mLevelList[levelIndex].getString(),
+      mLevelReadThread->mSourceFile, mLevelReadThread->mCompiledFile);
+   mPrefetchIndex = levelIndex;
+   mPrefetchPending = true;
+   mLevelReadThread->mRequest.increment();
+}
+
+void ServerGame::finishPrefetch()
+{
+   if(!mPrefetchPending)
+      return;
+
+   mLevelReadThread->mDone.wait();
+   mPrefetchPending = false;
+   mPrefetchSource = mLevelReadThread->mSource;
+   mPrefetchSourceSize = mLevelReadThread->mSourceSize;
+   mPrefetchCompiled = mLevelReadThread->mCompiled;
+   mPrefetchCompiledSize = mLevelReadThread->mCompiledSize;
+   if(!mPrefetchSource && !mPrefetchCompiled)
+      logprintf("Unable to open level file %s!!", mLevelReadThread->mSourceFile);
+}
+
+void ServerGame::freePrefetchedLevel()
+{
+   finishPrefetch();
+   free(mPrefetchSource);
+   free(mPrefetchCompiled);
+   mPrefetchIndex = -1;
+   mPrefetchSource = NULL;
+   mPrefetchSourceSize = 0;
+   mPrefetchCompiled = NULL;
+   mPrefetchCompiledSize = 0;
+}
+
+void ServerGame::loadLevel(S32 levelIndex)
+{
+   mGridSize = DefaultGridSize;
+
+   // normally the files were read while the previous level was running.
+   if(mPrefetchIndex != levelIndex)
+      prefetchLevel(levelIndex);
+   finishPrefetch();
+
+   U32 sourceCRC = mPrefetchSource ? ByteBuffer(mPrefetchSource, mPrefetchSourceSize).calculateCRC() : 0;
+   bool compiled = mPrefetchCompiled &&
+      initLevelFromCompiledData(mPrefetchCompiled, mPrefetchCompiledSize, sourceCRC);
+   if(!compiled && mPrefetchSource)
+      parseArgs((const char *) mPrefetchSource);
+   freePrefetchedLevel();
+
    if(!getGameType())
    {
       GameType *g = new GameType;
       g->addToGame(this);
    }
+
+   if(mGameObjects.size())
+      getGameType()->setWorldExtents(computeWorldObjectExtents());
 }
 
 void ServerGame::processLevelLoadLine(int argc, const char **argv)
@@ -299,19 +447,43 @@ void ServerGame::processLevelLoadLine(int argc, const char **argv)
       mGridSize = atof(argv[1]);
    }
    else if(mGameType.isNull() || !mGameType->processLevelItem(argc, argv))
+      addLevelObject(TNL::Object::create(argv[0]), argc, argv);
+}
+
+void ServerGame::processLevelObject(U32 classId, int argc, const char **argv)
+{
+   addLevelObject(TNL::Object::create(NetClassGroupGame, NetClassTypeObject, classId), argc, argv);
+}
+
+void ServerGame::processLevelBarrier(F32 width, const Vector<F32> &verts, const Vector<Point> &barrierEnds, int argc, const char **argv)
+{
+   if(mGameType.isNull())
+      return;
+
+   GameType::BarrierRec barrier;
+   barrier.width = width;
+   barrier.verts = verts;
+   mGameType->mBarriers.push_back(barrier);
+
+   for(S32 i = 0; i < barrierEnds.size(); i += 2)
    {
-      TNL::Object *theObject = TNL::Object::create(argv[0]);
-      GameObject *object = dynamic_cast<GameObject*>(theObject);
-      if(!object)
-      {
-         logprintf("Invalid object type in level file: %s", argv[0]);
-         delete theObject;
-      }
-      else
-      {
-         object->addToGame(this);
-         object->processArguments(argc - 1, argv + 1);
-      }
+      Barrier *b = new Barrier(barrierEnds[i], barrierEnds[i+1], width);
+      b->addToGame(this);
+   }
+}
+
+void ServerGame::addLevelObject(TNL::Object *theObject, int argc, const char **argv)
+{
+   GameObject *object = dynamic_cast<GameObject*>(theObject);
+   if(!object)
+   {
+      logprintf("Invalid object type in level file: %s", argv[0]);
+      delete theObject;
+   }
+   else
+   {
+      object->addToGame(this);
+      object->processArguments(argc - 1, argv + 1);
    }
 }
 
@@ -354,9 +526,12 @@ void ServerGame::idle(U32 timeDelta)
 
    processDeleteList(timeDelta);
    mNetInterface->processConnections();
+   StringTable::compact();
 
    if(mLevelSwitchTimer.update(timeDelta))
       cycleLevel();
+   else if(mPrefetchIndex == -1 && mLevelList.size())
+      prefetchLevel((mCurrentLevelIndex + 1) % mLevelList.size());
 }
 
 void ServerGame::gameEnded()
@@ -375,8 +550,8 @@ ClientGame::ClientGame(const Address &bindAddress)
    // create random stars
    for(U32 i = 0; i < NumStars; i++)
    {
-      mStars[i].x = Random::readF();
-      mStars[i].y = Random::readF();
+      mStars[i].x = FastRandom::get().readF();
+      mStars[i].y = FastRandom::get().readF();
    }
 }
 
@@ -428,10 +603,15 @@ void ClientGame::idle(U32 timeDelta)
          mCommanderZoomDelta = CommanderMapZoomTime;
    }
 
+#ifndef ZAP_DEDICATED
    Move *theMove = gGameUserInterface.getCurrentMove();
 
    if(OptionsMenuUserInterface::joystickType != -1)
       JoystickUpdateMove(theMove);
+#else
+   Move headlessMove;
+   Move *theMove = &headlessMove;
+#endif
 
    theMove->time = timeDelta;
 
@@ -451,6 +631,7 @@ void ClientGame::idle(U32 timeDelta)
          {
             mGameObjects[i]->setCurrentMove(*theMove);
             mGameObjects[i]->idle(GameObject::ClientIdleControlMain);
+            mConnectionToServer->recordPendingMoveState();
          }
          else
          {
@@ -599,7 +780,9 @@ void ClientGame::renderCommander()
 
    F32 zoomFrac = getCommanderZoomFraction();
    // Set up the view to show the whole level.
-   Rect worldBounds = computeWorldObjectExtents();
+   GameType *theGameType = getGameType();
+   Rect worldBounds = theGameType && theGameType->hasWorldExtents() ?
+      theGameType->getWorldExtents() : computeWorldObjectExtents();
    mWorldBounds = worldBounds;
 
    Point worldCenter = worldBounds.getCenter();
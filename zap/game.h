@@ -156,6 +156,8 @@ public:
    void processDeleteList(U32 timeDelta);
 };
 
+class LevelReadThread;
+
 class ServerGame : public Game, public LevelLoader
 {
    enum {
@@ -171,6 +173,21 @@ class ServerGame : public Game, public LevelLoader
 
    U32 mCurrentLevelIndex;
    Timer mLevelSwitchTimer;
+
+   /// The files of the next level are read ahead of time on
+   /// mLevelReadThread, while the current level is running, so cycleLevel
+   /// only has to create the objects from memory.
+   LevelReadThread *mLevelReadThread;
+   S32 mPrefetchIndex;
+   bool mPrefetchPending;
+   U8 *mPrefetchSource;
+   U32 mPrefetchSourceSize;
+   U8 *mPrefetchCompiled;
+   U32 mPrefetchCompiledSize;
+
+   void prefetchLevel(S32 levelIndex);
+   void finishPrefetch();
+   void freePrefetchedLevel();
 public:
    U32 getPlayerCount() { return mPlayerCount; }
    U32 getMaxPlayers() { return mMaxPlayers; }
@@ -180,13 +197,18 @@ public:
    void addClient(GameConnection *theConnection);
    void removeClient(GameConnection *theConnection);
    ServerGame(const Address &theBindAddress, U32 maxPlayers, const char *hostName);
+   ~ServerGame();
 
    void setLevelList(const char *levelList);
-   void loadLevel(const char *fileName);
+   void loadLevel(S32 levelIndex);
    void cycleLevel(S32 newLevelIndex = -1);
    StringTableEntry getLevelName(S32 index);
 
    void processLevelLoadLine(int argc, const char **argv);
+   void processLevelObject(U32 classId, int argc, const char **argv);
+   void processLevelBarrier(F32 width, const Vector<F32> &verts, const Vector<Point> &barrierEnds, int argc, const char **argv);
+   void addLevelObject(TNL::Object *theObject, int argc, const char **argv);
+   void getLevelFileNames(const char *fileName, char sourceFile[256], char compiledFile[256]);
    bool isServer() { return true; }
    void idle(U32 timeDelta);
    void gameEnded();
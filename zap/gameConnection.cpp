@@ -40,6 +40,7 @@ GameConnection GameConnection::gClientList;
 
 extern const char *gServerPassword;
 extern const char *gAdminPassword;
+extern bool gFieldCoding;
 
 TNL_IMPLEMENT_NETCONNECTION(GameConnection, NetClassGroupGame, true);
 
@@ -47,6 +48,7 @@ GameConnection::GameConnection()
 {
    mNext = mPrev = this;
    setTranslatesStrings();
+   setFieldCoding(gFieldCoding);
    mInCommanderMap = false;
    mIsAdmin = false;
 }
@@ -196,7 +198,9 @@ static void displayMessage(U32 colorIndex, U32 sfxEnum, const char *message)
       Color(1,1,0),
       Color(0.6f, 1, 0.8f),
    };
+#ifndef ZAP_DEDICATED
    gGameUserInterface.displayMessage(colors[colorIndex], "%s", message);
+#endif
    if(sfxEnum != SFXNone)
       SFXObject::play(sfxEnum);
 }
@@ -320,8 +324,13 @@ TNL_IMPLEMENT_RPC(GameConnection, c2sRequestLevelChange, (S32 newLevelIndex), (n
 void GameConnection::writeConnectRequest(BitStream *stream)
 {
    Parent::writeConnectRequest(stream);
+   writeStringTableRequest(stream);
 
+#ifndef ZAP_DEDICATED
    stream->writeString(gPasswordEntryUserInterface.getText());
+#else
+   stream->writeString(gServerPassword ? gServerPassword : "");
+#endif
    stream->writeString(mClientName.getString());
 }
 
@@ -329,6 +338,7 @@ bool GameConnection::readConnectRequest(BitStream *stream, const char **errorStr
 {
    if(!Parent::readConnectRequest(stream, errorString))
       return false;
+   readStringTableRequest(stream);
 
    if(gServerGame->isFull())
    {
@@ -384,9 +394,46 @@ checkPlayerName:
    }
 
    mClientName = name;
+   seedStringTable();
    return true;
 }
 
+void GameConnection::writeConnectAccept(BitStream *stream)
+{
+   Parent::writeConnectAccept(stream);
+   writeStringTableAccept(stream);
+}
+
+bool GameConnection::readConnectAccept(BitStream *stream, const char **errorString)
+{
+   if(!Parent::readConnectAccept(stream, errorString))
+      return false;
+   readStringTableAccept(stream);
+   return true;
+}
+
+void GameConnection::seedStringTable()
+{
+   // Names the client is certain to see early on are sent with the connect
+   // accept, so they never cross the wire in full during play.
+   ConnectionStringTable *table = getStringTable();
+   if(!table || !table->addSeed(mClientName))
+      return;
+
+   for(GameConnection *walk = getClientList(); walk; walk = walk->getNextClient())
+      if(!table->addSeed(walk->mClientName))
+         return;
+
+   GameType *gt = gServerGame->getGameType();
+   if(!gt)
+      return;
+   if(!table->addSeed(gt->mLevelName) || !table->addSeed(gt->mLevelDescription))
+      return;
+   for(S32 i = 0; i < gt->mTeams.size(); i++)
+      if(!table->addSeed(gt->mTeams[i].name))
+         return;
+}
+
 void GameConnection::onConnectionEstablished()
 {
    Parent::onConnectionEstablished();
@@ -414,16 +461,28 @@ void GameConnection::onConnectionTerminated(NetConnection::TerminationReason r,
 {
    if(isInitiator())
    {
+#ifndef ZAP_DEDICATED
       gMainMenuUserInterface.activate();
+#endif
    }
    else
    {
+      ConnectionStringTable *table = getStringTable();
+      if(table)
+      {
+         const ConnectionStringTable::Stats &stats = table->getStats();
+         U32 lookups = stats.hits + stats.misses + stats.unconfirmed;
+         logprintf("%s - string table: %d hits, %d misses, %d unconfirmed, %d seeded, %.1f%% hit rate, %d bytes saved.",
+            getNetAddressString(), stats.hits, stats.misses, stats.unconfirmed, stats.seeds,
+            lookups ? stats.hits * 100.0f / lookups : 0.0f, stats.bytesSaved);
+      }
       gServerGame->removeClient(this);
    }
 }
 
 void GameConnection::onConnectTerminated(TerminationReason r, const char *string)
 {
+#ifndef ZAP_DEDICATED
    if(isInitiator())
    {
       if(!strcmp(string, "PASSWORD"))
@@ -434,6 +493,7 @@ void GameConnection::onConnectTerminated(TerminationReason r, const char *string
       else
          gMainMenuUserInterface.activate();
    }
+#endif
 }
 
 };
@@ -116,6 +116,9 @@ public:
    const Vector<U32> &getLoadout() { return mLoadout; }
    void writeConnectRequest(BitStream *stream);
    bool readConnectRequest(BitStream *stream, const char **errorString);
+   void writeConnectAccept(BitStream *stream);
+   bool readConnectAccept(BitStream *stream, const char **errorString);
+   void seedStringTable();
 
    void onConnectionEstablished();
 
@@ -25,8 +25,11 @@
 //------------------------------------------------------------------------------------
 
 #include "gameLoader.h"
+#include "levelFile.h"
 #include "tnl.h"
 #include "tnlLog.h"
+#include "tnlEndian.h"
+#include "tnlNetBase.h"
 
 #include <stdio.h>
 
@@ -164,24 +167,208 @@ stateLineParseDone:
    return numObjects;
 }      
 
-void LevelLoader::initLevelFromFile(const char *file)
+U8 *readLevelFileData(const char *file, U32 &size)
 {
-   FILE *f = fopen(file, "r");
+   FILE *f = fopen(file, "rb");
    if(!f)
+      return NULL;
+
+   fseek(f, 0, SEEK_END);
+   long fileSize = ftell(f);
+   fseek(f, 0, SEEK_SET);
+   if(fileSize < 0)
    {
-      logprintf("Unable to open level file %s!!", file);
-      return;
+      fclose(f);
+      return NULL;
    }
 
-   char fileData[32768];
+   U8 *data = (U8 *) malloc(fileSize + 1);
+   size = fread(data, 1, fileSize, f);
+   data[size] = 0;
+
+   fclose(f);
+   return data;
+}
 
-   size_t bytesRead = fread(fileData, 1, sizeof(fileData), f);
-   fileData[bytesRead] = 0;
+void LevelLoader::initLevelFromFile(const char *file)
+{
+   U32 size;
+   char *fileData = (char *) readLevelFileData(file, size);
+   if(!fileData)
+   {
+      logprintf("Unable to open level file %s!!", file);
+      return;
+   }
 
    parseArgs(fileData);
+   free(fileData);
+}
 
-   fclose(f);
+void LevelLoader::processLevelObject(U32 classId, int argc, const char **argv)
+{
+   processLevelLoadLine(argc, argv);
 }
 
+void LevelLoader::processLevelBarrier(F32 width, const Vector<F32> &verts, const Vector<Point> &barrierEnds, int argc, const char **argv)
+{
+   processLevelLoadLine(argc, argv);
+}
+
+/// Bounds checked reader over the words of a compiled level.
+struct LevelFileReader
+{
+   const U8 *data;
+   U32 size;
+   U32 offset;
+   bool error;
+
+   LevelFileReader(const U8 *d, U32 s, U32 o) { data = d; size = s; offset = o; error = false; }
+
+   U32 readU32()
+   {
+      if(offset + sizeof(U32) > size)
+      {
+         error = true;
+         return 0;
+      }
+      U32 value;
+      memcpy(&value, data + offset, sizeof(U32));
+      offset += sizeof(U32);
+      return convertLEndianToHost(value);
+   }
+   F32 readF32()
+   {
+      U32 value = readU32();
+      F32 ret;
+      memcpy(&ret, &value, sizeof(F32));
+      return ret;
+   }
 };
 
+/// Finds the id of a class in the game class group.  The id stored in the
+/// level is tried first, and the class table is only searched if that class
+/// has since been renumbered.
+static S32 resolveLevelClass(const char *className, U32 classId)
+{
+   U32 count = NetClassRep::getNetClassCount(NetClassGroupGame, NetClassTypeObject);
+   if(classId < count && !strcmp(NetClassRep::getClass(NetClassGroupGame, NetClassTypeObject, classId)->getClassName(), className))
+      return classId;
+
+   for(U32 i = 0; i < count; i++)
+      if(!strcmp(NetClassRep::getClass(NetClassGroupGame, NetClassTypeObject, i)->getClassName(), className))
+         return i;
+   return -1;
+}
+
+bool LevelLoader::initLevelFromCompiledFile(const char *file, U32 sourceCRC)
+{
+   U32 size;
+   U8 *data = readLevelFileData(file, size);
+   if(!data)
+      return false;
+
+   bool ret = initLevelFromCompiledData(data, size, sourceCRC);
+   free(data);
+   return ret;
+}
+
+bool LevelLoader::initLevelFromCompiledData(const U8 *data, U32 size, U32 sourceCRC)
+{
+   LevelFileHeader header;
+   if(size < sizeof(header))
+      return false;
+   memcpy(&header, data, sizeof(header));
+   header.convertEndian();
+
+   if(header.magic != LevelFileHeader::Magic || header.version != LevelFileHeader::Version ||
+      (sourceCRC && header.sourceCRC != sourceCRC) || header.fileSize != size ||
+      header.stringPoolSize == 0 || header.stringPoolOffset + header.stringPoolSize > size ||
+      data[header.stringPoolOffset + header.stringPoolSize - 1] != 0)
+      return false;
+   const char *stringPool = (const char *) data + header.stringPoolOffset;
+
+   // resolve the class table up front, so objects are created by id.
+   Vector<S32> classIds;
+   LevelFileReader reader(data, size, header.classOffset);
+   for(U32 i = 0; i < header.classCount; i++)
+   {
+      U32 nameOffset = reader.readU32();
+      U32 classId = reader.readU32();
+      if(reader.error || nameOffset >= header.stringPoolSize)
+         return false;
+      S32 resolvedId = resolveLevelClass(stringPool + nameOffset, classId);
+      if(resolvedId == -1)
+         logprintf("Invalid object type in level file: %s", stringPool + nameOffset);
+      classIds.push_back(resolvedId);
+   }
+
+   const char *args[MaxArgc];
+   Vector<F32> verts;
+   Vector<Point> barrierEnds;
+
+   // the records are read through once without loading anything, so a
+   // truncated level is rejected rather than left half loaded.
+   for(U32 pass = 0; pass < 2; pass++)
+   {
+      bool load = pass == 1;
+      reader.offset = header.recordOffset;
+      for(U32 i = 0; i < header.recordCount && !reader.error; i++)
+      {
+         U32 kind = reader.readU32();
+         U32 classIndex = reader.readU32();
+         U32 argCount = reader.readU32();
+         if(argCount == 0 || argCount > MaxArgc)
+         {
+            reader.error = true;
+            break;
+         }
+         for(U32 j = 0; j < argCount; j++)
+         {
+            U32 stringOffset = reader.readU32();
+            args[j] = stringOffset < header.stringPoolSize ? stringPool + stringOffset : "";
+         }
+         if(reader.error)
+            break;
+
+         switch(kind)
+         {
+            case LevelFileHeader::RecordObject:
+               if(load && classIndex < U32(classIds.size()) && classIds[classIndex] != -1)
+                  processLevelObject(classIds[classIndex], argCount, args);
+               break;
+            case LevelFileHeader::RecordBarrierMaker:
+            {
+               F32 width = reader.readF32();
+               U32 vertCount = reader.readU32();
+               verts.clear();
+               for(U32 j = 0; j < vertCount && !reader.error; j++)
+                  verts.push_back(reader.readF32());
+               U32 endCount = reader.readU32();
+               barrierEnds.clear();
+               for(U32 j = 0; j < endCount && !reader.error; j++)
+               {
+                  Point p;
+                  p.x = reader.readF32();
+                  p.y = reader.readF32();
+                  barrierEnds.push_back(p);
+               }
+               if(load && !reader.error)
+                  processLevelBarrier(width, verts, barrierEnds, argCount, args);
+               break;
+            }
+            default:
+               if(load)
+                  processLevelLoadLine(argCount, args);
+               break;
+         }
+      }
+      if(reader.error)
+      {
+         logprintf("Compiled level is truncated.");
+         return false;
+      }
+   }
+   return true;
+}
+
+};
@@ -26,6 +26,12 @@
 #ifndef _GAMELOADER_H_
 #define _GAMELOADER_H_
 
+#include "tnlTypes.h"
+#include "tnlVector.h"
+#include "point.h"
+
+using namespace TNL;
+
 namespace Zap
 {
 
@@ -34,11 +40,35 @@ class LevelLoader
 protected:
    virtual void processLevelLoadLine(int argc, const char **argv) = 0;
 
+   /// Called for each object in a compiled level, with the object's class
+   /// id in the game class group already resolved.  By default the line
+   /// is handed to processLevelLoadLine.
+   virtual void processLevelObject(U32 classId, int argc, const char **argv);
+
+   /// Called for each BarrierMaker in a compiled level with the barrier
+   /// segments (start/end pairs) already constructed.  By default the
+   /// line is handed to processLevelLoadLine.
+   virtual void processLevelBarrier(F32 width, const Vector<F32> &verts, const Vector<Point> &barrierEnds, int argc, const char **argv);
+
    int parseArgs(const char *string);
 public:
    void initLevelFromFile(const char *file);
+
+   /// Loads a level compiled with compileLevelFile.  Returns false, without
+   /// processing anything, if the file is missing, invalid or was not
+   /// compiled from a source with the given CRC (0 accepts any source).
+   bool initLevelFromCompiledFile(const char *file, U32 sourceCRC);
+
+   /// Loads a compiled level image already read into memory, as
+   /// initLevelFromCompiledFile does.  A damaged image is rejected before
+   /// any of the level is loaded.
+   bool initLevelFromCompiledData(const U8 *data, U32 size, U32 sourceCRC);
 };
 
+/// Reads an entire file into a newly malloc'd, null terminated buffer.
+/// Returns NULL if the file can't be opened.
+extern U8 *readLevelFileData(const char *file, U32 &size);
+
 };
 
 #endif
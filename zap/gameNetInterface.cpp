@@ -25,7 +25,7 @@
 //------------------------------------------------------------------------------------
 
 #include "gameNetInterface.h"
-#include "UIQueryServers.h"
+#include "serverBrowser.h"
 #include "game.h"
 
 namespace Zap
@@ -38,6 +38,7 @@ GameNetInterface::GameNetInterface(const Address &bindAddress, Game *theGame)
    : NetInterface(bindAddress)
 {
    mGame = theGame;
+   mServerBrowser = NULL;
 };
 
 void GameNetInterface::banHost(const Address &bannedAddress, U32 bannedMilliseconds)
@@ -84,7 +85,7 @@ void GameNetInterface::handleInfoPacket(const Address &remoteAddress, U8 packetT
    {
       case Ping:
          logprintf("Got ping packet from %s", remoteAddress.toString());
-         if(mGame->isServer())
+         if(mGame && mGame->isServer())
          {
             Nonce clientNonce;
             clientNonce.read(stream);
@@ -103,12 +104,12 @@ void GameNetInterface::handleInfoPacket(const Address &remoteAddress, U8 packetT
          break;
       case PingResponse:
          {
-            logprintf("Got ping response from %s", remoteAddress.toString());
             Nonce theNonce;
             U32 clientIdentityToken;
             theNonce.read(stream);
             stream->read(&clientIdentityToken);
-            gQueryServersUserInterface.gotPingResponse(remoteAddress, theNonce, clientIdentityToken);
+            if(mServerBrowser)
+               mServerBrowser->gotPingResponse(remoteAddress, theNonce, clientIdentityToken);
          }
          break;
       case Query:
@@ -123,7 +124,7 @@ void GameNetInterface::handleInfoPacket(const Address &remoteAddress, U8 packetT
                PacketStream queryResponse;
                queryResponse.write(U8(QueryResponse));
                theNonce.write(&queryResponse);
-               queryResponse.writeString(gServerGame->getHostName(), QueryServersUserInterface::MaxServerNameLen);
+               queryResponse.writeString(gServerGame->getHostName(), ServerBrowser::MaxServerNameLen);
                queryResponse.write(gServerGame->getPlayerCount());
                queryResponse.write(gServerGame->getMaxPlayers());
                queryResponse.writeFlag(gDedicatedServer);
@@ -135,7 +136,6 @@ void GameNetInterface::handleInfoPacket(const Address &remoteAddress, U8 packetT
          break;
       case QueryResponse:
          {
-            logprintf("Got query response from %s", remoteAddress.toString());
             Nonce theNonce;
             char nameString[256];
             U32 playerCount, maxPlayers;
@@ -146,7 +146,8 @@ void GameNetInterface::handleInfoPacket(const Address &remoteAddress, U8 packetT
             stream->read(&maxPlayers);
             dedicated = stream->readFlag();
             passwordRequired = stream->readFlag();
-            gQueryServersUserInterface.gotQueryResponse(remoteAddress, theNonce, nameString, playerCount, maxPlayers, dedicated, passwordRequired);
+            if(mServerBrowser)
+               mServerBrowser->gotQueryResponse(remoteAddress, theNonce, nameString, playerCount, maxPlayers, dedicated, passwordRequired);
          }
          break;
    }
@@ -154,8 +155,6 @@ void GameNetInterface::handleInfoPacket(const Address &remoteAddress, U8 packetT
 
 void GameNetInterface::sendPing(const Address &theAddress, const Nonce &clientNonce)
 {
-   logprintf("pinging server %s...", theAddress.toString());
-
    PacketStream packet;
    packet.write(U8(Ping));
    clientNonce.write(&packet);
@@ -165,8 +164,6 @@ void GameNetInterface::sendPing(const Address &theAddress, const Nonce &clientNo
 
 void GameNetInterface::sendQuery(const Address &theAddress, const Nonce &clientNonce, U32 identityToken)
 {
-   logprintf("querying server %s...", theAddress.toString());
-
    PacketStream packet;
    packet.write(U8(Query));
    clientNonce.write(&packet);
@@ -35,11 +35,13 @@ namespace Zap
 {
 
 class Game;
+class ServerBrowser;
 
 class GameNetInterface : public NetInterface
 {
    typedef NetInterface Parent;
    Game *mGame;
+   ServerBrowser *mServerBrowser;
 
    struct BannedHost {
       Address theAddress;
@@ -55,6 +57,12 @@ public:
       QueryResponse,
    };
    GameNetInterface(const Address &bindAddress, Game *theGame);
+
+   /// Returns the game that connections on this interface play in.
+   Game *getGame() { return mGame; }
+
+   /// Sets the browser that ping and query responses are passed to.
+   void setServerBrowser(ServerBrowser *browser) { mServerBrowser = browser; }
    void handleInfoPacket(const Address &remoteAddress, U8 packetType, BitStream *stream);
    void sendPing(const Address &theAddress, const Nonce &clientNonce);
    void sendQuery(const Address &theAddress, const Nonce &clientNonce, U32 identityToken);
@@ -26,6 +26,7 @@
 
 #include "gameObject.h"
 #include "gameType.h"
+#include "gameNetInterface.h"
 #include "glutInclude.h"
 
 using namespace TNL;
@@ -42,6 +43,7 @@ GameObject::GameObject()
    mDisableCollisionCount = 0;
    mInDatabase = false;
    mCreationTime = 0;
+   mGameObjectIndex = -1;
 }
 
 void GameObject::setOwner(GameConnection *c)
@@ -322,11 +324,19 @@ void GameObject::readControlState(BitStream *)
 {
 }
 
+bool GameObject::controlStateMatches(BitStream *serverState, BitStream *predictedState)
+{
+   U32 bitCount = serverState->getMaxReadBitPosition();
+   if(bitCount != predictedState->getMaxReadBitPosition())
+      return false;
+   return !memcmp(serverState->getBuffer(), predictedState->getBuffer(), (bitCount + 7) >> 3);
+}
+
 void GameObject::controlMoveReplayComplete()
 {
 }
 
-void GameObject::writeCompressedVelocity(Point &vel, U32 max, BitStream *stream)
+void GameObject::writeCompressedVelocity(Point &vel, U32 max, BitStream *stream, CodedField *speedField)
 {
    U32 len = U32(vel.len());
    if(stream->writeFlag(len == 0))
@@ -341,11 +351,14 @@ void GameObject::writeCompressedVelocity(Point &vel, U32 max, BitStream *stream)
    {
       F32 theta = atan2(vel.y, vel.x);
       stream->writeFloat(theta * FloatInverse2Pi, 10);
-      stream->writeRangedU32(len, 0, max);
+      if(speedField)
+         stream->writeCodedRangedU32(len, 0, max, *speedField);
+      else
+         stream->writeRangedU32(len, 0, max);
    }
 }
 
-void GameObject::readCompressedVelocity(Point &vel, U32 max, BitStream *stream)
+void GameObject::readCompressedVelocity(Point &vel, U32 max, BitStream *stream, CodedField *speedField)
 {
    if(stream->readFlag())
    {
@@ -360,7 +373,7 @@ void GameObject::readCompressedVelocity(Point &vel, U32 max, BitStream *stream)
    else
    {
       F32 theta = stream->readFloat(10) * Float2Pi;
-      F32 magnitude = stream->readRangedU32(0, max);
+      F32 magnitude = speedField ? stream->readCodedRangedU32(0, max, *speedField) : stream->readRangedU32(0, max);
       vel.set(cos(theta) * magnitude, sin(theta) * magnitude);
    }
 }
@@ -371,7 +384,7 @@ void GameObject::processArguments(S32 argc, const char**argv)
 
 bool GameObject::onGhostAdd(GhostConnection *theConnection)
 {
-   addToGame(gClientGame);
+   addToGame(((GameNetInterface *) theConnection->getInterface())->getGame());
    return true;
 }
 
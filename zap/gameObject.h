@@ -65,6 +65,7 @@ enum GameObjectType
 
 class GameObject;
 class Game;
+class GameType;
 class GameConnection;
 
 struct DamageInfo
@@ -79,9 +80,11 @@ struct DamageInfo
 class GameObject : public TNL::NetObject
 {
    friend class GridDatabase;
+   friend class Game;
 
    typedef NetObject Parent;
    Game *mGame;
+   S32 mGameObjectIndex; ///< This object's index in its game's object list, for O(1) removal.
    U32 mLastQueryId;
    U32 mCreationTime;
    SafePtr<GameConnection> mControllingClient;
@@ -102,6 +105,10 @@ public:
 
    void addToGame(Game *theGame);
    virtual void onAddedToGame(Game *theGame);
+   /// Called when the game's GameType is set, for objects already in the
+   /// game.  A ghosted GameType can arrive after the objects that
+   /// register with it.
+   virtual void onGameTypeAdded(GameType *theGameType) {}
    void removeFromGame();
 
    Game *getGame() { return mGame; }
@@ -155,13 +162,21 @@ public:
 
    virtual void writeControlState(BitStream *stream);
    virtual void readControlState(BitStream *stream);
+
+   /// Compares two control states written by writeControlState.  Returns
+   /// true if the client's predicted state is close enough to the server's
+   /// that the client does not need to replay its pending moves.
+   virtual bool controlStateMatches(BitStream *serverState, BitStream *predictedState);
+
    virtual F32 getHealth() { return 1; }
    virtual bool isDestroyed() { return false; }
 
    virtual void controlMoveReplayComplete();
 
-   void writeCompressedVelocity(Point &vel, U32 max, BitStream *stream);
-   void readCompressedVelocity(Point &vel, U32 max, BitStream *stream);
+   /// Writes a velocity as a direction and a speed of up to max.  Classes
+   /// whose speeds are skewed pass a speedField to code the speed against.
+   void writeCompressedVelocity(Point &vel, U32 max, BitStream *stream, CodedField *speedField = NULL);
+   void readCompressedVelocity(Point &vel, U32 max, BitStream *stream, CodedField *speedField = NULL);
 
    virtual Point getRenderPos();
    virtual Point getActualPos();
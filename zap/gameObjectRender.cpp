@@ -269,11 +269,11 @@ void renderTeleporter(Point pos, U32 type, bool in, S32 time, F32 radiusFraction
       for(S32 i = 0; i < NumParticles; i++)
       {
          Tracker &t = particles[i];
-         t.thetaI = Random::readF() * Float2Pi;
-         t.thetaP = Random::readF() * 2 + 0.5;
-         t.dP = Random::readF() * 5 + 2.5;
-         t.dI = Random::readF() * t.dP;
-         t.ci = Random::readI(0, NumColors - 1);
+         t.thetaI = FastRandom::get().readF() * Float2Pi;
+         t.thetaP = FastRandom::get().readF() * 2 + 0.5;
+         t.dP = FastRandom::get().readF() * 5 + 2.5;
+         t.dI = FastRandom::get().readF() * t.dP;
+         t.ci = FastRandom::get().readI(0, NumColors - 1);
       }
    }
 
@@ -48,6 +48,11 @@ GameType::GameType()
    mNetFlags.set(Ghostable);
    mGameOver = false;
    mTeamScoreLimit = DefaultTeamScoreLimit;
+   mTeamScopeValid = false;
+   mTeamScopeTime = 0;
+   mTeamScopeWidth = 0;
+   mTeamScopeHeight = 0;
+   mHasWorldExtents = false;
 }
 
 void GameType::processArguments(S32 argc, const char **argv)
@@ -65,6 +70,10 @@ void GameType::idle(GameObject::IdleCallPath path)
    if(isGhost())
    {
       mGameTimer.update(deltaT);
+      if(gVoicePipeline)
+         for(S32 i = 0; i < mClientList.size(); i++)
+            if(mClientList[i]->voiceChannel)
+               gVoicePipeline->play(mClientList[i]->voiceChannel, mClientList[i]->voiceSFX);
       return;
    }
    queryItemsOfInterest();
@@ -475,7 +484,7 @@ void GameType::spawnShip(GameConnection *theClient)
    TNLAssert(mTeams[teamIndex].spawnPoints.size(), "No spawn points!");
 
    Point spawnPoint;
-   S32 spawnIndex = Random::readI() % mTeams[teamIndex].spawnPoints.size();
+   S32 spawnIndex = FastRandom::get().readI() % mTeams[teamIndex].spawnPoints.size();
    spawnPoint = mTeams[teamIndex].spawnPoints[spawnIndex];
 
    Ship *newShip = new Ship(cl->name, teamIndex, spawnPoint);
@@ -552,21 +561,28 @@ void GameType::addItemOfInterest(Item *theItem)
 
 void GameType::queryItemsOfInterest()
 {
-   static Vector<GameObject *> fillVector;
+   // Gather the ships once rather than querying the database around
+   // every item of interest.
+   static Vector<Ship *> ships;
+   ships.clear();
+   for(S32 i = 0; i < mClientList.size(); i++)
+   {
+      if(!mClientList[i]->clientConnection)
+         continue;
+      Ship *theShip = (Ship *) mClientList[i]->clientConnection->getControlObject();
+      if(theShip && (theShip->getObjectTypeMask() & ShipType))
+         ships.push_back(theShip);
+   }
+
    for(S32 i = 0; i < mItemsOfInterest.size(); i++)
    {
       ItemOfInterest &ioi = mItemsOfInterest[i];
       ioi.teamVisMask = 0;
       Point pos = ioi.theItem->getActualPos();
-      Point scopeRange(Game::PlayerSensorHorizVisDistance,
-         Game::PlayerSensorVertVisDistance);
-      Rect queryRect(pos, pos);
 
-      queryRect.expand(scopeRange);
-      findObjects(ShipType, fillVector, queryRect);
-      for(S32 j = 0; j < fillVector.size(); j++)
+      for(S32 j = 0; j < ships.size(); j++)
       {
-         Ship *theShip = (Ship *) fillVector[j];
+         Ship *theShip = ships[j];
          Point delta = theShip->getActualPos() - pos;
          delta.x = fabs(delta.x);
          delta.y = fabs(delta.y);
@@ -577,7 +593,140 @@ void GameType::queryItemsOfInterest()
                delta.y < Game::PlayerVertVisDistance))
                ioi.teamVisMask |= (1 << theShip->getTeam());
       }
-      fillVector.clear();
+   }
+}
+
+Rect GameType::getShipScopeRect(GameObject *shipObject, bool withMargin)
+{
+   Ship *co = (Ship *) shipObject;
+   Point pos = co->getActualPos();
+   Point scopeRange;
+
+   if(co->isSensorActive())
+      scopeRange.set(Game::PlayerSensorHorizVisDistance, Game::PlayerSensorVertVisDistance);
+   else
+      scopeRange.set(Game::PlayerHorizVisDistance, Game::PlayerVertVisDistance);
+   if(withMargin)
+      scopeRange += Point(Game::PlayerScopeMargin, Game::PlayerScopeMargin);
+
+   Rect scopeRect(pos, pos);
+   scopeRect.expand(scopeRange);
+   return scopeRect;
+}
+
+void GameType::getTeamScopeCells(const Rect &extent, S32 &x0, S32 &y0, S32 &x1, S32 &y1)
+{
+   x0 = getMax(S32((extent.min.x - mTeamScopeBounds.min.x) / TeamScopeCellSize), 0);
+   y0 = getMax(S32((extent.min.y - mTeamScopeBounds.min.y) / TeamScopeCellSize), 0);
+   x1 = getMin(S32((extent.max.x - mTeamScopeBounds.min.x) / TeamScopeCellSize), mTeamScopeWidth - 1);
+   y1 = getMin(S32((extent.max.y - mTeamScopeBounds.min.y) / TeamScopeCellSize), mTeamScopeHeight - 1);
+}
+
+void GameType::buildTeamScopeMap()
+{
+   mTeamScopeValid = true;
+   mTeamScopeTime = getGame()->getCurrentTime();
+
+   mTeamScopeObjects.setSize(mTeams.size());
+   for(S32 i = 0; i < mTeamScopeObjects.size(); i++)
+      mTeamScopeObjects[i].clear();
+
+   // find the area covered by all the ships' scope rectangles.
+   static Vector<Rect> scopeRects;
+   static Vector<S32> scopeTeams;
+   scopeRects.clear();
+   scopeTeams.clear();
+   for(S32 i = 0; i < mClientList.size(); i++)
+   {
+      S32 teamId = mClientList[i]->teamId;
+      if(!mClientList[i]->clientConnection || teamId < 0 || teamId >= mTeams.size())
+         continue;
+      Ship *co = (Ship *) mClientList[i]->clientConnection->getControlObject();
+      if(!co)
+         continue;
+
+      Rect scopeRect = getShipScopeRect(co, true);
+      if(!scopeRects.size())
+         mTeamScopeBounds = scopeRect;
+      else
+         mTeamScopeBounds.unionRect(scopeRect);
+      scopeRects.push_back(scopeRect);
+      scopeTeams.push_back(teamId);
+   }
+   if(!scopeRects.size())
+   {
+      mTeamScopeWidth = mTeamScopeHeight = 0;
+      return;
+   }
+
+   // index each scope rectangle into the cells it overlaps.  The cells'
+   // lists are packed into one array, cell by cell...
+   Point extents = mTeamScopeBounds.getExtents();
+   mTeamScopeWidth = S32(extents.x / TeamScopeCellSize) + 1;
+   mTeamScopeHeight = S32(extents.y / TeamScopeCellSize) + 1;
+   S32 cellCount = mTeamScopeWidth * mTeamScopeHeight;
+   mTeamScopeCellStart.setSize(cellCount + 1);
+   for(S32 i = 0; i <= cellCount; i++)
+      mTeamScopeCellStart[i] = 0;
+
+   S32 x0, y0, x1, y1;
+   for(S32 i = 0; i < scopeRects.size(); i++)
+   {
+      getTeamScopeCells(scopeRects[i], x0, y0, x1, y1);
+      for(S32 y = y0; y <= y1; y++)
+         for(S32 x = x0; x <= x1; x++)
+            mTeamScopeCellStart[y * mTeamScopeWidth + x + 1]++;
+   }
+   for(S32 i = 0; i < cellCount; i++)
+      mTeamScopeCellStart[i + 1] += mTeamScopeCellStart[i];
+
+   static Vector<S32> cellFill;
+   cellFill.setSize(cellCount);
+   for(S32 i = 0; i < cellCount; i++)
+      cellFill[i] = mTeamScopeCellStart[i];
+   mTeamScopeCellRects.setSize(mTeamScopeCellStart[cellCount]);
+   for(S32 i = 0; i < scopeRects.size(); i++)
+   {
+      getTeamScopeCells(scopeRects[i], x0, y0, x1, y1);
+      for(S32 y = y0; y <= y1; y++)
+         for(S32 x = x0; x <= x1; x++)
+            mTeamScopeCellRects[cellFill[y * mTeamScopeWidth + x]++] = i;
+   }
+
+   // ...then hand every commander map object to each team with a scope
+   // rectangle that overlaps it.  Only the rectangles in the object's
+   // cells are tested, and a team is stamped with the object once it has
+   // it, so it isn't tested again.
+   static Vector<GameObject *> fillVector;
+   fillVector.clear();
+   findObjects(CommandMapVisType, fillVector, mTeamScopeBounds);
+
+   static Vector<S32> teamStamps;
+   teamStamps.setSize(mTeams.size());
+   for(S32 i = 0; i < teamStamps.size(); i++)
+      teamStamps[i] = -1;
+
+   for(S32 i = 0; i < fillVector.size(); i++)
+   {
+      Rect extent = fillVector[i]->getExtent();
+      getTeamScopeCells(extent, x0, y0, x1, y1);
+      for(S32 y = y0; y <= y1; y++)
+      {
+         for(S32 x = x0; x <= x1; x++)
+         {
+            S32 cell = y * mTeamScopeWidth + x;
+            for(S32 j = mTeamScopeCellStart[cell]; j < mTeamScopeCellStart[cell + 1]; j++)
+            {
+               S32 rectIndex = mTeamScopeCellRects[j];
+               S32 team = scopeTeams[rectIndex];
+               if(teamStamps[team] != i && scopeRects[rectIndex].intersects(extent))
+               {
+                  teamStamps[team] = i;
+                  mTeamScopeObjects[team].push_back(fillVector[i]);
+               }
+            }
+         }
+      }
    }
 }
 
@@ -602,52 +751,20 @@ void GameType::performProxyScopeQuery(GameObject *scopeObject, GameConnection *c
 
    if(connection->isInCommanderMap() && mTeams.size() > 1)
    {
-      S32 teamId = connection->getClientRef()->teamId;
+      if(!mTeamScopeValid || mTeamScopeTime != getGame()->getCurrentTime())
+         buildTeamScopeMap();
 
-      for(S32 i = 0; i < mClientList.size(); i++)
+      S32 teamId = connection->getClientRef()->teamId;
+      if(teamId >= 0 && teamId < mTeamScopeObjects.size())
       {
-         if(mClientList[i]->teamId == teamId)
-         {
-            if(!mClientList[i]->clientConnection)
-               continue;
-
-            Ship *co = (Ship *) mClientList[i]->clientConnection->getControlObject();
-            if(!co)
-               continue;
-
-            Point pos = co->getActualPos();
-            Point scopeRange;
-            if(co->isSensorActive())
-               scopeRange.set(Game::PlayerSensorHorizVisDistance + Game::PlayerScopeMargin,
-                              Game::PlayerSensorVertVisDistance + Game::PlayerScopeMargin);
-            else
-               scopeRange.set(Game::PlayerHorizVisDistance + Game::PlayerScopeMargin,
-                              Game::PlayerVertVisDistance + Game::PlayerScopeMargin);
-
-            Rect queryRect(pos, pos);
-            
-            queryRect.expand(scopeRange);
-            findObjects(scopeObject == co ? AllObjectTypes : CommandMapVisType, fillVector, queryRect);
-         }
+         Vector<SafePtr<GameObject> > &teamObjects = mTeamScopeObjects[teamId];
+         for(S32 i = 0; i < teamObjects.size(); i++)
+            if(teamObjects[i].isValid())
+               connection->objectInScope(teamObjects[i]);
       }
    }
-   else
-   {
-      Point pos = scopeObject->getActualPos();
-      Ship *co = (Ship *) scopeObject;
-      Point scopeRange;
-
-      if(co->isSensorActive())
-         scopeRange.set(Game::PlayerSensorHorizVisDistance + Game::PlayerScopeMargin,
-                        Game::PlayerSensorVertVisDistance + Game::PlayerScopeMargin);
-      else
-         scopeRange.set(Game::PlayerHorizVisDistance + Game::PlayerScopeMargin,
-                        Game::PlayerVertVisDistance + Game::PlayerScopeMargin);
-
-      Rect queryRect(pos, pos);
-      queryRect.expand(scopeRange);
-      findObjects(AllObjectTypes, fillVector, queryRect);
-   }
+   Rect queryRect = getShipScopeRect(scopeObject, true);
+   findObjects(AllObjectTypes, fillVector, queryRect);
 
    for(S32 i = 0; i < fillVector.size(); i++)
       connection->objectInScope(fillVector[i]);
@@ -774,6 +891,11 @@ GAMETYPE_RPC_S2C(GameType, s2cSetLevelInfo, (StringTableEntry levelName, StringT
    mLevelInfoDisplayTimer.reset(LevelInfoDisplayTime);
 }
 
+GAMETYPE_RPC_S2C(GameType, s2cSetWorldExtents, (F32 minX, F32 minY, F32 maxX, F32 maxY), (minX, minY, maxX, maxY))
+{
+   setWorldExtents(Rect(Point(minX, minY), Point(maxX, maxY)));
+}
+
 GAMETYPE_RPC_S2C(GameType, s2cSetTimeRemaining, (U32 timeLeft), (timeLeft))
 {
    mGameTimer.reset(timeLeft);
@@ -809,12 +931,15 @@ GAMETYPE_RPC_S2C(GameType, s2cAddClient, (StringTableEntry name, bool isMyClient
    ClientRef *cref = allocClientRef();
    cref->name = name;
    cref->teamId = 0;
-   cref->decoder = new LPC10VoiceDecoder();
+   if(gVoicePipeline)
+      cref->voiceChannel = gVoicePipeline->createChannel(new LPC10VoiceDecoder());
 
    cref->voiceSFX = new SFXObject(SFXVoice, NULL, 1, Point(), Point());
 
    mClientList.push_back(cref);
+#ifndef ZAP_DEDICATED
    gGameUserInterface.displayMessage(Color(0.6f, 0.6f, 0.8f), "%s joined the game.", name.getString());
+#endif
 }
 
 void GameType::serverRemoveClient(GameConnection *theClient)
@@ -845,7 +970,9 @@ GAMETYPE_RPC_S2C(GameType, s2cRemoveClient, (StringTableEntry name), (name))
          break;
       }
    }
+#ifndef ZAP_DEDICATED
    gGameUserInterface.displayMessage(Color(0.6f, 0.6f, 0.8f), "%s left the game.", name.getString());
+#endif
 }
 
 GAMETYPE_RPC_S2C(GameType, s2cAddTeam, (StringTableEntry teamName, F32 r, F32 g, F32 b), (teamName, r, g, b))
@@ -867,7 +994,9 @@ GAMETYPE_RPC_S2C(GameType, s2cClientJoinedTeam, (StringTableEntry name, U32 team
 {
    ClientRef *cl = findClientRef(name);
    cl->teamId = teamIndex;
+#ifndef ZAP_DEDICATED
    gGameUserInterface.displayMessage(Color(0.6f, 0.6f, 0.8f), "%s joined team %s.", name.getString(), mTeams[teamIndex].name.getString());
+#endif
 }
 
 void GameType::onGhostAvailable(GhostConnection *theConnection)
@@ -875,6 +1004,8 @@ void GameType::onGhostAvailable(GhostConnection *theConnection)
    NetObject::setRPCDestConnection(theConnection);
 
    s2cSetLevelInfo(mLevelName, mLevelDescription);
+   if(mHasWorldExtents)
+      s2cSetWorldExtents(mWorldExtents.min.x, mWorldExtents.min.y, mWorldExtents.max.x, mWorldExtents.max.y);
 
    for(S32 i = 0; i < mTeams.size(); i++)
    {
@@ -968,16 +1099,18 @@ extern Color gTeamChatColor;
 
 GAMETYPE_RPC_S2C(GameType, s2cDisplayChatMessage, (bool global, StringTableEntry clientName, StringPtr message), (global, clientName, message))
 {
+#ifndef ZAP_DEDICATED
    Color theColor = global ? gGlobalChatColor : gTeamChatColor;
-
    gGameUserInterface.displayMessage(theColor, "%s: %s", clientName.getString(), message.getString());
+#endif
 }
 
 GAMETYPE_RPC_S2C(GameType, s2cDisplayChatMessageSTE, (bool global, StringTableEntry clientName, StringTableEntry message), (global, clientName, message))
 {
+#ifndef ZAP_DEDICATED
    Color theColor = global ? gGlobalChatColor : gTeamChatColor;
-
    gGameUserInterface.displayMessage(theColor, "%s: %s", clientName.getString(), message.getString());
+#endif
 }
 
 GAMETYPE_RPC_C2S(GameType, c2sRequestScoreboardUpdates, (bool updates), (updates))
@@ -1033,8 +1166,10 @@ GAMETYPE_RPC_S2C(GameType, s2cScoreboardUpdate, (Vector<RangedU32<0, GameType::M
 
 GAMETYPE_RPC_S2C(GameType, s2cKillMessage, (StringTableEntry victim, StringTableEntry killer), (victim, killer))
 {
+#ifndef ZAP_DEDICATED
    gGameUserInterface.displayMessage(Color(1.0f, 1.0f, 0.8f), 
             "%s zapped %s", killer.getString(), victim.getString());
+#endif
 }
 
 TNL_IMPLEMENT_NETOBJECT_RPC(GameType, c2sVoiceChat, (bool echo, ByteBufferPtr voiceBuffer), (echo, voiceBuffer),
@@ -1043,6 +1178,12 @@ TNL_IMPLEMENT_NETOBJECT_RPC(GameType, c2sVoiceChat, (bool echo, ByteBufferPtr vo
    // Broadcast this to all clients on the same team
    // Only send back to the source if echo is true.
 
+   // The buffer is relayed as it arrived, without decoding it; the one
+   // event is packed once for all the recipients.  Packets every client
+   // would throw away aren't relayed at all.
+   if(voiceBuffer->getBufferSize() > VoicePipeline::MaxPacketSize)
+      return;
+
    GameConnection *source = (GameConnection *) getRPCSourceConnection();
    ClientRef *cl = source->getClientRef();
    if(cl)
@@ -1059,14 +1200,11 @@ TNL_IMPLEMENT_NETOBJECT_RPC(GameType, c2sVoiceChat, (bool echo, ByteBufferPtr vo
 TNL_IMPLEMENT_NETOBJECT_RPC(GameType, s2cVoiceChat, (StringTableEntry clientName, ByteBufferPtr voiceBuffer), (clientName, voiceBuffer),
    NetClassGroupGameMask, RPCUnguaranteed, RPCToGhost, 0)
 {
+   // decoding happens on the voice pipeline's thread; GameType::idle
+   // plays the result.
    ClientRef *cl = findClientRef(clientName);
-   if(cl)
-   {
-      ByteBufferPtr playBuffer = cl->decoder->decompressBuffer(*(voiceBuffer.getPointer()));
-
-      //logprintf("Decoded buffer size %d", playBuffer->getBufferSize());
-      cl->voiceSFX->queueBuffer(playBuffer);
-   }
+   if(cl && cl->voiceChannel)
+      gVoicePipeline->queuePacket(cl->voiceChannel, voiceBuffer->getBuffer(), voiceBuffer->getBufferSize());
 }
 
 };
@@ -30,7 +30,7 @@
 #include "gameObject.h"
 #include "timer.h"
 #include "sfx.h"
-#include "voiceCodec.h"
+#include "voicePipeline.h"
 
 namespace Zap
 {
@@ -53,7 +53,7 @@ public:
 
    SafePtr<GameConnection> clientConnection;
    RefPtr<SFXObject> voiceSFX;
-   RefPtr<VoiceDecoder> decoder;
+   VoicePipeline::Channel *voiceChannel;  ///< Decodes this client's voice on the client, if voice is enabled.
 
    U32 ping;
    ClientRef()
@@ -63,6 +63,12 @@ public:
       readyForRegularGhosts = false;
       wantsScoreboardUpdates = false;
       teamId = 0;
+      voiceChannel = NULL;
+   }
+   ~ClientRef()
+   {
+      if(voiceChannel && gVoicePipeline)
+         gVoicePipeline->destroyChannel(voiceChannel);
    }
 };
 
@@ -101,6 +107,12 @@ public:
    StringTableEntry mLevelName;
    StringTableEntry mLevelDescription;
 
+   Rect mWorldExtents;        ///< extents of the level's objects, for the commander map
+   bool mHasWorldExtents;
+   void setWorldExtents(const Rect &extents) { mWorldExtents = extents; mHasWorldExtents = true; }
+   bool hasWorldExtents() { return mHasWorldExtents; }
+   const Rect &getWorldExtents() { return mWorldExtents; }
+
    struct ItemOfInterest
    {
       SafePtr<Item> theItem;
@@ -185,8 +197,34 @@ public:
    void performScopeQuery(GhostConnection *connection);
    virtual void performProxyScopeQuery(GameObject *scopeObject, GameConnection *connection);
 
+   /// Commander map scoping.  The first commander map scope query in a
+   /// tick indexes the scope rectangle of every ship into a coarse grid,
+   /// then sorts every CommandMapVisType object into the list of each
+   /// team with a scope rectangle in the object's cells that overlaps it.
+   /// Each connection in commander map mode then scopes its team's list,
+   /// so the cost is linear in the number of players rather than one
+   /// database query per teammate per connection.  The lists hold safe
+   /// pointers, since objects can be deleted between the build and a
+   /// later query in the same tick.
+   enum {
+      TeamScopeCellSize = 128,
+   };
+   bool mTeamScopeValid;
+   U32 mTeamScopeTime;
+   Rect mTeamScopeBounds;
+   S32 mTeamScopeWidth;
+   S32 mTeamScopeHeight;
+   Vector<S32> mTeamScopeCellStart; ///< Start of each cell's list in mTeamScopeCellRects, plus the end
+   Vector<S32> mTeamScopeCellRects; ///< Scope rectangle indices, cell by cell
+   Vector<Vector<SafePtr<GameObject> > > mTeamScopeObjects;
+
+   Rect getShipScopeRect(GameObject *shipObject, bool withMargin);
+   void buildTeamScopeMap();
+   void getTeamScopeCells(const Rect &extent, S32 &x0, S32 &y0, S32 &x1, S32 &y1);
+
    void onGhostAvailable(GhostConnection *theConnection);
    TNL_DECLARE_RPC(s2cSetLevelInfo, (StringTableEntry levelName, StringTableEntry levelDesc));
+   TNL_DECLARE_RPC(s2cSetWorldExtents, (F32 minX, F32 minY, F32 maxX, F32 maxY));
    TNL_DECLARE_RPC(s2cAddBarriers, (Vector<F32> barrier, F32 width));
    TNL_DECLARE_RPC(s2cAddTeam, (StringTableEntry teamName, F32 r, F32 g, F32 b));
    TNL_DECLARE_RPC(s2cAddClient, (StringTableEntry clientName, bool isMyClient));
@@ -43,6 +43,8 @@ GoalZone::GoalZone()
 
 void GoalZone::render()
 {
+   if(!getGame()->getGameType())
+      return;
    renderGoalZone(mPolyBounds, getGame()->getGameType()->getTeamColor(getTeam()), isFlashing());
 }
 
@@ -77,7 +79,13 @@ void GoalZone::onAddedToGame(Game *theGame)
 {
    if(!isGhost())
       setScopeAlways(); 
-   theGame->getGameType()->addZone(this);
+   if(theGame->getGameType())
+      onGameTypeAdded(theGame->getGameType());
+}
+
+void GoalZone::onGameTypeAdded(GameType *theGameType)
+{
+   theGameType->addZone(this);
 }
 
 void GoalZone::computeExtent()
@@ -58,6 +58,7 @@ public:
 
    void setTeam(S32 team);
    void onAddedToGame(Game *theGame);
+   void onGameTypeAdded(GameType *theGameType);
    void computeExtent();
    bool getCollisionPoly(Vector<Point> &polyPoints);
    bool collide(GameObject *hitObject);
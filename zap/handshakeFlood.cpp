@@ -0,0 +1,132 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "handshakeFlood.h"
+#include "tnlNetInterface.h"
+#include "tnlClientPuzzle.h"
+#include "tnlRandom.h"
+
+namespace Zap
+{
+
+HandshakeFlood::HandshakeFlood(const Address &serverAddress, U32 rate) :
+   mSocket(Address(IPProtocol, Address::Any, 0))
+{
+   mServerAddress = serverAddress;
+   mRate = rate;
+   mSendCredit = 0;
+   mPacketsSent = 0;
+   mNextPacketType = 0;
+   mNextChallenge = 0;
+}
+
+void HandshakeFlood::readChallengeResponses()
+{
+   for(;;)
+   {
+      PacketStream packet;
+      Address from;
+      if(packet.recvfrom(mSocket, &from) != NoError)
+         return;
+
+      U8 packetType;
+      packet.read(&packetType);
+      if(packetType != NetInterface::ConnectChallengeResponse)
+         continue;
+
+      Challenge challenge;
+      challenge.clientNonce.read(&packet);
+      packet.read(&challenge.identityToken);
+      challenge.serverNonce.read(&packet);
+      packet.read(&challenge.difficulty);
+
+      if(mChallenges.size() < MaxChallenges)
+         mChallenges.push_back(challenge);
+      else
+         mChallenges[mNextChallenge++ % MaxChallenges] = challenge;
+   }
+}
+
+void HandshakeFlood::sendPacket()
+{
+   FastRandom &random = FastRandom::get();
+   PacketStream out;
+
+   U32 packetType = mNextPacketType++ % 3;
+   if(packetType == 2 && !mChallenges.size())
+      packetType = 1;
+
+   Nonce clientNonce;
+   for(U32 i = 0; i < Nonce::NonceSize; i++)
+      clientNonce.data[i] = U8(random.readI());
+
+   if(packetType == 1)
+   {
+      out.write(U8(NetInterface::ConnectChallengeRequest));
+      clientNonce.write(&out);
+      out.writeFlag(false);
+      out.writeFlag(false);
+   }
+   else
+   {
+      Challenge challenge;
+      if(packetType == 2)
+         challenge = mChallenges[random.readI(0, mChallenges.size() - 1)];
+      else
+      {
+         challenge.clientNonce = clientNonce;
+         challenge.serverNonce = clientNonce;
+         challenge.identityToken = random.readI();
+         challenge.difficulty = ClientPuzzleManager::InitialPuzzleDifficulty;
+      }
+      out.write(U8(NetInterface::ConnectRequest));
+      challenge.clientNonce.write(&out);
+      challenge.serverNonce.write(&out);
+      out.write(challenge.identityToken);
+      out.write(challenge.difficulty);
+      out.write(random.readI());
+      out.writeFlag(false);
+      out.writeFlag(false);
+      out.write(random.readI());
+      out.writeString("GameConnection");
+   }
+   out.sendto(mSocket, mServerAddress);
+   mPacketsSent++;
+}
+
+void HandshakeFlood::idle(U32 timeDelta)
+{
+   readChallengeResponses();
+
+   mSendCredit += mRate * timeDelta * 0.001f;
+   while(mSendCredit >= 1)
+   {
+      sendPacket();
+      mSendCredit -= 1;
+   }
+}
+
+};
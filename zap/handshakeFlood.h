@@ -0,0 +1,85 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _HANDSHAKEFLOOD_H_
+#define _HANDSHAKEFLOOD_H_
+
+#include "tnlTypes.h"
+#include "tnlVector.h"
+#include "tnlNetBase.h"
+#include "tnlUDP.h"
+#include "tnlNonce.h"
+
+using namespace TNL;
+
+namespace Zap
+{
+
+/// HandshakeFlood sends a stream of bogus connection handshake packets
+/// at a server from a single socket, to measure how well the server
+/// keeps accepting real clients under attack.  It rotates between three
+/// kinds of packet:
+///
+/// - connect requests with made up identity tokens, as a flood from
+///   spoofed addresses would send;
+/// - connect challenge requests;
+/// - connect requests carrying a valid identity token, taken from the
+///   server's challenge responses, and a wrong puzzle solution, which
+///   the server has to hash before it can reject them.
+class HandshakeFlood
+{
+   struct Challenge
+   {
+      Nonce clientNonce;
+      Nonce serverNonce;
+      U32 identityToken;
+      U32 difficulty;
+   };
+   enum {
+      MaxChallenges = 64,
+   };
+
+   Socket mSocket;
+   Address mServerAddress;
+   U32 mRate;
+   F32 mSendCredit;
+   U32 mPacketsSent;
+   U32 mNextPacketType;
+   Vector<Challenge> mChallenges;
+   U32 mNextChallenge;
+
+   void readChallengeResponses();
+   void sendPacket();
+public:
+   HandshakeFlood(const Address &serverAddress, U32 rate);
+
+   void idle(U32 timeDelta);
+   U32 getPacketsSent() { return mPacketsSent; }
+};
+
+};
+
+#endif
@@ -59,6 +59,7 @@ TNL_IMPLEMENT_NETOBJECT_RPC(HuntersGameType, s2cHuntersMessage,
    (U32 msgIndex, StringTableEntry clientName, U32 flagCount), (msgIndex, clientName, flagCount),
    NetClassGroupGameMask, RPCGuaranteedOrdered, RPCToGhost, 0)
 {
+#ifndef ZAP_DEDICATED
    if(msgIndex == HuntersMsgScore)
    {
       SFXObject::play(SFXFlagCapture);
@@ -87,6 +88,7 @@ TNL_IMPLEMENT_NETOBJECT_RPC(HuntersGameType, s2cHuntersMessage,
                      "The game ended in a tie.");
       SFXObject::play(SFXFlagDrop);
    }
+#endif
 }
 
 HuntersGameType::HuntersGameType() : GameType()
@@ -305,8 +307,8 @@ void HuntersFlagItem::onMountDestroyed()
       HuntersFlagItem *newFlag = new HuntersFlagItem(mMount->getActualPos());
       newFlag->addToGame(getGame());
 
-      F32 th = Random::readF() * 2 * 3.14;
-      F32 f = (Random::readF() * 2 - 1) * 100;
+      F32 th = FastRandom::get().readF() * 2 * 3.14;
+      F32 f = (FastRandom::get().readF() * 2 - 1) * 100;
       Point vel(cos(th) * f, sin(th) * f);
       vel += mMount->getActualVel();
       
@@ -412,7 +414,13 @@ void HuntersNexusObject::onAddedToGame(Game *theGame)
 {
    if(!isGhost())
       setScopeAlways();
-   ((HuntersGameType *) theGame->getGameType())->addNexus(this);
+   if(theGame->getGameType())
+      onGameTypeAdded(theGame->getGameType());
+}
+
+void HuntersNexusObject::onGameTypeAdded(GameType *theGameType)
+{
+   ((HuntersGameType *) theGameType)->addNexus(this);
 }
 
 void HuntersNexusObject::render()
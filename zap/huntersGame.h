@@ -127,6 +127,7 @@ public:
    HuntersNexusObject();
 
    void onAddedToGame(Game *theGame);
+   void onGameTypeAdded(GameType *theGameType);
    void processArguments(S32 argc, const char **argv);
 
    void render();
@@ -32,6 +32,8 @@
 namespace Zap
 {
 
+static CodedField ItemSpeedField("Item speed", 8);
+
 Item::Item(Point p, bool collideable, float radius, float mass) : MoveObject(p, radius, mass)
 {
    mIsMounted = false;
@@ -171,7 +173,7 @@ U32 Item::packUpdate(GhostConnection *connection, U32 updateMask, BitStream *str
    if(stream->writeFlag(updateMask & PositionMask))
    {
       ((GameConnection *) connection)->writeCompressedPoint(mMoveState[ActualState].pos, stream);
-      writeCompressedVelocity(mMoveState[ActualState].vel, 511, stream);
+      writeCompressedVelocity(mMoveState[ActualState].vel, 511, stream, &ItemSpeedField);
       stream->writeFlag(updateMask & WarpPositionMask);
    }
    if(stream->writeFlag(updateMask & MountMask) && stream->writeFlag(mIsMounted))
@@ -209,7 +211,7 @@ void Item::unpackUpdate(GhostConnection *connection, BitStream *stream)
    if(stream->readFlag())
    {
       ((GameConnection *) connection)->readCompressedPoint(mMoveState[ActualState].pos, stream);
-      readCompressedVelocity(mMoveState[ActualState].vel, 511, stream);
+      readCompressedVelocity(mMoveState[ActualState].vel, 511, stream, &ItemSpeedField);
       positionChanged = true;
       interpolate = !stream->readFlag();
    }
@@ -0,0 +1,384 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU 
+//   General Public License, alternative licensing options are available 
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "levelFile.h"
+#include "gameLoader.h"
+#include "gameType.h"
+#include "game.h"
+#include "tnlLog.h"
+#include "tnlEndian.h"
+#include "tnlByteBuffer.h"
+
+#include <stdio.h>
+
+namespace Zap
+{
+
+extern void constructBarrierPoints(const Vector<Point> &vec, F32 width, Vector<Point> &barrierEnds);
+
+void LevelFileHeader::convertEndian()
+{
+   magic = convertLEndianToHost(magic);
+   version = convertLEndianToHost(version);
+   sourceCRC = convertLEndianToHost(sourceCRC);
+   indexSize = convertLEndianToHost(indexSize);
+   for(U32 i = 0; i < 4; i++)
+      extents[i] = convertLEndianToHost(extents[i]);
+   classCount = convertLEndianToHost(classCount);
+   classOffset = convertLEndianToHost(classOffset);
+   recordCount = convertLEndianToHost(recordCount);
+   recordOffset = convertLEndianToHost(recordOffset);
+   stringPoolOffset = convertLEndianToHost(stringPoolOffset);
+   stringPoolSize = convertLEndianToHost(stringPoolSize);
+   fileSize = convertLEndianToHost(fileSize);
+}
+
+void getCompiledLevelFileName(const char *sourceFile, char *buffer, U32 bufferSize)
+{
+   dSprintf(buffer, bufferSize, "%s", sourceFile);
+
+   char *ext = strrchr(buffer, '.');
+   char *dir = strrchr(buffer, '/');
+   if(!ext || (dir && dir > ext))
+      ext = buffer + strlen(buffer);
+   dSprintf(ext, bufferSize - (ext - buffer), ".zlv");
+}
+
+U32 computeLevelSourceCRC(const char *sourceFile)
+{
+   U32 size;
+   U8 *data = readLevelFileData(sourceFile, size);
+   if(!data)
+      return 0;
+   U32 crc = ByteBuffer(data, size).calculateCRC();
+   free(data);
+   return crc;
+}
+
+bool readLevelFileIndex(const char *fileName, U32 sourceCRC, LevelFileIndex &index)
+{
+   enum {
+      MaxIndexSize = 1024,
+   };
+
+   FILE *f = fopen(fileName, "rb");
+   if(!f)
+      return false;
+
+   LevelFileHeader header;
+   char indexData[MaxIndexSize + 1];
+   bool valid = fread(&header, sizeof(header), 1, f) == 1;
+   if(valid)
+   {
+      header.convertEndian();
+      valid = header.magic == LevelFileHeader::Magic && header.version == LevelFileHeader::Version &&
+              (!sourceCRC || header.sourceCRC == sourceCRC) && header.indexSize <= MaxIndexSize &&
+              fread(indexData, 1, header.indexSize, f) == header.indexSize;
+   }
+   fclose(f);
+   if(!valid)
+      return false;
+
+   // the index holds the level name followed by the game type string.
+   indexData[header.indexSize] = 0;
+   U32 nameLen = strlen(indexData);
+   if(nameLen >= header.indexSize)
+      return false;
+
+   index.levelName.set(indexData);
+   index.gameType.set(indexData + nameLen + 1);
+   index.extents.min.set(header.extents[0], header.extents[1]);
+   index.extents.max.set(header.extents[2], header.extents[3]);
+   return true;
+}
+
+/// LevelCompiler runs a text level through the regular level parser and
+/// records each line, resolving object classes and building barrier
+/// geometry as it goes.
+class LevelCompiler : public LevelLoader
+{
+   struct ClassEntry
+   {
+      U32 nameOffset;
+      U32 classId;
+   };
+   Vector<ClassEntry> mClasses;
+   Vector<U32> mRecords;
+   Vector<char> mStringPool;
+   U32 mRecordCount;
+   F32 mGridSize;
+   bool mHasExtents;
+
+   U32 addString(const char *string)
+   {
+      U32 offset = mStringPool.size();
+      U32 len = strlen(string) + 1;
+      mStringPool.setSize(offset + len);
+      memcpy(mStringPool.address() + offset, string, len);
+      return offset;
+   }
+
+   S32 findClass(const char *className)
+   {
+      U32 count = NetClassRep::getNetClassCount(NetClassGroupGame, NetClassTypeObject);
+      for(U32 i = 0; i < count; i++)
+      {
+         NetClassRep *rep = NetClassRep::getClass(NetClassGroupGame, NetClassTypeObject, i);
+         if(strcmp(rep->getClassName(), className))
+            continue;
+
+         for(S32 j = 0; j < mClasses.size(); j++)
+            if(mClasses[j].classId == i)
+               return j;
+
+         ClassEntry entry;
+         entry.nameOffset = addString(className);
+         entry.classId = i;
+         mClasses.push_back(entry);
+
+         // the first game type in the level determines the level type
+         if(!mGameType)
+         {
+            TNL::Object *theObject = rep->create();
+            GameType *gt = dynamic_cast<GameType *>(theObject);
+            if(gt)
+               mGameType.set(gt->getGameTypeString());
+            delete theObject;
+         }
+         return mClasses.size() - 1;
+      }
+      return -1;
+   }
+
+   void addRecord(U32 kind, U32 classIndex, int argc, const char **argv)
+   {
+      mRecordCount++;
+      mRecords.push_back(kind);
+      mRecords.push_back(classIndex);
+      mRecords.push_back(argc);
+      for(S32 i = 0; i < argc; i++)
+         mRecords.push_back(addString(argv[i]));
+   }
+
+   void addFloat(F32 value)
+   {
+      U32 word;
+      memcpy(&word, &value, sizeof(U32));
+      mRecords.push_back(word);
+   }
+
+   void processLevelLoadLine(int argc, const char **argv)
+   {
+      // grid size and level name are recorded as directives like any
+      // other line, but the compiler needs them too.
+      if(!stricmp(argv[0], "GridSize") && argc > 1)
+         mGridSize = atof(argv[1]);
+      else if(!stricmp(argv[0], "LevelName") && argc > 1)
+         mLevelName.set(argv[1]);
+
+      if(!stricmp(argv[0], "BarrierMaker") && argc > 1)
+      {
+         GameType::BarrierRec barrier;
+         barrier.width = atof(argv[1]);
+         for(S32 i = 2; i < argc; i++)
+            barrier.verts.push_back(atof(argv[i]) * mGridSize);
+         if(barrier.verts.size() <= 3)
+            return;
+
+         Vector<Point> vec;
+         for(S32 i = 1; i < barrier.verts.size(); i += 2)
+            vec.push_back(Point(barrier.verts[i-1], barrier.verts[i]));
+         Vector<Point> barrierEnds;
+         constructBarrierPoints(vec, barrier.width, barrierEnds);
+
+         addRecord(LevelFileHeader::RecordBarrierMaker, 0, argc, argv);
+         addFloat(barrier.width);
+         mRecords.push_back(barrier.verts.size());
+         for(S32 i = 0; i < barrier.verts.size(); i++)
+            addFloat(barrier.verts[i]);
+         mRecords.push_back(barrierEnds.size());
+         for(S32 i = 0; i < barrierEnds.size(); i++)
+         {
+            addFloat(barrierEnds[i].x);
+            addFloat(barrierEnds[i].y);
+
+            // the level extents are those of the barriers, as in Barrier::Barrier
+            Rect r(barrierEnds[i], barrierEnds[i]);
+            r.expand(Point(barrier.width, barrier.width));
+            if(mHasExtents)
+               mExtents.unionRect(r);
+            else
+               mExtents = r;
+            mHasExtents = true;
+         }
+         return;
+      }
+
+      S32 classIndex = findClass(argv[0]);
+      if(classIndex != -1)
+         addRecord(LevelFileHeader::RecordObject, classIndex, argc, argv);
+      else
+         addRecord(LevelFileHeader::RecordDirective, 0, argc, argv);
+   }
+public:
+   StringTableEntry mLevelName;
+   StringTableEntry mGameType;
+   Rect mExtents;
+
+   LevelCompiler()
+   {
+      mRecordCount = 0;
+      mGridSize = Game::DefaultGridSize;
+      mHasExtents = false;
+      mExtents.min.set(0, 0);
+      mExtents.max.set(0, 0);
+   }
+
+   bool compile(const char *sourceFile, const char *destFile)
+   {
+      U32 size;
+      char *fileData = (char *) readLevelFileData(sourceFile, size);
+      if(!fileData)
+      {
+         logprintf("Unable to open level file %s!!", sourceFile);
+         return false;
+      }
+      U32 sourceCRC = ByteBuffer((U8 *) fileData, size).calculateCRC();
+
+      parseArgs(fileData);
+      free(fileData);
+
+      if(!write(destFile, sourceCRC))
+      {
+         logprintf("Unable to write compiled level file %s!!", destFile);
+         return false;
+      }
+      return true;
+   }
+
+   bool write(const char *destFile, U32 sourceCRC)
+   {
+      if(!mGameType)
+      {
+         GameType defaultType;
+         mGameType.set(defaultType.getGameTypeString());
+      }
+
+      // index block: level name and game type, padded to a word boundary
+      Vector<char> index;
+      const char *indexStrings[2] = { mLevelName.getString(), mGameType.getString() };
+      for(U32 i = 0; i < 2; i++)
+      {
+         U32 len = strlen(indexStrings[i]) + 1;
+         U32 start = index.size();
+         index.setSize(start + len);
+         memcpy(index.address() + start, indexStrings[i], len);
+      }
+      while(index.size() & 3)
+         index.push_back(0);
+
+      // always have a terminating zero in the pool, even if it is empty.
+      if(!mStringPool.size())
+         mStringPool.push_back(0);
+
+      LevelFileHeader header;
+      header.magic = LevelFileHeader::Magic;
+      header.version = LevelFileHeader::Version;
+      header.sourceCRC = sourceCRC;
+      header.indexSize = index.size();
+      header.extents[0] = mExtents.min.x;
+      header.extents[1] = mExtents.min.y;
+      header.extents[2] = mExtents.max.x;
+      header.extents[3] = mExtents.max.y;
+      header.classCount = mClasses.size();
+      header.classOffset = sizeof(LevelFileHeader) + index.size();
+      header.recordCount = mRecordCount;
+      header.recordOffset = header.classOffset + mClasses.size() * sizeof(U32) * 2;
+      header.stringPoolOffset = header.recordOffset + mRecords.size() * sizeof(U32);
+      header.stringPoolSize = mStringPool.size();
+      header.fileSize = header.stringPoolOffset + header.stringPoolSize;
+
+      FILE *f = fopen(destFile, "wb");
+      if(!f)
+         return false;
+
+      header.convertEndian();
+      fwrite(&header, sizeof(header), 1, f);
+      fwrite(index.address(), 1, index.size(), f);
+      for(S32 i = 0; i < mClasses.size(); i++)
+      {
+         U32 entry[2];
+         entry[0] = convertHostToLEndian(mClasses[i].nameOffset);
+         entry[1] = convertHostToLEndian(mClasses[i].classId);
+         fwrite(entry, sizeof(entry), 1, f);
+      }
+      for(S32 i = 0; i < mRecords.size(); i++)
+      {
+         U32 word = convertHostToLEndian(mRecords[i]);
+         fwrite(&word, sizeof(word), 1, f);
+      }
+      fwrite(mStringPool.address(), 1, mStringPool.size(), f);
+      bool success = !ferror(f);
+      fclose(f);
+      return success;
+   }
+};
+
+bool compileLevelFile(const char *sourceFile, const char *destFile)
+{
+   LevelCompiler compiler;
+   return compiler.compile(sourceFile, destFile);
+}
+
+void compileLevelList(const char *levelList)
+{
+   NetClassRep::initialize();
+
+   for(;;)
+   {
+      const char *firstSpace = strchr(levelList, ' ');
+      char levelName[256];
+      if(firstSpace)
+         dSprintf(levelName, sizeof(levelName), "%.*s", S32(firstSpace - levelList), levelList);
+      else
+         dSprintf(levelName, sizeof(levelName), "%s", levelList);
+
+      if(levelName[0])
+      {
+         char sourceFile[256];
+         char destFile[256];
+         dSprintf(sourceFile, sizeof(sourceFile), "levels/%s", levelName);
+         getCompiledLevelFileName(sourceFile, destFile, sizeof(destFile));
+         if(compileLevelFile(sourceFile, destFile))
+            logprintf("Compiled %s to %s", sourceFile, destFile);
+      }
+      if(!firstSpace)
+         break;
+      levelList = firstSpace + 1;
+   }
+}
+
+};
@@ -0,0 +1,112 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU 
+//   General Public License, alternative licensing options are available 
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _LEVELFILE_H_
+#define _LEVELFILE_H_
+
+#include "tnlTypes.h"
+#include "tnlNetStringTable.h"
+#include "point.h"
+
+using namespace TNL;
+
+namespace Zap
+{
+
+/// Compiled levels are stored next to their text source as .zlv files.
+/// The file is a flat, position independent image: a fixed header, a
+/// small index block holding the level name and game type string, a
+/// table of the object classes used by the level, the records for
+/// every line of the source level and finally a string pool holding
+/// all the argument strings.  All offsets are byte offsets from the
+/// start of the file and all words are stored little endian, so the
+/// file can be read with a single fread (or mapped) and walked in place.
+///
+/// Each record is a sequence of 32 bit words:
+///   kind, classIndex, argc, argv[argc] (string pool offsets)
+/// BarrierMaker records are followed by the pre-built barrier geometry:
+///   width, vertCount, verts[vertCount], endCount, ends[endCount * 2]
+/// where the ends are the start/end point pairs that constructBarriers
+/// would have produced for the wall.
+struct LevelFileHeader
+{
+   enum {
+      Magic = 0x31564C5A, ///< "ZLV1"
+      Version = 1,
+   };
+   enum RecordKind {
+      RecordDirective,   ///< handed to processLevelLoadLine
+      RecordObject,      ///< a GameObject to create, by class table index
+      RecordBarrierMaker,///< a wall with its pre-built barrier segments
+   };
+
+   U32 magic;
+   U32 version;
+   U32 sourceCRC;        ///< CRC of the text level this was compiled from
+   U32 indexSize;        ///< size of the name/type index block after the header
+   F32 extents[4];       ///< min x, min y, max x, max y of the level geometry
+   U32 classCount;
+   U32 classOffset;      ///< classCount pairs of (name offset, class id)
+   U32 recordCount;
+   U32 recordOffset;
+   U32 stringPoolOffset;
+   U32 stringPoolSize;
+   U32 fileSize;
+
+   /// Converts all the header fields between little endian and host order.
+   void convertEndian();
+};
+
+/// The information the server needs about a level without loading it.
+struct LevelFileIndex
+{
+   StringTableEntry levelName;
+   StringTableEntry gameType;
+   Rect extents;
+};
+
+/// Returns the name of the compiled level file for a text level file.
+extern void getCompiledLevelFileName(const char *sourceFile, char *buffer, U32 bufferSize);
+
+/// Computes the CRC of a text level file, used to detect stale compiled levels.
+/// Returns 0 if the file can't be read.
+extern U32 computeLevelSourceCRC(const char *sourceFile);
+
+/// Reads just the header and index block of a compiled level.  Fails if the
+/// file is missing, of a different version or was compiled from a different
+/// source (sourceCRC).  A sourceCRC of 0 (no text source) skips that check,
+/// so levels can be shipped compiled only.
+extern bool readLevelFileIndex(const char *fileName, U32 sourceCRC, LevelFileIndex &index);
+
+/// Compiles the text level sourceFile into destFile.
+extern bool compileLevelFile(const char *sourceFile, const char *destFile);
+
+/// Compiles a space separated list of levels from the levels directory.
+extern void compileLevelList(const char *levelList);
+
+};
+
+#endif
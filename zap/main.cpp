@@ -43,8 +43,10 @@ using namespace TNL;
 #include "gameNetInterface.h"
 #include "masterConnection.h"
 #include "sfx.h"
+#include "voicePipeline.h"
 #include "sparkManager.h"
 #include "input.h"
+#include "levelFile.h"
 
 #ifdef TNL_OS_MAC_OSX
 #include <unistd.h>
@@ -62,6 +64,7 @@ U32 gMaxPlayers = 128;
 U32 gSimulatedPing = 0;
 F32 gSimulatedPacketLoss = 0;
 bool gDedicatedServer = false;
+bool gFieldCoding = true;
 
 const char *gMasterAddressString = "IP:master.opentnl.org:29005";
 const char *gServerPassword = NULL;
@@ -254,14 +257,16 @@ TNL_IMPLEMENT_JOURNAL_ENTRYPOINT(ZapJournal, modifierkeyup, (U32 key), (key))
       UserInterface::current->onModifierKeyUp(key);
 }
 
+/// Returns a random number from 0 up to (but not including) range, or 0 if
+/// range is 0.
 inline U32 RandomInt(U32 range)
 {
-   return U32((U32(rand()) / (F32(RAND_MAX) + 1)) * range);
+   return U32((U64(FastRandom::get().readI()) * range) >> 32);
 }
 
 inline U32 RandomBool()
 {
-   return (U32(rand()) / (F32(RAND_MAX) + 1)) > 0.5f;
+   return FastRandom::get().readB();
 }
 
 extern void getModifierState( bool &shiftDown, bool &controlDown, bool &altDown );
@@ -444,10 +449,13 @@ public:
    void logString(const char *string)
    {
       if(f)
-      {
          fprintf(f, "%s\n", string);
+   }
+
+   void flush()
+   {
+      if(f)
          fflush(f);
-      }
    }
 } gFileLogConsumer;
 
@@ -509,6 +517,8 @@ void endGame()
 void onExit()
 {
    endGame();
+   if(gVoicePipeline)
+      gVoicePipeline->shutdown();
    SFXObject::shutdown();
    ShutdownJoystick();
    NetClassRep::logBitUsage();
@@ -547,6 +557,11 @@ TNL_IMPLEMENT_JOURNAL_ENTRYPOINT(ZapJournal, startup, (Vector<StringPtr> argv),
          if(hasAdditionalArg)
             gMasterAddressString = argv[i+1];
       }
+      else if(!stricmp(argv[i], "-seed"))
+      {
+         if(hasAdditionalArg)
+            FastRandom::get().setSeed(U32(strtoul(argv[i+1], NULL, 10)));
+      }
       else if(!stricmp(argv[i], "-joystick"))
       {
          if(hasAdditionalArg)
@@ -562,6 +577,11 @@ TNL_IMPLEMENT_JOURNAL_ENTRYPOINT(ZapJournal, startup, (Vector<StringPtr> argv),
          if(hasAdditionalArg)
             gSimulatedPing = atoi(argv[i+1]);
       }
+      else if(!stricmp(argv[i], "-fieldcoding"))
+      {
+         if(hasAdditionalArg)
+            gFieldCoding = atoi(argv[i+1]) != 0;
+      }
       else if(!stricmp(argv[i], "-dedicated"))
       {
          hasClient = false;
@@ -671,18 +691,21 @@ int main(int argc, char **argv)
    TNLLogEnable(LogPlatform, true);
    TNLLogEnable(LogNetBase, true);
 
+   // format and write log messages on their own thread, so logging from the
+   // network code doesn't stall the game loop.
+   startAsyncLogging();
+
    for(S32 i = 0; i < argc;i++)
-      logprintf(argv[i]);
+      logprintf("%s", argv[i]);
 
    Vector<StringPtr> theArgv;
+   U32 journalBreakTime = 0;
+   bool seedSet = false;
 
    for(S32 i = 1; i < argc; i++)
    {
       if(!stricmp(argv[i], "-crazybot"))
-      {
-         srand(Platform::getRealMilliseconds());
          gIsCrazyBot = true;
-      }
       else if(!stricmp(argv[i], "-jsave"))
       {
          if(i != argc - 1)
@@ -691,6 +714,11 @@ int main(int argc, char **argv)
             i++;
          }
       }
+      else if(!stricmp(argv[i], "-compilelevels"))
+      {
+         compileLevelList(i != argc - 1 ? argv[i+1] : gLevelList);
+         return 0;
+      }
       else if(!stricmp(argv[i], "-jplay"))
       {
          if(i != argc - 1)
@@ -699,10 +727,35 @@ int main(int argc, char **argv)
             i++;
          }
       }
+      else if(!stricmp(argv[i], "-jbreak"))
+      {
+         if(i != argc - 1)
+         {
+            journalBreakTime = U32(atof(argv[i+1]) * 1000);
+            i++;
+         }
+      }
       else
+      {
+         if(!stricmp(argv[i], "-seed"))
+            seedSet = true;
          theArgv.push_back(argv[i]);
+      }
    }
 
+   // pick the simulation seed here rather than in startup, so that it is
+   // saved in the journal along with the rest of the command line.
+   if(!seedSet)
+   {
+      char seedString[16];
+      dSprintf(seedString, sizeof(seedString), "%u", Random::readI());
+      theArgv.push_back("-seed");
+      theArgv.push_back(seedString);
+   }
+
+   if(journalBreakTime && Journal::getCurrentMode() == Journal::Playback)
+      Journal::setBreakTime(journalBreakTime);
+
    gZapJournal.startup(theArgv);
 
    // we need to process the startup code if this is playing back
@@ -712,6 +765,8 @@ int main(int argc, char **argv)
    if(gClientGame)
    {
       SFXObject::init();
+      gVoicePipeline = new VoicePipeline;
+      gVoicePipeline->startup();
       InitJoystick();
       OptionsMenuUserInterface::joystickType = autodetectJoystickType();
 
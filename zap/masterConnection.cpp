@@ -50,6 +50,29 @@ void MasterServerConnection::startGameTypesQuery()
    c2mQueryGameTypes(mCurrentQueryId);
 }
 
+/// Asks the master for the server list.  A master that speaks version 2 of
+/// the protocol sends the list and then keeps it up to date; older masters
+/// are sent the one-shot game types and servers queries.
+void MasterServerConnection::startServerListUpdates()
+{
+   if(getEventClassVersion() < 2)
+   {
+      startGameTypesQuery();
+      return;
+   }
+   mCurrentQueryId++;
+   mSubscriptionId = mCurrentQueryId;
+   c2mSubscribeServers(mSubscriptionId, 0xFFFFFFFF, 0, 128, 0, 128, 0, "", "");
+}
+
+void MasterServerConnection::stopServerListUpdates()
+{
+   if(!mSubscriptionId)
+      return;
+   c2mUnsubscribeServers(mSubscriptionId);
+   mSubscriptionId = 0;
+}
+
 TNL_IMPLEMENT_RPC_OVERRIDE(MasterServerConnection, m2cQueryGameTypesResponse, (U32 queryId, Vector<StringTableEntry> gameTypes, Vector<StringTableEntry> missionTypes))
 {
    // Ignore old queries...
@@ -87,7 +110,22 @@ TNL_IMPLEMENT_RPC_OVERRIDE(MasterServerConnection, m2cQueryServersResponse, (U32
    for(S32 i = 0; i < ipList.size(); i++)
       logprintf("  %s", Address(ipList[i]).toString());
 
+#ifndef ZAP_DEDICATED
    gQueryServersUserInterface.addPingServers(ipList);
+#endif
+}
+
+TNL_IMPLEMENT_RPC_OVERRIDE(MasterServerConnection, m2cServerListDelta, (U32 queryId, Vector<IPAddress> updatedServers, Vector<IPAddress> removedServers))
+{
+   if(!mSubscriptionId || queryId != mSubscriptionId)
+      return;
+
+   logprintf("server list update from the master: %d updated, %d removed", updatedServers.size(), removedServers.size());
+
+#ifndef ZAP_DEDICATED
+   gQueryServersUserInterface.removePingServers(removedServers);
+   gQueryServersUserInterface.updatePingServers(updatedServers);
+#endif
 }
 
 void MasterServerConnection::requestArrangedConnection(const Address &remoteAddress)
@@ -165,9 +203,13 @@ TNL_IMPLEMENT_RPC_OVERRIDE(MasterServerConnection, m2cArrangedConnectionAccepted
       Nonce serverNonce(connectionData->getBuffer() + Nonce::NonceSize);
 
       GameConnection *conn = new GameConnection();
+#ifndef ZAP_DEDICATED
       const char *name = gNameEntryUserInterface.getText();
       if(!name[0])
          name = "Playa";
+#else
+      const char *name = "Playa";
+#endif
 
       conn->setSimulatedNetParams(gSimulatedPacketLoss, gSimulatedPing);
       conn->setClientName(name);
@@ -184,14 +226,18 @@ TNL_IMPLEMENT_RPC_OVERRIDE(MasterServerConnection, m2cArrangedConnectionRejected
    {
       logprintf("Remote host rejected arranged connection...");
       endGame();
+#ifndef ZAP_DEDICATED
       gMainMenuUserInterface.activate();
+#endif
    }
 }
 
 TNL_IMPLEMENT_RPC_OVERRIDE(MasterServerConnection, m2cSetMOTD, (StringPtr motdString))
 {
+#ifndef ZAP_DEDICATED
    if(!mIsGameServer)
       gMainMenuUserInterface.setMOTD(motdString);
+#endif
 }
 
 void MasterServerConnection::writeConnectRequest(BitStream *bstream)
@@ -39,6 +39,9 @@ class MasterServerConnection : public MasterServerInterface
    // ID of our current query.
    U32 mCurrentQueryId;
 
+   // ID of our server list subscription, or 0 if there isn't one.
+   U32 mSubscriptionId;
+
    bool mIsGameServer;
 
 public:
@@ -46,16 +49,20 @@ public:
    {
       mIsGameServer = isGameServer;
       mCurrentQueryId = 0;
+      mSubscriptionId = 0;
       setIsConnectionToServer();
       setIsAdaptive();
    }
 
    void startGameTypesQuery();
+   void startServerListUpdates();
+   void stopServerListUpdates();
    void cancelArrangedConnectionAttempt() { mCurrentQueryId++; }
    void requestArrangedConnection(const Address &remoteAddress);
 
    TNL_DECLARE_RPC_OVERRIDE(m2cQueryGameTypesResponse, (U32 queryId, Vector<StringTableEntry> gameTypes, Vector<StringTableEntry> missionTypes));
    TNL_DECLARE_RPC_OVERRIDE(m2cQueryServersResponse, (U32 queryId, Vector<IPAddress> ipList));
+   TNL_DECLARE_RPC_OVERRIDE(m2cServerListDelta, (U32 queryId, Vector<IPAddress> updatedServers, Vector<IPAddress> removedServers));
    TNL_DECLARE_RPC_OVERRIDE(m2cClientRequestedArrangedConnection, (U32 requestId, Vector<IPAddress> possibleAddresses,
       ByteBufferPtr connectionParameters));
    TNL_DECLARE_RPC_OVERRIDE(m2cArrangedConnectionAccepted, (U32 requestId, Vector<IPAddress> possibleAddresses, ByteBufferPtr connectionData));
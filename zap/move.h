@@ -53,6 +53,10 @@ inline F32 unitToRadians(F32 angle)
    return angle * Float2Pi;
 }
 
+// thrust is entropy coded when a move is sent in a ghost update, since
+// it's mostly full or none.
+extern CodedField MoveThrustField;
+
 struct Move
 {
    float left;
@@ -86,10 +90,10 @@ struct Move
    {
       if(!stream->writeFlag(prev && isEqualMove(prev)))
       {
-         stream->writeFloat(left, 4);
-         stream->writeFloat(right, 4);
-         stream->writeFloat(up, 4);
-         stream->writeFloat(down, 4);
+         stream->writeCodedFloat(left, 4, MoveThrustField);
+         stream->writeCodedFloat(right, 4, MoveThrustField);
+         stream->writeCodedFloat(up, 4, MoveThrustField);
+         stream->writeCodedFloat(down, 4, MoveThrustField);
          U32 writeAngle = U32(radiansToUnit(angle) * 0xFFF);
 
          stream->writeInt(writeAngle, 12);
@@ -104,10 +108,10 @@ struct Move
    {
       if(!stream->readFlag())
       {
-         left = stream->readFloat(4);
-         right = stream->readFloat(4);
-         up = stream->readFloat(4);
-         down = stream->readFloat(4);
+         left = stream->readCodedFloat(4, MoveThrustField);
+         right = stream->readCodedFloat(4, MoveThrustField);
+         up = stream->readCodedFloat(4, MoveThrustField);
+         down = stream->readCodedFloat(4, MoveThrustField);
          angle = unitToRadians(stream->readInt(12) / F32(0xFFF));
          fire = stream->readFlag();
          module[0] = stream->readFlag();
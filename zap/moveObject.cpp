@@ -32,6 +32,8 @@
 namespace Zap
 {
 
+CodedField MoveThrustField("Move thrust", 4);
+
 MoveObject::MoveObject(Point pos, float radius, float mass)
 {
    for(U32 i = 0; i < MoveStateCount; i++)
@@ -316,13 +318,13 @@ void MoveObject::computeCollisionResponseBarrier(U32 stateIndex, Point &collisio
 
          for(S32 i=0; i<4*pow((F32)scale, 0.5f); i++)
          {
-            Point chaos(Random::readF(), Random::readF());
+            Point chaos(FastRandom::get().readF(), FastRandom::get().readF());
             chaos *= scale + 1;
 
-            if(Random::readF() > 0.5)
+            if(FastRandom::get().readF() > 0.5)
                FXManager::emitSpark(collisionPoint, normal * chaos.len() + Point(normal.y, -normal.x)*scale*5  + chaos + mMoveState[stateIndex].vel*0.05f, bumpC);
 
-            if(Random::readF() > 0.5)
+            if(FastRandom::get().readF() > 0.5)
                FXManager::emitSpark(collisionPoint, normal * chaos.len() + Point(normal.y, -normal.x)*scale*-5 + chaos + mMoveState[stateIndex].vel*0.05f, bumpC);
          }
       }
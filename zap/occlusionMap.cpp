@@ -0,0 +1,182 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "occlusionMap.h"
+#include "gameObject.h"
+#include "gridDB.h"
+#include <math.h>
+
+namespace Zap
+{
+
+// Points this close to a barrier's outline are left to a ray cast, to
+// cover rounding error.
+static const F32 OcclusionMargin = 1.0f;
+static const F32 Unblocked = 1e30f;
+
+Point OcclusionMap::mWedgeSides[OcclusionMap::WedgeCount];
+bool OcclusionMap::mWedgeSidesInitialized = false;
+
+OcclusionMap::OcclusionMap()
+{
+   mRadius = 0;
+   mBuilt = false;
+}
+
+// Wedge i runs counterclockwise from side i to side i + 1, and side i
+// points at angle -pi + i * 2pi / WedgeCount.
+U32 OcclusionMap::getWedge(Point delta)
+{
+   F32 angle = atan2(delta.y, delta.x);
+   S32 wedge = S32((angle + FloatPi) * (WedgeCount / Float2Pi));
+   if(wedge < 0)
+      wedge = 0;
+   return U32(wedge) & (WedgeCount - 1);
+}
+
+void OcclusionMap::addPoint(Point p)
+{
+   U32 wedge = getWedge(p);
+   F32 dist = p.len();
+   if(dist < mNearest[wedge])
+      mNearest[wedge] = dist;
+}
+
+void OcclusionMap::addEdge(Point a, Point b)
+{
+   addPoint(a);
+   addPoint(b);
+
+   Point e = b - a;
+   F32 lenSquared = e.dot(e);
+   if(lenSquared == 0)
+      return;
+   F32 t = -a.dot(e) / lenSquared;
+   if(t > 0 && t < 1)
+      addPoint(a + e * t);
+
+   // walk the sides the edge crosses counterclockwise.  An edge in line
+   // with the origin crosses none.
+   F32 cross = a.x * b.y - a.y * b.x;
+   if(fabs(cross) < 1e-4f * lenSquared)
+      return;
+   if(cross < 0)
+   {
+      Point temp = a;
+      a = b;
+      b = temp;
+      e = b - a;
+   }
+   U32 firstWedge = getWedge(a);
+   U32 sideCount = (getWedge(b) - firstWedge) & (WedgeCount - 1);
+   F32 aCrossE = a.x * e.y - a.y * e.x;
+
+   F32 prevDist = 0;
+   for(U32 i = 1; i <= sideCount; i++)
+   {
+      U32 side = (firstWedge + i) & (WedgeCount - 1);
+      Point d = mWedgeSides[side];
+      F32 denom = d.x * e.y - d.y * e.x;
+      if(denom == 0)
+         return;
+      F32 dist = aCrossE / denom;
+
+      // the crossing bounds both wedges on either side.
+      U32 before = (side - 1) & (WedgeCount - 1);
+      if(dist < mNearest[before])
+         mNearest[before] = dist;
+      if(dist < mNearest[side])
+         mNearest[side] = dist;
+
+      // between two crossings the edge spans the whole wedge, and is no
+      // further away than the further crossing.
+      if(i > 1)
+      {
+         F32 blocked = getMax(prevDist, dist);
+         if(blocked < mBlocked[before])
+            mBlocked[before] = blocked;
+      }
+      prevDist = dist;
+   }
+}
+
+void OcclusionMap::build(GridDatabase *database, Point origin, F32 radius)
+{
+   if(!mWedgeSidesInitialized)
+   {
+      for(U32 i = 0; i < WedgeCount; i++)
+      {
+         F32 angle = -FloatPi + i * (Float2Pi / WedgeCount);
+         mWedgeSides[i].set(cos(angle), sin(angle));
+      }
+      mWedgeSidesInitialized = true;
+   }
+
+   mOrigin = origin;
+   mRadius = radius;
+   for(U32 i = 0; i < WedgeCount; i++)
+   {
+      mNearest[i] = radius;
+      mBlocked[i] = Unblocked;
+   }
+
+   Rect extents(origin, origin);
+   extents.expand(Point(radius, radius));
+   Vector<GameObject *> barriers;
+   database->findObjects(BarrierType, barriers, extents);
+
+   Vector<Point> poly;
+   for(S32 i = 0; i < barriers.size(); i++)
+   {
+      poly.clear();
+      if(!barriers[i]->getCollisionPoly(poly))
+         continue;
+      for(S32 j = 0; j < poly.size(); j++)
+         addEdge(poly[j] - origin, poly[j + 1 == poly.size() ? 0 : j + 1] - origin);
+   }
+   mBuilt = true;
+}
+
+OcclusionMap::Visibility OcclusionMap::test(Point p)
+{
+   Point delta = p - mOrigin;
+   F32 dist = delta.len();
+   U32 wedge = getWedge(delta);
+
+   if(dist < mNearest[wedge] - OcclusionMargin)
+      return Visible;
+   if(dist > mBlocked[wedge] + OcclusionMargin)
+      return Hidden;
+   return Unknown;
+}
+
+F32 OcclusionMap::getClearDistance(Point dir)
+{
+   F32 dist = mNearest[getWedge(dir)] - OcclusionMargin;
+   return dist > 0 ? dist : 0;
+}
+
+};
@@ -0,0 +1,103 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _OCCLUSIONMAP_H_
+#define _OCCLUSIONMAP_H_
+
+#include "tnlTypes.h"
+#include "tnlVector.h"
+#include "point.h"
+
+using namespace TNL;
+
+namespace Zap
+{
+
+class GridDatabase;
+
+/// OcclusionMap answers whether barriers block the view from a fixed point,
+/// for objects that never move, like turrets.
+///
+/// The circle around the origin is split into wedges.  For each wedge the
+/// map keeps the distance to the nearest barrier inside it, and the
+/// distance beyond which a single barrier edge blocks the whole wedge.
+/// A point nearer than the first is certainly visible, and a point beyond
+/// the second is certainly hidden; only points in the thin band between
+/// the two, around the outlines of the barriers, still need a ray cast.
+///
+/// Both distances are exact, not sampled: the nearest point of an edge in
+/// a wedge is an edge end point, a crossing of the wedge's sides or the
+/// foot of the perpendicular from the origin, and an edge crossing both
+/// sides of a wedge is no further away anywhere in between than at the
+/// two crossings.
+///
+/// Barriers don't change once a level is loaded, so a map never has to be
+/// rebuilt.
+class OcclusionMap
+{
+public:
+   enum {
+      WedgeCount = 1024,
+   };
+
+   enum Visibility {
+      Visible,
+      Hidden,
+      Unknown,    ///< Too close to a barrier's outline, or out of range; cast a ray.
+   };
+
+private:
+   Point mOrigin;
+   F32 mRadius;
+   F32 mNearest[WedgeCount];     ///< Distance to the nearest barrier in each wedge.
+   F32 mBlocked[WedgeCount];     ///< Distance beyond which each wedge is blocked.
+   bool mBuilt;
+
+   static Point mWedgeSides[WedgeCount];
+   static bool mWedgeSidesInitialized;
+
+   static U32 getWedge(Point delta);
+   void addPoint(Point p);
+   void addEdge(Point p1, Point p2);
+public:
+   OcclusionMap();
+
+   /// Builds the map for barriers within radius of origin.
+   void build(GridDatabase *database, Point origin, F32 radius);
+
+   bool isBuilt() { return mBuilt; }
+
+   /// Returns whether barriers hide the point from the origin.
+   Visibility test(Point p);
+
+   /// Returns the distance from the origin along dir that's certainly clear
+   /// of barriers.
+   F32 getClearDistance(Point dir);
+};
+
+};
+
+#endif
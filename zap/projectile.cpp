@@ -37,6 +37,14 @@ namespace Zap
 {
 
 TNL_IMPLEMENT_NETOBJECT(Projectile);
+TNL_IMPLEMENT_FREE_LIST_ALLOCATOR(Projectile);
+
+// a projectile's state is coded as a pair, with its own model for initial
+// updates, since a projectile is always alive and uncollided when it's
+// first ghosted and its later updates are mostly its end.
+static CodedField ProjectileInitialField("Projectile initial", 1);
+static CodedField ProjectileInitialStateField("Projectile initial state", 2);
+static CodedField ProjectileStateField("Projectile state", 2);
 
 Projectile::Projectile(U32 type, Point p, Point v, U32 t, GameObject *shooter)
 {
@@ -59,7 +67,8 @@ Projectile::Projectile(U32 type, Point p, Point v, U32 t, GameObject *shooter)
 
 U32 Projectile::packUpdate(GhostConnection *connection, U32 updateMask, BitStream *stream)
 {
-   if(stream->writeFlag(updateMask & InitialMask))
+   bool initial = updateMask & InitialMask;
+   if(stream->writeCodedFlag(initial, ProjectileInitialField))
    {
       ((GameConnection *) connection)->writeCompressedPoint(pos, stream);
       writeCompressedVelocity(velocity, CompressedVelocityMax, stream);
@@ -72,8 +81,7 @@ U32 Projectile::packUpdate(GhostConnection *connection, U32 updateMask, BitStrea
       if(stream->writeFlag(index != -1))
          stream->writeInt(index, GhostConnection::GhostIdBitSize);
    }
-   stream->writeFlag(collided);
-   stream->writeFlag(alive);
+   stream->writeCodedInt((collided << 1) | alive, 2, initial ? ProjectileInitialStateField : ProjectileStateField);
    return 0;
 }
 
@@ -81,7 +89,7 @@ void Projectile::unpackUpdate(GhostConnection *connection, BitStream *stream)
 {
    bool initial = false;
 
-   if(stream->readFlag())
+   if(stream->readCodedFlag(ProjectileInitialField))
    {
       ((GameConnection *) connection)->readCompressedPoint(pos, stream);
       readCompressedVelocity(velocity, CompressedVelocityMax, stream);
@@ -97,8 +105,9 @@ void Projectile::unpackUpdate(GhostConnection *connection, BitStream *stream)
       SFXObject::play(gProjInfo[mType].projectileSound, pos, velocity);
    }
    bool preCollided = collided;
-   collided = stream->readFlag();
-   alive = stream->readFlag();
+   U32 state = stream->readCodedInt(2, initial ? ProjectileInitialStateField : ProjectileStateField);
+   collided = (state & 2) != 0;
+   alive = (state & 1) != 0;
 
    if(!preCollided && collided)
       explode(NULL, pos);
@@ -238,6 +247,7 @@ void Projectile::render()
 
 //-----------------------------------------------------------------------------
 TNL_IMPLEMENT_NETOBJECT(Mine);
+TNL_IMPLEMENT_FREE_LIST_ALLOCATOR(Mine);
 
 Mine::Mine(Point pos, Ship *planter)
  : GrenadeProjectile(pos, Point())
@@ -368,6 +378,7 @@ void Mine::renderItem(Point pos)
 
 //-----------------------------------------------------------------------------
 TNL_IMPLEMENT_NETOBJECT(GrenadeProjectile);
+TNL_IMPLEMENT_FREE_LIST_ALLOCATOR(GrenadeProjectile);
 
 GrenadeProjectile::GrenadeProjectile(Point pos, Point vel, U32 liveTime, GameObject *shooter)
  : Item(pos, true, 7.f, 1.f)
@@ -31,6 +31,7 @@
 #include "gameObject.h"
 #include "item.h"
 #include "gameWeapons.h"
+#include "tnlDataChunker.h"
 namespace Zap
 {
 
@@ -68,6 +69,7 @@ public:
 
    void render();
    TNL_DECLARE_CLASS(Projectile);
+   TNL_DECLARE_FREE_LIST_ALLOCATOR(Projectile);
 };
 
 class GrenadeProjectile : public Item
@@ -96,6 +98,7 @@ public:
    void unpackUpdate(GhostConnection *connection, BitStream *stream);
 
    TNL_DECLARE_CLASS(GrenadeProjectile);
+   TNL_DECLARE_FREE_LIST_ALLOCATOR(GrenadeProjectile);
 };
 
 class Mine : public GrenadeProjectile
@@ -126,6 +129,7 @@ public:
    void unpackUpdate(GhostConnection *connection, BitStream *stream);
 
    TNL_DECLARE_CLASS(Mine);
+   TNL_DECLARE_FREE_LIST_ALLOCATOR(Mine);
 };
 
 };
@@ -39,6 +39,7 @@ namespace Zap
 TNL_IMPLEMENT_NETOBJECT_RPC(RabbitGameType, s2cRabbitMessage, (U32 msgIndex, StringTableEntry clientName), (msgIndex, clientName),
    NetClassGroupGameMask, RPCGuaranteedOrdered, RPCToGhost, 0)
 {
+#ifndef ZAP_DEDICATED
    switch (msgIndex)
    {
    case RabbitMsgGrab:
@@ -80,6 +81,7 @@ TNL_IMPLEMENT_NETOBJECT_RPC(RabbitGameType, s2cRabbitMessage, (U32 msgIndex, Str
                   "No top rabbit - Carrot wins by default!");
       break;
    }
+#endif
 }
 
 //-----------------------------------------------------
@@ -0,0 +1,579 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "serverBrowser.h"
+#include "gameNetInterface.h"
+#include "tnlLog.h"
+
+namespace Zap
+{
+
+ServerBrowser::ServerBrowser()
+{
+   mInterface = NULL;
+   mLastUsedServerId = 0;
+   mBroadcastPingSendTime = 0;
+   mNonceTableMask = 0;
+   mAddressTableMask = 0;
+   setLimits(DefaultWindowSize, DefaultSendRate);
+   clear();
+}
+
+void ServerBrowser::setLimits(U32 windowSize, U32 sendRate)
+{
+   mWindowSize = windowSize ? windowSize : 1;
+   if(mWindowSize > MaxWindowSize)
+      mWindowSize = MaxWindowSize;
+   mSendRate = sendRate ? sendRate : 1;
+
+   // keep the nonce table at most half full.
+   U32 tableSize = 1;
+   while(tableSize < mWindowSize * 2)
+      tableSize <<= 1;
+   if(tableSize - 1 != mNonceTableMask)
+      resizeNonceTable(tableSize - 1);
+}
+
+void ServerBrowser::clear()
+{
+   mServers.clear();
+   mFreeSlots.clear();
+   mOrder.clear();
+   mPingQueue.clear();
+   mPingQueueHead = 0;
+   mQueryQueue.clear();
+   mQueryQueueHead = 0;
+   mOutstanding.clear();
+   resizeNonceTable(mNonceTableMask);
+   resizeAddressTable(15);
+
+   mBroadcastNonce.getRandom();
+   mSendCredit = 0;
+   mChanged = true;
+   mLastIdleTime = Platform::getRealMilliseconds();
+   mSmoothedRTT = -1;
+   mRTTVariance = 0;
+   memset(&mStats, 0, sizeof(mStats));
+}
+
+//------------------------------------------------------------------------------------
+
+U32 ServerBrowser::hashNonce(const Nonce &nonce)
+{
+   // nonces are random, so any mix of their bytes will do.
+   U32 a = nonce.data[0] | (nonce.data[1] << 8) | (nonce.data[2] << 16) | (nonce.data[3] << 24);
+   U32 b = nonce.data[4] | (nonce.data[5] << 8) | (nonce.data[6] << 16) | (nonce.data[7] << 24);
+   return (a ^ (b * 0x9E3779B1)) * 0x85EBCA6B;
+}
+
+U32 ServerBrowser::hashAddress(const Address &address, bool isFromMaster)
+{
+   U32 hash = (address.netNum[0] ^ (address.port << 16) ^ (isFromMaster ? 0x5BD1E995 : 0)) * 0x9E3779B1;
+   return hash ^ (hash >> 15);
+}
+
+void ServerBrowser::insertSlot(Vector<S32> &table, U32 mask, S32 slot, HashFunction hash)
+{
+   U32 entry = (this->*hash)(slot) & mask;
+   while(table[entry] != -1)
+      entry = (entry + 1) & mask;
+   table[entry] = slot;
+}
+
+void ServerBrowser::removeSlot(Vector<S32> &table, U32 mask, S32 slot, HashFunction hash)
+{
+   U32 entry = (this->*hash)(slot) & mask;
+   while(table[entry] != slot)
+   {
+      if(table[entry] == -1)
+         return;
+      entry = (entry + 1) & mask;
+   }
+
+   // shift back any following entries that would no longer be found past
+   // the hole, so lookups can still stop at the first empty entry.
+   U32 hole = entry;
+   for(;;)
+   {
+      entry = (entry + 1) & mask;
+      S32 index = table[entry];
+      if(index == -1)
+         break;
+      U32 home = (this->*hash)(index) & mask;
+      if(((entry - home) & mask) >= ((entry - hole) & mask))
+      {
+         table[hole] = index;
+         hole = entry;
+      }
+   }
+   table[hole] = -1;
+}
+
+S32 ServerBrowser::findNonce(const Nonce &nonce, const Address &address)
+{
+   U32 entry = hashNonce(nonce) & mNonceTableMask;
+   for(;;)
+   {
+      S32 slot = mNonceTable[entry];
+      if(slot == -1)
+         return -1;
+      if(mServers[slot].sendNonce == nonce && mServers[slot].serverAddress == address)
+         return slot;
+      entry = (entry + 1) & mNonceTableMask;
+   }
+}
+
+S32 ServerBrowser::findAddress(const Address &address, bool isFromMaster)
+{
+   U32 entry = hashAddress(address, isFromMaster) & mAddressTableMask;
+   for(;;)
+   {
+      S32 slot = mAddressTable[entry];
+      if(slot == -1)
+         return -1;
+      if(mServers[slot].serverAddress == address && mServers[slot].isFromMaster == isFromMaster)
+         return slot;
+      entry = (entry + 1) & mAddressTableMask;
+   }
+}
+
+void ServerBrowser::resizeNonceTable(U32 mask)
+{
+   mNonceTableMask = mask;
+   mNonceTable.setSize(mask + 1);
+   for(U32 i = 0; i <= mask; i++)
+      mNonceTable[i] = -1;
+   for(S32 i = 0; i < mOutstanding.size(); i++)
+      insertSlot(mNonceTable, mNonceTableMask, mOutstanding[i], &ServerBrowser::getNonceHash);
+}
+
+void ServerBrowser::resizeAddressTable(U32 mask)
+{
+   mAddressTableMask = mask;
+   mAddressTable.setSize(mask + 1);
+   for(U32 i = 0; i <= mask; i++)
+      mAddressTable[i] = -1;
+   for(S32 i = 0; i < mOrder.size(); i++)
+      insertSlot(mAddressTable, mAddressTableMask, mOrder[i], &ServerBrowser::getAddressHash);
+}
+
+void ServerBrowser::addOutstanding(S32 slot)
+{
+   mServers[slot].outstandingSlot = mOutstanding.size();
+   mOutstanding.push_back(slot);
+   insertSlot(mNonceTable, mNonceTableMask, slot, &ServerBrowser::getNonceHash);
+}
+
+void ServerBrowser::removeOutstanding(S32 slot)
+{
+   Server &s = mServers[slot];
+   S32 index = s.outstandingSlot;
+   S32 last = mOutstanding[mOutstanding.size() - 1];
+   mOutstanding[index] = last;
+   mServers[last].outstandingSlot = index;
+   mOutstanding.pop_back();
+   s.outstandingSlot = -1;
+   removeSlot(mNonceTable, mNonceTableMask, slot, &ServerBrowser::getNonceHash);
+}
+
+void ServerBrowser::addRTTSample(U32 rtt)
+{
+   // the usual TCP estimator: a gain of 1/8 on the mean and 1/4 on the
+   // mean deviation, in fixed point.
+   S32 sample = S32(rtt);
+   if(mSmoothedRTT == -1)
+   {
+      mSmoothedRTT = sample << 3;
+      mRTTVariance = sample << 1;
+      return;
+   }
+   S32 delta = sample - (mSmoothedRTT >> 3);
+   mSmoothedRTT += delta;
+   if(delta < 0)
+      delta = -delta;
+   mRTTVariance += delta - (mRTTVariance >> 2);
+}
+
+U32 ServerBrowser::getTimeout()
+{
+   if(mSmoothedRTT == -1)
+      return InitialTimeout;
+   U32 timeout = U32((mSmoothedRTT >> 3) + mRTTVariance);
+   if(timeout < MinTimeout)
+      return MinTimeout;
+   if(timeout > MaxTimeout)
+      return MaxTimeout;
+   return timeout;
+}
+
+//------------------------------------------------------------------------------------
+
+S32 ServerBrowser::addServer(const Address &address, bool isFromMaster)
+{
+   S32 slot;
+   if(mFreeSlots.size())
+   {
+      slot = mFreeSlots[mFreeSlots.size() - 1];
+      mFreeSlots.pop_back();
+   }
+   else
+   {
+      slot = mServers.size();
+      mServers.setSize(slot + 1);
+   }
+   Server &s = mServers[slot];
+   s.state = Server::Start;
+   s.id = ++mLastUsedServerId;
+   s.pingTime = UnknownPing;
+   s.identityToken = 0;
+   s.lastSendTime = 0;
+   s.sendCount = 0;
+   s.isFromMaster = isFromMaster;
+   s.dedicated = false;
+   s.passwordRequired = false;
+   s.sendNonce.getRandom();
+   s.serverAddress = address;
+   s.playerCount = s.maxPlayers = -1;
+   s.outstandingSlot = -1;
+   strcpy(s.serverName, isFromMaster ? "Internet Server" : "LAN Server");
+
+   mOrder.push_back(slot);
+   if(U32(mOrder.size()) * 2 > mAddressTableMask + 1)
+      resizeAddressTable(mAddressTableMask * 2 + 1);
+   else
+      insertSlot(mAddressTable, mAddressTableMask, slot, &ServerBrowser::getAddressHash);
+   return slot;
+}
+
+void ServerBrowser::sendBroadcastPing(U16 port)
+{
+   if(!mInterface)
+      return;
+   Address broadcastAddress(IPProtocol, Address::Broadcast, port);
+   mBroadcastPingSendTime = Platform::getRealMilliseconds();
+   mInterface->sendPing(broadcastAddress, mBroadcastNonce);
+}
+
+void ServerBrowser::addServers(const Vector<IPAddress> &ipList)
+{
+   for(S32 i = 0; i < ipList.size(); i++)
+      mPingQueue.push_back(addServer(Address(ipList[i]), true));
+}
+
+void ServerBrowser::refreshServers(const Vector<IPAddress> &ipList)
+{
+   Vector<IPAddress> newServers;
+   for(S32 i = 0; i < ipList.size(); i++)
+   {
+      S32 slot = findAddress(Address(ipList[i]), true);
+      if(slot == -1)
+         newServers.push_back(ipList[i]);
+      else if(mServers[slot].state == Server::ReceivedQuery)
+      {
+         // a ping or query in flight or queued will pick up the new
+         // status anyway.
+         mServers[slot].state = Server::Start;
+         mServers[slot].sendCount = 0;
+         mPingQueue.push_back(slot);
+      }
+   }
+   addServers(newServers);
+}
+
+void ServerBrowser::removeServers(const Vector<IPAddress> &ipList)
+{
+   bool removed = false;
+   for(S32 i = 0; i < ipList.size(); i++)
+   {
+      S32 slot = findAddress(Address(ipList[i]), true);
+      if(slot == -1)
+         continue;
+
+      // queued requests for the slot are skipped by their state check.
+      if(mServers[slot].outstandingSlot != -1)
+         removeOutstanding(slot);
+      removeSlot(mAddressTable, mAddressTableMask, slot, &ServerBrowser::getAddressHash);
+      mServers[slot].state = Server::Removed;
+      mFreeSlots.push_back(slot);
+      removed = true;
+   }
+   if(!removed)
+      return;
+
+   // close up the display order in one pass.
+   S32 count = 0;
+   for(S32 i = 0; i < mOrder.size(); i++)
+   {
+      S32 slot = mOrder[i];
+      if(mServers[slot].state != Server::Removed)
+         mOrder[count++] = slot;
+   }
+   mOrder.setSize(count);
+   mChanged = true;
+}
+
+S32 ServerBrowser::findServer(U32 id)
+{
+   for(S32 i = 0; i < mOrder.size(); i++)
+      if(mServers[mOrder[i]].id == id)
+         return i;
+   return -1;
+}
+
+//------------------------------------------------------------------------------------
+
+void ServerBrowser::gotPingResponse(const Address &theAddress, const Nonce &theNonce, U32 clientIdentityToken)
+{
+   U32 time = Platform::getRealMilliseconds();
+
+   // see if this ping is a server from the local broadcast ping:
+   if(mBroadcastNonce == theNonce)
+   {
+      if(findAddress(theAddress, false) != -1)
+         return;
+
+      S32 index = addServer(theAddress, false);
+      Server &s = mServers[index];
+      s.pingTime = time - mBroadcastPingSendTime;
+      s.state = Server::ReceivedPing;
+      s.sendNonce = theNonce;
+      s.identityToken = clientIdentityToken;
+      mQueryQueue.push_back(index);
+      mChanged = true;
+      return;
+   }
+
+   S32 index = findNonce(theNonce, theAddress);
+   if(index == -1 || mServers[index].state != Server::SentPing)
+   {
+      mStats.unmatchedResponses++;
+      return;
+   }
+   mStats.responses++;
+
+   Server &s = mServers[index];
+   removeOutstanding(index);
+
+   U32 rtt = time - s.lastSendTime;
+   addRTTSample(rtt);
+   if(s.pingTime == UnknownPing)
+      s.pingTime = rtt;
+   else
+      s.pingTime = (s.pingTime * 7 + rtt) >> 3;
+
+   s.state = Server::ReceivedPing;
+   s.identityToken = clientIdentityToken;
+   s.sendCount = 0;
+   mQueryQueue.push_back(index);
+   mChanged = true;
+}
+
+void ServerBrowser::gotQueryResponse(const Address &theAddress, const Nonce &clientNonce, const char *serverName, U32 playerCount, U32 maxPlayers, bool dedicated, bool passwordRequired)
+{
+   S32 index = findNonce(clientNonce, theAddress);
+   if(index == -1 || mServers[index].state != Server::SentQuery)
+   {
+      mStats.unmatchedResponses++;
+      return;
+   }
+   mStats.responses++;
+
+   Server &s = mServers[index];
+   removeOutstanding(index);
+
+   s.playerCount = playerCount;
+   s.maxPlayers = maxPlayers;
+   s.dedicated = dedicated;
+   s.passwordRequired = passwordRequired;
+   dSprintf(s.serverName, sizeof(s.serverName), "%s", serverName);
+   s.state = Server::ReceivedQuery;
+   mChanged = true;
+}
+
+void ServerBrowser::sendPing(S32 slot, U32 time)
+{
+   Server &s = mServers[slot];
+   s.sendCount++;
+   if(s.sendCount > RetryCount)
+   {
+      s.pingTime = 999;
+      strcpy(s.serverName, "PingTimedOut");
+      s.playerCount = 0;
+      s.maxPlayers = 0;
+      s.state = Server::ReceivedQuery;
+      mChanged = true;
+      return;
+   }
+   s.state = Server::SentPing;
+   s.lastSendTime = time;
+   s.sendNonce.getRandom();
+   addOutstanding(slot);
+   mInterface->sendPing(s.serverAddress, s.sendNonce);
+   mStats.pingsSent++;
+}
+
+void ServerBrowser::sendQuery(S32 slot, U32 time)
+{
+   Server &s = mServers[slot];
+   s.sendCount++;
+   if(s.sendCount > RetryCount)
+   {
+      strcpy(s.serverName, "QueryTimedOut");
+      s.playerCount = s.maxPlayers = 0;
+      s.state = Server::ReceivedQuery;
+      mChanged = true;
+      return;
+   }
+
+   // the query goes out with the ping's nonce, which the server's identity
+   // token was computed from.
+   s.state = Server::SentQuery;
+   s.lastSendTime = time;
+   addOutstanding(slot);
+   mInterface->sendQuery(s.serverAddress, s.sendNonce, s.identityToken);
+   mStats.queriesSent++;
+}
+
+bool ServerBrowser::idle()
+{
+   U32 time = Platform::getRealMilliseconds();
+
+   // time out stale requests and queue them to be sent again.
+   U32 timeout = getTimeout();
+   for(S32 i = 0; i < mOutstanding.size(); )
+   {
+      S32 index = mOutstanding[i];
+      Server &s = mServers[index];
+      if(time - s.lastSendTime <= timeout)
+      {
+         i++;
+         continue;
+      }
+      removeOutstanding(index);
+      mStats.timeouts++;
+      if(s.state == Server::SentPing)
+      {
+         s.state = Server::Start;
+         mPingQueue.push_back(index);
+      }
+      else
+      {
+         s.state = Server::ReceivedPing;
+         mQueryQueue.push_back(index);
+      }
+   }
+
+   mSendCredit += (time - mLastIdleTime) * mSendRate * 0.001f;
+   mLastIdleTime = time;
+
+   // don't let credit pile up while there's nothing to send.
+   F32 maxCredit = mWindowSize < mSendRate ? F32(mWindowSize) : F32(mSendRate);
+   if(mSendCredit > maxCredit)
+      mSendCredit = maxCredit;
+
+   if(mInterface)
+      sendRequests(time);
+
+   bool changed = mChanged;
+   mChanged = false;
+   return changed;
+}
+
+void ServerBrowser::sendRequests(U32 time)
+{
+
+   // queries first, since they finish off servers that have already been
+   // pinged.
+   while(mSendCredit >= 1 && U32(mOutstanding.size()) < mWindowSize)
+   {
+      S32 index;
+      if(mQueryQueueHead < mQueryQueue.size())
+      {
+         index = mQueryQueue[mQueryQueueHead++];
+         if(mServers[index].state != Server::ReceivedPing)
+            continue;
+         sendQuery(index, time);
+      }
+      else if(mPingQueueHead < mPingQueue.size())
+      {
+         index = mPingQueue[mPingQueueHead++];
+         if(mServers[index].state != Server::Start)
+            continue;
+         sendPing(index, time);
+      }
+      else
+         break;
+      mSendCredit -= 1;
+   }
+
+   if(mQueryQueueHead == mQueryQueue.size())
+   {
+      mQueryQueue.clear();
+      mQueryQueueHead = 0;
+   }
+   if(mPingQueueHead == mPingQueue.size())
+   {
+      mPingQueue.clear();
+      mPingQueueHead = 0;
+   }
+}
+
+bool ServerBrowser::isFinished()
+{
+   return !mOutstanding.size() && mPingQueueHead == mPingQueue.size() &&
+          mQueryQueueHead == mQueryQueue.size();
+}
+
+/// qsort has no context argument, so the order list is sorted through
+/// these while sort() runs.
+static ServerBrowser::Server *gSortServers;
+static ServerBrowser::CompareFunction gSortCompare;
+
+static S32 QSORT_CALLBACK compareSlots(const void *a, const void *b)
+{
+   return gSortCompare(gSortServers + *((const S32 *) a), gSortServers + *((const S32 *) b));
+}
+
+void ServerBrowser::sort(CompareFunction compare, bool ascending)
+{
+   gSortServers = mServers.address();
+   gSortCompare = compare;
+   qsort(mOrder.address(), mOrder.size(), sizeof(S32), compareSlots);
+   if(!ascending)
+   {
+      S32 size = mOrder.size() / 2;
+      S32 totalSize = mOrder.size();
+
+      for(S32 i = 0; i < size; i++)
+      {
+         S32 temp = mOrder[i];
+         mOrder[i] = mOrder[totalSize - i - 1];
+         mOrder[totalSize - i - 1] = temp;
+      }
+   }
+}
+
+};
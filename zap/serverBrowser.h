@@ -0,0 +1,221 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _SERVERBROWSER_H_
+#define _SERVERBROWSER_H_
+
+#include "tnlTypes.h"
+#include "tnlVector.h"
+#include "tnlNonce.h"
+#include "tnlUDP.h"
+
+using namespace TNL;
+
+namespace Zap
+{
+
+class GameNetInterface;
+
+/// ServerBrowser pings and queries a list of game servers and keeps their
+/// status, independent of any user interface.
+///
+/// Requests go out in rate limited batches, with at most a window's worth
+/// outstanding at once.  A server's query is sent as soon as its ping is
+/// answered, rather than after every ping has come back.  Responses are
+/// matched to their server by nonce through a small open addressed hash
+/// table of the outstanding requests, and request timeouts follow a
+/// smoothed round trip time kept from all the ping responses so far.
+///
+/// Servers keep their slot in the browser's server storage for as long as
+/// they are listed, so the request queues and tables refer to them by slot
+/// and are updated as servers are added, answered and removed.  A separate
+/// order list holds the slots in display order; sort() only reorders that.
+/// Servers from the master and from the local broadcast are also found by
+/// address through a hash table, so refreshing or removing a list of
+/// servers costs time in the length of that list.
+class ServerBrowser
+{
+public:
+   enum {
+      MaxServerNameLen = 20,
+      DefaultWindowSize = 64,       ///< Default number of outstanding pings and queries.
+      DefaultSendRate = 400,        ///< Default pings and queries sent per second.
+      MaxWindowSize = 1024,
+      InitialTimeout = 1500,        ///< Request timeout before any round trip time is known.
+      MinTimeout = 250,
+      MaxTimeout = 3000,
+      RetryCount = 3,
+      UnknownPing = 9999,
+   };
+
+   struct Server
+   {
+      enum State
+      {
+         Start,
+         SentPing,
+         ReceivedPing,
+         SentQuery,
+         ReceivedQuery,
+         Removed,      ///< The slot is free.
+      };
+      U32 state;
+      U32 id;
+      U32 pingTime;        ///< Smoothed round trip time, in milliseconds.
+      U32 identityToken;
+      U32 lastSendTime;
+      U32 sendCount;
+      bool isFromMaster;
+      bool dedicated;
+      bool passwordRequired;
+      Nonce sendNonce;
+      char serverName[MaxServerNameLen+1];
+      Address serverAddress;
+      S32 playerCount, maxPlayers;
+      S32 outstandingSlot; ///< Index in the outstanding request list, or -1.
+   };
+
+   /// Counters for a browse, reset by clear().
+   struct Stats
+   {
+      U32 pingsSent;
+      U32 queriesSent;
+      U32 timeouts;
+      U32 responses;
+      U32 unmatchedResponses;  ///< Responses with a stale or unknown nonce.
+   };
+
+   typedef S32 (QSORT_CALLBACK *CompareFunction)(const void *a, const void *b);
+
+private:
+   GameNetInterface *mInterface;
+   Vector<Server> mServers;      ///< Server storage, by slot.
+   Vector<S32> mFreeSlots;       ///< Slots of removed servers, for reuse.
+   Vector<S32> mOrder;           ///< Slots of the listed servers in display order.
+   U32 mLastUsedServerId;
+
+   Nonce mBroadcastNonce;
+   U32 mBroadcastPingSendTime;
+
+   U32 mWindowSize;
+   U32 mSendRate;
+   F32 mSendCredit;
+   U32 mLastIdleTime;
+   bool mChanged;          ///< Set when a server's displayed status changes.
+
+   S32 mSmoothedRTT;       ///< In 1/8 milliseconds, -1 until the first sample.
+   S32 mRTTVariance;       ///< In 1/4 milliseconds.
+
+   Vector<S32> mPingQueue;
+   S32 mPingQueueHead;
+   Vector<S32> mQueryQueue;
+   S32 mQueryQueueHead;
+   Vector<S32> mOutstanding;
+
+   /// Open addressed table of outstanding request nonces, holding server
+   /// slots, or -1 for an empty entry.
+   Vector<S32> mNonceTable;
+   U32 mNonceTableMask;
+
+   /// Open addressed table of all listed servers by address, kept at most
+   /// half full.
+   Vector<S32> mAddressTable;
+   U32 mAddressTableMask;
+
+   Stats mStats;
+
+   typedef U32 (ServerBrowser::*HashFunction)(S32 slot);
+   static U32 hashNonce(const Nonce &nonce);
+   static U32 hashAddress(const Address &address, bool isFromMaster);
+   U32 getNonceHash(S32 slot) { return hashNonce(mServers[slot].sendNonce); }
+   U32 getAddressHash(S32 slot) { return hashAddress(mServers[slot].serverAddress, mServers[slot].isFromMaster); }
+   void insertSlot(Vector<S32> &table, U32 mask, S32 slot, HashFunction hash);
+   void removeSlot(Vector<S32> &table, U32 mask, S32 slot, HashFunction hash);
+   S32 findNonce(const Nonce &nonce, const Address &address);
+   S32 findAddress(const Address &address, bool isFromMaster);
+   void resizeNonceTable(U32 mask);
+   void resizeAddressTable(U32 mask);
+
+   void addOutstanding(S32 slot);
+   void removeOutstanding(S32 slot);
+   void addRTTSample(U32 rtt);
+   U32 getTimeout();
+
+   void sendPing(S32 slot, U32 time);
+   void sendQuery(S32 slot, U32 time);
+   void sendRequests(U32 time);
+   S32 addServer(const Address &address, bool isFromMaster);
+public:
+   ServerBrowser();
+
+   /// Sets the interface pings and queries are sent from.  The interface
+   /// passes ping and query responses back through gotPingResponse and
+   /// gotQueryResponse.
+   void setInterface(GameNetInterface *theInterface) { mInterface = theInterface; }
+
+   /// Sets the number of outstanding requests and the send rate.
+   void setLimits(U32 windowSize, U32 sendRate);
+
+   /// Forgets all servers and outstanding requests.
+   void clear();
+
+   /// Pings the local network for servers on the given port.
+   void sendBroadcastPing(U16 port);
+
+   /// Adds servers from the master's list.
+   void addServers(const Vector<IPAddress> &ipList);
+
+   /// Pings and queries the given master servers again, adding any that
+   /// aren't listed.
+   void refreshServers(const Vector<IPAddress> &ipList);
+
+   /// Removes the given master servers.
+   void removeServers(const Vector<IPAddress> &ipList);
+
+   void gotPingResponse(const Address &theAddress, const Nonce &clientNonce, U32 clientIdentityToken);
+   void gotQueryResponse(const Address &theAddress, const Nonce &clientNonce, const char *serverName, U32 playerCount, U32 maxPlayers, bool dedicated, bool passwordRequired);
+
+   /// Times out stale requests and sends what the window and send rate
+   /// allow.  Returns true if any server's displayed status changed since
+   /// the last call.
+   bool idle();
+
+   /// Returns true when every server has answered or timed out.
+   bool isFinished();
+
+   /// Sorts the servers with a qsort style compare function.
+   void sort(CompareFunction compare, bool ascending);
+
+   /// Servers are numbered in display order.
+   S32 getServerCount() { return mOrder.size(); }
+   Server &getServer(S32 index) { return mServers[mOrder[index]]; }
+   S32 findServer(U32 id);
+   const Stats &getStats() { return mStats; }
+};
+
+};
+
+#endif
@@ -247,17 +247,6 @@ void SFXObject::queueBuffer(ByteBufferPtr p)
       ALuint buffer = gVoiceFreeBuffers.first();
       gVoiceFreeBuffers.pop_front();
 
-      S16 max = 0;
-      S16 *ptr = (S16 *) p->getBuffer();
-      U32 count = p->getBufferSize() / 2;
-      while(count--)
-      {
-         if(max < *ptr)
-            max = *ptr;
-         ptr++;
-      }
-
-      //logprintf("queued buffer %d - %d max %d len\n", buffer, max, mInitialBuffer->getBufferSize());
       alBufferData(buffer, AL_FORMAT_MONO16, mInitialBuffer->getBuffer(),
             mInitialBuffer->getBufferSize(), 8000);
       alSourceQueueBuffers(source, 1, &buffer);
@@ -763,10 +752,10 @@ void SFXObject::captureSamples(ByteBufferPtr buffer)
          {
             if(synthCount == 0)
             {
-               if(Random::readI(0, 16) < 4)
-                  curSynth = Random::readI(0, 65535);
+               if(FastRandom::get().readI(0, 16) < 4)
+                  curSynth = FastRandom::get().readI(0, 65535);
 
-               synthGoal = Random::readI(0, 32000);
+               synthGoal = FastRandom::get().readI(0, 32000);
                synthCount = 25;
             }
             synthCount--;
@@ -37,6 +37,7 @@
 #include "UIGame.h"
 #include "gameType.h"
 #include "gameConnection.h"
+#include "gameNetInterface.h"
 #include "shipItems.h"
 #include "gameWeapons.h"
 #include "gameObjectRender.h"
@@ -591,6 +592,57 @@ void Ship::readControlState(BitStream *stream)
    mWeapon[mActiveWeapon] = stream->readRangedU32(0, WeaponCount);
 }
 
+bool Ship::controlStateMatches(BitStream *serverState, BitStream *predictedState)
+{
+   // position and velocity are normalized to 1/128th after every
+   // control move, so allow them to be off by one normalization step.
+   const F32 ShipControlStateTolerance = 1 / 128.0f;
+
+   BitStream *streams[2] = { serverState, predictedState };
+   Point pos[2], vel[2];
+   U32 energy[2], fireTimer[2], weapon[2];
+   bool cooldown[2];
+
+   for(U32 i = 0; i < 2; i++)
+   {
+      streams[i]->read(&pos[i].x);
+      streams[i]->read(&pos[i].y);
+      streams[i]->read(&vel[i].x);
+      streams[i]->read(&vel[i].y);
+      energy[i] = streams[i]->readRangedU32(0, EnergyMax);
+      cooldown[i] = streams[i]->readFlag();
+      fireTimer[i] = streams[i]->readRangedU32(0, MaxFireDelay);
+      weapon[i] = streams[i]->readRangedU32(0, WeaponCount);
+      if(!streams[i]->isValid())
+         return false;
+   }
+   Point posDelta = pos[0] - pos[1];
+   Point velDelta = vel[0] - vel[1];
+
+   return fabs(posDelta.x) <= ShipControlStateTolerance &&
+          fabs(posDelta.y) <= ShipControlStateTolerance &&
+          fabs(velDelta.x) <= ShipControlStateTolerance &&
+          fabs(velDelta.y) <= ShipControlStateTolerance &&
+          energy[0] == energy[1] &&
+          cooldown[0] == cooldown[1] &&
+          fireTimer[0] == fireTimer[1] &&
+          weapon[0] == weapon[1];
+}
+
+// the fields of a ship's updates that are entropy coded.  Ships are mostly
+// at full health or close to it, and most of their flags are mostly clear.
+static CodedField ShipHealthField("Ship health", 6);
+static CodedField ShipModuleField("Ship module", 3);
+static CodedField ShipSpeedField("Ship speed", 8);
+static CodedField ShipHealthMaskField("Ship health mask", 1);
+static CodedField ShipLoadoutMaskField("Ship loadout mask", 1);
+static CodedField ShipExplodedField("Ship exploded", 1);
+static CodedField ShipWarpField("Ship warp", 1);
+static CodedField ShipPositionMaskField("Ship position mask", 1);
+static CodedField ShipMoveMaskField("Ship move mask", 1);
+static CodedField ShipPowersMaskField("Ship powers mask", 1);
+static CodedField ShipModuleActiveField("Ship module active", 1);
+
 U32  Ship::packUpdate(GhostConnection *connection, U32 updateMask, BitStream *stream)
 {
    GameConnection *gameConnection = (GameConnection *) connection;
@@ -617,42 +669,49 @@ U32  Ship::packUpdate(GhostConnection *connection, U32 updateMask, BitStream *st
       }
       stream->writeFlag(false);
    }
-   if(stream->writeFlag(updateMask & HealthMask))
-      stream->writeFloat(mHealth, 6);
+   if(stream->writeCodedFlag(updateMask & HealthMask, ShipHealthMaskField))
+   {
+      NetProfileScope scope(stream, HealthMask);
+      stream->writeCodedFloat(mHealth, 6, ShipHealthField);
+   }
 
-   if(stream->writeFlag(updateMask & LoadoutMask))
+   if(stream->writeCodedFlag(updateMask & LoadoutMask, ShipLoadoutMaskField))
    {
-      stream->writeRangedU32(mModule[0], 0, ModuleCount);
-      stream->writeRangedU32(mModule[1], 0, ModuleCount);
+      NetProfileScope scope(stream, LoadoutMask);
+      stream->writeCodedRangedU32(mModule[0], 0, ModuleCount, ShipModuleField);
+      stream->writeCodedRangedU32(mModule[1], 0, ModuleCount, ShipModuleField);
    }
 
-   stream->writeFlag(hasExploded);
+   stream->writeCodedFlag(hasExploded, ShipExplodedField);
 
    bool shouldWritePosition = (updateMask & InitialMask) || 
       gameConnection->getControlObject() != this;
 
-   stream->writeFlag(updateMask & WarpPositionMask);
+   stream->writeCodedFlag(updateMask & WarpPositionMask, ShipWarpField);
    if(!shouldWritePosition)
    {
-      stream->writeFlag(false);
-      stream->writeFlag(false);
-      stream->writeFlag(false);
+      stream->writeCodedFlag(false, ShipPositionMaskField);
+      stream->writeCodedFlag(false, ShipMoveMaskField);
+      stream->writeCodedFlag(false, ShipPowersMaskField);
    }
    else
    {
-      if(stream->writeFlag(updateMask & PositionMask))
+      if(stream->writeCodedFlag(updateMask & PositionMask, ShipPositionMaskField))
       {
+         NetProfileScope scope(stream, PositionMask);
          gameConnection->writeCompressedPoint(mMoveState[RenderState].pos, stream);
-         writeCompressedVelocity(mMoveState[RenderState].vel, BoostMaxVelocity + 1, stream);
+         writeCompressedVelocity(mMoveState[RenderState].vel, BoostMaxVelocity + 1, stream, &ShipSpeedField);
       }
-      if(stream->writeFlag(updateMask & MoveMask))
+      if(stream->writeCodedFlag(updateMask & MoveMask, ShipMoveMaskField))
       {
+         NetProfileScope scope(stream, MoveMask);
          mCurrentMove.pack(stream, NULL, false);
       }
-      if(stream->writeFlag(updateMask & PowersMask))
+      if(stream->writeCodedFlag(updateMask & PowersMask, ShipPowersMaskField))
       {
+         NetProfileScope scope(stream, PowersMask);
          for(S32 i = 0; i < ModuleCount; i++)
-            stream->writeFlag(mModuleActive[i]);
+            stream->writeCodedFlag(mModuleActive[i], ShipModuleActiveField);
       }
    }
    return 0;
@@ -660,6 +719,9 @@ U32  Ship::packUpdate(GhostConnection *connection, U32 updateMask, BitStream *st
 
 void Ship::unpackUpdate(GhostConnection *connection, BitStream *stream)
 {
+   // the initial update is read before the ship is added to a game.
+   Game *clientGame = ((GameNetInterface *) connection->getInterface())->getGame();
+
    bool positionChanged = false;
    bool wasInitialUpdate = false;
    bool playSpawnEffect = false;
@@ -671,7 +733,7 @@ void Ship::unpackUpdate(GhostConnection *connection, BitStream *stream)
 
       stream->readStringTableEntry(&mPlayerName);
       stream->read(&mass);
-      mTeam = stream->readRangedU32(0, gClientGame->getTeamCount()) - 1;
+      mTeam = stream->readRangedU32(0, clientGame->getTeamCount()) - 1;
 
       // read mounted items:
       while(stream->readFlag())
@@ -682,42 +744,42 @@ void Ship::unpackUpdate(GhostConnection *connection, BitStream *stream)
       }
    }
 
-   if(stream->readFlag())
-      mHealth = stream->readFloat(6);
+   if(stream->readCodedFlag(ShipHealthMaskField))
+      mHealth = stream->readCodedFloat(6, ShipHealthField);
 
-   if(stream->readFlag())
+   if(stream->readCodedFlag(ShipLoadoutMaskField))
    {
-      mModule[0] = stream->readRangedU32(0, ModuleCount);
-      mModule[1] = stream->readRangedU32(0, ModuleCount);
+      mModule[0] = stream->readCodedRangedU32(0, ModuleCount, ShipModuleField);
+      mModule[1] = stream->readCodedRangedU32(0, ModuleCount, ShipModuleField);
    }
 
-   bool explode = stream->readFlag();
-   bool warp = stream->readFlag();
+   bool explode = stream->readCodedFlag(ShipExplodedField);
+   bool warp = stream->readCodedFlag(ShipWarpField);
    if(warp)
       mWarpInTimer.reset(WarpFadeInTime);
 
-   if(stream->readFlag())
+   if(stream->readCodedFlag(ShipPositionMaskField))
    {
       ((GameConnection *) connection)->readCompressedPoint(mMoveState[ActualState].pos, stream);
-      readCompressedVelocity(mMoveState[ActualState].vel, BoostMaxVelocity + 1, stream);
+      readCompressedVelocity(mMoveState[ActualState].vel, BoostMaxVelocity + 1, stream, &ShipSpeedField);
       positionChanged = true;
    }
-   if(stream->readFlag())
+   if(stream->readCodedFlag(ShipMoveMaskField))
    {
       mCurrentMove = Move();
       mCurrentMove.unpack(stream, false);
    }
-   if(stream->readFlag())
+   if(stream->readCodedFlag(ShipPowersMaskField))
    {
       bool wasActive[ModuleCount];
       for(S32 i = 0; i < ModuleCount; i++)
       {
          wasActive[i] = mModuleActive[i];
-         mModuleActive[i] = stream->readFlag();
+         mModuleActive[i] = stream->readCodedFlag(ShipModuleActiveField);
          if(i == ModuleSensor && wasActive[i] != mModuleActive[i])
          {
             mSensorZoomTimer.reset(SensorZoomTime - mSensorZoomTimer.getCurrent(), SensorZoomTime);
-            mSensorStartTime = gClientGame->getCurrentTime();
+            mSensorStartTime = clientGame->getCurrentTime();
          }
          if(i == ModuleCloak && wasActive[i] != mModuleActive[i])
             mCloakTimer.reset(CloakFadeTime - mCloakTimer.getCurrent(), CloakFadeTime);
@@ -899,12 +961,12 @@ void Ship::emitShipExplosion(Point pos)
    SFXObject::play(SFXShipExplode, pos, Point());
 
    F32 a, b;
-   a = Random::readF() * 0.4 + 0.5;
-   b = Random::readF() * 0.2 + 0.9;
+   a = FastRandom::get().readF() * 0.4 + 0.5;
+   b = FastRandom::get().readF() * 0.2 + 0.9;
 
    F32 c, d;
-   c = Random::readF() * 0.15 + 0.125;
-   d = Random::readF() * 0.2 + 0.9;
+   c = FastRandom::get().readF() * 0.15 + 0.125;
+   d = FastRandom::get().readF() * 0.2 + 0.9;
 
    FXManager::emitExplosion(mMoveState[ActualState].pos, 0.9, ShipExplosionColors, NumShipExplosionColors);
    FXManager::emitBurst(pos, Point(a,c), Color(1,1,0.25), Color(1,0,0));
@@ -1037,7 +1099,7 @@ void Ship::emitMovementSparks()
              // shoot some sparks...
              if(th >= 0.2*velDir.len())
              {
-                Point chaos(TNL::Random::readF(),TNL::Random::readF());
+                Point chaos(TNL::FastRandom::get().readF(),TNL::FastRandom::get().readF());
                 chaos *= 5;
  
                 //interp give us some nice enginey colors...
@@ -1045,11 +1107,11 @@ void Ship::emitMovementSparks()
                 Color light(1, 1, boostActive ? 1.f : 0.f);
                 Color thrust;
   
-                F32 t = TNL::Random::readF();
+                F32 t = TNL::FastRandom::get().readF();
                 thrust.interp(t, dim, light);
   
                 FXManager::emitSpark(mMoveState[RenderState].pos - shipDirs[i] * 13,
-                     -shipDirs[i] * 100 + chaos, thrust, 1.5 * Random::readF());
+                     -shipDirs[i] * 100 + chaos, thrust, 1.5 * FastRandom::get().readF());
              }
           }
       }
@@ -174,6 +174,7 @@ public:
 
    void writeControlState(BitStream *stream);
    void readControlState(BitStream *stream);
+   bool controlStateMatches(BitStream *serverState, BitStream *predictedState);
 
    U32 packUpdate(GhostConnection *connection, U32 updateMask, BitStream *stream);
    void unpackUpdate(GhostConnection *connection, BitStream *stream);
@@ -45,6 +45,7 @@ TNL_IMPLEMENT_NETOBJECT_RPC(SoccerGameType, s2cSoccerScoreMessage,
    (U32 msgIndex, StringTableEntry clientName, U32 teamIndex), (msgIndex, clientName, teamIndex),
    NetClassGroupGameMask, RPCGuaranteedOrdered, RPCToGhost, 0)
 {
+#ifndef ZAP_DEDICATED
    if(msgIndex == SoccerMsgScoreGoal)
    {
       SFXObject::play(SFXFlagCapture);
@@ -66,6 +67,7 @@ TNL_IMPLEMENT_NETOBJECT_RPC(SoccerGameType, s2cSoccerScoreMessage,
                      clientName.getString(),
                      mTeams.size() > 2 ? "s" : "");
    }
+#endif
 }
 
 void SoccerGameType::addZone(GoalZone *theZone)
@@ -135,10 +137,16 @@ void SoccerBallItem::processArguments(S32 argc, const char **argv)
 }
 
 void SoccerBallItem::onAddedToGame(Game *theGame)
+{
+   if(theGame->getGameType())
+      onGameTypeAdded(theGame->getGameType());
+}
+
+void SoccerBallItem::onGameTypeAdded(GameType *theGameType)
 {
    if(!isGhost())
-      theGame->getGameType()->addItemOfInterest(this);
-   ((SoccerGameType *) theGame->getGameType())->setBall(this);
+      theGameType->addItemOfInterest(this);
+   ((SoccerGameType *) theGameType)->setBall(this);
 }
 
 void SoccerBallItem::renderItem(Point pos)
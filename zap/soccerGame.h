@@ -80,6 +80,7 @@ public:
    void idle(GameObject::IdleCallPath path);
    void processArguments(S32 argc, const char **argv);
    void onAddedToGame(Game *theGame);
+   void onGameTypeAdded(GameType *theGameType);
 
    bool collide(GameObject *hitObject);
 
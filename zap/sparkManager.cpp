@@ -28,6 +28,7 @@
 #include "glutInclude.h"
 #include "teleporter.h"
 #include "gameObjectRender.h"
+#include "tnlDataChunker.h"
 
 using namespace TNL;
 
@@ -76,7 +77,7 @@ void emitSpark(Point pos, Point vel, Color color, F32 ttl)
    s->color = color;
    
    if(!ttl)
-      s->ttl = 15 * Random::readF() * Random::readF();
+      s->ttl = 15 * FastRandom::get().readF() * FastRandom::get().readF();
    else
       s->ttl = ttl;
 }
@@ -90,10 +91,11 @@ struct TeleporterEffect
 };
 
 TeleporterEffect *teleporterEffects = NULL;
+ClassChunker<TeleporterEffect> teleporterEffectChunker(1024);
 
 void emitTeleportInEffect(Point pos, U32 type)
 {
-   TeleporterEffect *e = new TeleporterEffect;
+   TeleporterEffect *e = teleporterEffectChunker.alloc();
    e->pos = pos;
    e->time = 0;
    e->type = type;
@@ -129,7 +131,7 @@ void tick( F32 dT )
       if(temp->time > Teleporter::TeleportInExpandTime)
       {
          *walk = temp->nextEffect;
-         delete temp;
+         teleporterEffectChunker.free(temp);
       }
       else
          walk = &(temp->nextEffect);
@@ -172,27 +174,29 @@ void render(U32 renderPass)
 
 void emitExplosion(Point pos, F32 size, Color *colorArray, U32 numColors)
 {
+   FastRandom &random = FastRandom::get();
    for(U32 i = 0; i < (250.0 * size); i++)
    {
 
-      F32 th = Random::readF() * 2 * 3.14;
-      F32 f = (Random::readF() * 2 - 1) * 400 * size;
-      U32 colorIndex = Random::readI() % numColors;
+      F32 th = random.readF() * 2 * 3.14;
+      F32 f = (random.readF() * 2 - 1) * 400 * size;
+      U32 colorIndex = random.readI() % numColors;
 
-      emitSpark(pos, Point(cos(th)*f, sin(th)*f), colorArray[colorIndex], Random::readF()*size + 2*size);
+      emitSpark(pos, Point(cos(th)*f, sin(th)*f), colorArray[colorIndex], random.readF()*size + 2*size);
    }
 }
 
 void emitBurst(Point pos, Point scale, Color color1, Color color2)
 {
    F32 size = 1;
+   FastRandom &random = FastRandom::get();
 
    for(U32 i = 0; i < (250.0 * size); i++)
    {
 
-      F32 th = Random::readF() * 2 * 3.14;
-      F32 f = (Random::readF() * 0.1 + 0.9) * 200 * size;
-      F32 t = Random::readF();
+      F32 th = random.readF() * 2 * 3.14;
+      F32 f = (random.readF() * 0.1 + 0.9) * 200 * size;
+      F32 t = random.readF();
 
       Color r;
 
@@ -202,7 +206,7 @@ void emitBurst(Point pos, Point scale, Color color1, Color color2)
          pos + Point(cos(th)*scale.x, sin(th)*scale.y),
          Point(cos(th)*scale.x*f, sin(th)*scale.y*f),
          r,
-         Random::readF() * scale.len() * 3 + scale.len()
+         random.readF() * scale.len() * 3 + scale.len()
       );
    }
 }
@@ -88,6 +88,8 @@ ByteBufferPtr VoiceDecoder::decompressBuffer(ByteBufferRef compressedBuffer)
          samplePtr = (S16 *) ret->getBuffer();
       }
       p = decompressFrame(samplePtr + frameCount * spf, inputPtr + i, compressedSize - i);
+      if(!p)
+         break;
       frameCount++;
    }
    ret->resize(frameCount * spf * sizeof(S16));
@@ -144,9 +146,22 @@ U32 LPC10VoiceDecoder::getAvgCompressedFrameSize()
 
 U32 LPC10VoiceDecoder::decompressFrame(S16 *framePtr, U8 *inputPtr, U32 inSize)
 {
-   int p;
-   vbr_lpc10_decode(inputPtr, inSize, framePtr, (lpc10_decoder_state *) decoderState, &p);
-   return (U32) p;
+   // the frame type is in the low 7 bits of the first byte: 127 is a
+   // silence frame, 0 and 126 are unvoiced frames and the rest are voiced.
+   if(!inSize)
+      return 0;
+   U32 frameType = inputPtr[0] & 0x7F;
+   U32 frameSize = LPC10_ENCODED_FRAME_SIZE;
+   if(frameType == 127)
+      frameSize = 1;
+   else if(frameType == 0 || frameType == 126)
+      frameSize = 4;
+   if(inSize < frameSize)
+      return 0;
+
+   int p = 0;
+   vbr_lpc10_decode(inputPtr, frameSize, framePtr, (lpc10_decoder_state *) decoderState, &p);
+   return frameSize;
 }
 
 GSMVoiceEncoder::GSMVoiceEncoder()
@@ -196,6 +211,8 @@ U32 GSMVoiceDecoder::getAvgCompressedFrameSize()
 
 U32 GSMVoiceDecoder::decompressFrame(S16 *framePtr, U8 *inputPtr, U32 inSize)
 {
+   if(inSize < GSM_ENCODED_FRAME_SIZE)
+      return 0;
    gsm_decode((struct gsm_state *) decoderState, inputPtr, framePtr);
    return GSM_ENCODED_FRAME_SIZE;
 }
@@ -42,12 +42,16 @@ namespace Zap
 /// of 16 bit samples at 8KHz and returns a compressed buffer.  The 
 /// original buffer is modified to contain any samples that were not used 
 /// due to unfilled frame sizing.
+///
+/// The frame level functions are public so that the VoicePipeline can
+/// encode into its own preallocated buffers.
 class VoiceEncoder : public TNL::Object
 {
+public:
    virtual U32 getSamplesPerFrame() = 0;
    virtual U32 getMaxCompressedFrameSize() = 0;
    virtual U32 compressFrame(S16 *samplePtr, U8 *outputPtr) = 0;
-public:
+
    ByteBufferPtr compressBuffer(ByteBufferPtr sampleBuffer);
 };
 
@@ -58,11 +62,15 @@ public:
 /// 16 bit sample buffer.
 class VoiceDecoder : public TNL::Object
 {
+public:
    virtual U32 getSamplesPerFrame() = 0;
    virtual U32 getAvgCompressedFrameSize() = 0;
 
+   /// Decodes one frame into framePtr, which must hold getSamplesPerFrame()
+   /// samples.  Returns the number of input bytes used, or 0 if inSize
+   /// doesn't hold a whole frame.
    virtual U32 decompressFrame(S16 *framePtr, U8 *inputPtr, U32 inSize) = 0;
-public:
+
    ByteBufferPtr decompressBuffer(ByteBufferRef compressedBuffer);
 };
 
@@ -0,0 +1,395 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#include "voicePipeline.h"
+#include "sfx.h"
+#include "tnlPlatform.h"
+
+namespace Zap
+{
+
+VoicePipeline *gVoicePipeline = NULL;
+
+// The rings count their heads and tails up forever and mask them on
+// access, so head - tail is always the amount in use.  Callers hold the
+// pipeline lock.
+template <class T> static U32 writeRing(T *ring, U32 ringSize, U32 &head, U32 tail, const T *data, U32 count)
+{
+   U32 space = ringSize - (head - tail);
+   if(count > space)
+      count = space;
+   for(U32 i = 0; i < count; i++)
+      ring[(head + i) & (ringSize - 1)] = data[i];
+   head += count;
+   return count;
+}
+
+template <class T> static U32 readRing(const T *ring, U32 ringSize, U32 head, U32 &tail, T *data, U32 count)
+{
+   U32 available = head - tail;
+   if(count > available)
+      count = available;
+   for(U32 i = 0; i < count; i++)
+      data[i] = ring[(tail + i) & (ringSize - 1)];
+   tail += count;
+   return count;
+}
+
+VoicePipeline::Channel::Channel(VoiceDecoder *theDecoder)
+{
+   decoder = theDecoder;
+   packetHead = packetTail = 0;
+   sampleHead = sampleTail = 0;
+   playing = false;
+   lastPacketTime = 0;
+   playEndTime = 0;
+   ranDry = false;
+   dryTime = 0;
+   nextChunk = 0;
+
+   // the chunk buffers don't own their memory, so handing one to the
+   // sound system never allocates.
+   for(U32 i = 0; i < PlayChunkCount; i++)
+      chunkBuffers[i] = new ByteBuffer((U8 *) chunkData[i], sizeof(chunkData[i]));
+}
+
+VoicePipeline::VoicePipeline() : mWake(0, 0x7FFFFFFF)
+{
+   mRunning = false;
+   mShuttingDown = false;
+   mEncoder = new LPC10VoiceEncoder;
+   mCaptureHead = mCaptureTail = 0;
+   mEncodedHead = mEncodedTail = 0;
+   memset(&mStats, 0, sizeof(mStats));
+}
+
+VoicePipeline::~VoicePipeline()
+{
+   shutdown();
+   for(S32 i = 0; i < mChannels.size(); i++)
+      delete mChannels[i];
+}
+
+void VoicePipeline::startup()
+{
+   if(mRunning)
+      return;
+   mRunning = true;
+   start();
+}
+
+void VoicePipeline::shutdown()
+{
+   if(!mRunning)
+      return;
+   mLock.lock();
+   mShuttingDown = true;
+   mLock.unlock();
+   mWake.increment();
+   mStopped.wait();
+   mRunning = false;
+}
+
+U32 VoicePipeline::run()
+{
+   for(;;)
+   {
+      mWake.wait();
+
+      mLock.lock();
+      bool quit = mShuttingDown;
+      mLock.unlock();
+      if(quit)
+         break;
+
+      mWorkLock.lock();
+      encodePending();
+      decodePending();
+      mWorkLock.unlock();
+   }
+   mStopped.increment();
+   return 0;
+}
+
+void VoicePipeline::decodePending()
+{
+   U8 packet[MaxPacketSize];
+   S16 frame[MaxFrameSamples];
+
+   // take one packet at a time from each channel in turn, so a burst from
+   // one talker doesn't hold up everyone else.
+   bool decodedAny = true;
+   while(decodedAny)
+   {
+      decodedAny = false;
+      for(S32 i = 0; ; i++)
+      {
+         mLock.lock();
+         if(i >= mChannels.size())
+         {
+            mLock.unlock();
+            break;
+         }
+         Channel *channel = mChannels[i];
+         if(channel->packetHead == channel->packetTail)
+         {
+            mLock.unlock();
+            continue;
+         }
+         Channel::Packet &p = channel->packets[channel->packetTail & (PacketRingSize - 1)];
+         U32 size = p.size;
+         memcpy(packet, p.data, size);
+         channel->packetTail++;
+         mLock.unlock();
+
+         decodedAny = true;
+
+         // the channel can't be destroyed while we hold the work lock, and
+         // only this thread uses its decoder.
+         VoiceDecoder *decoder = channel->decoder;
+         U32 spf = decoder->getSamplesPerFrame();
+         U32 dropped = 0;
+         for(U32 offset = 0; offset < size; )
+         {
+            U32 used = decoder->decompressFrame(frame, packet + offset, size - offset);
+            if(!used)
+               break;
+            offset += used;
+
+            mLock.lock();
+            dropped += spf - writeRing(channel->samples, U32(SampleRingSize), channel->sampleHead, channel->sampleTail, frame, spf);
+            mLock.unlock();
+         }
+
+         mLock.lock();
+         mStats.packetsDecoded++;
+         mStats.samplesDropped += dropped;
+         mLock.unlock();
+      }
+   }
+}
+
+void VoicePipeline::encodePending()
+{
+   S16 frame[MaxFrameSamples];
+   U8 encoded[MaxFrameBytes];
+   U32 spf = mEncoder->getSamplesPerFrame();
+
+   for(;;)
+   {
+      mLock.lock();
+      if(mCaptureHead - mCaptureTail < spf || EncodedRingSize - (mEncodedHead - mEncodedTail) < MaxFrameBytes)
+      {
+         mLock.unlock();
+         break;
+      }
+      readRing(mCapture, U32(CaptureRingSize), mCaptureHead, mCaptureTail, frame, spf);
+      mLock.unlock();
+
+      U32 len = mEncoder->compressFrame(frame, encoded);
+
+      mLock.lock();
+      writeRing(mEncoded, U32(EncodedRingSize), mEncodedHead, mEncodedTail, encoded, len);
+      mStats.framesEncoded++;
+      mLock.unlock();
+   }
+}
+
+VoicePipeline::Channel *VoicePipeline::createChannel(VoiceDecoder *decoder)
+{
+   TNLAssert(decoder->getSamplesPerFrame() <= MaxFrameSamples, "Voice decoder frames are too big.");
+   Channel *channel = new Channel(decoder);
+   mLock.lock();
+   mChannels.push_back(channel);
+   mLock.unlock();
+   return channel;
+}
+
+void VoicePipeline::destroyChannel(Channel *channel)
+{
+   mLock.lock();
+   for(S32 i = 0; i < mChannels.size(); i++)
+   {
+      if(mChannels[i] == channel)
+      {
+         mChannels.erase_fast(i);
+         break;
+      }
+   }
+   mLock.unlock();
+
+   // wait for the worker to finish with the channel if it's decoding it.
+   mWorkLock.lock();
+   mWorkLock.unlock();
+   delete channel;
+}
+
+void VoicePipeline::queuePacket(Channel *channel, const U8 *data, U32 size)
+{
+   U32 time = Platform::getRealMilliseconds();
+   channel->lastPacketTime = time;
+
+   mLock.lock();
+   if(channel->ranDry)
+   {
+      // a packet this soon after running dry was late, not the start of a
+      // new talk spurt.
+      if(time - channel->dryTime < TalkSpurtTimeout)
+         mStats.underruns++;
+      channel->ranDry = false;
+   }
+   if(!size || size > MaxPacketSize || mShuttingDown ||
+         channel->packetHead - channel->packetTail == PacketRingSize)
+   {
+      mStats.packetsDropped++;
+      mLock.unlock();
+      return;
+   }
+   Channel::Packet &p = channel->packets[channel->packetHead & (PacketRingSize - 1)];
+   p.size = size;
+   memcpy(p.data, data, size);
+   channel->packetHead++;
+   mLock.unlock();
+
+   mWake.increment();
+}
+
+void VoicePipeline::queueChunk(Channel *channel, SFXObject *sfx, U32 count)
+{
+   U32 index = channel->nextChunk++ & (PlayChunkCount - 1);
+   S16 *chunk = channel->chunkData[index];
+
+   mLock.lock();
+   count = readRing(channel->samples, U32(SampleRingSize), channel->sampleHead, channel->sampleTail, chunk, count);
+   mLock.unlock();
+
+   // the sound system copies the samples out when they're queued, or
+   // when the sound starts; either happens before this chunk comes
+   // round again.
+   ByteBuffer *buffer = channel->chunkBuffers[index];
+   buffer->setBuffer((U8 *) chunk, count * sizeof(S16));
+   sfx->queueBuffer(buffer);
+
+   U32 time = Platform::getRealMilliseconds();
+   if(S32(channel->playEndTime - time) < 0)
+      channel->playEndTime = time;
+   channel->playEndTime += count * 1000 / SampleRate;
+}
+
+void VoicePipeline::play(Channel *channel, SFXObject *sfx)
+{
+   U32 time = Platform::getRealMilliseconds();
+
+   mLock.lock();
+   U32 available = channel->sampleHead - channel->sampleTail;
+   bool pending = channel->packetHead != channel->packetTail;
+   mLock.unlock();
+
+   if(!channel->playing)
+   {
+      // hold the start of a talk spurt back until enough is buffered to
+      // ride out late packets, or the talker has stopped.
+      bool spurtOver = !pending && time - channel->lastPacketTime > TalkSpurtTimeout;
+      if(available < JitterDelay && !(available && spurtOver))
+         return;
+      channel->playing = true;
+      channel->playEndTime = time;
+   }
+
+   while(available >= PlayChunkSamples && S32(channel->playEndTime - time) < MaxPlayAhead)
+   {
+      queueChunk(channel, sfx, PlayChunkSamples);
+      available -= PlayChunkSamples;
+   }
+
+   if(S32(channel->playEndTime - time) < PlayLowWater)
+   {
+      // about to run out; play what's left rather than leave a gap, and
+      // if there's nothing left, buffer up again.
+      if(available)
+         queueChunk(channel, sfx, available);
+      else
+      {
+         channel->playing = false;
+         channel->ranDry = true;
+         channel->dryTime = time;
+      }
+   }
+}
+
+void VoicePipeline::resetCapture()
+{
+   mWorkLock.lock();
+   mLock.lock();
+   mCaptureTail = mCaptureHead;
+   mEncodedTail = mEncodedHead;
+   mLock.unlock();
+   mWorkLock.unlock();
+}
+
+void VoicePipeline::queueCapture(const S16 *samples, U32 count)
+{
+   mLock.lock();
+   if(mShuttingDown)
+   {
+      mLock.unlock();
+      return;
+   }
+   mStats.samplesDropped += count - writeRing(mCapture, U32(CaptureRingSize), mCaptureHead, mCaptureTail, samples, count);
+   mLock.unlock();
+
+   mWake.increment();
+}
+
+ByteBufferPtr VoicePipeline::readEncoded()
+{
+   mLock.lock();
+   U32 count = mEncodedHead - mEncodedTail;
+   mLock.unlock();
+   if(!count)
+      return NULL;
+
+   // only this thread takes data out, so at least count bytes are still
+   // there.
+   ByteBufferPtr ret = new ByteBuffer(count);
+   mLock.lock();
+   readRing(mEncoded, U32(EncodedRingSize), mEncodedHead, mEncodedTail, ret->getBuffer(), count);
+   mLock.unlock();
+
+   // the worker stops encoding when the ring fills, so let it carry on.
+   mWake.increment();
+   return ret;
+}
+
+VoicePipeline::Stats VoicePipeline::getStats()
+{
+   mLock.lock();
+   Stats stats = mStats;
+   mLock.unlock();
+   return stats;
+}
+
+};
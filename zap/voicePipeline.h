@@ -0,0 +1,185 @@
+//-----------------------------------------------------------------------------------
+//
+//   Torque Network Library - ZAP example multiplayer vector graphics space game
+//   Copyright (C) 2004 GarageGames.com, Inc.
+//   For more information see http://www.opentnl.org
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   For use in products that are not compatible with the terms of the GNU
+//   General Public License, alternative licensing options are available
+//   from GarageGames.com.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//------------------------------------------------------------------------------------
+
+#ifndef _VOICEPIPELINE_H_
+#define _VOICEPIPELINE_H_
+
+#include "tnlThread.h"
+#include "tnlVector.h"
+#include "voiceCodec.h"
+
+using namespace TNL;
+
+namespace Zap
+{
+
+class SFXObject;
+
+/// VoicePipeline runs the client's voice codecs on a worker thread, so
+/// that encoding the local player's speech and decoding everyone else's
+/// never stalls the game loop.
+///
+/// Each remote talker has a Channel holding a ring of compressed packets
+/// waiting to be decoded and a ring of decoded samples waiting to be
+/// played.  The game thread copies received packets in with
+/// queuePacket(), and play() feeds the decoded samples to the talker's
+/// SFXObject in fixed size chunks once a talk spurt has buffered
+/// JitterDelay samples, which smooths over uneven packet arrival.
+///
+/// Captured samples go in through queueCapture() and come back out as
+/// compressed packets from readEncoded().
+///
+/// All the buffers are allocated up front; the rings are protected by a
+/// single mutex that is only held while copying, never while a codec runs.
+class VoicePipeline : public Thread
+{
+public:
+   enum {
+      MaxPacketSize = 512,          ///< Largest compressed packet accepted, in bytes.
+      PacketRingSize = 16,          ///< Compressed packets queued per channel.
+      SampleRingSize = 8192,        ///< Decoded samples buffered per channel (about one second).
+      CaptureRingSize = 8192,       ///< Captured samples waiting to be encoded.
+      EncodedRingSize = 2048,       ///< Encoded bytes waiting to be sent.
+      MaxFrameSamples = 256,        ///< Largest codec frame, in samples.
+      MaxFrameBytes = 64,           ///< Largest compressed codec frame, in bytes.
+      JitterDelay = 1200,           ///< Samples buffered before a talk spurt starts playing (150 ms).
+      PlayChunkSamples = 800,       ///< Samples handed to the sound system at a time (100 ms).
+      PlayChunkCount = 4,           ///< Chunk buffers cycled through by each channel.
+      MaxPlayAhead = 300,           ///< Most milliseconds of samples queued in the sound system.
+      PlayLowWater = 40,            ///< Milliseconds left queued when a partial chunk is sent.
+      TalkSpurtTimeout = 300,       ///< Milliseconds without packets that end a talk spurt.
+      SampleRate = 8000,
+   };
+
+   /// The decoding state for one remote talker.
+   struct Channel
+   {
+      struct Packet
+      {
+         U32 size;
+         U8 data[MaxPacketSize];
+      };
+
+      RefPtr<VoiceDecoder> decoder;
+
+      Packet packets[PacketRingSize];
+      U32 packetHead, packetTail;
+
+      S16 samples[SampleRingSize];
+      U32 sampleHead, sampleTail;
+
+      bool playing;
+      U32 lastPacketTime;
+      U32 playEndTime;     ///< When the sound system will run out of queued samples.
+      bool ranDry;         ///< Playback ran out of samples at dryTime.
+      U32 dryTime;
+
+      S16 chunkData[PlayChunkCount][PlayChunkSamples];
+      ByteBufferPtr chunkBuffers[PlayChunkCount];
+      U32 nextChunk;
+
+      Channel(VoiceDecoder *theDecoder);
+   };
+
+   /// Counters for tuning, never reset.
+   struct Stats
+   {
+      U32 packetsDecoded;
+      U32 packetsDropped;   ///< Packets that arrived with their channel's ring full, or were too big.
+      U32 samplesDropped;   ///< Decoded or captured samples that didn't fit their ring.
+      U32 underruns;        ///< Times playback ran dry with more of the talk spurt still to come.
+      U32 framesEncoded;
+   };
+
+private:
+   Mutex mLock;            ///< Protects the rings, the channel list and the stats.
+   Mutex mWorkLock;        ///< Held by the worker while it uses a channel or the encoder.
+   Semaphore mWake;
+   Semaphore mStopped;
+   bool mRunning;
+   bool mShuttingDown;
+
+   Vector<Channel *> mChannels;
+
+   RefPtr<VoiceEncoder> mEncoder;
+   S16 mCapture[CaptureRingSize];
+   U32 mCaptureHead, mCaptureTail;
+   U8 mEncoded[EncodedRingSize];
+   U32 mEncodedHead, mEncodedTail;
+
+   Stats mStats;
+
+   void decodePending();
+   void encodePending();
+   void queueChunk(Channel *channel, SFXObject *sfx, U32 count);
+public:
+   VoicePipeline();
+   ~VoicePipeline();
+
+   U32 run();
+
+   /// Starts the worker thread.
+   void startup();
+
+   /// Lets the worker finish what it's doing and waits for it to exit.
+   /// Packets and samples queued afterwards are dropped.
+   void shutdown();
+
+   /// Creates a channel decoding with the given decoder.
+   Channel *createChannel(VoiceDecoder *decoder);
+
+   /// Removes a channel, waiting for the worker to finish with it first.
+   void destroyChannel(Channel *channel);
+
+   /// Copies a received compressed packet into the channel's ring and wakes
+   /// the worker to decode it.
+   void queuePacket(Channel *channel, const U8 *data, U32 size);
+
+   /// Hands decoded samples to the channel's sound object, holding the
+   /// start of each talk spurt back until enough has been buffered.
+   void play(Channel *channel, SFXObject *sfx);
+
+   /// Throws away any captured samples and encoded data from an earlier
+   /// recording.
+   void resetCapture();
+
+   /// Copies captured samples in to be encoded.
+   void queueCapture(const S16 *samples, U32 count);
+
+   /// Returns everything encoded since the last call, or NULL if there's
+   /// nothing new.
+   ByteBufferPtr readEncoded();
+
+   Stats getStats();
+};
+
+/// The client's voice pipeline, or NULL if voice is disabled, as it is
+/// for the dedicated server and its bots.
+extern VoicePipeline *gVoicePipeline;
+
+};
+
+#endif